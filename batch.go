@@ -0,0 +1,258 @@
+// Package main provides batched tab creation and deletion.
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"net/http"
+	"runtime"
+	"sync"
+	"time"
+)
+
+const (
+	// maxBatchOps is the maximum number of operations in one batch request.
+	maxBatchOps = 10000
+	// maxBatchWorkers caps concurrent file reads and diffs within a batch.
+	maxBatchWorkers = 16
+)
+
+// Batch operation names.
+const (
+	BatchOpCreate = "create" // Create or update a tab (the default)
+	BatchOpDelete = "delete" // Delete the tab with the given id
+)
+
+// BatchRequest is the request body for POST /api/tabs/batch.
+type BatchRequest struct {
+	Ops []BatchRequestOp `json:"ops"`
+}
+
+// BatchRequestOp is one operation in a batch request. Create operations
+// take the same fields as POST /api/tabs; delete operations only need id.
+type BatchRequestOp struct {
+	Op string `json:"op,omitempty"`
+	CreateTabRequest
+}
+
+// BatchResponse is the response for a batch request, with one result per
+// operation in request order.
+type BatchResponse struct {
+	Results []BatchOpResponse `json:"results"`
+}
+
+// BatchOpResponse is the result of one batch operation.
+type BatchOpResponse struct {
+	Op      string `json:"op"`
+	ID      string `json:"id"`
+	Title   string `json:"title,omitempty"`
+	Type    string `json:"type,omitempty"`
+	Created bool   `json:"created,omitempty"` // create: tab was new rather than updated
+	Deleted bool   `json:"deleted,omitempty"` // delete: tab existed and was removed
+}
+
+// BatchOp is one state operation in a batch: a tab to create or update, or
+// the ID of a tab to delete.
+type BatchOp struct {
+	Tab      *Tab
+	DeleteID string
+}
+
+// BatchOpResult is the outcome of one BatchOp.
+type BatchOpResult struct {
+	ID      string
+	Created bool
+	Deleted bool
+}
+
+// BatchResult is the outcome of ApplyBatch.
+type BatchResult struct {
+	Ops     []BatchOpResult
+	Tabs    []*Tab   // Open tabs created or updated by the batch, in tab order, with content
+	Deleted []string // Tabs deleted by the batch, including any re-created later in it
+}
+
+// ApplyBatch applies creates and deletes in order as a single state
+// transition: readers see either none or all of them, the list generation
+// advances once and the journal records them as one entry.
+func (s *State) ApplyBatch(ops []BatchOp) *BatchResult {
+	defer s.writePendingBlobs()
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	now := time.Now()
+	result := &BatchResult{Ops: make([]BatchOpResult, len(ops))}
+	touched := make(map[string]bool)
+	deleted := make(map[string]bool)
+	var records []journalRecord
+
+	for i, op := range ops {
+		if op.Tab == nil {
+			if !s.deleteTabLocked(op.DeleteID) {
+				result.Ops[i] = BatchOpResult{ID: op.DeleteID}
+				continue
+			}
+			result.Ops[i] = BatchOpResult{ID: op.DeleteID, Deleted: true}
+			if !deleted[op.DeleteID] {
+				deleted[op.DeleteID] = true
+				result.Deleted = append(result.Deleted, op.DeleteID)
+			}
+			records = append(records, journalRecord{Op: journalDelete, ID: op.DeleteID})
+			continue
+		}
+
+		stored, created := s.createTabLocked(op.Tab, now)
+		result.Ops[i] = BatchOpResult{ID: stored.ID, Created: created}
+		touched[stored.ID] = true
+		if rec, ok := s.putRecordLocked(stored); ok {
+			records = append(records, rec)
+		}
+	}
+
+	for _, id := range s.order.IDs() {
+		if touched[id] {
+			result.Tabs = append(result.Tabs, s.viewLocked(s.tabs[id]))
+		}
+	}
+
+	if len(records) > 0 || len(result.Deleted) > 0 || len(result.Tabs) > 0 {
+		s.commitLocked(journalRecord{Op: journalBatch, Batch: records})
+	}
+	return result
+}
+
+// handleBatchTabs handles POST /api/tabs/batch.
+// All create operations are validated and their files read or diffed in
+// parallel before any state changes; if one fails, nothing is applied.
+// The whole batch is announced with a single tabs_batch message.
+func (s *Server) handleBatchTabs(w http.ResponseWriter, r *http.Request) {
+	var req BatchRequest
+	if err := json.NewDecoder(r.Body).Decode(&req); err != nil {
+		writeError(w, http.StatusBadRequest, "Invalid JSON")
+		return
+	}
+	if len(req.Ops) == 0 {
+		writeError(w, http.StatusBadRequest, "Batch requires at least one op")
+		return
+	}
+	if len(req.Ops) > maxBatchOps {
+		writeError(w, http.StatusBadRequest, fmt.Sprintf("Batch exceeds %d ops", maxBatchOps))
+		return
+	}
+
+	ops, err := buildBatch(req.Ops)
+	if err != nil {
+		writeError(w, http.StatusBadRequest, err.Error())
+		return
+	}
+
+	// Read followed files' tails, which needs the server's tail window
+	tails := make(map[string]*tailState)
+	for _, op := range ops {
+		if op.Tab != nil && op.Tab.Follow {
+			tail, err := s.follow.openTail(op.Tab)
+			if err != nil {
+				writeError(w, http.StatusBadRequest, "Cannot read file: "+err.Error())
+				return
+			}
+			tails[op.Tab.ID] = tail
+		}
+	}
+
+	// Stop watching deleted tabs before they go, as handleDeleteTab does
+	for _, op := range ops {
+		if op.Tab == nil {
+			s.stopWatching(op.DeleteID)
+		}
+	}
+
+	result := s.state.ApplyBatch(ops)
+
+	// Register files for watching
+	for _, tab := range result.Tabs {
+		if tab.Follow {
+			s.follow.track(tab.ID, tails[tab.ID])
+		} else {
+			s.follow.untrack(tab.ID)
+		}
+		if s.fileWatcher != nil && tab.SourcePath != "" {
+			_ = s.fileWatcher.Add(tab.SourcePath, tab.ID) // Watching is optional
+		}
+	}
+
+	s.hub.Broadcast(WSMessage{Type: "tabs_batch", Tabs: result.Tabs, IDs: result.Deleted})
+
+	resp := BatchResponse{Results: make([]BatchOpResponse, len(ops))}
+	for i, op := range ops {
+		res := result.Ops[i]
+		if op.Tab == nil {
+			resp.Results[i] = BatchOpResponse{Op: BatchOpDelete, ID: res.ID, Deleted: res.Deleted}
+			continue
+		}
+		resp.Results[i] = BatchOpResponse{
+			Op:      BatchOpCreate,
+			ID:      res.ID,
+			Title:   op.Tab.Title,
+			Type:    string(op.Tab.Type),
+			Created: res.Created,
+		}
+	}
+	writeJSON(w, http.StatusOK, resp)
+}
+
+// buildBatch validates batch operations and builds their tabs, running
+// file reads and diffs on a bounded pool of workers. Errors name the
+// index of the first failing operation.
+func buildBatch(reqs []BatchRequestOp) ([]BatchOp, error) {
+	ops := make([]BatchOp, len(reqs))
+	errs := make([]error, len(reqs))
+
+	var creates []int
+	for i := range reqs {
+		switch reqs[i].Op {
+		case "", BatchOpCreate:
+			creates = append(creates, i)
+		case BatchOpDelete:
+			if reqs[i].ID == "" {
+				return nil, fmt.Errorf("ops[%d]: Delete requires 'id'", i)
+			}
+			ops[i] = BatchOp{DeleteID: reqs[i].ID}
+		default:
+			return nil, fmt.Errorf("ops[%d]: Invalid op: must be 'create' or 'delete'", i)
+		}
+	}
+
+	parallelFor(len(creates), maxBatchWorkers, func(j int) {
+		i := creates[j]
+		ops[i].Tab, errs[i] = buildTab(&reqs[i].CreateTabRequest)
+	})
+
+	for _, i := range creates {
+		if errs[i] != nil {
+			return nil, fmt.Errorf("ops[%d]: %v", i, errs[i])
+		}
+	}
+	return ops, nil
+}
+
+// parallelFor calls fn(i) for each i in [0, n) on at most workers
+// goroutines (and no more than GOMAXPROCS), returning when all are done.
+func parallelFor(n, workers int, fn func(i int)) {
+	workers = min(min(n, runtime.GOMAXPROCS(0)), workers)
+	jobs := make(chan int)
+	var wg sync.WaitGroup
+	for w := 0; w < workers; w++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for i := range jobs {
+				fn(i)
+			}
+		}()
+	}
+	for i := 0; i < n; i++ {
+		jobs <- i
+	}
+	close(jobs)
+	wg.Wait()
+}
@@ -0,0 +1,199 @@
+package main
+
+import (
+	"bytes"
+	"encoding/json"
+	"fmt"
+	"net/http"
+	"net/http/httptest"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+)
+
+// postBatch sends a batch request and returns the recorder.
+func postBatch(srv *Server, body string) *httptest.ResponseRecorder {
+	req := httptest.NewRequest("POST", "/api/tabs/batch", strings.NewReader(body))
+	w := httptest.NewRecorder()
+	srv.handleBatchTabs(w, req)
+	return w
+}
+
+// TestBatchTabs_CreatesAndDeletes tests mixed operations with one broadcast.
+func TestBatchTabs_CreatesAndDeletes(t *testing.T) {
+	srv := setupTestServer()
+	srv.state.CreateTab(&Tab{ID: "old", Title: "Old", Content: "old"})
+	srv.state.CreateTab(&Tab{ID: "keep", Title: "Keep", Content: "keep"})
+
+	client := &Client{hub: srv.hub, send: make(chan []byte, 16)}
+	srv.hub.register <- client
+
+	w := postBatch(srv, `{"ops": [
+		{"id": "a", "title": "A", "type": "markdown", "content": "# A"},
+		{"op": "delete", "id": "old"},
+		{"op": "create", "id": "keep", "title": "Kept", "type": "code", "content": "x := 1"},
+		{"op": "delete", "id": "missing"}
+	]}`)
+
+	if w.Code != http.StatusOK {
+		t.Fatalf("expected status 200, got %d: %s", w.Code, w.Body.String())
+	}
+
+	var resp BatchResponse
+	if err := json.Unmarshal(w.Body.Bytes(), &resp); err != nil {
+		t.Fatalf("failed to parse response: %v", err)
+	}
+	want := []BatchOpResponse{
+		{Op: BatchOpCreate, ID: "a", Title: "A", Type: "markdown", Created: true},
+		{Op: BatchOpDelete, ID: "old", Deleted: true},
+		{Op: BatchOpCreate, ID: "keep", Title: "Kept", Type: "code"},
+		{Op: BatchOpDelete, ID: "missing"},
+	}
+	if len(resp.Results) != len(want) {
+		t.Fatalf("expected %d results, got %d", len(want), len(resp.Results))
+	}
+	for i := range want {
+		if resp.Results[i] != want[i] {
+			t.Errorf("result %d: expected %+v, got %+v", i, want[i], resp.Results[i])
+		}
+	}
+
+	var ids []string
+	for _, tab := range srv.state.ListTabs() {
+		ids = append(ids, tab.ID)
+	}
+	if got := strings.Join(ids, ","); got != "keep,a" {
+		t.Errorf("expected tabs keep,a, got %s", got)
+	}
+
+	time.Sleep(20 * time.Millisecond)
+	if len(client.send) != 1 {
+		t.Fatalf("expected exactly 1 broadcast, got %d", len(client.send))
+	}
+	var msg WSMessage
+	json.Unmarshal(<-client.send, &msg)
+	if msg.Type != "tabs_batch" {
+		t.Errorf("expected tabs_batch message, got %s", msg.Type)
+	}
+	if len(msg.Tabs) != 2 || msg.Tabs[0].ID != "keep" || msg.Tabs[1].ID != "a" || msg.Tabs[1].Content != "# A" {
+		t.Errorf("expected tabs keep,a with content in tab order, got %+v", msg.Tabs)
+	}
+	if len(msg.IDs) != 1 || msg.IDs[0] != "old" {
+		t.Errorf("expected deleted ids [old], got %v", msg.IDs)
+	}
+}
+
+// TestBatchTabs_ReadsFiles tests file reads and diffs within a batch.
+func TestBatchTabs_ReadsFiles(t *testing.T) {
+	srv := setupTestServer()
+	dir := t.TempDir()
+
+	var ops []string
+	for i := 0; i < 50; i++ {
+		path := filepath.Join(dir, fmt.Sprintf("file%d.go", i))
+		os.WriteFile(path, []byte(fmt.Sprintf("package f%d\n", i)), 0644)
+		ops = append(ops, fmt.Sprintf(`{"id": "f%d", "file": %q}`, i, path))
+	}
+	left := filepath.Join(dir, "file0.go")
+	right := filepath.Join(dir, "file1.go")
+	ops = append(ops, fmt.Sprintf(`{"id": "d", "type": "diff", "diff": {"left": %q, "right": %q}}`, left, right))
+
+	w := postBatch(srv, `{"ops": [`+strings.Join(ops, ",")+`]}`)
+	if w.Code != http.StatusOK {
+		t.Fatalf("expected status 200, got %d: %s", w.Code, w.Body.String())
+	}
+
+	tab, _ := srv.state.GetTab("f42")
+	if tab.Content != "package f42\n" || tab.Type != TabTypeCode || tab.Language != "go" {
+		t.Errorf("unexpected file tab: %+v", tab)
+	}
+	diff, _ := srv.state.GetTab("d")
+	if !strings.Contains(diff.Content, "-package f0") || !strings.Contains(diff.Content, "+package f1") {
+		t.Errorf("expected computed diff, got %q", diff.Content)
+	}
+}
+
+// TestBatchTabs_AllOrNothing tests that a failing op leaves state untouched.
+func TestBatchTabs_AllOrNothing(t *testing.T) {
+	srv := setupTestServer()
+	srv.state.CreateTab(&Tab{ID: "existing", Content: "x"})
+	etag := srv.state.ListETag()
+
+	w := postBatch(srv, `{"ops": [
+		{"id": "a", "content": "a"},
+		{"op": "delete", "id": "existing"},
+		{"id": "b", "file": "/nonexistent/file.md"}
+	]}`)
+
+	if w.Code != http.StatusBadRequest {
+		t.Fatalf("expected status 400, got %d", w.Code)
+	}
+	if !strings.Contains(w.Body.String(), "ops[2]") {
+		t.Errorf("expected error to name the failing op, got %s", w.Body.String())
+	}
+	if srv.state.TabCount() != 1 || srv.state.ListETag() != etag {
+		t.Error("expected no changes after a failed batch")
+	}
+}
+
+// TestBatchTabs_InvalidRequests tests request validation.
+func TestBatchTabs_InvalidRequests(t *testing.T) {
+	tests := []struct {
+		name string
+		body string
+	}{
+		{"invalid json", `{"ops": [`},
+		{"empty", `{"ops": []}`},
+		{"unknown op", `{"ops": [{"op": "rename", "id": "a"}]}`},
+		{"delete without id", `{"ops": [{"op": "delete"}]}`},
+		{"invalid type", `{"ops": [{"type": "video", "content": "x"}]}`},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			w := postBatch(setupTestServer(), tt.body)
+			if w.Code != http.StatusBadRequest {
+				t.Errorf("expected status 400, got %d", w.Code)
+			}
+		})
+	}
+}
+
+// TestApplyBatch_SingleTransition tests that a batch is one generation and one journal entry.
+func TestApplyBatch_SingleTransition(t *testing.T) {
+	dir := t.TempDir()
+	state := openPersistentState(t, dir)
+	state.CreateTab(&Tab{ID: "gone", Content: "bye"})
+
+	before := state.generation
+	state.ApplyBatch([]BatchOp{
+		{Tab: &Tab{ID: "a", Content: "first"}},
+		{Tab: &Tab{ID: "b", Content: "second"}},
+		{DeleteID: "gone"},
+		{Tab: &Tab{ID: "a", Content: "updated"}},
+	})
+	if state.generation != before+1 {
+		t.Errorf("expected generation to advance once, went from %d to %d", before, state.generation)
+	}
+
+	journal, _ := os.ReadFile(state.persist.journalPath)
+	if lines := bytes.Count(journal, []byte("\n")); lines != 2 {
+		t.Errorf("expected 2 journal lines (create + batch), got %d", lines)
+	}
+	crash(state)
+
+	restored := openPersistentState(t, dir)
+	defer restored.Close()
+	a, _ := restored.GetTab("a")
+	if a == nil || a.Content != "updated" || a.Version != 2 {
+		t.Errorf("expected replayed tab a at version 2, got %+v", a)
+	}
+	if _, exists := restored.GetTab("gone"); exists {
+		t.Error("expected deleted tab to stay deleted")
+	}
+	if restored.TabCount() != 2 {
+		t.Errorf("expected 2 tabs, got %d", restored.TabCount())
+	}
+}
@@ -0,0 +1,503 @@
+// Package main provides content-addressed storage for tab content.
+package main
+
+import (
+	"compress/gzip"
+	"crypto/sha256"
+	"encoding"
+	"encoding/hex"
+	"errors"
+	"fmt"
+	"hash"
+	"io"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"sync/atomic"
+)
+
+// BlobHash is the SHA-256 digest that identifies a blob.
+type BlobHash [sha256.Size]byte
+
+// String returns the hex encoding of the hash.
+func (h BlobHash) String() string {
+	return hex.EncodeToString(h[:])
+}
+
+// Blob is an immutable, reference-counted piece of tab content.
+// Tabs holding identical content share a single Blob. Content may be
+// spilled to disk under memory pressure; read it with BlobStore.Load.
+type Blob struct {
+	hash  BlobHash
+	size  int64
+	state []byte // Marshaled SHA-256 state after data; lets Append hash only the suffix
+
+	// Guarded by the owning BlobStore's mutex
+	data      string
+	refs      int
+	spillPath string           // Compressed copy on disk, once spilled
+	spilled   bool             // True while data is not resident
+	keepFile  bool             // spillPath belongs to a persistent state dir; never removed here
+	buf       *strings.Builder // Append buffer whose contents begin with data; nil if unshared
+}
+
+// Hash returns the content hash of the blob.
+func (b *Blob) Hash() BlobHash {
+	return b.hash
+}
+
+// Size returns the content length in bytes. A nil blob has size 0.
+func (b *Blob) Size() int64 {
+	if b == nil {
+		return 0
+	}
+	return b.size
+}
+
+// BlobStats reports deduplication and residency of a BlobStore.
+type BlobStats struct {
+	Blobs         int   `json:"blobs"`         // Unique blobs held
+	References    int   `json:"references"`    // Total references across all holders
+	LogicalBytes  int64 `json:"logicalBytes"`  // Bytes as seen by holders (size * refs)
+	PhysicalBytes int64 `json:"physicalBytes"` // Bytes of unique content, resident or spilled
+	ResidentBytes int64 `json:"residentBytes"` // Bytes of unique content held in memory
+	Spills        int64 `json:"spills"`        // Blobs written out to disk
+	Loads         int64 `json:"loads"`         // Spilled blobs read back into memory
+}
+
+// BlobStore is a content-addressed store for tab content.
+// Content is keyed by hash and shared by reference; a blob is dropped once
+// its last reference is released. It is safe for concurrent use.
+type BlobStore struct {
+	mu       sync.Mutex
+	blobs    map[BlobHash]*Blob
+	refs     int
+	logical  int64
+	physical int64
+	resident int64
+	spills   int64
+	loads    int64
+	spillDir string // Created on first spill
+
+	// grown counts increases of resident bytes; read without the lock
+	grown atomic.Int64
+}
+
+// NewBlobStore creates an empty BlobStore.
+func NewBlobStore() *BlobStore {
+	return &BlobStore{
+		blobs: make(map[BlobHash]*Blob),
+	}
+}
+
+// Put interns content and returns a referenced blob for it.
+// If identical content is already stored, the existing blob is returned and
+// the caller's copy can be garbage collected. Empty content returns nil.
+func (bs *BlobStore) Put(content string) *Blob {
+	if content == "" {
+		return nil
+	}
+
+	h := sha256.New()
+	hashString(h, content)
+	return bs.intern(h, content)
+}
+
+// Append returns a referenced blob for base's content followed by suffix.
+// The hash is resumed from base's saved state, so only suffix is hashed,
+// and the content is written into a buffer with spare capacity shared along
+// the chain of appends, so only suffix is copied; this keeps streaming
+// appends to large documents cheap. base is not released.
+func (bs *BlobStore) Append(base *Blob, suffix string) *Blob {
+	prefix, err := bs.Load(base)
+	if err != nil || base == nil || base.state == nil {
+		return bs.Put(prefix + suffix)
+	}
+	if suffix == "" {
+		bs.Retain(base)
+		return base
+	}
+
+	h := sha256.New()
+	if err := h.(encoding.BinaryUnmarshaler).UnmarshalBinary(base.state); err != nil {
+		return bs.Put(prefix + suffix)
+	}
+	hashString(h, suffix)
+	state, _ := h.(encoding.BinaryMarshaler).MarshalBinary()
+	var sum BlobHash
+	h.Sum(sum[:0])
+
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+
+	if blob, exists := bs.blobs[sum]; exists {
+		if blob.spilled {
+			blob.data = prefix + suffix
+			blob.spilled = false
+			bs.resident += blob.size
+			bs.grown.Add(1)
+		}
+		bs.retainLocked(blob)
+		return blob
+	}
+
+	// Strings already handed out cover at most the buffer's current length,
+	// so only the blob ending there may extend it in place; any other base
+	// starts a fresh buffer, paying for one copy of the prefix.
+	buf := base.buf
+	if buf == nil || buf.Len() != len(prefix) {
+		buf = &strings.Builder{}
+		buf.Grow(2 * (len(prefix) + len(suffix)))
+		buf.WriteString(prefix)
+	}
+	buf.WriteString(suffix)
+
+	blob := &Blob{hash: sum, data: buf.String(), size: int64(buf.Len()), state: state, buf: buf}
+	bs.blobs[sum] = blob
+	bs.physical += blob.size
+	bs.resident += blob.size
+	bs.grown.Add(1)
+	bs.retainLocked(blob)
+	return blob
+}
+
+// hashChunkSize bounds the scratch buffer used when hashing strings.
+const hashChunkSize = 64 * 1024
+
+// hashString feeds s into h in fixed-size chunks, avoiding a full []byte
+// copy of multi-megabyte content.
+func hashString(h hash.Hash, s string) {
+	buf := make([]byte, min(len(s), hashChunkSize))
+	for len(s) > 0 {
+		n := copy(buf, s)
+		h.Write(buf[:n])
+		s = s[n:]
+	}
+}
+
+// intern looks up content by the digest in h, storing it if absent, and
+// returns a referenced blob.
+func (bs *BlobStore) intern(h hash.Hash, content string) *Blob {
+	state, _ := h.(encoding.BinaryMarshaler).MarshalBinary()
+	var sum BlobHash
+	h.Sum(sum[:0])
+
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+
+	blob, exists := bs.blobs[sum]
+	if !exists {
+		blob = &Blob{hash: sum, data: content, size: int64(len(content)), state: state}
+		bs.blobs[sum] = blob
+		bs.physical += blob.size
+		bs.resident += blob.size
+		bs.grown.Add(1)
+	} else if blob.spilled {
+		// The caller just handed us the content; make it resident again for free
+		blob.data = content
+		blob.spilled = false
+		bs.resident += blob.size
+		bs.grown.Add(1)
+	}
+	bs.retainLocked(blob)
+	return blob
+}
+
+// Retain adds a reference to a blob already in the store.
+func (bs *BlobStore) Retain(blob *Blob) {
+	if blob == nil {
+		return
+	}
+
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+	bs.retainLocked(blob)
+}
+
+// retainLocked adds a reference. Caller must hold the lock.
+func (bs *BlobStore) retainLocked(blob *Blob) {
+	blob.refs++
+	bs.refs++
+	bs.logical += blob.size
+}
+
+// Release drops a reference to a blob, removing it when no references remain.
+func (bs *BlobStore) Release(blob *Blob) {
+	if blob == nil {
+		return
+	}
+
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+
+	if blob.refs <= 0 {
+		return
+	}
+
+	blob.refs--
+	bs.refs--
+	bs.logical -= blob.size
+
+	if blob.refs == 0 {
+		delete(bs.blobs, blob.hash)
+		bs.physical -= blob.size
+		if !blob.spilled {
+			bs.resident -= blob.size
+		}
+		if blob.spillPath != "" && !blob.keepFile {
+			os.Remove(blob.spillPath)
+		}
+		blob.data = ""
+		blob.buf = nil
+	}
+}
+
+// ErrBlobReleased is returned by Load for a blob whose last reference was
+// released, e.g. by a lock-free reader holding an outdated tab.
+var ErrBlobReleased = errors.New("blob released")
+
+// Load returns the blob content, reading it back from disk if it was spilled.
+// A nil blob is empty content.
+func (bs *BlobStore) Load(blob *Blob) (string, error) {
+	if blob == nil {
+		return "", nil
+	}
+
+	bs.mu.Lock()
+	if blob.refs == 0 {
+		bs.mu.Unlock()
+		return "", ErrBlobReleased
+	}
+	if !blob.spilled {
+		data := blob.data
+		bs.mu.Unlock()
+		return data, nil
+	}
+	path := blob.spillPath
+	bs.mu.Unlock()
+
+	data, err := readSpillFile(path, blob.size)
+	if err != nil {
+		return "", fmt.Errorf("load spilled content %s: %w", blob.hash, err)
+	}
+
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+	if blob.spilled && blob.refs > 0 {
+		// Keep the spill file so a later eviction needs no rewrite
+		blob.data = data
+		blob.spilled = false
+		bs.resident += blob.size
+		bs.loads++
+		bs.grown.Add(1)
+	}
+	return data, nil
+}
+
+// Contains reports whether a blob with the given hash is held.
+func (bs *BlobStore) Contains(hash BlobHash) bool {
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+	_, exists := bs.blobs[hash]
+	return exists
+}
+
+// Resident reports whether the blob content is held in memory.
+func (bs *BlobStore) Resident(blob *Blob) bool {
+	if blob == nil {
+		return true
+	}
+
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+	return !blob.spilled
+}
+
+// Spill writes the blob content to a compressed temp file and drops it from
+// memory. Compression happens without holding the store lock. Returns the
+// number of resident bytes freed.
+func (bs *BlobStore) Spill(blob *Blob) (int64, error) {
+	if blob == nil {
+		return 0, nil
+	}
+
+	bs.mu.Lock()
+	if blob.spilled || blob.refs == 0 {
+		bs.mu.Unlock()
+		return 0, nil
+	}
+	data := blob.data
+	path := blob.spillPath
+	needsWrite := path == ""
+	if needsWrite {
+		if bs.spillDir == "" {
+			dir, err := os.MkdirTemp("", "agentviewer-spill-")
+			if err != nil {
+				bs.mu.Unlock()
+				return 0, err
+			}
+			bs.spillDir = dir
+		}
+		path = filepath.Join(bs.spillDir, blob.hash.String()+".gz")
+	}
+	bs.mu.Unlock()
+
+	if needsWrite {
+		if err := writeSpillFile(path, data); err != nil {
+			return 0, err
+		}
+	}
+
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+	if blob.spilled || blob.refs == 0 {
+		// Released or spilled concurrently while writing
+		if blob.refs == 0 {
+			os.Remove(path)
+		}
+		return 0, nil
+	}
+	blob.spillPath = path
+	blob.data = ""
+	blob.buf = nil
+	blob.spilled = true
+	bs.resident -= blob.size
+	bs.spills++
+	return blob.size, nil
+}
+
+// Adopt returns a referenced blob for content already stored compressed at
+// path, such as a persisted session. The content is not read until Load.
+// If the hash is already in the store, the existing blob is used.
+func (bs *BlobStore) Adopt(hash BlobHash, size int64, path string) *Blob {
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+
+	blob, exists := bs.blobs[hash]
+	if !exists {
+		blob = &Blob{hash: hash, size: size, spillPath: path, spilled: true, keepFile: true}
+		bs.blobs[hash] = blob
+		bs.physical += size
+	}
+	bs.retainLocked(blob)
+	return blob
+}
+
+// Persist makes sure a compressed copy of the blob exists at path, writing it
+// atomically if missing, and uses it as the blob's spill file from then on so
+// later evictions need no rewrite. The file is never removed by the store.
+// Spilled content is copied without being made resident.
+func (bs *BlobStore) Persist(blob *Blob, path string) error {
+	if blob == nil {
+		return nil
+	}
+
+	if _, err := os.Stat(path); err != nil {
+		bs.mu.Lock()
+		data, spilled, spillPath := blob.data, blob.spilled, blob.spillPath
+		bs.mu.Unlock()
+		if spilled {
+			var err error
+			if data, err = readSpillFile(spillPath, blob.size); err != nil {
+				return err
+			}
+		}
+
+		tmp, err := os.CreateTemp(filepath.Dir(path), "blob-*.tmp")
+		if err != nil {
+			return err
+		}
+		tmp.Close()
+		if err := writeSpillFile(tmp.Name(), data); err != nil {
+			return err
+		}
+		if err := os.Rename(tmp.Name(), path); err != nil {
+			os.Remove(tmp.Name())
+			return err
+		}
+	}
+
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+	if blob.refs == 0 || blob.spillPath == path {
+		return nil
+	}
+	if blob.spillPath != "" && !blob.keepFile {
+		os.Remove(blob.spillPath)
+	}
+	blob.spillPath = path
+	blob.keepFile = true
+	return nil
+}
+
+// Close removes all spill files. The store must not be used afterwards.
+func (bs *BlobStore) Close() error {
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+
+	if bs.spillDir == "" {
+		return nil
+	}
+	err := os.RemoveAll(bs.spillDir)
+	bs.spillDir = ""
+	return err
+}
+
+// Stats returns current deduplication and residency statistics.
+func (bs *BlobStore) Stats() BlobStats {
+	bs.mu.Lock()
+	defer bs.mu.Unlock()
+
+	return BlobStats{
+		Blobs:         len(bs.blobs),
+		References:    bs.refs,
+		LogicalBytes:  bs.logical,
+		PhysicalBytes: bs.physical,
+		ResidentBytes: bs.resident,
+		Spills:        bs.spills,
+		Loads:         bs.loads,
+	}
+}
+
+// writeSpillFile writes data gzip-compressed to path.
+func writeSpillFile(path, data string) error {
+	f, err := os.Create(path)
+	if err != nil {
+		return err
+	}
+
+	zw, _ := gzip.NewWriterLevel(f, gzip.BestSpeed)
+	_, err = io.WriteString(zw, data)
+	if err == nil {
+		err = zw.Close()
+	}
+	if err != nil {
+		f.Close()
+		os.Remove(path)
+		return err
+	}
+	return f.Close()
+}
+
+// readSpillFile reads gzip-compressed content of the given size from path.
+func readSpillFile(path string, size int64) (string, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return "", err
+	}
+	defer f.Close()
+
+	zr, err := gzip.NewReader(f)
+	if err != nil {
+		return "", err
+	}
+	defer zr.Close()
+
+	var sb strings.Builder
+	sb.Grow(int(size))
+	if _, err := io.Copy(&sb, zr); err != nil {
+		return "", err
+	}
+	return sb.String(), nil
+}
@@ -0,0 +1,324 @@
+package main
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"testing"
+)
+
+// mustLoad returns a blob's content, failing the test on error.
+func mustLoad(t *testing.T, bs *BlobStore, blob *Blob) string {
+	t.Helper()
+	content, err := bs.Load(blob)
+	if err != nil {
+		t.Fatalf("load failed: %v", err)
+	}
+	return content
+}
+
+// TestBlobStorePut verifies that identical content is deduplicated.
+func TestBlobStorePut(t *testing.T) {
+	t.Run("empty content returns nil blob", func(t *testing.T) {
+		bs := NewBlobStore()
+		if blob := bs.Put(""); blob != nil {
+			t.Errorf("expected nil blob for empty content, got %v", blob)
+		}
+		if stats := bs.Stats(); stats.Blobs != 0 || stats.References != 0 {
+			t.Errorf("expected empty stats, got %+v", stats)
+		}
+	})
+
+	t.Run("identical content shares one blob", func(t *testing.T) {
+		bs := NewBlobStore()
+		a := bs.Put(strings.Repeat("x", 100))
+		b := bs.Put(strings.Repeat("x", 100))
+
+		if a != b {
+			t.Error("expected identical content to return the same blob")
+		}
+
+		stats := bs.Stats()
+		if stats.Blobs != 1 {
+			t.Errorf("expected 1 blob, got %d", stats.Blobs)
+		}
+		if stats.References != 2 {
+			t.Errorf("expected 2 references, got %d", stats.References)
+		}
+		if stats.LogicalBytes != 200 {
+			t.Errorf("expected 200 logical bytes, got %d", stats.LogicalBytes)
+		}
+		if stats.PhysicalBytes != 100 {
+			t.Errorf("expected 100 physical bytes, got %d", stats.PhysicalBytes)
+		}
+	})
+
+	t.Run("different content gets different blobs", func(t *testing.T) {
+		bs := NewBlobStore()
+		a := bs.Put("alpha")
+		b := bs.Put("beta")
+
+		if a == b {
+			t.Error("expected different blobs for different content")
+		}
+		if a.Hash() == b.Hash() {
+			t.Error("expected different hashes for different content")
+		}
+		if got := mustLoad(t, bs, a) + "," + mustLoad(t, bs, b); got != "alpha,beta" {
+			t.Errorf("unexpected blob content: %q", got)
+		}
+	})
+}
+
+// TestBlobStoreRelease verifies reference counting and removal.
+func TestBlobStoreRelease(t *testing.T) {
+	t.Run("blob survives until last release", func(t *testing.T) {
+		bs := NewBlobStore()
+		a := bs.Put("shared")
+		bs.Retain(a)
+
+		bs.Release(a)
+		if stats := bs.Stats(); stats.Blobs != 1 || stats.References != 1 {
+			t.Errorf("expected blob kept with 1 reference, got %+v", stats)
+		}
+
+		bs.Release(a)
+		if stats := bs.Stats(); stats != (BlobStats{}) {
+			t.Errorf("expected empty store after final release, got %+v", stats)
+		}
+	})
+
+	t.Run("extra release is ignored", func(t *testing.T) {
+		bs := NewBlobStore()
+		a := bs.Put("once")
+		bs.Release(a)
+		bs.Release(a)
+
+		if stats := bs.Stats(); stats != (BlobStats{}) {
+			t.Errorf("expected empty store, got %+v", stats)
+		}
+	})
+
+	t.Run("nil blob is a no-op", func(t *testing.T) {
+		bs := NewBlobStore()
+		bs.Retain(nil)
+		bs.Release(nil)
+
+		if stats := bs.Stats(); stats != (BlobStats{}) {
+			t.Errorf("expected empty store, got %+v", stats)
+		}
+	})
+
+	t.Run("content can be re-added after removal", func(t *testing.T) {
+		bs := NewBlobStore()
+		a := bs.Put("again")
+		bs.Release(a)
+		b := bs.Put("again")
+
+		if got := mustLoad(t, bs, b); got != "again" {
+			t.Errorf("expected content 'again', got %q", got)
+		}
+		if stats := bs.Stats(); stats.Blobs != 1 || stats.References != 1 {
+			t.Errorf("expected 1 blob with 1 reference, got %+v", stats)
+		}
+	})
+}
+
+// TestBlobStoreConcurrency verifies concurrent put/release is safe.
+func TestBlobStoreConcurrency(t *testing.T) {
+	bs := NewBlobStore()
+	var wg sync.WaitGroup
+
+	for i := 0; i < 50; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for j := 0; j < 100; j++ {
+				blob := bs.Put("concurrent content")
+				bs.Release(blob)
+			}
+		}()
+	}
+	wg.Wait()
+
+	if stats := bs.Stats(); stats != (BlobStats{}) {
+		t.Errorf("expected empty store after balanced put/release, got %+v", stats)
+	}
+}
+
+// TestBlobStoreAppend verifies incremental hashing matches a full put.
+func TestBlobStoreAppend(t *testing.T) {
+	t.Run("appended blob equals put of full content", func(t *testing.T) {
+		bs := NewBlobStore()
+		base := bs.Put(strings.Repeat("a", hashChunkSize+10))
+		appended := bs.Append(base, "tail")
+		full := bs.Put(strings.Repeat("a", hashChunkSize+10) + "tail")
+
+		if appended != full {
+			t.Error("expected appended blob to be shared with identical full content")
+		}
+		if mustLoad(t, bs, appended) != strings.Repeat("a", hashChunkSize+10)+"tail" {
+			t.Error("unexpected appended content")
+		}
+	})
+
+	t.Run("append to nil blob", func(t *testing.T) {
+		bs := NewBlobStore()
+		blob := bs.Append(nil, "start")
+		if got := mustLoad(t, bs, blob); got != "start" {
+			t.Errorf("expected 'start', got %q", got)
+		}
+	})
+
+	t.Run("branching appends keep earlier content", func(t *testing.T) {
+		bs := NewBlobStore()
+		base := bs.Append(bs.Put("base"), "-1")
+		first := bs.Append(base, "-a")
+		second := bs.Append(base, "-b")
+		third := bs.Append(first, "-c")
+
+		for blob, want := range map[*Blob]string{base: "base-1", first: "base-1-a", second: "base-1-b", third: "base-1-a-c"} {
+			if got := mustLoad(t, bs, blob); got != want {
+				t.Errorf("expected %q, got %q", want, got)
+			}
+		}
+	})
+
+	t.Run("empty suffix retains base", func(t *testing.T) {
+		bs := NewBlobStore()
+		base := bs.Put("base")
+		same := bs.Append(base, "")
+
+		if same != base {
+			t.Error("expected same blob for empty suffix")
+		}
+		if stats := bs.Stats(); stats.References != 2 {
+			t.Errorf("expected 2 references, got %d", stats.References)
+		}
+	})
+}
+
+// BenchmarkBlobStoreAppend measures one streaming flush (append a chunk,
+// release the previous version) at several document sizes. The cost per
+// flush should stay flat as the document grows.
+func BenchmarkBlobStoreAppend(b *testing.B) {
+	chunk := strings.Repeat("x", 4096)
+	for _, size := range []int{1 << 20, 16 << 20, 64 << 20} {
+		b.Run(fmt.Sprintf("%dMB", size>>20), func(b *testing.B) {
+			bs := NewBlobStore()
+			blob := bs.Put(strings.Repeat("a", size))
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				next := bs.Append(blob, chunk)
+				bs.Release(blob)
+				blob = next
+			}
+		})
+	}
+}
+
+// TestBlobStoreSpill verifies spilling content to disk and loading it back.
+func TestBlobStoreSpill(t *testing.T) {
+	t.Run("spilled blob loads back", func(t *testing.T) {
+		bs := NewBlobStore()
+		defer bs.Close()
+		content := strings.Repeat("spill me ", 1000)
+		blob := bs.Put(content)
+
+		freed, err := bs.Spill(blob)
+		if err != nil {
+			t.Fatalf("spill failed: %v", err)
+		}
+		if freed != int64(len(content)) {
+			t.Errorf("expected %d bytes freed, got %d", len(content), freed)
+		}
+		if bs.Resident(blob) {
+			t.Error("expected blob not resident after spill")
+		}
+		stats := bs.Stats()
+		if stats.ResidentBytes != 0 || stats.PhysicalBytes != int64(len(content)) || stats.Spills != 1 {
+			t.Errorf("unexpected stats after spill: %+v", stats)
+		}
+
+		if got := mustLoad(t, bs, blob); got != content {
+			t.Error("expected loaded content to match original")
+		}
+		if !bs.Resident(blob) {
+			t.Error("expected blob resident after load")
+		}
+		if stats := bs.Stats(); stats.ResidentBytes != int64(len(content)) || stats.Loads != 1 {
+			t.Errorf("unexpected stats after load: %+v", stats)
+		}
+	})
+
+	t.Run("re-put makes spilled blob resident", func(t *testing.T) {
+		bs := NewBlobStore()
+		defer bs.Close()
+		blob := bs.Put("warm again")
+		bs.Spill(blob)
+
+		again := bs.Put("warm again")
+		if again != blob || !bs.Resident(blob) {
+			t.Error("expected re-put to reuse the blob and make it resident")
+		}
+	})
+
+	t.Run("release removes spill file", func(t *testing.T) {
+		bs := NewBlobStore()
+		defer bs.Close()
+		blob := bs.Put("short lived")
+		bs.Spill(blob)
+		path := blob.spillPath
+
+		if _, err := os.Stat(path); err != nil {
+			t.Fatalf("expected spill file to exist: %v", err)
+		}
+		bs.Release(blob)
+		if _, err := os.Stat(path); !os.IsNotExist(err) {
+			t.Error("expected spill file removed after release")
+		}
+	})
+
+	t.Run("close removes spill directory", func(t *testing.T) {
+		bs := NewBlobStore()
+		bs.Spill(bs.Put("temporary"))
+		dir := bs.spillDir
+
+		if err := bs.Close(); err != nil {
+			t.Fatalf("close failed: %v", err)
+		}
+		if _, err := os.Stat(dir); !os.IsNotExist(err) {
+			t.Error("expected spill directory removed")
+		}
+	})
+}
+
+// TestBlobStorePersistAdopt verifies persisted files can be adopted lazily.
+func TestBlobStorePersistAdopt(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "content.gz")
+
+	bs := NewBlobStore()
+	blob := bs.Put("persist me")
+	if err := bs.Persist(blob, path); err != nil {
+		t.Fatalf("persist failed: %v", err)
+	}
+	bs.Release(blob)
+	if _, err := os.Stat(path); err != nil {
+		t.Fatal("expected persisted file to survive release")
+	}
+
+	other := NewBlobStore()
+	adopted := other.Adopt(blob.Hash(), blob.Size(), path)
+	if other.Resident(adopted) {
+		t.Error("expected adopted blob not to be read until loaded")
+	}
+	if got := mustLoad(t, other, adopted); got != "persist me" {
+		t.Errorf("expected adopted content, got %q", got)
+	}
+	if again := other.Put("persist me"); again != adopted {
+		t.Error("expected adopted blob to deduplicate with identical content")
+	}
+}
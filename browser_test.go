@@ -9,6 +9,7 @@ import (
 	"fmt"
 	"net"
 	"net/http"
+	"net/http/httptest"
 	"strings"
 	"testing"
 	"time"
@@ -60,7 +61,7 @@ func startTestServer(t *testing.T) (string, func()) {
 }
 
 // createTestTab creates a tab via API and returns the tab ID.
-func createTestTab(t *testing.T, baseURL string, title, tabType, content string) string {
+func createTestTab(t testing.TB, baseURL string, title, tabType, content string) string {
 	t.Helper()
 
 	body := map[string]string{
@@ -1577,3 +1578,91 @@ not a real environment
 
 	t.Logf("KaTeX error handling: page stable, %d math spans found", katexSpanCount)
 }
+
+// === Startup Benchmark ===
+
+// eagerIndex returns index.html with every vendor library loaded by
+// blocking tags before app.js, as the page did before on-demand loading.
+func eagerIndex(tb testing.TB) []byte {
+	tb.Helper()
+	assets := getStaticAssets()
+	url := func(name string) string {
+		for hashed, asset := range assets.byHashed {
+			if asset.name == name {
+				return "/" + hashed
+			}
+		}
+		return "/" + name
+	}
+
+	var tags strings.Builder
+	for _, name := range []string{"vendor/katex.min.css", "vendor/diff2html.min.css"} {
+		fmt.Fprintf(&tags, "<link rel=\"stylesheet\" href=%q>\n", url(name))
+	}
+	for _, name := range []string{"vendor/highlight.min.js", "vendor/mermaid.min.js", "vendor/katex.min.js", "vendor/diff2html-ui-slim.min.js"} {
+		fmt.Fprintf(&tags, "<script src=%q></script>\n", url(name))
+	}
+	app := []byte(`<script src="` + url("app.js") + `">`)
+	if !bytes.Contains(assets.index, app) {
+		tb.Fatal("index.html does not load app.js")
+	}
+	return bytes.Replace(assets.index, app, append([]byte(tags.String()), app...), 1)
+}
+
+// BenchmarkBrowserStartup measures the time from navigation to the first
+// rendered tab, a markdown document with a code block, in a new browser tab.
+// "eager" loads every vendor library up front as the page used to; "lazy"
+// is the current page, which loads highlight.js on demand. The browser
+// cache is warm after the first iteration, as for a returning user.
+func BenchmarkBrowserStartup(b *testing.B) {
+	srv := NewServer()
+	defer srv.Shutdown(context.Background())
+	mux := http.NewServeMux()
+	srv.setupRoutes(mux)
+	eager := eagerIndex(b)
+	mux.HandleFunc("GET /eager", func(w http.ResponseWriter, r *http.Request) {
+		w.Header().Set("Content-Type", "text/html; charset=utf-8")
+		w.Write(eager)
+	})
+	ts := httptest.NewServer(mux)
+	defer ts.Close()
+	createTestTab(b, ts.URL, "Notes", "markdown", "# Notes\n\nSome text.\n\n```go\nfunc main() {}\n```\n")
+
+	allocCtx, allocCancel := chromedp.NewExecAllocator(context.Background(),
+		append(chromedp.DefaultExecAllocatorOptions[:],
+			chromedp.Flag("headless", true),
+			chromedp.Flag("disable-gpu", true),
+			chromedp.Flag("no-sandbox", true),
+		)...,
+	)
+	defer allocCancel()
+	browserCtx, cancel := chromedp.NewContext(allocCtx)
+	defer cancel()
+	if err := chromedp.Run(browserCtx); err != nil {
+		b.Fatalf("failed to start browser: %v", err)
+	}
+
+	for _, bc := range []struct{ name, path string }{{"eager", "/eager"}, {"lazy", "/"}} {
+		b.Run(bc.name, func(b *testing.B) {
+			var total float64
+			for i := 0; i < b.N; i++ {
+				tabCtx, cancelTab := chromedp.NewContext(browserCtx)
+				ctx, cancelTimeout := context.WithTimeout(tabCtx, 30*time.Second)
+				var ms float64
+				err := chromedp.Run(ctx,
+					chromedp.Navigate(ts.URL+bc.path),
+					chromedp.WaitVisible(`.content-markdown`, chromedp.ByQuery),
+					// Milliseconds since navigation started
+					chromedp.Evaluate(`performance.now()`, &ms),
+				)
+				cancelTimeout()
+				cancelTab()
+				if err != nil {
+					b.Fatalf("chromedp failed: %v", err)
+				}
+				total += ms
+			}
+			b.ReportMetric(total/float64(b.N), "ms/first-render")
+		})
+	}
+}
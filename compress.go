@@ -0,0 +1,89 @@
+// Package main provides shared compression of WebSocket broadcasts.
+package main
+
+import (
+	"bytes"
+	"compress/zlib"
+	"net/http"
+	"strings"
+	"sync"
+	"sync/atomic"
+)
+
+const (
+	// DeflateSubprotocol is the WebSocket subprotocol under which broadcasts
+	// of at least the hub's compression threshold arrive as zlib-compressed
+	// binary messages; smaller ones stay JSON text.
+	DeflateSubprotocol = "agentviewer.deflate"
+
+	// defaultCompressThreshold is the smallest payload, in bytes, worth
+	// compressing. Below it, deflate headers and latency outweigh the savings.
+	defaultCompressThreshold = 1024
+
+	// zlibHeader is the first byte of every zlib stream this package writes
+	// (deflate, 32 KiB window). JSON messages start with '{' and MessagePack
+	// messages with a map header instead, which is how WritePump and the
+	// browser tell compressed payloads apart.
+	zlibHeader = 0x78
+)
+
+// zlibWriters reuses compressors across broadcasts.
+var zlibWriters = sync.Pool{
+	New: func() interface{} {
+		w, _ := zlib.NewWriterLevel(nil, zlib.BestSpeed)
+		return w
+	},
+}
+
+// compressionCounters counts broadcast payloads compressed by the hub.
+type compressionCounters struct {
+	messages    atomic.Int64
+	bytesBefore atomic.Int64
+	bytesAfter  atomic.Int64
+}
+
+// compress returns data zlib-compressed, or nil if it is below the
+// threshold or does not shrink. Each broadcast payload is compressed at
+// most once and the result shared by every client that negotiated
+// DeflateSubprotocol.
+func (h *Hub) compress(data []byte) []byte {
+	if len(data) < h.compressThreshold {
+		return nil
+	}
+
+	var buf bytes.Buffer
+	buf.Grow(len(data) / 4)
+	zw := zlibWriters.Get().(*zlib.Writer)
+	zw.Reset(&buf)
+	zw.Write(data)
+	err := zw.Close()
+	zlibWriters.Put(zw)
+	if err != nil || buf.Len() >= len(data) {
+		return nil
+	}
+
+	h.compression.messages.Add(1)
+	h.compression.bytesBefore.Add(int64(len(data)))
+	h.compression.bytesAfter.Add(int64(buf.Len()))
+	return buf.Bytes()
+}
+
+// isCompressed reports whether a queued message is a compressed payload.
+func isCompressed(message []byte) bool {
+	return len(message) > 0 && message[0] == zlibHeader
+}
+
+// wantsSharedDeflate reports whether a WebSocket handshake offers
+// DeflateSubprotocol or MsgpackDeflateSubprotocol. Such clients get shared
+// compression, so per-connection permessage-deflate is not negotiated.
+func wantsSharedDeflate(r *http.Request) bool {
+	for _, value := range r.Header.Values("Sec-WebSocket-Protocol") {
+		for _, protocol := range strings.Split(value, ",") {
+			switch strings.TrimSpace(protocol) {
+			case DeflateSubprotocol, MsgpackDeflateSubprotocol:
+				return true
+			}
+		}
+	}
+	return false
+}
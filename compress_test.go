@@ -0,0 +1,119 @@
+package main
+
+import (
+	"bytes"
+	"compress/zlib"
+	"context"
+	"encoding/json"
+	"io"
+	"net/http"
+	"net/http/httptest"
+	"strings"
+	"testing"
+	"time"
+
+	"nhooyr.io/websocket"
+)
+
+// inflate decompresses a zlib payload.
+func inflate(t *testing.T, data []byte) []byte {
+	t.Helper()
+	zr, err := zlib.NewReader(bytes.NewReader(data))
+	if err != nil {
+		t.Fatalf("not a zlib payload: %v", err)
+	}
+	out, err := io.ReadAll(zr)
+	if err != nil {
+		t.Fatalf("failed to inflate: %v", err)
+	}
+	return out
+}
+
+// TestHub_CompressesOncePerBroadcast tests that deflate clients share one
+// compressed payload and others receive plain JSON.
+func TestHub_CompressesOncePerBroadcast(t *testing.T) {
+	hub := NewHub()
+	go hub.Run()
+	defer hub.Shutdown()
+
+	plain := &Client{hub: hub, send: make(chan []byte, 4)}
+	deflated := make([]*Client, 3)
+	hub.register <- plain
+	for i := range deflated {
+		deflated[i] = &Client{hub: hub, send: make(chan []byte, 4), deflate: true}
+		hub.register <- deflated[i]
+	}
+
+	content := strings.Repeat("func main() { fmt.Println(\"hello\") }\n", 200)
+	hub.Broadcast(WSMessage{Type: "tab_updated", Tab: &Tab{ID: "a", Content: content}})
+	hub.Broadcast(WSMessage{Type: "tab_activated", ID: "a"})
+	time.Sleep(20 * time.Millisecond)
+
+	full := <-plain.send
+	if isCompressed(full) {
+		t.Fatal("expected plain client to receive JSON")
+	}
+	var first []byte
+	for i, c := range deflated {
+		data := <-c.send
+		if !isCompressed(data) || len(data)*5 > len(full) {
+			t.Fatalf("client %d: expected a compressed payload, got %d of %d bytes", i, len(data), len(full))
+		}
+		if first == nil {
+			first = data
+		} else if &data[0] != &first[0] {
+			t.Errorf("client %d: expected the shared compressed payload", i)
+		}
+		if small := <-c.send; isCompressed(small) {
+			t.Errorf("client %d: expected small message to stay uncompressed", i)
+		}
+	}
+	if got := inflate(t, first); !bytes.Equal(got, full) {
+		t.Error("expected compressed payload to inflate to the JSON message")
+	}
+
+	stats := hub.Stats()
+	if stats.CompressedMessages != 1 || stats.BytesBeforeCompression != int64(len(full)) || stats.BytesAfterCompression != int64(len(first)) {
+		t.Errorf("unexpected compression stats: %+v", stats)
+	}
+}
+
+// TestServeWS_DeflateSubprotocol tests that negotiating the subprotocol
+// delivers large broadcasts as compressed binary messages.
+func TestServeWS_DeflateSubprotocol(t *testing.T) {
+	srv := NewServer()
+	go srv.hub.Run()
+	defer srv.hub.Shutdown()
+
+	ts := httptest.NewServer(http.HandlerFunc(srv.handleWebSocket))
+	defer ts.Close()
+
+	ctx, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+	wsURL := "ws" + strings.TrimPrefix(ts.URL, "http") + "/ws"
+	conn, _, err := websocket.Dial(ctx, wsURL, &websocket.DialOptions{Subprotocols: []string{DeflateSubprotocol}})
+	if err != nil {
+		t.Fatalf("failed to connect: %v", err)
+	}
+	defer conn.Close(websocket.StatusNormalClosure, "")
+	conn.SetReadLimit(1 << 20)
+	if conn.Subprotocol() != DeflateSubprotocol {
+		t.Fatalf("expected subprotocol %s, got %q", DeflateSubprotocol, conn.Subprotocol())
+	}
+
+	time.Sleep(50 * time.Millisecond)
+	content := strings.Repeat("| a | b | c |\n", 1000)
+	srv.hub.Broadcast(WSMessage{Type: "tab_created", Tab: &Tab{ID: "t", Content: content}})
+
+	typ, data, err := conn.Read(ctx)
+	if err != nil {
+		t.Fatalf("failed to read: %v", err)
+	}
+	if typ != websocket.MessageBinary {
+		t.Fatalf("expected a binary message, got %v", typ)
+	}
+	var msg WSMessage
+	if err := json.Unmarshal(inflate(t, data), &msg); err != nil || msg.Tab.Content != content {
+		t.Errorf("expected inflated tab_created with content, got %v", err)
+	}
+}
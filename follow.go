@@ -0,0 +1,292 @@
+// Package main provides tail-follow for file tabs on growing files such as logs.
+package main
+
+import (
+	"bytes"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"strings"
+	"sync"
+	"unicode/utf8"
+)
+
+// defaultTailWindow is how much of a followed file a tab keeps by default.
+const defaultTailWindow = 4 << 20 // 4 MiB
+
+// tailSlack is the fraction of the window (1/tailSlack) a followed tab may
+// grow past it before its head is trimmed, so most writes stay plain appends.
+const tailSlack = 4
+
+// tailState is what is known about a followed file: which file it is (to
+// detect rotation) and how far into it the tab has read. Its lock
+// serialises the tab's updates so its reads and patches stay in file order.
+type tailState struct {
+	mu     sync.Mutex
+	info   os.FileInfo // Nil until the tail is first read, e.g. after a restart
+	offset int64
+}
+
+// followers tracks followed tabs, keyed by tab ID. Its lock guards only the
+// map and window; each tab's tailState has its own, so followed tabs update
+// in parallel. The zero value follows nothing and keeps defaultTailWindow
+// bytes per tab.
+type followers struct {
+	mu     sync.Mutex
+	window int64 // Zero means defaultTailWindow
+	tails  map[string]*tailState
+}
+
+// SetTailWindow sets how many bytes of a followed file a tab keeps.
+// Values below 1 restore the default.
+func (s *Server) SetTailWindow(window int64) {
+	if window < 1 {
+		window = 0
+	}
+	s.follow.mu.Lock()
+	s.follow.window = window
+	s.follow.mu.Unlock()
+}
+
+// windowLocked returns the tail window. Caller must hold f.mu.
+func (f *followers) windowLocked() int64 {
+	if f.window == 0 {
+		return defaultTailWindow
+	}
+	return f.window
+}
+
+// openTail reads the last window bytes of path into tab.Content and returns
+// the state to track once the tab is stored.
+func (f *followers) openTail(tab *Tab) (*tailState, error) {
+	f.mu.Lock()
+	window := f.windowLocked()
+	f.mu.Unlock()
+
+	content, state, err := readTail(tab.SourcePath, window)
+	if err != nil {
+		return nil, err
+	}
+	tab.Content = content
+	return state, nil
+}
+
+// track starts following a stored tab from state. A nil state makes the
+// next change reload the tail.
+func (f *followers) track(tabID string, state *tailState) {
+	if state == nil {
+		state = &tailState{}
+	}
+	f.mu.Lock()
+	if f.tails == nil {
+		f.tails = make(map[string]*tailState)
+	}
+	f.tails[tabID] = state
+	f.mu.Unlock()
+}
+
+// untrack stops following a tab.
+func (f *followers) untrack(tabID string) {
+	f.mu.Lock()
+	delete(f.tails, tabID)
+	f.mu.Unlock()
+}
+
+// clear stops following all tabs.
+func (f *followers) clear() {
+	f.mu.Lock()
+	f.tails = nil
+	f.mu.Unlock()
+}
+
+// readTail reads up to window bytes from the end of path. A tail that starts
+// mid-file begins at the next line, or failing that the next character, and
+// an incomplete character at the end is left for the next read.
+func readTail(path string, window int64) (string, *tailState, error) {
+	file, err := os.Open(path)
+	if err != nil {
+		return "", nil, err
+	}
+	defer file.Close()
+
+	info, err := file.Stat()
+	if err != nil {
+		return "", nil, err
+	}
+	start := info.Size() - window
+	if start < 0 {
+		start = 0
+	}
+	buf := make([]byte, info.Size()-start)
+	n, err := file.ReadAt(buf, start)
+	if err != nil && !errors.Is(err, io.EOF) {
+		return "", nil, err
+	}
+	buf = buf[:n]
+
+	if start > 0 {
+		skip := bytes.IndexByte(buf, '\n') + 1
+		for skip < len(buf) && !utf8.RuneStart(buf[skip]) {
+			skip++
+		}
+		buf = buf[skip:]
+	}
+	end := completeRunes(buf)
+	return string(buf[:end]), &tailState{info: info, offset: start + int64(n-len(buf)) + int64(end)}, nil
+}
+
+// validateFollowFile checks that path is a regular file that can be followed.
+func validateFollowFile(path string) error {
+	cleanPath, err := ValidatePath(path)
+	if err != nil {
+		return err
+	}
+	info, err := os.Stat(cleanPath)
+	if err != nil {
+		return err
+	}
+	if !info.Mode().IsRegular() {
+		return fmt.Errorf("path is not a regular file: %s", cleanPath)
+	}
+	return nil
+}
+
+// completeRunes returns the length of b without an incomplete trailing
+// character, which may still be being written.
+func completeRunes(b []byte) int {
+	for i := len(b) - 1; i >= 0 && i >= len(b)-utf8.UTFMax; i-- {
+		if utf8.RuneStart(b[i]) {
+			if !utf8.FullRune(b[i:]) {
+				return i
+			}
+			break
+		}
+	}
+	return len(b)
+}
+
+// lookup returns a followed tab's state and the tail window.
+func (f *followers) lookup(tabID string) (*tailState, int64, bool) {
+	f.mu.Lock()
+	defer f.mu.Unlock()
+	state, ok := f.tails[tabID]
+	return state, f.windowLocked(), ok
+}
+
+// followChanges updates the followed tabs among tabIDs after path changed
+// and returns the rest.
+func (s *Server) followChanges(path string, tabIDs []string) []string {
+	rest := tabIDs[:0:0]
+	for _, tabID := range tabIDs {
+		if state, window, followed := s.follow.lookup(tabID); followed {
+			s.followChange(tabID, path, state, window)
+		} else {
+			rest = append(rest, tabID)
+		}
+	}
+	return rest
+}
+
+// followChange brings a followed tab up to date with its file. Bytes written
+// since the last read are read with ReadAt and sent as an append patch,
+// trimming the head once the tab outgrows its window. A replaced file
+// (rotation), a shrunk one (truncation), a conflicting edit or a jump
+// larger than the window reloads the tail instead.
+func (s *Server) followChange(tabID, path string, state *tailState, window int64) {
+	state.mu.Lock()
+	defer state.mu.Unlock()
+
+	if err := s.appendTail(tabID, path, state, window); err != nil {
+		if !errors.Is(err, errTailReset) {
+			fmt.Printf("Warning: cannot follow %s: %v\n", path, err)
+			return
+		}
+		s.resetTail(tabID, path, state, window)
+	}
+}
+
+// errTailReset is returned by appendTail when the tab must reload its tail.
+var errTailReset = errors.New("tail reset")
+
+// appendTail patches newly written bytes onto a followed tab.
+// Caller must hold state.mu.
+func (s *Server) appendTail(tabID, path string, state *tailState, window int64) error {
+	file, err := os.Open(path)
+	if err != nil {
+		return err
+	}
+	defer file.Close()
+
+	info, err := file.Stat()
+	if err != nil {
+		return err
+	}
+	switch {
+	case state.info == nil, !os.SameFile(state.info, info), info.Size() < state.offset:
+		return errTailReset
+	case info.Size() == state.offset:
+		return nil
+	case info.Size()-state.offset > window:
+		return errTailReset
+	}
+
+	buf := make([]byte, info.Size()-state.offset)
+	n, err := file.ReadAt(buf, state.offset)
+	if err != nil && !errors.Is(err, io.EOF) {
+		return err
+	}
+	buf = buf[:completeRunes(buf[:n])]
+	if len(buf) == 0 {
+		return nil
+	}
+
+	tab, ok := s.state.GetTab(tabID)
+	if !ok {
+		return nil
+	}
+	ops := []PatchOp{{Op: PatchOpAppend, Text: string(buf)}}
+	if size := int64(len(tab.Content) + len(buf)); size > window+window/tailSlack {
+		excess := int(size - window)
+		if excess >= len(tab.Content) {
+			return errTailReset
+		}
+		// Drop whole lines, or failing that whole characters
+		cut := excess
+		if nl := strings.IndexByte(tab.Content[cut:], '\n'); nl >= 0 {
+			cut += nl + 1
+		}
+		for cut < len(tab.Content) && !utf8.RuneStart(tab.Content[cut]) {
+			cut++
+		}
+		ops = append([]PatchOp{{Op: PatchOpReplace, Offset: 0, Length: cut}}, ops...)
+	}
+
+	patch, err := s.state.PatchTab(tabID, tab.Version, ops)
+	if err != nil {
+		if errors.Is(err, ErrVersionConflict) {
+			return errTailReset
+		}
+		return err
+	}
+	state.info = info
+	state.offset += int64(len(buf))
+	s.hub.Broadcast(WSMessage{Type: "tab_patched", ID: tabID, Patch: patch})
+	return nil
+}
+
+// resetTail reloads a followed tab's tail and sends it whole.
+// Caller must hold state.mu.
+func (s *Server) resetTail(tabID, path string, state *tailState, window int64) {
+	content, fresh, err := readTail(path, window)
+	if err != nil {
+		fmt.Printf("Warning: cannot follow %s: %v\n", path, err)
+		return
+	}
+	tab := s.state.UpdateTabContent(tabID, content)
+	if tab == nil {
+		return
+	}
+	state.info, state.offset = fresh.info, fresh.offset
+	s.hub.Broadcast(WSMessage{Type: "tab_updated", Tab: tab})
+}
@@ -0,0 +1,161 @@
+package main
+
+import (
+	"bytes"
+	"net/http"
+	"net/http/httptest"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+)
+
+// createFollowTab creates a tab following path through the API.
+func createFollowTab(t *testing.T, srv *Server, path string) {
+	t.Helper()
+	body := `{"id": "log", "type": "code", "file": "` + path + `", "follow": true}`
+	req := httptest.NewRequest("POST", "/api/tabs", bytes.NewBufferString(body))
+	w := httptest.NewRecorder()
+	srv.handleCreateTab(w, req)
+	if w.Code != http.StatusOK {
+		t.Fatalf("expected status 200, got %d: %s", w.Code, w.Body.String())
+	}
+}
+
+// appendFile appends text to path.
+func appendFile(t *testing.T, path, text string) {
+	t.Helper()
+	f, err := os.OpenFile(path, os.O_APPEND|os.O_WRONLY, 0644)
+	if err != nil {
+		t.Fatalf("failed to open file: %v", err)
+	}
+	defer f.Close()
+	if _, err := f.WriteString(text); err != nil {
+		t.Fatalf("failed to append: %v", err)
+	}
+}
+
+// followedContent reports a change of path and returns the tab's content.
+func followedContent(t *testing.T, srv *Server, path string) string {
+	t.Helper()
+	srv.handleFileChange(path, []string{"log"})
+	tab, ok := srv.state.GetTab("log")
+	if !ok {
+		t.Fatal("tab not found")
+	}
+	return tab.Content
+}
+
+// TestFollow_AppendsNewBytes tests that a followed tab gains only what was
+// appended, holding back an incomplete character until it is complete.
+func TestFollow_AppendsNewBytes(t *testing.T) {
+	srv := setupTestServer()
+	path := filepath.Join(t.TempDir(), "app.log")
+	if err := os.WriteFile(path, []byte("one\n"), 0644); err != nil {
+		t.Fatalf("failed to write file: %v", err)
+	}
+	createFollowTab(t, srv, path)
+
+	appendFile(t, path, "two\n\xc3")
+	if got := followedContent(t, srv, path); got != "one\ntwo\n" {
+		t.Errorf("expected the complete new line, got %q", got)
+	}
+	appendFile(t, path, "\xa9\n")
+	if got := followedContent(t, srv, path); got != "one\ntwo\né\n" {
+		t.Errorf("expected the completed character, got %q", got)
+	}
+
+	tab, _ := srv.state.GetTab("log")
+	if !tab.Follow || tab.Version != 3 {
+		t.Errorf("expected a followed tab at version 3, got follow=%v version %d", tab.Follow, tab.Version)
+	}
+}
+
+// TestFollow_TabsUpdateIndependently tests that a followed tab mid-update
+// does not hold up changes to other followed tabs.
+func TestFollow_TabsUpdateIndependently(t *testing.T) {
+	srv := setupTestServer()
+	path := filepath.Join(t.TempDir(), "app.log")
+	if err := os.WriteFile(path, []byte("one\n"), 0644); err != nil {
+		t.Fatalf("failed to write file: %v", err)
+	}
+	createFollowTab(t, srv, path)
+	other := filepath.Join(t.TempDir(), "other.log")
+	if err := os.WriteFile(other, []byte("a\n"), 0644); err != nil {
+		t.Fatalf("failed to write file: %v", err)
+	}
+	body := `{"id": "other", "type": "code", "file": "` + other + `", "follow": true}`
+	srv.handleCreateTab(httptest.NewRecorder(), httptest.NewRequest("POST", "/api/tabs", bytes.NewBufferString(body)))
+
+	busy, _, _ := srv.follow.lookup("other")
+	busy.mu.Lock() // As if a large read of other.log were in progress
+	defer busy.mu.Unlock()
+
+	appendFile(t, path, "two\n")
+	done := make(chan string)
+	go func() { done <- followedContent(t, srv, path) }()
+	select {
+	case got := <-done:
+		if got != "one\ntwo\n" {
+			t.Errorf("expected the appended line, got %q", got)
+		}
+	case <-time.After(2 * time.Second):
+		t.Fatal("expected the update not to wait for another followed tab")
+	}
+}
+
+// TestFollow_TruncationAndRotation tests that a shrunk or replaced file
+// reloads the tab from the new content.
+func TestFollow_TruncationAndRotation(t *testing.T) {
+	srv := setupTestServer()
+	dir := t.TempDir()
+	path := filepath.Join(dir, "app.log")
+	if err := os.WriteFile(path, []byte("first run\n"), 0644); err != nil {
+		t.Fatalf("failed to write file: %v", err)
+	}
+	createFollowTab(t, srv, path)
+
+	if err := os.WriteFile(path, []byte("new\n"), 0644); err != nil {
+		t.Fatalf("failed to truncate file: %v", err)
+	}
+	if got := followedContent(t, srv, path); got != "new\n" {
+		t.Errorf("expected the truncated file, got %q", got)
+	}
+
+	// Rotate to a new file of the same size, which only the inode tells apart
+	if err := os.Rename(path, filepath.Join(dir, "app.log.1")); err != nil {
+		t.Fatalf("failed to rotate: %v", err)
+	}
+	if err := os.WriteFile(path, []byte("rot\n"), 0644); err != nil {
+		t.Fatalf("failed to write file: %v", err)
+	}
+	if got := followedContent(t, srv, path); got != "rot\n" {
+		t.Errorf("expected the rotated file, got %q", got)
+	}
+}
+
+// TestFollow_TailWindow tests that a followed tab starts and stays within its
+// window, trimmed to whole lines.
+func TestFollow_TailWindow(t *testing.T) {
+	srv := setupTestServer()
+	srv.SetTailWindow(40)
+	path := filepath.Join(t.TempDir(), "app.log")
+	if err := os.WriteFile(path, []byte(strings.Repeat("0123456789\n", 10)), 0644); err != nil {
+		t.Fatalf("failed to write file: %v", err)
+	}
+	createFollowTab(t, srv, path)
+
+	tab, _ := srv.state.GetTab("log")
+	if tab.Content != strings.Repeat("0123456789\n", 3) {
+		t.Errorf("expected the last three whole lines, got %q", tab.Content)
+	}
+
+	for i := 0; i < 5; i++ {
+		appendFile(t, path, "abcdefghij\n")
+		got := followedContent(t, srv, path)
+		if len(got) > 50 || !strings.HasSuffix(got, "abcdefghij\n") || strings.Count(got, "\n")*11 != len(got) {
+			t.Fatalf("append %d: expected whole lines within the window, got %q", i, got)
+		}
+	}
+}
@@ -0,0 +1,136 @@
+//go:build ignore
+
+// Gen_assets fingerprints and precompresses the web UI's scripts and
+// stylesheets into web/dist. Run it with `go generate` after editing
+// anything under web/.
+//
+// For each .js and .css file it writes gzip (and, when the brotli command
+// is installed, brotli) variants named after a hash of the content, a
+// manifest mapping source names to hashed names, and an index.html that
+// refers to the hashed names.
+package main
+
+import (
+	"bytes"
+	"compress/gzip"
+	"crypto/sha256"
+	"encoding/hex"
+	"encoding/json"
+	"fmt"
+	"io/fs"
+	"os"
+	"os/exec"
+	"path"
+	"path/filepath"
+	"sort"
+	"strings"
+)
+
+const (
+	webDir  = "web"
+	distDir = "web/dist"
+)
+
+func main() {
+	if err := generate(); err != nil {
+		fmt.Fprintf(os.Stderr, "gen_assets: %v\n", err)
+		os.Exit(1)
+	}
+}
+
+// generate rebuilds distDir from scratch, so renamed assets leave nothing behind.
+func generate() error {
+	if err := os.RemoveAll(distDir); err != nil {
+		return err
+	}
+	brotli, _ := exec.LookPath("brotli")
+	if brotli == "" {
+		fmt.Fprintln(os.Stderr, "gen_assets: brotli not found, writing gzip variants only")
+	}
+
+	manifest := make(map[string]string)
+	err := filepath.WalkDir(webDir, func(p string, d fs.DirEntry, err error) error {
+		if err != nil {
+			return err
+		}
+		if d.IsDir() {
+			if p == distDir {
+				return filepath.SkipDir
+			}
+			return nil
+		}
+		ext := path.Ext(p)
+		if ext != ".js" && ext != ".css" {
+			return nil
+		}
+
+		data, err := os.ReadFile(p)
+		if err != nil {
+			return err
+		}
+		name := filepath.ToSlash(strings.TrimPrefix(p, webDir+string(filepath.Separator)))
+		sum := sha256.Sum256(data)
+		hashed := strings.TrimSuffix(name, ext) + "." + hex.EncodeToString(sum[:5]) + ext
+		manifest[name] = hashed
+		return compress(data, filepath.Join(distDir, filepath.FromSlash(hashed)), brotli)
+	})
+	if err != nil {
+		return err
+	}
+
+	index, err := os.ReadFile(filepath.Join(webDir, "index.html"))
+	if err != nil {
+		return err
+	}
+	names := make([]string, 0, len(manifest))
+	for name := range manifest {
+		names = append(names, name)
+	}
+	sort.Strings(names)
+	for _, name := range names {
+		index = bytes.ReplaceAll(index, []byte(`"/`+name+`"`), []byte(`"/`+manifest[name]+`"`))
+	}
+	if err := os.WriteFile(filepath.Join(distDir, "index.html"), index, 0644); err != nil {
+		return err
+	}
+
+	data, err := json.MarshalIndent(manifest, "", "  ")
+	if err != nil {
+		return err
+	}
+	return os.WriteFile(filepath.Join(distDir, "manifest.json"), append(data, '\n'), 0644)
+}
+
+// compress writes dst.gz and, if brotli is set, dst.br.
+func compress(data []byte, dst, brotli string) error {
+	if err := os.MkdirAll(filepath.Dir(dst), 0755); err != nil {
+		return err
+	}
+
+	// Deterministic output: no name or modification time in the header
+	var buf bytes.Buffer
+	zw, err := gzip.NewWriterLevel(&buf, gzip.BestCompression)
+	if err != nil {
+		return err
+	}
+	if _, err := zw.Write(data); err != nil {
+		return err
+	}
+	if err := zw.Close(); err != nil {
+		return err
+	}
+	if err := os.WriteFile(dst+".gz", buf.Bytes(), 0644); err != nil {
+		return err
+	}
+
+	if brotli == "" {
+		return nil
+	}
+	cmd := exec.Command(brotli, "--best", "--stdout", "-")
+	cmd.Stdin = bytes.NewReader(data)
+	out, err := cmd.Output()
+	if err != nil {
+		return fmt.Errorf("brotli %s: %w", dst, err)
+	}
+	return os.WriteFile(dst+".br", out, 0644)
+}
@@ -3,8 +3,11 @@ package main
 
 import (
 	"encoding/json"
+	"errors"
+	"fmt"
 	"net/http"
 	"path/filepath"
+	"strconv"
 	"strings"
 	"time"
 )
@@ -20,6 +23,7 @@ type CreateTabRequest struct {
 	Diff        *DiffReq `json:"diff,omitempty"`
 	Path        string   `json:"path,omitempty"`     // File path for git-based diffs
 	GitDiffMode string   `json:"diffMode,omitempty"` // Git diff mode: unstaged, staged, head, commit:<sha>, range:<from>..<to>
+	Follow      bool     `json:"follow,omitempty"`   // Show the tail of File and append to it as the file grows
 }
 
 // DiffReq holds diff-specific request parameters.
@@ -38,26 +42,49 @@ type CreateTabResponse struct {
 	Title   string `json:"title"`
 	Type    string `json:"type"`
 	Created bool   `json:"created"`
+	Version uint64 `json:"version"` // Version of the tab as stored, even if its push is rate limited
+}
+
+// PatchTabRequest is the request body for patching a tab's content.
+type PatchTabRequest struct {
+	BaseVersion uint64    `json:"baseVersion,omitempty"` // If set, the patch is rejected unless the tab is at this version
+	Ops         []PatchOp `json:"ops"`
+}
+
+// PatchTabResponse is the response for patching a tab.
+type PatchTabResponse struct {
+	ID      string `json:"id"`
+	Version uint64 `json:"version"`
+	Size    int    `json:"size"`
 }
 
 // ListTabsResponse is the response for listing tabs.
 type ListTabsResponse struct {
-	Tabs []*TabSummary `json:"tabs"`
+	Tabs       []*TabSummary `json:"tabs"`
+	Total      int           `json:"total"`                // Number of tabs across all pages
+	NextCursor string        `json:"nextCursor,omitempty"` // Pass as ?cursor= for the next page; empty on the last page
 }
 
 // TabSummary is a summary of a tab for listing.
 type TabSummary struct {
-	ID     string `json:"id"`
-	Title  string `json:"title"`
-	Type   string `json:"type"`
-	Active bool   `json:"active"`
+	ID        string `json:"id"`
+	Title     string `json:"title"`
+	Type      string `json:"type"`
+	Active    bool   `json:"active"`
+	Streaming bool   `json:"streaming,omitempty"`
+	Version   uint64 `json:"version"`
 }
 
 // StatusResponse is the response for server status.
 type StatusResponse struct {
-	Version string `json:"version"`
-	Tabs    int    `json:"tabs"`
-	Uptime  int64  `json:"uptime"`
+	Version   string      `json:"version"`
+	Tabs      int         `json:"tabs"`
+	Uptime    int64       `json:"uptime"`
+	Content   BlobStats   `json:"content"`   // Logical vs. physical content bytes after deduplication
+	Memory    MemoryStats `json:"memory"`    // Memory budget and eviction counts
+	WebSocket HubStats    `json:"websocket"` // Connected clients and broadcast compression
+	Images    ImageStats  `json:"images"`    // Image downscaling timings and variant cache
+	Watch     WatchStats  `json:"watch"`     // File and directory watches against the system limit
 }
 
 // ErrorResponse is a standard error response.
@@ -65,6 +92,9 @@ type ErrorResponse struct {
 	Error string `json:"error"`
 }
 
+// maxListLimit is the largest page size accepted by GET /api/tabs?limit=.
+const maxListLimit = 1000
+
 // Version is the application version.
 var Version = "0.1.0"
 
@@ -87,31 +117,90 @@ func (s *Server) handleCreateTab(w http.ResponseWriter, r *http.Request) {
 		return
 	}
 
+	tab, err := buildTab(&req)
+	if err != nil {
+		writeError(w, http.StatusBadRequest, err.Error())
+		return
+	}
+	var tail *tailState
+	if tab.Follow {
+		if tail, err = s.follow.openTail(tab); err != nil {
+			writeError(w, http.StatusBadRequest, "Cannot read file: "+err.Error())
+			return
+		}
+	}
+
+	tab, created := s.state.CreateTab(tab)
+	if tab.Follow {
+		s.follow.track(tab.ID, tail)
+	} else {
+		s.follow.untrack(tab.ID)
+	}
+
+	// Register file for watching if it has a source path
+	if tab.SourcePath != "" && s.fileWatcher != nil {
+		if err := s.fileWatcher.Add(tab.SourcePath, tab.ID); err != nil {
+			// Log but don't fail - watching is optional
+			// The tab was created successfully
+			fmt.Printf("Warning: cannot watch %s: %v\n", tab.SourcePath, err)
+		}
+	}
+
+	// Broadcast to WebSocket clients
+	msgType := "tab_updated"
+	if created {
+		msgType = "tab_created"
+	}
+	s.hub.Broadcast(WSMessage{Type: msgType, Tab: tab})
+
+	writeJSON(w, http.StatusOK, CreateTabResponse{
+		ID:      tab.ID,
+		Title:   tab.Title,
+		Type:    string(tab.Type),
+		Created: created,
+		Version: tab.Version,
+	})
+}
+
+// buildTab validates a create request and resolves its content, reading
+// files and computing diffs as needed. It does not touch server state, so
+// requests can be built concurrently.
+func buildTab(req *CreateTabRequest) (*Tab, error) {
 	// Validate tab type
 	if !ValidTabTypes[req.Type] {
-		writeError(w, http.StatusBadRequest, "Invalid type: must be 'markdown', 'code', 'diff', 'image', 'csv', or 'mermaid'")
-		return
+		return nil, errors.New("Invalid type: must be 'markdown', 'code', 'diff', 'image', 'csv', or 'mermaid'")
+	}
+
+	if req.Follow && (req.File == "" || IsImageFile(req.File) || req.Type == "diff" || req.Type == "image") {
+		return nil, errors.New("Follow requires a text 'file'")
 	}
 
 	// Validate diff type has diff data
 	if req.Type == "diff" && req.Diff == nil && req.Content == "" && req.File == "" && req.Path == "" {
-		writeError(w, http.StatusBadRequest, "Diff type requires 'diff' object, 'content', 'file', or 'path' (for git diff)")
-		return
+		return nil, errors.New("Diff type requires 'diff' object, 'content', 'file', or 'path' (for git diff)")
 	}
 
 	// Determine content
 	content := req.Content
 	if req.File != "" && content == "" {
 		var err error
-		// For image files, read as base64 data URL
+		// Image bytes stay on disk; the tab refers to GET /api/tabs/{id}/raw
 		if IsImageFile(req.File) {
-			content, err = ReadImageAsDataURL(req.File)
+			if req.ID == "" {
+				req.ID = GenerateID()
+			}
+			content, err = imageReference(req.ID, req.File)
+		} else if req.Follow {
+			// The server reads the tail once the tab has an ID (see followers.openTail)
+			if req.ID == "" {
+				req.ID = GenerateID()
+			}
+			err = validateFollowFile(req.File)
 		} else {
 			content, err = ReadFileContent(req.File)
 		}
 		if err != nil {
-			writeError(w, http.StatusBadRequest, "Cannot read file: "+err.Error())
-			return
+			return nil, errors.New("Cannot read file: " + err.Error())
 		}
 	}
 
@@ -121,15 +210,13 @@ func (s *Server) handleCreateTab(w http.ResponseWriter, r *http.Request) {
 		// Parse the diff mode (defaults to "unstaged")
 		mode, err := ParseDiffMode(req.GitDiffMode)
 		if err != nil {
-			writeError(w, http.StatusBadRequest, "Invalid diffMode: "+err.Error())
-			return
+			return nil, errors.New("Invalid diffMode: " + err.Error())
 		}
 
 		// Compute the git diff
 		diffOutput, err := GitDiff(req.Path, mode)
 		if err != nil {
-			writeError(w, http.StatusBadRequest, "Git diff failed: "+err.Error())
-			return
+			return nil, errors.New("Git diff failed: " + err.Error())
 		}
 
 		content = diffOutput
@@ -160,13 +247,11 @@ func (s *Server) handleCreateTab(w http.ResponseWriter, r *http.Request) {
 			// Read both files and create diff
 			leftContent, err := ReadFileContent(req.Diff.Left)
 			if err != nil {
-				writeError(w, http.StatusBadRequest, "Cannot read left file: "+err.Error())
-				return
+				return nil, errors.New("Cannot read left file: " + err.Error())
 			}
 			rightContent, err := ReadFileContent(req.Diff.Right)
 			if err != nil {
-				writeError(w, http.StatusBadRequest, "Cannot read right file: "+err.Error())
-				return
+				return nil, errors.New("Cannot read right file: " + err.Error())
 			}
 			content = CreateUnifiedDiff(req.Diff.Left, req.Diff.Right, leftContent, rightContent)
 		}
@@ -187,10 +272,10 @@ func (s *Server) handleCreateTab(w http.ResponseWriter, r *http.Request) {
 	// Determine source path for file-based tabs (enables auto-reload)
 	sourcePath := ""
 	if req.File != "" {
-		sourcePath = req.File
+		sourcePath = watchPath(req.File)
 	}
 
-	tab := &Tab{
+	return &Tab{
 		ID:         req.ID,
 		Title:      req.Title,
 		Type:       tabType,
@@ -198,57 +283,106 @@ func (s *Server) handleCreateTab(w http.ResponseWriter, r *http.Request) {
 		Language:   language,
 		DiffMeta:   diffMeta,
 		SourcePath: sourcePath,
-	}
+		Follow:     req.Follow,
+	}, nil
+}
 
-	tab, created := s.state.CreateTab(tab)
+// handlePatchTab handles PATCH /api/tabs/{id}.
+// It applies append/insert/replace operations to the tab content and
+// broadcasts only the delta to WebSocket clients.
+func (s *Server) handlePatchTab(w http.ResponseWriter, r *http.Request) {
+	id := r.PathValue("id")
 
-	// Register file for watching if it has a source path
-	if tab.SourcePath != "" && s.fileWatcher != nil {
-		if err := s.fileWatcher.Add(tab.SourcePath, tab.ID); err != nil {
-			// Log but don't fail - watching is optional
-			// The tab was created successfully
-			_ = err // ignore error
-		}
+	var req PatchTabRequest
+	if err := json.NewDecoder(r.Body).Decode(&req); err != nil {
+		writeError(w, http.StatusBadRequest, "Invalid JSON")
+		return
+	}
+	if len(req.Ops) == 0 {
+		writeError(w, http.StatusBadRequest, "Patch requires at least one op")
+		return
 	}
 
-	// Broadcast to WebSocket clients
-	msgType := "tab_updated"
-	if created {
-		msgType = "tab_created"
+	patch, err := s.state.PatchTab(id, req.BaseVersion, req.Ops)
+	switch {
+	case errors.Is(err, ErrTabNotFound):
+		writeError(w, http.StatusNotFound, "Tab not found")
+		return
+	case errors.Is(err, ErrVersionConflict):
+		writeError(w, http.StatusConflict, "Version conflict: tab has changed since baseVersion")
+		return
+	case err != nil:
+		writeError(w, http.StatusBadRequest, err.Error())
+		return
 	}
-	s.hub.Broadcast(WSMessage{Type: msgType, Tab: tab})
 
-	writeJSON(w, http.StatusOK, CreateTabResponse{
-		ID:      tab.ID,
-		Title:   tab.Title,
-		Type:    string(tab.Type),
-		Created: created,
+	// Broadcast the delta to WebSocket clients
+	s.hub.Broadcast(WSMessage{Type: "tab_patched", ID: id, Patch: patch})
+
+	writeJSON(w, http.StatusOK, PatchTabResponse{
+		ID:      id,
+		Version: patch.Version,
+		Size:    patch.Size,
 	})
 }
 
 // handleListTabs handles GET /api/tabs.
+// With ?limit=N it returns one page and a cursor for the next (?cursor=);
+// without it, all tabs. Responds 304 Not Modified when If-None-Match
+// matches the list ETag.
 func (s *Server) handleListTabs(w http.ResponseWriter, r *http.Request) {
-	tabs := s.state.ListTabs()
+	query := r.URL.Query()
+	limit := 0
+	if v := query.Get("limit"); v != "" {
+		n, err := strconv.Atoi(v)
+		if err != nil || n < 1 || n > maxListLimit {
+			writeError(w, http.StatusBadRequest, fmt.Sprintf("Invalid limit: must be 1-%d", maxListLimit))
+			return
+		}
+		limit = n
+	}
+
+	// Read the tag before the list: a concurrent change can then only make
+	// the tag older than the body, which costs a refetch but never a stale hit.
+	etag := s.state.ListETag()
+	if checkNotModified(w, r, etag) {
+		return
+	}
+
+	tabs, next, total, err := s.state.ListTabsPage(query.Get("cursor"), limit)
+	if err != nil {
+		writeError(w, http.StatusBadRequest, "Invalid cursor: "+err.Error())
+		return
+	}
 	summaries := make([]*TabSummary, len(tabs))
 	for i, tab := range tabs {
 		summaries[i] = &TabSummary{
-			ID:     tab.ID,
-			Title:  tab.Title,
-			Type:   string(tab.Type),
-			Active: tab.Active,
+			ID:        tab.ID,
+			Title:     tab.Title,
+			Type:      string(tab.Type),
+			Active:    tab.Active,
+			Streaming: tab.Streaming,
+			Version:   tab.Version,
 		}
 	}
-	writeJSON(w, http.StatusOK, ListTabsResponse{Tabs: summaries})
+	writeJSON(w, http.StatusOK, ListTabsResponse{Tabs: summaries, Total: total, NextCursor: next})
 }
 
 // handleGetTab handles GET /api/tabs/{id}.
+// Responds 304 Not Modified, without loading or encoding the content, when
+// If-None-Match matches the tab's ETag.
 func (s *Server) handleGetTab(w http.ResponseWriter, r *http.Request) {
 	id := r.PathValue("id")
+	if etag, exists := s.state.TabETag(id); exists && checkNotModified(w, r, etag) {
+		return
+	}
+
 	tab, exists := s.state.GetTab(id)
 	if !exists {
 		writeError(w, http.StatusNotFound, "Tab not found")
 		return
 	}
+	setETag(w, tabETag(tab))
 	writeJSON(w, http.StatusOK, tab)
 }
 
@@ -256,11 +390,7 @@ func (s *Server) handleGetTab(w http.ResponseWriter, r *http.Request) {
 func (s *Server) handleDeleteTab(w http.ResponseWriter, r *http.Request) {
 	id := r.PathValue("id")
 
-	// Remove from file watcher before deleting
-	if s.fileWatcher != nil {
-		s.fileWatcher.Remove(id)
-	}
-
+	s.stopWatching(id)
 	if !s.state.DeleteTab(id) {
 		writeError(w, http.StatusNotFound, "Tab not found")
 		return
@@ -272,6 +402,15 @@ func (s *Server) handleDeleteTab(w http.ResponseWriter, r *http.Request) {
 	w.WriteHeader(http.StatusNoContent)
 }
 
+// stopWatching stops watching and following a tab's file. Tabs are closed
+// through it before they are deleted, so no file event reaches a closed tab.
+func (s *Server) stopWatching(id string) {
+	if s.fileWatcher != nil {
+		s.fileWatcher.Remove(id)
+	}
+	s.follow.untrack(id)
+}
+
 // handleActivateTab handles POST /api/tabs/{id}/activate.
 func (s *Server) handleActivateTab(w http.ResponseWriter, r *http.Request) {
 	id := r.PathValue("id")
@@ -292,6 +431,7 @@ func (s *Server) handleClearTabs(w http.ResponseWriter, r *http.Request) {
 	if s.fileWatcher != nil {
 		s.fileWatcher.Clear()
 	}
+	s.follow.clear()
 
 	s.state.Clear()
 
@@ -304,16 +444,25 @@ func (s *Server) handleClearTabs(w http.ResponseWriter, r *http.Request) {
 // handleStatus handles GET /api/status.
 func (s *Server) handleStatus(w http.ResponseWriter, r *http.Request) {
 	uptime := int64(time.Since(StartTime).Seconds())
+	var watch WatchStats
+	if s.fileWatcher != nil {
+		watch = s.fileWatcher.Stats()
+	}
 	writeJSON(w, http.StatusOK, StatusResponse{
-		Version: Version,
-		Tabs:    s.state.TabCount(),
-		Uptime:  uptime,
+		Version:   Version,
+		Tabs:      s.state.TabCount(),
+		Uptime:    uptime,
+		Content:   s.state.ContentStats(),
+		Memory:    s.state.MemoryStats(),
+		WebSocket: s.hub.Stats(),
+		Images:    s.images.Stats(),
+		Watch:     watch,
 	})
 }
 
 // handleWebSocket handles WebSocket connections.
 func (s *Server) handleWebSocket(w http.ResponseWriter, r *http.Request) {
-	ServeWS(s.hub, w, r, func(data []byte) {
+	ServeWS(s.hub, w, r, func(client *Client, data []byte) {
 		var msg WSMessage
 		if err := json.Unmarshal(data, &msg); err != nil {
 			return
@@ -321,13 +470,27 @@ func (s *Server) handleWebSocket(w http.ResponseWriter, r *http.Request) {
 
 		// Handle client messages
 		switch msg.Type {
+		case "subscribe":
+			switch msg.Mode {
+			case SubscribeFull:
+				client.Subscribe(Subscription{Viewing: msg.ID})
+			case SubscribeMetadata:
+				client.Subscribe(Subscription{Metadata: true, Viewing: msg.ID})
+			}
+		case "view_tab":
+			client.SetViewing(msg.ID)
 		case "activate_tab":
 			if msg.ID != "" {
+				client.SetViewing(msg.ID)
 				s.state.SetActive(msg.ID)
 				s.hub.Broadcast(WSMessage{Type: "tab_activated", ID: msg.ID})
 			}
 		case "close_tab":
-			if msg.ID != "" && s.state.DeleteTab(msg.ID) {
+			if msg.ID == "" {
+				break
+			}
+			s.stopWatching(msg.ID)
+			if s.state.DeleteTab(msg.ID) {
 				s.hub.Broadcast(WSMessage{Type: "tab_deleted", ID: msg.ID})
 			}
 		}
@@ -346,6 +509,38 @@ func writeJSON(w http.ResponseWriter, status int, data interface{}) {
 	json.NewEncoder(w).Encode(data)
 }
 
+// setETag sets the ETag header, asking clients to revalidate before reuse.
+func setETag(w http.ResponseWriter, etag string) {
+	w.Header().Set("ETag", etag)
+	w.Header().Set("Cache-Control", "no-cache")
+}
+
+// checkNotModified sets the ETag header and, if the request's If-None-Match
+// matches it, writes 304 Not Modified and returns true.
+func checkNotModified(w http.ResponseWriter, r *http.Request, etag string) bool {
+	setETag(w, etag)
+	if !etagMatches(r.Header.Get("If-None-Match"), etag) {
+		return false
+	}
+	w.WriteHeader(http.StatusNotModified)
+	return true
+}
+
+// etagMatches reports whether an If-None-Match header value matches etag.
+// Comparison is weak, as RFC 9110 specifies for If-None-Match.
+func etagMatches(header, etag string) bool {
+	if header == "" {
+		return false
+	}
+	for _, candidate := range strings.Split(header, ",") {
+		candidate = strings.TrimSpace(candidate)
+		if candidate == "*" || strings.TrimPrefix(candidate, "W/") == etag {
+			return true
+		}
+	}
+	return false
+}
+
 // writeError writes an error response.
 func writeError(w http.ResponseWriter, status int, msg string) {
 	writeJSON(w, status, ErrorResponse{Error: msg})
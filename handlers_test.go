@@ -4,12 +4,14 @@ import (
 	"bytes"
 	"context"
 	"encoding/json"
+	"fmt"
 	"net/http"
 	"net/http/httptest"
 	"os"
 	"path/filepath"
 	"strings"
 	"testing"
+	"time"
 )
 
 func setupTestServer() *Server {
@@ -407,6 +409,9 @@ func TestCreateTab_UpdateExisting(t *testing.T) {
 	if resp.Created {
 		t.Error("expected Created to be false for update")
 	}
+	if resp.Version != 2 {
+		t.Errorf("expected version 2 in response, got %d", resp.Version)
+	}
 
 	// Verify content was updated
 	tab, _ := srv.state.GetTab("update-test")
@@ -1211,9 +1216,256 @@ func TestCreateTab_ImageFile(t *testing.T) {
 		t.Fatal("tab was not created in state")
 	}
 
-	// Content should be a base64 data URL
-	if !strings.HasPrefix(tab.Content, "data:image/png;base64,") {
-		t.Errorf("expected content to be a data URL, got prefix: %s",
+	// Content should refer to the raw image rather than embed it
+	if tab.Content != RawTabURL(resp.ID) {
+		t.Errorf("expected content to be the raw URL, got prefix: %s",
 			tab.Content[:min(30, len(tab.Content))])
 	}
 }
+
+// TestStatus_ContentDeduplication verifies status reports logical vs. physical bytes.
+func TestStatus_ContentDeduplication(t *testing.T) {
+	srv := setupTestServer()
+
+	srv.state.CreateTab(&Tab{Title: "Tab1", Type: TabTypeMarkdown, Content: "same content"})
+	srv.state.CreateTab(&Tab{Title: "Tab2", Type: TabTypeMarkdown, Content: "same content"})
+
+	req := httptest.NewRequest("GET", "/api/status", nil)
+	w := httptest.NewRecorder()
+
+	srv.handleStatus(w, req)
+
+	var resp StatusResponse
+	if err := json.Unmarshal(w.Body.Bytes(), &resp); err != nil {
+		t.Fatalf("failed to parse response: %v", err)
+	}
+	if resp.Content.LogicalBytes != 24 {
+		t.Errorf("expected 24 logical bytes, got %d", resp.Content.LogicalBytes)
+	}
+	if resp.Content.PhysicalBytes != 12 {
+		t.Errorf("expected 12 physical bytes, got %d", resp.Content.PhysicalBytes)
+	}
+}
+
+// TestPatchTab_Append tests appending to a tab via PATCH.
+func TestPatchTab_Append(t *testing.T) {
+	srv := setupTestServer()
+	srv.state.CreateTab(&Tab{ID: "report", Title: "Report", Type: TabTypeMarkdown, Content: "# Report\n"})
+
+	body := `{"baseVersion": 1, "ops": [{"op": "append", "text": "- done\n"}]}`
+	req := httptest.NewRequest("PATCH", "/api/tabs/report", bytes.NewBufferString(body))
+	req.SetPathValue("id", "report")
+	w := httptest.NewRecorder()
+
+	srv.handlePatchTab(w, req)
+
+	if w.Code != http.StatusOK {
+		t.Fatalf("expected status 200, got %d: %s", w.Code, w.Body.String())
+	}
+
+	var resp PatchTabResponse
+	if err := json.Unmarshal(w.Body.Bytes(), &resp); err != nil {
+		t.Fatalf("failed to parse response: %v", err)
+	}
+	if resp.Version != 2 {
+		t.Errorf("expected version 2, got %d", resp.Version)
+	}
+	if resp.Size != len("# Report\n- done\n") {
+		t.Errorf("expected size %d, got %d", len("# Report\n- done\n"), resp.Size)
+	}
+
+	tab, _ := srv.state.GetTab("report")
+	if tab.Content != "# Report\n- done\n" {
+		t.Errorf("unexpected content %q", tab.Content)
+	}
+}
+
+// TestPatchTab_Errors tests PATCH error responses.
+func TestPatchTab_Errors(t *testing.T) {
+	tests := []struct {
+		name   string
+		id     string
+		body   string
+		status int
+	}{
+		{"invalid JSON", "doc", "not json", http.StatusBadRequest},
+		{"no ops", "doc", `{"ops": []}`, http.StatusBadRequest},
+		{"unknown tab", "missing", `{"ops": [{"op": "append", "text": "x"}]}`, http.StatusNotFound},
+		{"version conflict", "doc", `{"baseVersion": 9, "ops": [{"op": "append", "text": "x"}]}`, http.StatusConflict},
+		{"out of range", "doc", `{"ops": [{"op": "insert", "offset": 99, "text": "x"}]}`, http.StatusBadRequest},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			srv := setupTestServer()
+			srv.state.CreateTab(&Tab{ID: "doc", Title: "Doc", Type: TabTypeMarkdown, Content: "text"})
+
+			req := httptest.NewRequest("PATCH", "/api/tabs/"+tt.id, bytes.NewBufferString(tt.body))
+			req.SetPathValue("id", tt.id)
+			w := httptest.NewRecorder()
+
+			srv.handlePatchTab(w, req)
+
+			if w.Code != tt.status {
+				t.Errorf("expected status %d, got %d: %s", tt.status, w.Code, w.Body.String())
+			}
+		})
+	}
+}
+
+// TestGetTab_ConditionalGet tests ETag and If-None-Match handling on a tab.
+func TestGetTab_ConditionalGet(t *testing.T) {
+	srv := setupTestServer()
+	srv.state.CreateTab(&Tab{ID: "big", Type: TabTypeMarkdown, Content: strings.Repeat("x", 10000)})
+
+	get := func(ifNoneMatch string) *httptest.ResponseRecorder {
+		req := httptest.NewRequest("GET", "/api/tabs/big", nil)
+		req.SetPathValue("id", "big")
+		if ifNoneMatch != "" {
+			req.Header.Set("If-None-Match", ifNoneMatch)
+		}
+		w := httptest.NewRecorder()
+		srv.handleGetTab(w, req)
+		return w
+	}
+
+	first := get("")
+	etag := first.Header().Get("ETag")
+	if first.Code != http.StatusOK || etag == "" {
+		t.Fatalf("expected 200 with ETag, got %d %q", first.Code, etag)
+	}
+	if !strings.HasPrefix(etag, `"`) {
+		t.Errorf("expected strong ETag, got %q", etag)
+	}
+
+	t.Run("matching tag returns 304 without body", func(t *testing.T) {
+		w := get(etag)
+		if w.Code != http.StatusNotModified {
+			t.Fatalf("expected 304, got %d", w.Code)
+		}
+		if w.Body.Len() != 0 {
+			t.Errorf("expected empty body, got %d bytes", w.Body.Len())
+		}
+		if w.Header().Get("ETag") != etag {
+			t.Errorf("expected ETag on 304, got %q", w.Header().Get("ETag"))
+		}
+	})
+
+	t.Run("tag list and weak form match", func(t *testing.T) {
+		if w := get(`"other", W/` + etag); w.Code != http.StatusNotModified {
+			t.Errorf("expected 304, got %d", w.Code)
+		}
+	})
+
+	t.Run("activation keeps tag", func(t *testing.T) {
+		srv.state.CreateTab(&Tab{ID: "other", Content: "o"})
+		srv.state.SetActive("other")
+		if w := get(etag); w.Code != http.StatusNotModified {
+			t.Errorf("expected 304 after switching tabs, got %d", w.Code)
+		}
+	})
+
+	t.Run("content change returns new tag", func(t *testing.T) {
+		srv.state.PatchTab("big", 0, []PatchOp{{Op: PatchOpAppend, Text: "y"}})
+		w := get(etag)
+		if w.Code != http.StatusOK {
+			t.Fatalf("expected 200 after change, got %d", w.Code)
+		}
+		if w.Header().Get("ETag") == etag {
+			t.Error("expected a new ETag after change")
+		}
+	})
+
+	t.Run("recreated tab gets a different tag", func(t *testing.T) {
+		current := get("").Header().Get("ETag")
+		srv.state.DeleteTab("big")
+		time.Sleep(time.Millisecond)
+		srv.state.CreateTab(&Tab{ID: "big", Content: "new"})
+		if w := get(current); w.Code != http.StatusOK {
+			t.Errorf("expected 200 for a recreated tab, got %d", w.Code)
+		}
+	})
+}
+
+// TestListTabs_Pagination tests ?limit= and ?cursor= paging.
+func TestListTabs_Pagination(t *testing.T) {
+	srv := setupTestServer()
+	for i := 0; i < 5; i++ {
+		srv.state.CreateTab(&Tab{ID: fmt.Sprintf("page%d", i), Title: "Tab"})
+	}
+
+	var ids []string
+	url := "/api/tabs?limit=2"
+	for pages := 0; url != ""; pages++ {
+		if pages > 3 {
+			t.Fatal("expected 3 pages")
+		}
+		w := httptest.NewRecorder()
+		srv.handleListTabs(w, httptest.NewRequest("GET", url, nil))
+		if w.Code != http.StatusOK {
+			t.Fatalf("expected status 200, got %d: %s", w.Code, w.Body.String())
+		}
+
+		var resp ListTabsResponse
+		json.Unmarshal(w.Body.Bytes(), &resp)
+		if resp.Total != 5 {
+			t.Errorf("expected total 5, got %d", resp.Total)
+		}
+		for _, tab := range resp.Tabs {
+			ids = append(ids, tab.ID)
+		}
+		url = ""
+		if resp.NextCursor != "" {
+			url = "/api/tabs?limit=2&cursor=" + resp.NextCursor
+		}
+	}
+	if got := strings.Join(ids, ","); got != "page0,page1,page2,page3,page4" {
+		t.Errorf("unexpected paged order: %s", got)
+	}
+
+	for _, query := range []string{"limit=0", "limit=abc", "limit=1001", "limit=2&cursor=bogus"} {
+		w := httptest.NewRecorder()
+		srv.handleListTabs(w, httptest.NewRequest("GET", "/api/tabs?"+query, nil))
+		if w.Code != http.StatusBadRequest {
+			t.Errorf("%s: expected status 400, got %d", query, w.Code)
+		}
+	}
+}
+
+// TestListTabs_ConditionalGet tests ETag and If-None-Match handling on the tab list.
+func TestListTabs_ConditionalGet(t *testing.T) {
+	srv := setupTestServer()
+	srv.state.CreateTab(&Tab{ID: "a", Content: "a"})
+	srv.state.CreateTab(&Tab{ID: "b", Content: "b"})
+
+	list := func(ifNoneMatch string) *httptest.ResponseRecorder {
+		req := httptest.NewRequest("GET", "/api/tabs", nil)
+		if ifNoneMatch != "" {
+			req.Header.Set("If-None-Match", ifNoneMatch)
+		}
+		w := httptest.NewRecorder()
+		srv.handleListTabs(w, req)
+		return w
+	}
+
+	first := list("")
+	etag := first.Header().Get("ETag")
+	if etag == "" {
+		t.Fatal("expected ETag on list response")
+	}
+
+	var resp ListTabsResponse
+	json.Unmarshal(first.Body.Bytes(), &resp)
+	if resp.Tabs[0].Version != 1 {
+		t.Errorf("expected version in summaries, got %d", resp.Tabs[0].Version)
+	}
+
+	if w := list(etag); w.Code != http.StatusNotModified {
+		t.Errorf("expected 304 for unchanged list, got %d", w.Code)
+	}
+
+	srv.state.SetActive("b")
+	if w := list(etag); w.Code != http.StatusOK {
+		t.Errorf("expected 200 after activation, got %d", w.Code)
+	}
+}
@@ -0,0 +1,316 @@
+// Package main provides downscaled variants of image files for display.
+package main
+
+import (
+	"bytes"
+	"container/list"
+	"fmt"
+	"image"
+	"image/draw"
+	"image/gif"
+	"image/jpeg"
+	"image/png"
+	"os"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+const (
+	// defaultImageCacheBytes caps the encoded variants kept in memory.
+	defaultImageCacheBytes = 64 << 20
+
+	// maxScalePixels is the largest image decoded for scaling (about 5K x
+	// 3K, 64 MB as RGBA); bigger ones are served at full resolution.
+	maxScalePixels = 16 << 20
+
+	// maxConcurrentScales bounds images being decoded and scaled at once,
+	// across all files, so their pixel buffers stay within a few hundred MB.
+	maxConcurrentScales = 2
+
+	// scaledJPEGQuality is the quality of downscaled JPEG variants.
+	scaledJPEGQuality = 85
+)
+
+// imageWidthSteps are the widths variants are made at. Requested widths
+// round up to the next step, so window sizes share a few cached variants.
+var imageWidthSteps = []int{320, 640, 960, 1280, 1600, 1920, 2560, 3200, 3840}
+
+// variantKey identifies a scaled variant of a file at one version.
+type variantKey struct {
+	path  string
+	mtime int64
+	size  int64
+	width int
+}
+
+// imageVariant is an encoded scaled image.
+type imageVariant struct {
+	key  variantKey
+	data []byte
+	mime string
+}
+
+// variantCall is a variant being made; concurrent requests wait for it.
+type variantCall struct {
+	done    chan struct{}
+	variant *imageVariant
+	err     error
+}
+
+// imageVariants makes downscaled variants of PNG, JPEG and GIF files and
+// keeps them in an LRU cache bounded by encoded bytes.
+type imageVariants struct {
+	mu       sync.Mutex
+	lru      *list.List // Front is most recently used; values are *imageVariant
+	items    map[variantKey]*list.Element
+	inflight map[variantKey]*variantCall
+	slots    chan struct{} // Semaphore of maxConcurrentScales decodes
+	bytes    int64
+	maxBytes int64
+
+	hits, misses    atomic.Int64
+	decodes         atomic.Int64
+	decodeMicros    atomic.Int64
+	resizes         atomic.Int64
+	resizeMicros    atomic.Int64
+	encodeMicros    atomic.Int64
+	fullResolutions atomic.Int64
+}
+
+// ImageStats reports image scaling work and the variant cache.
+type ImageStats struct {
+	CachedVariants  int   `json:"cachedVariants"`
+	CachedBytes     int64 `json:"cachedBytes"`
+	CacheHits       int64 `json:"cacheHits"`
+	CacheMisses     int64 `json:"cacheMisses"`
+	Decodes         int64 `json:"decodes"`
+	DecodeMicros    int64 `json:"decodeMicros"` // Total time decoding source images
+	Resizes         int64 `json:"resizes"`
+	ResizeMicros    int64 `json:"resizeMicros"`    // Total time downscaling
+	EncodeMicros    int64 `json:"encodeMicros"`    // Total time encoding variants
+	FullResolutions int64 `json:"fullResolutions"` // Width requests served unscaled
+}
+
+// newImageVariants creates an empty cache holding up to maxBytes.
+func newImageVariants(maxBytes int64) *imageVariants {
+	return &imageVariants{
+		lru:      list.New(),
+		items:    make(map[variantKey]*list.Element),
+		inflight: make(map[variantKey]*variantCall),
+		slots:    make(chan struct{}, maxConcurrentScales),
+		maxBytes: maxBytes,
+	}
+}
+
+// variantWidth rounds a requested width up to the next step.
+func variantWidth(width int) int {
+	for _, step := range imageWidthSteps {
+		if width <= step {
+			return step
+		}
+	}
+	return imageWidthSteps[len(imageWidthSteps)-1]
+}
+
+// Get returns the file at path scaled down to about width pixels wide, or
+// nil if the original should be served: it is no wider, too large to
+// decode, animated, or not PNG, JPEG or GIF.
+func (v *imageVariants) Get(path string, info os.FileInfo, width int) (*imageVariant, error) {
+	key := variantKey{path: path, mtime: info.ModTime().UnixNano(), size: info.Size(), width: variantWidth(width)}
+
+	v.mu.Lock()
+	if elem, ok := v.items[key]; ok {
+		v.lru.MoveToFront(elem)
+		v.mu.Unlock()
+		v.hits.Add(1)
+		return elem.Value.(*imageVariant), nil
+	}
+	if call, ok := v.inflight[key]; ok {
+		v.mu.Unlock()
+		<-call.done
+		return call.variant, call.err
+	}
+	call := &variantCall{done: make(chan struct{})}
+	v.inflight[key] = call
+	v.mu.Unlock()
+	v.misses.Add(1)
+
+	call.variant, call.err = v.make(key)
+	if call.variant == nil && call.err == nil {
+		v.fullResolutions.Add(1)
+	}
+
+	v.mu.Lock()
+	delete(v.inflight, key)
+	if call.variant != nil {
+		v.addLocked(call.variant)
+	}
+	v.mu.Unlock()
+	close(call.done)
+	return call.variant, call.err
+}
+
+// addLocked caches a variant, evicting the least recently used ones.
+func (v *imageVariants) addLocked(variant *imageVariant) {
+	size := int64(len(variant.data))
+	if size > v.maxBytes {
+		return
+	}
+	for v.bytes+size > v.maxBytes {
+		oldest := v.lru.Back()
+		evicted := v.lru.Remove(oldest).(*imageVariant)
+		delete(v.items, evicted.key)
+		v.bytes -= int64(len(evicted.data))
+	}
+	v.items[variant.key] = v.lru.PushFront(variant)
+	v.bytes += size
+}
+
+// make decodes, scales and encodes a variant.
+func (v *imageVariants) make(key variantKey) (*imageVariant, error) {
+	f, err := os.Open(key.path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	cfg, format, err := image.DecodeConfig(f)
+	if err != nil || cfg.Width <= key.width || cfg.Width*cfg.Height > maxScalePixels {
+		return nil, nil // Not a decodable format, or nothing to gain
+	}
+	if _, err := f.Seek(0, 0); err != nil {
+		return nil, err
+	}
+
+	v.slots <- struct{}{}
+	defer func() { <-v.slots }()
+
+	start := time.Now()
+	var src image.Image
+	switch format {
+	case "png":
+		src, err = png.Decode(f)
+	case "jpeg":
+		src, err = jpeg.Decode(f)
+	case "gif":
+		var anim *gif.GIF
+		if anim, err = gif.DecodeAll(f); err == nil {
+			if len(anim.Image) != 1 {
+				return nil, nil // Keep animations intact
+			}
+			src = anim.Image[0]
+		}
+	default:
+		return nil, nil
+	}
+	if err != nil {
+		return nil, fmt.Errorf("cannot decode image: %w", err)
+	}
+	v.decodes.Add(1)
+	v.decodeMicros.Add(time.Since(start).Microseconds())
+
+	start = time.Now()
+	height := max(1, (cfg.Height*key.width+cfg.Width/2)/cfg.Width)
+	scaled := downscale(toRGBA(src), key.width, height)
+	v.resizes.Add(1)
+	v.resizeMicros.Add(time.Since(start).Microseconds())
+
+	start = time.Now()
+	var buf bytes.Buffer
+	variant := &imageVariant{key: key, mime: "image/png"}
+	if format == "jpeg" {
+		variant.mime = "image/jpeg"
+		err = jpeg.Encode(&buf, scaled, &jpeg.Options{Quality: scaledJPEGQuality})
+	} else {
+		// GIFs become PNG, which keeps their colours without re-quantizing
+		err = png.Encode(&buf, scaled)
+	}
+	if err != nil {
+		return nil, fmt.Errorf("cannot encode image: %w", err)
+	}
+	v.encodeMicros.Add(time.Since(start).Microseconds())
+	variant.data = buf.Bytes()
+	return variant, nil
+}
+
+// Stats returns scaling counters and the cache size.
+func (v *imageVariants) Stats() ImageStats {
+	v.mu.Lock()
+	cached, bytes := len(v.items), v.bytes
+	v.mu.Unlock()
+	return ImageStats{
+		CachedVariants:  cached,
+		CachedBytes:     bytes,
+		CacheHits:       v.hits.Load(),
+		CacheMisses:     v.misses.Load(),
+		Decodes:         v.decodes.Load(),
+		DecodeMicros:    v.decodeMicros.Load(),
+		Resizes:         v.resizes.Load(),
+		ResizeMicros:    v.resizeMicros.Load(),
+		EncodeMicros:    v.encodeMicros.Load(),
+		FullResolutions: v.fullResolutions.Load(),
+	}
+}
+
+// toRGBA returns img as premultiplied RGBA at the origin, converting with
+// the image/draw fast paths where they exist.
+func toRGBA(img image.Image) *image.RGBA {
+	if rgba, ok := img.(*image.RGBA); ok && rgba.Rect.Min == (image.Point{}) {
+		return rgba
+	}
+	b := img.Bounds()
+	rgba := image.NewRGBA(image.Rect(0, 0, b.Dx(), b.Dy()))
+	draw.Draw(rgba, rgba.Rect, img, b.Min, draw.Src)
+	return rgba
+}
+
+// downscale shrinks src to w x h by averaging the block of source pixels
+// under each destination pixel (area averaging), which avoids the aliasing
+// of point sampling at large reductions. Alpha is premultiplied, so
+// transparent pixels do not darken their neighbours.
+func downscale(src *image.RGBA, w, h int) *image.RGBA {
+	sw, sh := src.Rect.Dx(), src.Rect.Dy()
+	dst := image.NewRGBA(image.Rect(0, 0, w, h))
+
+	// Destination column of each source column, and source columns per destination column
+	colOf := make([]int, sw)
+	colCount := make([]uint64, w)
+	for sx := range colOf {
+		colOf[sx] = sx * w / sw
+		colCount[colOf[sx]]++
+	}
+
+	sums := make([]uint64, 4*w)
+	rows := uint64(0)
+	flush := func(dy int) {
+		out := dst.Pix[dy*dst.Stride:]
+		for dx := 0; dx < w; dx++ {
+			n := colCount[dx] * rows
+			for c := 0; c < 4; c++ {
+				out[4*dx+c] = uint8((sums[4*dx+c] + n/2) / n)
+				sums[4*dx+c] = 0
+			}
+		}
+		rows = 0
+	}
+
+	dy := 0
+	for sy := 0; sy < sh; sy++ {
+		if next := sy * h / sh; next != dy {
+			flush(dy)
+			dy = next
+		}
+		row := src.Pix[sy*src.Stride : sy*src.Stride+4*sw]
+		for sx, dx := range colOf {
+			p, s := row[4*sx:4*sx+4:4*sx+4], sums[4*dx:4*dx+4:4*dx+4]
+			s[0] += uint64(p[0])
+			s[1] += uint64(p[1])
+			s[2] += uint64(p[2])
+			s[3] += uint64(p[3])
+		}
+		rows++
+	}
+	flush(dy)
+	return dst
+}
@@ -0,0 +1,147 @@
+package main
+
+import (
+	"bytes"
+	"image"
+	"image/color"
+	"image/png"
+	"net/http"
+	"net/http/httptest"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+)
+
+// writePNG writes a w x h gradient PNG to a temporary file.
+func writePNG(t testing.TB, w, h int) string {
+	t.Helper()
+	img := image.NewNRGBA(image.Rect(0, 0, w, h))
+	for y := 0; y < h; y++ {
+		for x := 0; x < w; x++ {
+			img.SetNRGBA(x, y, color.NRGBA{uint8(x), uint8(y), 128, 255})
+		}
+	}
+	var buf bytes.Buffer
+	if err := png.Encode(&buf, img); err != nil {
+		t.Fatalf("failed to encode image: %v", err)
+	}
+	path := filepath.Join(t.TempDir(), "large.png")
+	if err := os.WriteFile(path, buf.Bytes(), 0644); err != nil {
+		t.Fatalf("failed to write image: %v", err)
+	}
+	return path
+}
+
+// TestDownscale_AveragesBlocks tests that each destination pixel is the
+// average of the source pixels under it.
+func TestDownscale_AveragesBlocks(t *testing.T) {
+	src := image.NewRGBA(image.Rect(0, 0, 4, 2))
+	for x := 0; x < 4; x++ {
+		v := uint8(0)
+		if x%2 == 1 {
+			v = 200
+		}
+		src.SetRGBA(x, 0, color.RGBA{v, v, v, 255})
+		src.SetRGBA(x, 1, color.RGBA{v, v, v, 255})
+	}
+
+	dst := downscale(src, 2, 1)
+	for x := 0; x < 2; x++ {
+		if got := dst.RGBAAt(x, 0); got != (color.RGBA{100, 100, 100, 255}) {
+			t.Errorf("pixel %d: expected grey 100, got %v", x, got)
+		}
+	}
+}
+
+// TestRawTab_ScaledImage tests that ?w= serves a cached variant scaled to
+// the next width step, and the original when it is not wider.
+func TestRawTab_ScaledImage(t *testing.T) {
+	srv := setupTestServer()
+	path := writePNG(t, 2000, 1000)
+	tab, err := buildTab(&CreateTabRequest{ID: "img", File: path})
+	if err != nil {
+		t.Fatalf("buildTab failed: %v", err)
+	}
+	srv.state.CreateTab(tab)
+
+	getScaled := func(width string) *http.Response {
+		req := httptest.NewRequest("GET", RawTabURL("img")+"?w="+width, nil)
+		req.SetPathValue("id", "img")
+		w := httptest.NewRecorder()
+		srv.handleRawTab(w, req)
+		return w.Result()
+	}
+
+	for i := 0; i < 2; i++ {
+		resp := getScaled("500")
+		cfg, format, err := image.DecodeConfig(resp.Body)
+		if err != nil || format != "png" || cfg.Width != 640 || cfg.Height != 320 {
+			t.Fatalf("expected a 640x320 PNG, got %dx%d %s (%v)", cfg.Width, cfg.Height, format, err)
+		}
+	}
+	stats := srv.images.Stats()
+	if stats.Decodes != 1 || stats.CacheHits != 1 || stats.CachedVariants != 1 {
+		t.Errorf("expected one decode then a cache hit, got %+v", stats)
+	}
+
+	resp := getScaled("4000")
+	if cfg, _, _ := image.DecodeConfig(resp.Body); cfg.Width != 2000 {
+		t.Errorf("expected the original for a wider request, got width %d", cfg.Width)
+	}
+	if stats := srv.images.Stats(); stats.Decodes != 1 || stats.FullResolutions != 1 {
+		t.Errorf("expected the original without decoding, got %+v", stats)
+	}
+}
+
+// TestImageVariants_BoundsConcurrentScales tests that decodes wait for a
+// free slot once maxConcurrentScales are running.
+func TestImageVariants_BoundsConcurrentScales(t *testing.T) {
+	v := newImageVariants(defaultImageCacheBytes)
+	path := writePNG(t, 800, 400)
+	info, err := os.Stat(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	for i := 0; i < maxConcurrentScales; i++ {
+		v.slots <- struct{}{} // Other images being scaled
+	}
+
+	done := make(chan *imageVariant)
+	go func() {
+		variant, _ := v.Get(path, info, 320)
+		done <- variant
+	}()
+	select {
+	case <-done:
+		t.Fatal("expected the decode to wait for a slot")
+	case <-time.After(50 * time.Millisecond):
+	}
+
+	<-v.slots
+	select {
+	case variant := <-done:
+		if variant == nil {
+			t.Error("expected a variant once a slot was free")
+		}
+	case <-time.After(2 * time.Second):
+		t.Fatal("timeout waiting for the decode")
+	}
+}
+
+// BenchmarkImageVariant measures decoding, scaling and encoding a 4K
+// screenshot for a typical window width, without the cache.
+func BenchmarkImageVariant(b *testing.B) {
+	path := writePNG(b, 3840, 2160)
+	info, err := os.Stat(path)
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		v := newImageVariants(defaultImageCacheBytes)
+		if variant, err := v.Get(path, info, 1280); err != nil || variant == nil {
+			b.Fatalf("expected a variant, got %v", err)
+		}
+	}
+}
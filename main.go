@@ -31,6 +31,17 @@ OPTIONS:
   --open, -o            Open browser automatically on start
   --type, -t <TYPE>     Content type: markdown, code, diff, image (default: auto-detect)
   --title <TITLE>       Tab title (default: filename)
+  --max-memory <SIZE>   Budget for in-memory tab content, e.g. 512MB, 2GB
+                        (default: unlimited). Least recently used tabs spill
+                        to compressed temp files or are re-read from disk.
+  --state-dir <DIR>     Save tabs in DIR and restore them on the next start
+  --update-rate <HZ>    Max pushes per second of a rewritten tab (default: 10;
+                        background tabs get a quarter; 0 = no limit)
+  --tail-window <SIZE>  How much of a followed file a tab keeps, e.g. 1MB
+                        (default: 4MB)
+  --watch-backend <B>   File watching: auto, fsnotify or poll (default: auto;
+                        auto polls files on network filesystems and files
+                        fsnotify cannot watch)
   --version, -v         Show version information
   --help, -h            Show this help message
 
@@ -42,10 +53,14 @@ CONTENT TYPES:
 
 API ENDPOINTS:
   POST   /api/tabs              Create or update a tab
-  GET    /api/tabs              List all tabs
+  GET    /api/tabs              List tabs (?limit=N&cursor=C to page)
   GET    /api/tabs/:id          Get tab content
+  GET    /api/tabs/:id/raw      Get raw content bytes (images, ?w=width, Range)
+  PATCH  /api/tabs/:id          Append/insert/replace content (delta update)
   DELETE /api/tabs/:id          Delete a tab
   POST   /api/tabs/:id/activate Switch to a tab
+  POST   /api/tabs/:id/stream   Append a streamed (chunked) body to a tab
+  POST   /api/tabs/batch        Create/update/delete many tabs in one request
   DELETE /api/tabs              Clear all tabs
   GET    /api/status            Server status
 
@@ -127,9 +142,34 @@ func runServe(args []string) {
 	contentType := fs.String("type", "", "Content type (markdown, code, diff, image)")
 	fs.StringVar(contentType, "t", "", "Content type (shorthand)")
 	title := fs.String("title", "", "Tab title")
+	maxMemory := fs.String("max-memory", "", "Memory budget for tab content (e.g. 512MB, 2GB)")
+	stateDir := fs.String("state-dir", "", "Directory to persist tabs across restarts")
+	updateRate := fs.Int("update-rate", defaultUpdateRate, "Max WebSocket pushes per second of each rewritten tab (0 = no limit)")
+	tailWindow := fs.String("tail-window", "", "Bytes of a followed file kept in its tab (e.g. 1MB; default 4MB)")
+	watchBackend := fs.String("watch-backend", WatchBackendAuto, "File watching backend: auto, fsnotify or poll")
 
 	fs.Parse(args)
 
+	var memoryLimit int64
+	if *maxMemory != "" {
+		limit, err := ParseByteSize(*maxMemory)
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "Error: --max-memory: %v\n", err)
+			os.Exit(1)
+		}
+		memoryLimit = limit
+	}
+
+	var tailBytes int64
+	if *tailWindow != "" {
+		window, err := ParseByteSize(*tailWindow)
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "Error: --tail-window: %v\n", err)
+			os.Exit(1)
+		}
+		tailBytes = window
+	}
+
 	// Get optional file argument
 	file := ""
 	if fs.NArg() > 0 {
@@ -138,10 +178,32 @@ func runServe(args []string) {
 
 	// Create server
 	srv := NewServer()
+	srv.state.SetMemoryLimit(memoryLimit)
+	srv.hub.SetUpdateRate(*updateRate)
+	srv.SetTailWindow(tailBytes)
+	if *watchBackend != WatchBackendAuto {
+		if err := srv.SetWatchBackend(*watchBackend); err != nil {
+			fmt.Fprintf(os.Stderr, "Error: --watch-backend: %v\n", err)
+			os.Exit(1)
+		}
+	}
+
+	// Restore the previous session before adding the initial tab
+	if *stateDir != "" {
+		start := time.Now()
+		restored, err := srv.EnablePersistence(*stateDir)
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "Error restoring state from %s: %v\n", *stateDir, err)
+			os.Exit(1)
+		}
+		if restored > 0 {
+			fmt.Printf("Restored %d tabs from %s in %v\n", restored, *stateDir, time.Since(start).Round(time.Millisecond))
+		}
+	}
 
 	// If a file is provided, create initial tab
 	if file != "" {
-		content, err := ReadFileContent(file)
+		content, err := readSourceContent("initial", file)
 		if err != nil {
 			fmt.Fprintf(os.Stderr, "Error reading file: %v\n", err)
 			os.Exit(1)
@@ -164,6 +226,9 @@ func runServe(args []string) {
 			Content:  content,
 			Language: DetectLanguage(file, content),
 		}
+		if IsImageFile(file) {
+			tab.SourcePath = watchPath(file) // Streamed from disk by GET /api/tabs/initial/raw
+		}
 		srv.state.CreateTab(tab)
 	}
 
@@ -0,0 +1,301 @@
+// Package main provides a memory budget for tab content with LRU eviction.
+package main
+
+import (
+	"fmt"
+	"log"
+	"sort"
+	"strconv"
+	"strings"
+	"sync/atomic"
+	"time"
+)
+
+// memoryBudget holds the resident content limit and eviction counters.
+// stop is guarded by State.mu; the rest is safe for lock-free readers.
+type memoryBudget struct {
+	limit     atomic.Int64  // Resident content budget in bytes; 0 disables eviction
+	wake      chan struct{} // Signals the background evictor (buffered, 1; set by NewState)
+	stop      chan struct{} // Closed to stop the background evictor; nil when not running
+	seen      atomic.Int64  // BlobStore growth count when the last eviction pass started
+	evictions atomic.Int64
+	drops     atomic.Int64
+	reloads   atomic.Int64
+}
+
+// MemoryStats reports the memory budget and eviction activity.
+type MemoryStats struct {
+	Limit         int64 `json:"limit"`         // Resident content budget in bytes (0 = unlimited)
+	ResidentBytes int64 `json:"residentBytes"` // Unique content bytes currently in memory
+	Evictions     int64 `json:"evictions"`     // Tab contents spilled to disk or dropped
+	Drops         int64 `json:"drops"`         // File-backed contents dropped (re-read on demand)
+	Reloads       int64 `json:"reloads"`       // Dropped contents re-read from their source file
+}
+
+// SetMemoryLimit sets the budget for resident tab content in bytes and starts
+// the background evictor. When content exceeds the budget, the least recently
+// used tabs are evicted: file-backed tabs drop their content and re-read it
+// from disk on next access, others spill to compressed temp files.
+// A limit of 0 disables eviction.
+func (s *State) SetMemoryLimit(limit int64) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	s.memory.limit.Store(limit)
+	if limit > 0 && s.memory.stop == nil {
+		s.memory.stop = make(chan struct{})
+		go s.runEvictor(s.memory.wake, s.memory.stop)
+	}
+	s.requestEviction()
+}
+
+// runEvictor runs eviction passes whenever woken, until stopped.
+func (s *State) runEvictor(wake, stop <-chan struct{}) {
+	for {
+		select {
+		case <-stop:
+			return
+		case <-wake:
+			s.Evict()
+		}
+	}
+}
+
+// requestEviction wakes the background evictor without blocking.
+func (s *State) requestEviction() {
+	if s.memory.limit.Load() <= 0 {
+		return
+	}
+	select {
+	case s.memory.wake <- struct{}{}:
+	default:
+	}
+}
+
+// Evict runs one eviction pass, freeing the least recently used content
+// until resident bytes are within the limit. Closed tabs go first; the active
+// tab and streaming tabs are never evicted. Spill files are written without
+// holding the state lock. Returns the number of resident bytes freed.
+func (s *State) Evict() int64 {
+	s.memory.seen.Store(s.blobs.grown.Load())
+	s.mu.Lock()
+	limit := s.memory.limit.Load()
+	before := s.blobs.Stats().ResidentBytes
+	over := before - limit
+	if limit <= 0 || over <= 0 {
+		s.mu.Unlock()
+		return 0
+	}
+
+	var activeBlob *Blob
+	if active, exists := s.tabs[s.activeID]; exists {
+		activeBlob = active.blob
+	}
+
+	// Drop file-backed content inline (no I/O); collect the rest for spilling
+	var toSpill []*Blob
+	var planned int64
+	for _, tab := range s.evictionCandidatesLocked() {
+		if planned >= over {
+			break
+		}
+		if tab.blob == nil || tab.blob == activeBlob || !s.blobs.Resident(tab.blob) {
+			continue
+		}
+		planned += tab.blob.Size()
+		if s.droppableLocked(tab) {
+			s.dropLocked(tab)
+			continue
+		}
+		s.blobs.Retain(tab.blob)
+		toSpill = append(toSpill, tab.blob)
+	}
+	freed := before - s.blobs.Stats().ResidentBytes
+	s.mu.Unlock()
+
+	for _, blob := range toSpill {
+		if freed < over {
+			n, err := s.blobs.Spill(blob)
+			if err != nil {
+				log.Printf("Warning: cannot spill tab content: %v", err)
+			} else if n > 0 {
+				s.memory.evictions.Add(1)
+				freed += n
+			}
+		}
+		s.blobs.Release(blob)
+	}
+	return freed
+}
+
+// evictionCandidatesLocked returns evictable tabs, coldest first: closed tabs
+// (oldest first), then open tabs by last access. Active and streaming tabs
+// are excluded. Caller must hold the lock.
+func (s *State) evictionCandidatesLocked() []*Tab {
+	open := make([]*Tab, 0, len(s.tabs))
+	for id, tab := range s.tabs {
+		if id != s.activeID && !tab.Streaming {
+			open = append(open, tab)
+		}
+	}
+	sort.Slice(open, func(i, j int) bool {
+		return open[i].access.Load() < open[j].access.Load()
+	})
+
+	candidates := make([]*Tab, 0, len(s.closedTabs)+len(open))
+	candidates = append(candidates, s.closedTabs...)
+	return append(candidates, open...)
+}
+
+// droppableLocked reports whether a tab's content can be discarded and
+// re-read from its source file. Caller must hold the lock.
+func (s *State) droppableLocked(tab *Tab) bool {
+	return s.tabs[tab.ID] == tab && tab.fileSynced && tab.SourcePath != "" && !tab.Stale
+}
+
+// dropLocked releases a file-backed tab's content. Caller must hold the lock.
+func (s *State) dropLocked(tab *Tab) {
+	tab.droppedHash = tab.blob.Hash()
+	s.blobs.Release(tab.blob)
+	tab.blob = nil
+	tab.dropped = true
+	s.memory.evictions.Add(1)
+	s.memory.drops.Add(1)
+	// Readers must not use the released blob; content is unchanged, so no commit
+	s.publishTabLocked(tab)
+}
+
+// lockLoaded takes the write lock and returns the tab with the given ID,
+// re-reading its content first if it was dropped. Like Evict's spills, the
+// file is read and hashed without the lock, so a slow disk does not hold up
+// every other reader and writer; the content is installed only if the tab is
+// still the dropped tab that was read, otherwise it is checked again.
+// Returns with the lock held, whether or not the tab exists.
+func (s *State) lockLoaded(id string) (*Tab, bool) {
+	s.mu.Lock()
+	for {
+		tab, exists := s.tabs[id]
+		if !exists || !tab.dropped {
+			return tab, exists
+		}
+		path, version := tab.SourcePath, tab.Version
+		s.mu.Unlock()
+
+		var blob *Blob
+		content, err := readSourceContent(id, path)
+		if err == nil {
+			blob = s.blobs.Put(content)
+		}
+
+		s.mu.Lock()
+		if s.tabs[id] == tab && tab.dropped && tab.SourcePath == path && tab.Version == version {
+			s.reloadLocked(tab, blob, err)
+		} else {
+			s.blobs.Release(blob)
+		}
+	}
+}
+
+// reloadLocked installs dropped content re-read from the tab's source file,
+// taking over the reference to its blob, or the error reading it. If the file changed in the meantime the version
+// is bumped; if it could no longer be read the tab is marked stale. Either
+// change is reported to onReload. Caller must hold the write lock.
+func (s *State) reloadLocked(tab *Tab, blob *Blob, err error) {
+	tab.dropped = false
+	if err != nil {
+		log.Printf("Warning: cannot reload %s for tab %s: %v", tab.SourcePath, tab.ID, err)
+		tab.fileSynced = false
+		tab.Stale = true
+		tab.Version++
+		s.commitTabLocked(tab)
+		s.notifyReloadLocked(tab.ID)
+		return
+	}
+
+	tab.blob = blob
+	var hash BlobHash
+	if tab.blob != nil {
+		hash = tab.blob.Hash()
+	}
+	if hash != tab.droppedHash {
+		tab.Version++
+		s.commitTabLocked(tab)
+		s.notifyReloadLocked(tab.ID)
+	} else {
+		s.publishTabLocked(tab)
+	}
+	s.memory.reloads.Add(1)
+}
+
+// notifyReloadLocked reports a tab changed by reloadLocked to onReload on
+// its own goroutine, since the lock is held. Caller must hold the lock.
+func (s *State) notifyReloadLocked(id string) {
+	if s.onReload != nil {
+		go s.onReload(id)
+	}
+}
+
+// touch marks a tab as recently used, and wakes the evictor if resident
+// content grew since its last pass. Reads that load nothing leave it alone,
+// so content that cannot be evicted does not cost a pass per read.
+// It is safe without the lock: copies of a tab share its access clock.
+func (s *State) touch(tab *Tab) {
+	tab.access.Store(time.Now().UnixNano())
+	if s.blobs.grown.Load() != s.memory.seen.Load() {
+		s.requestEviction()
+	}
+}
+
+// MemoryStats returns the memory budget and eviction counters.
+func (s *State) MemoryStats() MemoryStats {
+	return MemoryStats{
+		Limit:         s.memory.limit.Load(),
+		ResidentBytes: s.blobs.Stats().ResidentBytes,
+		Evictions:     s.memory.evictions.Load(),
+		Drops:         s.memory.drops.Load(),
+		Reloads:       s.memory.reloads.Load(),
+	}
+}
+
+// Close writes a final snapshot if persistence is enabled, stops the
+// background evictor and removes spill files.
+func (s *State) Close() error {
+	if err := s.closePersistence(); err != nil {
+		log.Printf("Warning: cannot save state: %v", err)
+	}
+
+	s.mu.Lock()
+	if s.memory.stop != nil {
+		close(s.memory.stop)
+		s.memory.stop = nil
+	}
+	s.mu.Unlock()
+
+	return s.blobs.Close()
+}
+
+// ParseByteSize parses a size such as "512MB", "2GB", "64k" or "1048576".
+// Units are binary (1KB = 1024 bytes) and case-insensitive.
+func ParseByteSize(s string) (int64, error) {
+	str := strings.ToUpper(strings.TrimSpace(s))
+	multiplier := int64(1)
+	for _, unit := range []struct {
+		suffix string
+		value  int64
+	}{
+		{"GB", 1 << 30}, {"MB", 1 << 20}, {"KB", 1 << 10},
+		{"G", 1 << 30}, {"M", 1 << 20}, {"K", 1 << 10}, {"B", 1},
+	} {
+		if strings.HasSuffix(str, unit.suffix) {
+			str = strings.TrimSpace(strings.TrimSuffix(str, unit.suffix))
+			multiplier = unit.value
+			break
+		}
+	}
+
+	n, err := strconv.ParseFloat(str, 64)
+	if err != nil || n < 0 {
+		return 0, fmt.Errorf("invalid size %q", s)
+	}
+	return int64(n * float64(multiplier)), nil
+}
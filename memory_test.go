@@ -0,0 +1,290 @@
+package main
+
+import (
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+)
+
+// newBudgetState creates a state with three 1000-byte tabs (a active) and
+// the given limit, without starting the background evictor.
+func newBudgetState(t *testing.T, limit int64) *State {
+	t.Helper()
+	state := NewState()
+	t.Cleanup(func() { state.Close() })
+
+	for _, id := range []string{"a", "b", "c"} {
+		state.CreateTab(&Tab{ID: id, Type: TabTypeMarkdown, Content: strings.Repeat(id, 1000)})
+	}
+	state.memory.limit.Store(limit)
+	return state
+}
+
+// TestEvict_SpillsColdTabs tests that least recently used tabs are spilled.
+func TestEvict_SpillsColdTabs(t *testing.T) {
+	state := newBudgetState(t, 1500)
+	state.GetTab("b") // b is now warmer than c
+
+	freed := state.Evict()
+	if freed < 1500 {
+		t.Errorf("expected at least 1500 bytes freed, got %d", freed)
+	}
+
+	stats := state.MemoryStats()
+	if stats.ResidentBytes > 1500 {
+		t.Errorf("expected resident bytes within limit, got %d", stats.ResidentBytes)
+	}
+	if stats.Evictions != 2 {
+		t.Errorf("expected 2 evictions, got %d", stats.Evictions)
+	}
+
+	state.mu.RLock()
+	activeResident := state.blobs.Resident(state.tabs["a"].blob)
+	state.mu.RUnlock()
+	if !activeResident {
+		t.Error("expected active tab to stay resident")
+	}
+
+	// Evicted content loads back transparently
+	tab, _ := state.GetTab("c")
+	if tab.Content != strings.Repeat("c", 1000) {
+		t.Error("expected spilled content to load back")
+	}
+	if loads := state.ContentStats().Loads; loads != 1 {
+		t.Errorf("expected 1 load, got %d", loads)
+	}
+}
+
+// TestEvict_ColdestFirst tests eviction order by last access.
+func TestEvict_ColdestFirst(t *testing.T) {
+	state := newBudgetState(t, 2000)
+	state.GetTab("b")
+	state.GetTab("c") // b is now colder than c
+
+	state.Evict()
+
+	state.mu.RLock()
+	defer state.mu.RUnlock()
+	if state.blobs.Resident(state.tabs["b"].blob) {
+		t.Error("expected coldest tab b to be evicted")
+	}
+	if !state.blobs.Resident(state.tabs["c"].blob) {
+		t.Error("expected recently used tab c to stay resident")
+	}
+}
+
+// TestEvict_ClosedTabsFirst tests that recently closed tabs are evicted before open ones.
+func TestEvict_ClosedTabsFirst(t *testing.T) {
+	state := newBudgetState(t, 2000)
+	state.GetTab("b")
+	state.DeleteTab("c")
+
+	state.Evict()
+
+	state.mu.RLock()
+	defer state.mu.RUnlock()
+	if state.blobs.Resident(state.closedTabs[0].blob) {
+		t.Error("expected closed tab to be evicted")
+	}
+	if !state.blobs.Resident(state.tabs["b"].blob) {
+		t.Error("expected open tab to stay resident")
+	}
+}
+
+// TestEvict_SkipsStreamingTabs tests that tabs receiving a stream stay resident.
+func TestEvict_SkipsStreamingTabs(t *testing.T) {
+	state := newBudgetState(t, 0)
+	state.SetStreaming("b", true)
+	state.SetStreaming("c", true)
+	state.memory.limit.Store(1)
+
+	if freed := state.Evict(); freed != 0 {
+		t.Errorf("expected nothing evicted, freed %d", freed)
+	}
+}
+
+// TestEvict_DropsFileBackedTabs tests that file-backed content is dropped and re-read.
+func TestEvict_DropsFileBackedTabs(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "notes.md")
+	os.WriteFile(path, []byte("# Notes"), 0644)
+
+	state := NewState()
+	defer state.Close()
+	state.CreateTab(&Tab{ID: "active", Content: strings.Repeat("x", 100)})
+	state.CreateTab(&Tab{ID: "file", Type: TabTypeMarkdown, Content: "# Notes", SourcePath: path})
+	state.memory.limit.Store(100)
+
+	state.Evict()
+
+	stats := state.MemoryStats()
+	if stats.Drops != 1 {
+		t.Errorf("expected 1 drop, got %d", stats.Drops)
+	}
+	if spills := state.ContentStats().Spills; spills != 0 {
+		t.Errorf("expected no spill for file-backed tab, got %d", spills)
+	}
+
+	t.Run("unchanged file reloads without version bump", func(t *testing.T) {
+		before := state.ListTabs()[1].Version
+		tab, _ := state.GetTab("file")
+		if tab.Content != "# Notes" {
+			t.Errorf("expected reloaded content, got %q", tab.Content)
+		}
+		if tab.Version != before {
+			t.Errorf("expected version %d kept, got %d", before, tab.Version)
+		}
+		if reloads := state.MemoryStats().Reloads; reloads != 1 {
+			t.Errorf("expected 1 reload, got %d", reloads)
+		}
+	})
+
+	t.Run("changed file bumps version", func(t *testing.T) {
+		state.Evict()
+		os.WriteFile(path, []byte("# Edited"), 0644)
+
+		before := state.ListTabs()[1].Version
+		tab, _ := state.GetTab("file")
+		if tab.Content != "# Edited" {
+			t.Errorf("expected new file content, got %q", tab.Content)
+		}
+		if tab.Version != before+1 {
+			t.Errorf("expected version %d, got %d", before+1, tab.Version)
+		}
+	})
+
+	t.Run("missing file marks tab stale", func(t *testing.T) {
+		state.Evict()
+		os.Remove(path)
+
+		tab, _ := state.GetTab("file")
+		if !tab.Stale {
+			t.Error("expected tab to be stale when source file is gone")
+		}
+	})
+}
+
+// TestEvict_ReloadBroadcasts tests that a dropped tab whose file changed is
+// announced when it is reloaded, so clients learn its new version.
+func TestEvict_ReloadBroadcasts(t *testing.T) {
+	srv := setupTestServer()
+	client := &Client{hub: srv.hub, send: make(chan []byte, 16)}
+	srv.hub.register <- client
+
+	path := filepath.Join(t.TempDir(), "notes.md")
+	os.WriteFile(path, []byte("# Notes"), 0644)
+	srv.state.CreateTab(&Tab{ID: "active", Content: strings.Repeat("x", 100)})
+	srv.state.CreateTab(&Tab{ID: "file", Type: TabTypeMarkdown, Content: "# Notes", SourcePath: path})
+	srv.state.memory.limit.Store(100)
+	srv.state.Evict()
+
+	os.WriteFile(path, []byte("# Edited"), 0644)
+	tab, _ := srv.state.GetTab("file")
+	msg := receive(t, client)
+	if msg.Type != "tab_updated" || msg.Tab.ID != "file" || msg.Tab.Version != tab.Version {
+		t.Errorf("expected tab_updated at version %d, got %s %+v", tab.Version, msg.Type, msg.Tab)
+	}
+}
+
+// TestEvict_WakesOnlyOnGrowth tests that reads wake the evictor only after
+// resident content grew since its last pass.
+func TestEvict_WakesOnlyOnGrowth(t *testing.T) {
+	state := newBudgetState(t, 1)
+	state.Evict()
+	select {
+	case <-state.memory.wake: // Drain wakes from setup
+	default:
+	}
+
+	state.GetTab("a") // Active, so the pass freed nothing
+	select {
+	case <-state.memory.wake:
+		t.Error("expected a read to leave the evictor asleep")
+	default:
+	}
+
+	state.CreateTab(&Tab{ID: "d", Content: "more"})
+	select {
+	case <-state.memory.wake:
+	default:
+		t.Error("expected new content to wake the evictor")
+	}
+}
+
+// TestEvict_PatchedFileTabIsSpilled tests that a file tab with local edits is not dropped.
+func TestEvict_PatchedFileTabIsSpilled(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "log.txt")
+	os.WriteFile(path, []byte("line 1\n"), 0644)
+
+	state := NewState()
+	defer state.Close()
+	state.CreateTab(&Tab{ID: "active", Content: "x"})
+	state.CreateTab(&Tab{ID: "file", Content: "line 1\n", SourcePath: path})
+	state.PatchTab("file", 0, []PatchOp{{Op: PatchOpAppend, Text: "local\n"}})
+	state.memory.limit.Store(1)
+
+	state.Evict()
+
+	if drops := state.MemoryStats().Drops; drops != 0 {
+		t.Errorf("expected no drops, got %d", drops)
+	}
+	tab, _ := state.GetTab("file")
+	if tab.Content != "line 1\nlocal\n" {
+		t.Errorf("expected patched content preserved, got %q", tab.Content)
+	}
+}
+
+// TestSetMemoryLimit_BackgroundEviction tests that the evictor runs on its own.
+func TestSetMemoryLimit_BackgroundEviction(t *testing.T) {
+	state := NewState()
+	defer state.Close()
+	state.SetMemoryLimit(1000)
+
+	for _, id := range []string{"a", "b", "c", "d"} {
+		state.CreateTab(&Tab{ID: id, Content: strings.Repeat(id, 1000)})
+	}
+
+	deadline := time.Now().Add(2 * time.Second)
+	for state.MemoryStats().ResidentBytes > 1000 {
+		if time.Now().After(deadline) {
+			t.Fatalf("expected background eviction, resident %d", state.MemoryStats().ResidentBytes)
+		}
+		time.Sleep(5 * time.Millisecond)
+	}
+
+	if stats := state.MemoryStats(); stats.Limit != 1000 || stats.Evictions == 0 {
+		t.Errorf("unexpected stats: %+v", stats)
+	}
+}
+
+// TestParseByteSize tests size parsing for --max-memory.
+func TestParseByteSize(t *testing.T) {
+	tests := []struct {
+		input   string
+		want    int64
+		wantErr bool
+	}{
+		{"1048576", 1048576, false},
+		{"512MB", 512 << 20, false},
+		{"2GB", 2 << 30, false},
+		{"64k", 64 << 10, false},
+		{"1.5G", 3 << 29, false},
+		{"100 B", 100, false},
+		{"", 0, true},
+		{"lots", 0, true},
+		{"-1MB", 0, true},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.input, func(t *testing.T) {
+			got, err := ParseByteSize(tt.input)
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("ParseByteSize(%q) error = %v, wantErr %v", tt.input, err, tt.wantErr)
+			}
+			if got != tt.want {
+				t.Errorf("ParseByteSize(%q) = %d, want %d", tt.input, got, tt.want)
+			}
+		})
+	}
+}
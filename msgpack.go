@@ -0,0 +1,398 @@
+// Package main provides MessagePack encoding of WebSocket messages.
+package main
+
+import (
+	"encoding/base64"
+	"encoding/binary"
+	"encoding/json"
+	"math"
+	"sort"
+	"strings"
+	"time"
+)
+
+// MsgpackSubprotocol is the WebSocket subprotocol under which messages are
+// sent as binary MessagePack instead of JSON text. Maps use the JSON field
+// names, content is sent as raw UTF-8 without escaping, and base64 image
+// data URLs are sent as the decoded bytes (bin) with their MIME type in
+// contentType. MsgpackDeflateSubprotocol adds shared compression as for
+// DeflateSubprotocol.
+const (
+	MsgpackSubprotocol        = "agentviewer.msgpack"
+	MsgpackDeflateSubprotocol = "agentviewer.msgpack.deflate"
+)
+
+// msgpackWriter appends MessagePack values to a buffer.
+type msgpackWriter struct {
+	buf []byte
+}
+
+// encodeMsgpack returns the MessagePack encoding of a message.
+func encodeMsgpack(msg *WSMessage) []byte {
+	w := msgpackWriter{buf: make([]byte, 0, msg.sizeHint()+64)}
+	w.message(msg)
+	return w.buf
+}
+
+// sizeHint estimates the encoded size of a message from its content.
+func (m *WSMessage) sizeHint() int {
+	n := len(m.Content)
+	if m.Tab != nil {
+		n += len(m.Tab.Content)
+	}
+	for _, tab := range m.Tabs {
+		n += len(tab.Content) + 128
+	}
+	if m.Patch != nil {
+		for _, op := range m.Patch.Ops {
+			n += len(op.Text) + 16
+		}
+	}
+	return n
+}
+
+// message writes a WSMessage as a map, omitting empty fields like its JSON form.
+func (w *msgpackWriter) message(m *WSMessage) {
+	n := 1 + countSet(m.Seq != 0, m.ID != "", m.Tab != nil, m.Content != "", m.Patch != nil,
+		len(m.Tabs) > 0, len(m.IDs) > 0, m.Mode != "", m.Data != nil)
+	w.mapHeader(n)
+	w.str("type")
+	w.str(m.Type)
+	if m.Seq != 0 {
+		w.str("seq")
+		w.uint(m.Seq)
+	}
+	if m.ID != "" {
+		w.str("id")
+		w.str(m.ID)
+	}
+	if m.Tab != nil {
+		w.str("tab")
+		w.tab(m.Tab)
+	}
+	if m.Content != "" {
+		w.str("content")
+		w.str(m.Content)
+	}
+	if m.Patch != nil {
+		w.str("patch")
+		w.patch(m.Patch)
+	}
+	if len(m.Tabs) > 0 {
+		w.str("tabs")
+		w.arrayHeader(len(m.Tabs))
+		for _, tab := range m.Tabs {
+			w.tab(tab)
+		}
+	}
+	if len(m.IDs) > 0 {
+		w.str("ids")
+		w.arrayHeader(len(m.IDs))
+		for _, id := range m.IDs {
+			w.str(id)
+		}
+	}
+	if m.Mode != "" {
+		w.str("mode")
+		w.str(m.Mode)
+	}
+	if m.Data != nil {
+		w.str("data")
+		w.value(m.Data)
+	}
+}
+
+// tab writes a Tab as a map with its JSON field names.
+func (w *msgpackWriter) tab(t *Tab) {
+	mime, data, isImage := splitImageDataURL(t)
+	n := 7 + countSet(t.Language != "", t.DiffMeta != nil, t.SourcePath != "", t.Stale,
+		t.Streaming, t.Active, t.Size != 0, t.ContentOmitted, isImage)
+	w.mapHeader(n)
+	w.str("id")
+	w.str(t.ID)
+	w.str("title")
+	w.str(t.Title)
+	w.str("type")
+	w.str(string(t.Type))
+	w.str("content")
+	if isImage {
+		w.bin(data)
+		w.str("contentType")
+		w.str(mime)
+	} else {
+		w.str(t.Content)
+	}
+	if t.Language != "" {
+		w.str("language")
+		w.str(t.Language)
+	}
+	if t.DiffMeta != nil {
+		d := t.DiffMeta
+		w.str("diff")
+		w.mapHeader(countSet(d.LeftLabel != "", d.RightLabel != "", d.Language != ""))
+		for _, kv := range [][2]string{{"leftLabel", d.LeftLabel}, {"rightLabel", d.RightLabel}, {"language", d.Language}} {
+			if kv[1] != "" {
+				w.str(kv[0])
+				w.str(kv[1])
+			}
+		}
+	}
+	if t.SourcePath != "" {
+		w.str("sourcePath")
+		w.str(t.SourcePath)
+	}
+	for _, kv := range []struct {
+		key string
+		set bool
+	}{{"stale", t.Stale}, {"streaming", t.Streaming}, {"active", t.Active}, {"contentOmitted", t.ContentOmitted}} {
+		if kv.set {
+			w.str(kv.key)
+			w.bool(true)
+		}
+	}
+	w.str("version")
+	w.uint(t.Version)
+	if t.Size != 0 {
+		w.str("size")
+		w.int(int64(t.Size))
+	}
+	w.str("createdAt")
+	w.time(t.CreatedAt)
+	w.str("updatedAt")
+	w.time(t.UpdatedAt)
+}
+
+// patch writes a TabPatch as a map with its JSON field names.
+func (w *msgpackWriter) patch(p *TabPatch) {
+	w.mapHeader(4 + countSet(p.Streaming, p.ContentOmitted))
+	w.str("baseVersion")
+	w.uint(p.BaseVersion)
+	w.str("version")
+	w.uint(p.Version)
+	w.str("ops")
+	if p.Ops == nil {
+		w.buf = append(w.buf, 0xc0) // null, as in JSON
+	} else {
+		w.arrayHeader(len(p.Ops))
+	}
+	for _, op := range p.Ops {
+		w.mapHeader(1 + countSet(op.Offset != 0, op.Length != 0, op.Text != ""))
+		w.str("op")
+		w.str(op.Op)
+		if op.Offset != 0 {
+			w.str("offset")
+			w.int(int64(op.Offset))
+		}
+		if op.Length != 0 {
+			w.str("length")
+			w.int(int64(op.Length))
+		}
+		if op.Text != "" {
+			w.str("text")
+			w.str(op.Text)
+		}
+	}
+	w.str("size")
+	w.int(int64(p.Size))
+	if p.Streaming {
+		w.str("streaming")
+		w.bool(true)
+	}
+	if p.ContentOmitted {
+		w.str("contentOmitted")
+		w.bool(true)
+	}
+}
+
+// value writes a generic JSON-like value. Types other than those produced by
+// encoding/json decoding are converted through their JSON form.
+func (w *msgpackWriter) value(v interface{}) {
+	switch v := v.(type) {
+	case nil:
+		w.buf = append(w.buf, 0xc0)
+	case bool:
+		w.bool(v)
+	case string:
+		w.str(v)
+	case float64:
+		w.buf = append(w.buf, 0xcb)
+		w.buf = binary.BigEndian.AppendUint64(w.buf, math.Float64bits(v))
+	case int:
+		w.int(int64(v))
+	case int64:
+		w.int(v)
+	case []interface{}:
+		w.arrayHeader(len(v))
+		for _, item := range v {
+			w.value(item)
+		}
+	case map[string]interface{}:
+		keys := make([]string, 0, len(v))
+		for k := range v {
+			keys = append(keys, k)
+		}
+		sort.Strings(keys)
+		w.mapHeader(len(keys))
+		for _, k := range keys {
+			w.str(k)
+			w.value(v[k])
+		}
+	default:
+		var generic interface{}
+		data, err := json.Marshal(v)
+		if err == nil {
+			err = json.Unmarshal(data, &generic)
+		}
+		if err != nil {
+			generic = nil
+		}
+		w.value(generic)
+	}
+}
+
+// mapHeader writes the header of a map with n entries.
+func (w *msgpackWriter) mapHeader(n int) {
+	switch {
+	case n < 16:
+		w.buf = append(w.buf, 0x80|byte(n))
+	case n <= math.MaxUint16:
+		w.buf = append(w.buf, 0xde)
+		w.buf = binary.BigEndian.AppendUint16(w.buf, uint16(n))
+	default:
+		w.buf = append(w.buf, 0xdf)
+		w.buf = binary.BigEndian.AppendUint32(w.buf, uint32(n))
+	}
+}
+
+// arrayHeader writes the header of an array with n items.
+func (w *msgpackWriter) arrayHeader(n int) {
+	switch {
+	case n < 16:
+		w.buf = append(w.buf, 0x90|byte(n))
+	case n <= math.MaxUint16:
+		w.buf = append(w.buf, 0xdc)
+		w.buf = binary.BigEndian.AppendUint16(w.buf, uint16(n))
+	default:
+		w.buf = append(w.buf, 0xdd)
+		w.buf = binary.BigEndian.AppendUint32(w.buf, uint32(n))
+	}
+}
+
+// str writes a UTF-8 string.
+func (w *msgpackWriter) str(s string) {
+	n := len(s)
+	switch {
+	case n < 32:
+		w.buf = append(w.buf, 0xa0|byte(n))
+	case n <= math.MaxUint8:
+		w.buf = append(w.buf, 0xd9, byte(n))
+	case n <= math.MaxUint16:
+		w.buf = append(w.buf, 0xda)
+		w.buf = binary.BigEndian.AppendUint16(w.buf, uint16(n))
+	default:
+		w.buf = append(w.buf, 0xdb)
+		w.buf = binary.BigEndian.AppendUint32(w.buf, uint32(n))
+	}
+	w.buf = append(w.buf, s...)
+}
+
+// bin writes raw bytes.
+func (w *msgpackWriter) bin(b []byte) {
+	n := len(b)
+	switch {
+	case n <= math.MaxUint8:
+		w.buf = append(w.buf, 0xc4, byte(n))
+	case n <= math.MaxUint16:
+		w.buf = append(w.buf, 0xc5)
+		w.buf = binary.BigEndian.AppendUint16(w.buf, uint16(n))
+	default:
+		w.buf = append(w.buf, 0xc6)
+		w.buf = binary.BigEndian.AppendUint32(w.buf, uint32(n))
+	}
+	w.buf = append(w.buf, b...)
+}
+
+// uint writes an unsigned integer in the smallest form.
+func (w *msgpackWriter) uint(u uint64) {
+	switch {
+	case u < 128:
+		w.buf = append(w.buf, byte(u))
+	case u <= math.MaxUint8:
+		w.buf = append(w.buf, 0xcc, byte(u))
+	case u <= math.MaxUint16:
+		w.buf = append(w.buf, 0xcd)
+		w.buf = binary.BigEndian.AppendUint16(w.buf, uint16(u))
+	case u <= math.MaxUint32:
+		w.buf = append(w.buf, 0xce)
+		w.buf = binary.BigEndian.AppendUint32(w.buf, uint32(u))
+	default:
+		w.buf = append(w.buf, 0xcf)
+		w.buf = binary.BigEndian.AppendUint64(w.buf, u)
+	}
+}
+
+// int writes a signed integer in the smallest form.
+func (w *msgpackWriter) int(i int64) {
+	if i >= 0 {
+		w.uint(uint64(i))
+		return
+	}
+	switch {
+	case i >= -32:
+		w.buf = append(w.buf, byte(i))
+	case i >= math.MinInt8:
+		w.buf = append(w.buf, 0xd0, byte(i))
+	case i >= math.MinInt16:
+		w.buf = append(w.buf, 0xd1)
+		w.buf = binary.BigEndian.AppendUint16(w.buf, uint16(i))
+	case i >= math.MinInt32:
+		w.buf = append(w.buf, 0xd2)
+		w.buf = binary.BigEndian.AppendUint32(w.buf, uint32(i))
+	default:
+		w.buf = append(w.buf, 0xd3)
+		w.buf = binary.BigEndian.AppendUint64(w.buf, uint64(i))
+	}
+}
+
+// bool writes a boolean.
+func (w *msgpackWriter) bool(b bool) {
+	if b {
+		w.buf = append(w.buf, 0xc3)
+	} else {
+		w.buf = append(w.buf, 0xc2)
+	}
+}
+
+// time writes a timestamp as an RFC 3339 string, as encoding/json does.
+func (w *msgpackWriter) time(t time.Time) {
+	w.str(t.Format(time.RFC3339Nano))
+}
+
+// countSet returns the number of true values.
+func countSet(flags ...bool) int {
+	n := 0
+	for _, set := range flags {
+		if set {
+			n++
+		}
+	}
+	return n
+}
+
+// splitImageDataURL returns the MIME type and decoded bytes of an image
+// tab whose content is a base64 data URL, as produced by ReadImageAsDataURL.
+func splitImageDataURL(t *Tab) (string, []byte, bool) {
+	if t.Type != TabTypeImage || !strings.HasPrefix(t.Content, "data:") {
+		return "", nil, false
+	}
+	header, payload, found := strings.Cut(t.Content[len("data:"):], ",")
+	mime, isBase64 := strings.CutSuffix(header, ";base64")
+	if !found || !isBase64 {
+		return "", nil, false
+	}
+	data, err := base64.StdEncoding.DecodeString(payload)
+	if err != nil {
+		return "", nil, false
+	}
+	return mime, data, true
+}
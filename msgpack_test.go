@@ -0,0 +1,328 @@
+package main
+
+import (
+	"bytes"
+	"context"
+	"encoding/base64"
+	"encoding/binary"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"math"
+	"math/rand"
+	"net/http"
+	"net/http/httptest"
+	"os"
+	"reflect"
+	"strings"
+	"testing"
+	"time"
+
+	"nhooyr.io/websocket"
+)
+
+// errMsgpack reports malformed MessagePack in tests.
+var errMsgpack = errors.New("malformed msgpack")
+
+// msgpackReader decodes MessagePack into generic values, mirroring the
+// decoder in web/app.js: strings as string, bin as []byte, maps as
+// map[string]interface{}, and numbers as float64 like encoding/json.
+type msgpackReader struct {
+	data []byte
+	pos  int
+}
+
+// decodeMsgpack decodes a single MessagePack value.
+func decodeMsgpack(data []byte) (interface{}, error) {
+	r := &msgpackReader{data: data}
+	v, err := r.read()
+	if err == nil && r.pos != len(data) {
+		err = errMsgpack
+	}
+	return v, err
+}
+
+// take returns the next n bytes.
+func (r *msgpackReader) take(n int) ([]byte, error) {
+	if n < 0 || r.pos+n > len(r.data) {
+		return nil, errMsgpack
+	}
+	b := r.data[r.pos : r.pos+n]
+	r.pos += n
+	return b, nil
+}
+
+// length reads a big-endian length of size bytes.
+func (r *msgpackReader) length(size int) (int, error) {
+	b, err := r.take(size)
+	if err != nil {
+		return 0, err
+	}
+	switch size {
+	case 1:
+		return int(b[0]), nil
+	case 2:
+		return int(binary.BigEndian.Uint16(b)), nil
+	default:
+		return int(binary.BigEndian.Uint32(b)), nil
+	}
+}
+
+// read decodes the next value.
+func (r *msgpackReader) read() (interface{}, error) {
+	tb, err := r.take(1)
+	if err != nil {
+		return nil, err
+	}
+	b := tb[0]
+	switch {
+	case b <= 0x7f:
+		return float64(b), nil
+	case b >= 0xe0:
+		return float64(int8(b)), nil
+	case b&0xf0 == 0x80:
+		return r.mapOf(int(b & 0x0f))
+	case b&0xf0 == 0x90:
+		return r.arrayOf(int(b & 0x0f))
+	case b&0xe0 == 0xa0:
+		s, err := r.take(int(b & 0x1f))
+		return string(s), err
+	}
+
+	sizes := map[byte]int{0xc4: 1, 0xc5: 2, 0xc6: 4, 0xd9: 1, 0xda: 2, 0xdb: 4, 0xdc: 2, 0xdd: 4, 0xde: 2, 0xdf: 4}
+	if size, ok := sizes[b]; ok {
+		n, err := r.length(size)
+		if err != nil {
+			return nil, err
+		}
+		switch b {
+		case 0xc4, 0xc5, 0xc6:
+			return r.take(n)
+		case 0xd9, 0xda, 0xdb:
+			s, err := r.take(n)
+			return string(s), err
+		case 0xdc, 0xdd:
+			return r.arrayOf(n)
+		default:
+			return r.mapOf(n)
+		}
+	}
+
+	switch b {
+	case 0xc0:
+		return nil, nil
+	case 0xc2:
+		return false, nil
+	case 0xc3:
+		return true, nil
+	case 0xcb:
+		v, err := r.take(8)
+		if err != nil {
+			return nil, err
+		}
+		return math.Float64frombits(binary.BigEndian.Uint64(v)), nil
+	case 0xcc, 0xcd, 0xce, 0xcf, 0xd0, 0xd1, 0xd2, 0xd3:
+		size := 1 << ((b - 0xcc) % 4)
+		v, err := r.take(size)
+		if err != nil {
+			return nil, err
+		}
+		var u uint64
+		for _, c := range v {
+			u = u<<8 | uint64(c)
+		}
+		if b >= 0xd0 {
+			shift := 64 - 8*size
+			return float64(int64(u<<shift) >> shift), nil
+		}
+		return float64(u), nil
+	}
+	return nil, errMsgpack
+}
+
+// arrayOf decodes n array items.
+func (r *msgpackReader) arrayOf(n int) ([]interface{}, error) {
+	a := make([]interface{}, n)
+	for i := range a {
+		v, err := r.read()
+		if err != nil {
+			return nil, err
+		}
+		a[i] = v
+	}
+	return a, nil
+}
+
+// mapOf decodes n map entries with string keys.
+func (r *msgpackReader) mapOf(n int) (map[string]interface{}, error) {
+	m := make(map[string]interface{}, n)
+	for i := 0; i < n; i++ {
+		k, err := r.read()
+		if err != nil {
+			return nil, err
+		}
+		key, ok := k.(string)
+		if !ok {
+			return nil, errMsgpack
+		}
+		if m[key], err = r.read(); err != nil {
+			return nil, err
+		}
+	}
+	return m, nil
+}
+
+// wsFixtures returns one sample message per tab type.
+func wsFixtures(t testing.TB) map[TabType]WSMessage {
+	read := func(path string) string {
+		data, err := os.ReadFile(path)
+		if err != nil {
+			t.Fatalf("failed to read fixture: %v", err)
+		}
+		return string(data)
+	}
+
+	rng := rand.New(rand.NewSource(1))
+	image := make([]byte, 200<<10)
+	rng.Read(image)
+	var csv strings.Builder
+	csv.WriteString("id,name,score,comment\n")
+	for i := 0; i < 2000; i++ {
+		fmt.Fprintf(&csv, "%d,user%d,%d,\"said \"\"hi\"\" at %d\"\n", i, i, rng.Intn(100), i)
+	}
+
+	now := time.Date(2026, 1, 2, 3, 4, 5, 6, time.UTC)
+	tab := func(typ TabType, content string) WSMessage {
+		return WSMessage{Type: "tab_updated", Tab: &Tab{
+			ID: "t-" + string(typ), Title: string(typ), Type: typ, Content: content,
+			Version: 300, CreatedAt: now, UpdatedAt: now,
+		}}
+	}
+	diff := tab(TabTypeDiff, read("testdata/unified_diffs/context_heavy.diff"))
+	diff.Tab.DiffMeta = &DiffMeta{LeftLabel: "a", RightLabel: "b", Language: "go"}
+	code := tab(TabTypeCode, read("testdata/code_go.go"))
+	code.Tab.Language = "go"
+
+	return map[TabType]WSMessage{
+		TabTypeMarkdown: tab(TabTypeMarkdown, read("testdata/gfm_features.md")),
+		TabTypeCode:     code,
+		TabTypeDiff:     diff,
+		TabTypeMermaid:  tab(TabTypeMermaid, read("testdata/mermaid_diagrams.md")),
+		TabTypeImage:    tab(TabTypeImage, "data:image/png;base64,"+base64.StdEncoding.EncodeToString(image)),
+		TabTypeCSV:      tab(TabTypeCSV, csv.String()),
+	}
+}
+
+// TestEncodeMsgpack_MatchesJSON tests that MessagePack messages decode to the
+// same values as their JSON form, with image data URLs as raw bytes.
+func TestEncodeMsgpack_MatchesJSON(t *testing.T) {
+	msgs := []WSMessage{
+		{Type: "tab_patched", Seq: 1 << 50, ID: "a", Patch: &TabPatch{BaseVersion: 1, Version: 70000, Size: 1 << 20, Streaming: true,
+			Ops: []PatchOp{{Op: PatchOpAppend, Text: "ünïcode ✓"}, {Op: PatchOpReplace, Offset: 300, Length: 2}}}},
+		{Type: "tabs_batch", Tabs: []*Tab{{ID: "x", Stale: true, Active: true}, {ID: "y", Size: 9, ContentOmitted: true}}, IDs: []string{"z"}},
+		{Type: "test", Content: strings.Repeat("x", 70000), Data: map[string]interface{}{"n": -5.5, "list": []interface{}{true, nil, "s"}}},
+		{Type: "tabs_cleared"},
+	}
+	for _, msg := range wsFixtures(t) {
+		msgs = append(msgs, msg)
+	}
+
+	for _, msg := range msgs {
+		t.Run(msg.Type, func(t *testing.T) {
+			data, _ := json.Marshal(msg)
+			var want interface{}
+			json.Unmarshal(data, &want)
+
+			got, err := decodeMsgpack(encodeMsgpack(&msg))
+			if err != nil {
+				t.Fatalf("failed to decode: %v", err)
+			}
+			if msg.Tab != nil && msg.Tab.Type == TabTypeImage {
+				tab := got.(map[string]interface{})["tab"].(map[string]interface{})
+				raw, ok := tab["content"].([]byte)
+				if !ok || tab["contentType"] != "image/png" {
+					t.Fatalf("expected image bytes with contentType, got %T %v", tab["content"], tab["contentType"])
+				}
+				tab["content"] = "data:image/png;base64," + base64.StdEncoding.EncodeToString(raw)
+				delete(tab, "contentType")
+			}
+			if !reflect.DeepEqual(got, want) {
+				t.Errorf("msgpack and JSON differ:\n got %v\nwant %v", got, want)
+			}
+		})
+	}
+}
+
+// TestServeWS_MsgpackSubprotocol tests that msgpack clients receive binary
+// MessagePack messages.
+func TestServeWS_MsgpackSubprotocol(t *testing.T) {
+	srv := NewServer()
+	go srv.hub.Run()
+	defer srv.hub.Shutdown()
+
+	ts := httptest.NewServer(http.HandlerFunc(srv.handleWebSocket))
+	defer ts.Close()
+
+	ctx, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+	wsURL := "ws" + strings.TrimPrefix(ts.URL, "http") + "/ws"
+	conn, _, err := websocket.Dial(ctx, wsURL, &websocket.DialOptions{Subprotocols: []string{MsgpackSubprotocol}})
+	if err != nil {
+		t.Fatalf("failed to connect: %v", err)
+	}
+	defer conn.Close(websocket.StatusNormalClosure, "")
+	if conn.Subprotocol() != MsgpackSubprotocol {
+		t.Fatalf("expected subprotocol %s, got %q", MsgpackSubprotocol, conn.Subprotocol())
+	}
+
+	time.Sleep(50 * time.Millisecond)
+	srv.hub.Broadcast(WSMessage{Type: "tab_activated", ID: "main"})
+
+	typ, data, err := conn.Read(ctx)
+	if err != nil {
+		t.Fatalf("failed to read: %v", err)
+	}
+	msg, err := decodeMsgpack(data)
+	if typ != websocket.MessageBinary || err != nil {
+		t.Fatalf("expected a binary MessagePack message, got %v (%v)", typ, err)
+	}
+	if m := msg.(map[string]interface{}); m["type"] != "tab_activated" || m["id"] != "main" {
+		t.Errorf("unexpected message: %v", m)
+	}
+}
+
+// BenchmarkWSEncoding compares JSON and MessagePack per tab type: encoding
+// on the server, decoding as a client would (to generic values), and bytes
+// on the wire (wire-B/msg).
+func BenchmarkWSEncoding(b *testing.B) {
+	fixtures := wsFixtures(b)
+	for _, typ := range []TabType{TabTypeMarkdown, TabTypeCode, TabTypeDiff, TabTypeMermaid, TabTypeImage, TabTypeCSV} {
+		msg := fixtures[typ]
+		jsonData, _ := json.Marshal(msg)
+		msgpackData := encodeMsgpack(&msg)
+
+		b.Run(string(typ)+"/json/encode", func(b *testing.B) {
+			b.ReportMetric(float64(len(jsonData)), "wire-B/msg")
+			for i := 0; i < b.N; i++ {
+				json.Marshal(msg)
+			}
+		})
+		b.Run(string(typ)+"/json/decode", func(b *testing.B) {
+			for i := 0; i < b.N; i++ {
+				var v interface{}
+				json.NewDecoder(bytes.NewReader(jsonData)).Decode(&v)
+			}
+		})
+		b.Run(string(typ)+"/msgpack/encode", func(b *testing.B) {
+			b.ReportMetric(float64(len(msgpackData)), "wire-B/msg")
+			for i := 0; i < b.N; i++ {
+				encodeMsgpack(&msg)
+			}
+		})
+		b.Run(string(typ)+"/msgpack/decode", func(b *testing.B) {
+			for i := 0; i < b.N; i++ {
+				decodeMsgpack(msgpackData)
+			}
+		})
+	}
+}
@@ -0,0 +1,134 @@
+// Package main provides indexed tab ordering.
+package main
+
+// minCompactSlots is the slot count below which holes are never compacted.
+const minCompactSlots = 64
+
+// tabOrder keeps tab IDs in display order with O(1) append, removal and
+// position lookup. Removed IDs leave holes in slots, so the slots of the
+// remaining tabs stay put; holes are compacted once they make up half the
+// slots, which keeps removal amortized O(1).
+type tabOrder struct {
+	slots []string       // IDs by slot; "" marks a removed tab
+	pos   map[string]int // ID to slot
+	holes int
+	// first is the slot of the first tab, or len(slots) if there are none;
+	// every slot before it is a hole.
+	first int
+	// epoch is incremented whenever slots are renumbered, so views built
+	// against an older numbering can tell their slots no longer line up.
+	epoch uint64
+}
+
+// newTabOrder creates an empty tabOrder.
+func newTabOrder() *tabOrder {
+	return &tabOrder{pos: make(map[string]int)}
+}
+
+// Len returns the number of tabs.
+func (o *tabOrder) Len() int {
+	return len(o.pos)
+}
+
+// Slots returns the number of slots, including holes.
+func (o *tabOrder) Slots() int {
+	return len(o.slots)
+}
+
+// Slot returns the slot of a tab.
+func (o *tabOrder) Slot(id string) (int, bool) {
+	i, exists := o.pos[id]
+	return i, exists
+}
+
+// At returns the ID in a slot, or "" for a hole.
+func (o *tabOrder) At(slot int) string {
+	return o.slots[slot]
+}
+
+// Append adds a tab at the end.
+func (o *tabOrder) Append(id string) {
+	o.pos[id] = len(o.slots)
+	o.slots = append(o.slots, id)
+}
+
+// Remove removes a tab, leaving a hole, and compacts if holes dominate.
+// Returns false if the tab was not present.
+func (o *tabOrder) Remove(id string) bool {
+	i, exists := o.pos[id]
+	if !exists {
+		return false
+	}
+	delete(o.pos, id)
+	o.slots[i] = ""
+	o.holes++
+
+	// Trailing holes can be dropped without renumbering anything
+	for len(o.slots) > 0 && o.slots[len(o.slots)-1] == "" {
+		o.slots = o.slots[:len(o.slots)-1]
+		o.holes--
+	}
+	// Each hole is passed over once, so removing from the front is amortized O(1)
+	for o.first < len(o.slots) && o.slots[o.first] == "" {
+		o.first++
+	}
+	o.first = min(o.first, len(o.slots))
+	if len(o.slots) >= minCompactSlots && o.holes*2 >= len(o.slots) {
+		o.compact()
+	}
+	return true
+}
+
+// Rename replaces a tab's ID in place.
+func (o *tabOrder) Rename(from, to string) {
+	i, exists := o.pos[from]
+	if !exists {
+		return
+	}
+	delete(o.pos, from)
+	o.pos[to] = i
+	o.slots[i] = to
+}
+
+// First returns the first tab ID, or "" if there are none.
+func (o *tabOrder) First() string {
+	if o.first < len(o.slots) {
+		return o.slots[o.first]
+	}
+	return ""
+}
+
+// IDs returns the tab IDs in order.
+func (o *tabOrder) IDs() []string {
+	ids := make([]string, 0, len(o.pos))
+	for _, id := range o.slots {
+		if id != "" {
+			ids = append(ids, id)
+		}
+	}
+	return ids
+}
+
+// Reset removes all tabs.
+func (o *tabOrder) Reset() {
+	o.slots = nil
+	o.pos = make(map[string]int)
+	o.holes = 0
+	o.first = 0
+	o.epoch++
+}
+
+// compact removes holes, renumbering slots.
+func (o *tabOrder) compact() {
+	slots := make([]string, 0, len(o.pos))
+	for _, id := range o.slots {
+		if id != "" {
+			o.pos[id] = len(slots)
+			slots = append(slots, id)
+		}
+	}
+	o.slots = slots
+	o.holes = 0
+	o.first = 0
+	o.epoch++
+}
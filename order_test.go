@@ -0,0 +1,216 @@
+package main
+
+import (
+	"fmt"
+	"strings"
+	"testing"
+)
+
+// TestTabOrder_AppendRemove tests ordering with holes and compaction.
+func TestTabOrder_AppendRemove(t *testing.T) {
+	o := newTabOrder()
+	for i := 0; i < 100; i++ {
+		o.Append(fmt.Sprintf("t%d", i))
+	}
+
+	// Remove every other tab from the front half; slots stay put
+	for i := 0; i < 50; i += 2 {
+		if !o.Remove(fmt.Sprintf("t%d", i)) {
+			t.Fatalf("expected t%d to be removed", i)
+		}
+	}
+	if o.Remove("t0") {
+		t.Error("expected second removal to fail")
+	}
+	if slot, _ := o.Slot("t99"); slot != 99 || o.epoch != 0 {
+		t.Errorf("expected no renumbering yet, t99 at %d epoch %d", slot, o.epoch)
+	}
+	if o.Len() != 75 || o.First() != "t1" {
+		t.Errorf("unexpected order: len %d first %s", o.Len(), o.First())
+	}
+
+	// Removing half the slots triggers compaction
+	for i := 50; i < 75; i++ {
+		o.Remove(fmt.Sprintf("t%d", i))
+	}
+	if o.epoch != 1 || o.Slots() != o.Len() {
+		t.Errorf("expected compaction, epoch %d slots %d len %d", o.epoch, o.Slots(), o.Len())
+	}
+	ids := o.IDs()
+	if len(ids) != 50 || ids[0] != "t1" || ids[25] != "t75" {
+		t.Errorf("unexpected order after compaction: %v", ids)
+	}
+	for i, id := range ids {
+		if slot, _ := o.Slot(id); slot != i {
+			t.Errorf("expected %s at slot %d, got %d", id, i, slot)
+		}
+	}
+}
+
+// TestTabOrder_TrimsTrailingHoles tests that removing the last tabs frees their slots.
+func TestTabOrder_TrimsTrailingHoles(t *testing.T) {
+	o := newTabOrder()
+	o.Append("a")
+	o.Append("b")
+	o.Append("c")
+	o.Remove("b")
+	o.Remove("c")
+
+	if o.Slots() != 1 || o.holes != 0 {
+		t.Errorf("expected trailing holes trimmed, slots %d holes %d", o.Slots(), o.holes)
+	}
+	o.Append("d")
+	if got := strings.Join(o.IDs(), ","); got != "a,d" {
+		t.Errorf("expected a,d, got %s", got)
+	}
+}
+
+// TestTabOrder_FirstAfterFrontRemovals tests that First skips the holes
+// left by removing tabs from the front.
+func TestTabOrder_FirstAfterFrontRemovals(t *testing.T) {
+	o := newTabOrder()
+	for i := 0; i < 200; i++ {
+		o.Append(fmt.Sprintf("t%d", i))
+	}
+	for i := 0; i < 199; i++ {
+		o.Remove(fmt.Sprintf("t%d", i))
+		if want := fmt.Sprintf("t%d", i+1); o.First() != want {
+			t.Fatalf("after removing t%d: expected first %s, got %s", i, want, o.First())
+		}
+		if o.first != 0 && o.slots[o.first-1] != "" {
+			t.Fatalf("expected only holes before slot %d", o.first)
+		}
+	}
+	o.Remove("t199")
+	if o.First() != "" || o.first != 0 {
+		t.Errorf("expected no first tab, got %q at %d", o.First(), o.first)
+	}
+	o.Append("new")
+	if o.First() != "new" {
+		t.Errorf("expected new to be first, got %q", o.First())
+	}
+}
+
+// TestListTabsPage tests cursor pagination.
+func TestListTabsPage(t *testing.T) {
+	state := NewState()
+	for i := 0; i < 25; i++ {
+		state.CreateTab(&Tab{ID: fmt.Sprintf("t%02d", i), Content: "x"})
+	}
+
+	collect := func(limit int) []string {
+		var ids []string
+		cursor := ""
+		for {
+			page, next, total, err := state.ListTabsPage(cursor, limit)
+			if err != nil {
+				t.Fatalf("ListTabsPage failed: %v", err)
+			}
+			if total != state.TabCount() {
+				t.Errorf("expected total %d, got %d", state.TabCount(), total)
+			}
+			for _, tab := range page {
+				ids = append(ids, tab.ID)
+			}
+			if next == "" {
+				return ids
+			}
+			cursor = next
+		}
+	}
+
+	if got := collect(10); len(got) != 25 || got[0] != "t00" || got[24] != "t24" {
+		t.Errorf("unexpected pages: %v", got)
+	}
+
+	t.Run("cursor survives removal of its tab", func(t *testing.T) {
+		page, next, _, _ := state.ListTabsPage("", 5)
+		state.DeleteTab(page[4].ID)
+		page, _, _, err := state.ListTabsPage(next, 5)
+		if err != nil || page[0].ID != "t05" {
+			t.Errorf("expected next page at t05, got %v (%v)", page, err)
+		}
+	})
+
+	t.Run("cursor follows its tab across compaction", func(t *testing.T) {
+		page, next, _, _ := state.ListTabsPage("", 20)
+		last := page[19].ID
+		epoch := state.order.epoch
+		for i := 0; i < 15; i++ {
+			state.DeleteTab(fmt.Sprintf("t%02d", i))
+		}
+		for i := 0; i < 100; i++ {
+			state.CreateTab(&Tab{ID: fmt.Sprintf("n%03d", i), Content: "x"})
+		}
+		for i := 0; i < 90; i++ {
+			state.DeleteTab(fmt.Sprintf("n%03d", i))
+		}
+		if state.order.epoch == epoch {
+			t.Fatal("expected the order to be compacted")
+		}
+		page, _, _, err := state.ListTabsPage(next, 3)
+		if err != nil {
+			t.Fatalf("expected cursor to resolve, got %v", err)
+		}
+		if slot, _ := state.order.Slot(last); page[0].ID != state.order.At(slot+1) {
+			t.Errorf("expected page to continue after %s, got %s", last, page[0].ID)
+		}
+	})
+
+	t.Run("invalid cursors", func(t *testing.T) {
+		for _, cursor := range []string{"!!", "bm90LWEtY3Vyc29y"} {
+			if _, _, _, err := state.ListTabsPage(cursor, 5); err != ErrInvalidCursor {
+				t.Errorf("expected ErrInvalidCursor for %q, got %v", cursor, err)
+			}
+		}
+	})
+}
+
+// TestView_IndexAfterChurn tests lookups through the overlay index and reused slots.
+func TestView_IndexAfterChurn(t *testing.T) {
+	state := NewState()
+	for i := 0; i < 300; i++ {
+		id := fmt.Sprintf("t%d", i)
+		state.CreateTab(&Tab{ID: id, Content: id})
+		if i%3 == 0 {
+			state.DeleteTab(id)
+		}
+		if i%7 == 0 {
+			state.CreateTab(&Tab{ID: id, Content: id + "!"})
+		}
+	}
+
+	ids := state.order.IDs()
+	listed := state.ListTabs()
+	if len(listed) != len(ids) || state.TabCount() != len(ids) {
+		t.Fatalf("expected %d tabs, listed %d, count %d", len(ids), len(listed), state.TabCount())
+	}
+	for i, id := range ids {
+		if listed[i].ID != id {
+			t.Fatalf("position %d: expected %s, got %s", i, id, listed[i].ID)
+		}
+		tab, exists := state.GetTab(id)
+		if !exists || !strings.HasPrefix(tab.Content, id) {
+			t.Fatalf("expected tab %s, got %+v", id, tab)
+		}
+	}
+	if _, exists := state.GetTab("t3"); exists {
+		t.Error("expected deleted tab t3 to be gone")
+	}
+}
+
+// BenchmarkDeleteTab measures deleting from the middle of a large session.
+func BenchmarkDeleteTab(b *testing.B) {
+	state := newBenchState(10000)
+	ids := state.order.IDs()
+
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		id := ids[(i*7919)%len(ids)]
+		if !state.DeleteTab(id) {
+			b.StopTimer()
+			state.CreateTab(&Tab{ID: id, Content: "x"})
+			b.StartTimer()
+		}
+	}
+}
@@ -0,0 +1,136 @@
+// Package main provides incremental (delta) updates to tab content.
+package main
+
+import (
+	"errors"
+	"fmt"
+	"unicode/utf8"
+)
+
+// Patch operation names.
+const (
+	PatchOpAppend  = "append"
+	PatchOpInsert  = "insert"
+	PatchOpReplace = "replace"
+)
+
+// PatchOp is a single splice applied to tab content.
+//
+// On the REST API, Offset and Length are UTF-8 byte positions and must fall
+// on character boundaries. In tab_patched WebSocket messages they are
+// re-expressed in UTF-16 code units so browsers can splice JavaScript strings
+// directly.
+type PatchOp struct {
+	Op     string `json:"op"`               // "append", "insert" or "replace"
+	Offset int    `json:"offset,omitempty"` // Start position (insert, replace)
+	Length int    `json:"length,omitempty"` // Bytes to remove at Offset (replace)
+	Text   string `json:"text,omitempty"`   // Text to add
+}
+
+// TabPatch describes a delta from BaseVersion to Version of a tab.
+type TabPatch struct {
+	BaseVersion uint64    `json:"baseVersion"`
+	Version     uint64    `json:"version"`
+	Ops         []PatchOp `json:"ops"`
+	Size        int       `json:"size"`                // Content length in bytes after the patch
+	Streaming   bool      `json:"streaming,omitempty"` // Tab's streaming flag after the patch
+	// ContentOmitted is set when Ops were left out of a metadata-only push;
+	// the receiver's cached content is then outdated.
+	ContentOmitted bool `json:"contentOmitted,omitempty"`
+}
+
+// Patch errors.
+var (
+	ErrTabNotFound     = errors.New("tab not found")
+	ErrVersionConflict = errors.New("version conflict")
+	ErrInvalidPatch    = errors.New("invalid patch")
+)
+
+// ApplyPatch applies ops in order to content.
+// It returns the new content and the same ops with offsets and lengths
+// converted to UTF-16 code units, for forwarding to browser clients.
+func ApplyPatch(content string, ops []PatchOp) (string, []PatchOp, error) {
+	wireOps := make([]PatchOp, len(ops))
+
+	for i, op := range ops {
+		switch op.Op {
+		case PatchOpAppend:
+			content += op.Text
+			wireOps[i] = PatchOp{Op: PatchOpAppend, Text: op.Text}
+
+		case PatchOpInsert, PatchOpReplace:
+			length := op.Length
+			if op.Op == PatchOpInsert {
+				length = 0
+			}
+			if err := checkSpliceRange(content, op.Offset, length); err != nil {
+				return "", nil, fmt.Errorf("%w: op %d: %v", ErrInvalidPatch, i, err)
+			}
+
+			end := op.Offset + length
+			wireOps[i] = PatchOp{
+				Op:     op.Op,
+				Offset: utf16Len(content[:op.Offset]),
+				Length: utf16Len(content[op.Offset:end]),
+				Text:   op.Text,
+			}
+			content = content[:op.Offset] + op.Text + content[end:]
+
+		default:
+			return "", nil, fmt.Errorf("%w: op %d: unknown op %q", ErrInvalidPatch, i, op.Op)
+		}
+	}
+
+	return content, wireOps, nil
+}
+
+// isAppendOnly reports whether every op is an append.
+func isAppendOnly(ops []PatchOp) bool {
+	for _, op := range ops {
+		if op.Op != PatchOpAppend {
+			return false
+		}
+	}
+	return true
+}
+
+// checkSpliceRange validates that [offset, offset+length) lies within content
+// and does not split a UTF-8 sequence.
+func checkSpliceRange(content string, offset, length int) error {
+	// Compared without offset+length, which a huge length could overflow
+	if offset < 0 || length < 0 || offset > len(content) || length > len(content)-offset {
+		return fmt.Errorf("range [%d, %d) out of bounds (size %d)", offset, offset+length, len(content))
+	}
+	if !isRuneBoundary(content, offset) || !isRuneBoundary(content, offset+length) {
+		return fmt.Errorf("range [%d, %d) splits a UTF-8 character", offset, offset+length)
+	}
+	return nil
+}
+
+// isRuneBoundary reports whether i is at the start of a character (or end) in s.
+func isRuneBoundary(s string, i int) bool {
+	return i == 0 || i == len(s) || utf8.RuneStart(s[i])
+}
+
+// utf16Len returns the length of s in UTF-16 code units, matching the
+// JavaScript String length of the same text as sent in JSON, where each
+// byte of an invalid sequence becomes U+FFFD.
+func utf16Len(s string) int {
+	n := 0
+	for i := 0; i < len(s); {
+		if s[i] < utf8.RuneSelf {
+			n++
+			i++
+			continue
+		}
+		r, size := utf8.DecodeRuneInString(s[i:])
+		if r >= 0x10000 {
+			// Outside the BMP, encoded as a surrogate pair
+			n += 2
+		} else {
+			n++ // Including RuneError for each invalid byte
+		}
+		i += size
+	}
+	return n
+}
@@ -0,0 +1,141 @@
+package main
+
+import (
+	"errors"
+	"math"
+	"testing"
+)
+
+// TestApplyPatch verifies splice operations on content.
+func TestApplyPatch(t *testing.T) {
+	tests := []struct {
+		name    string
+		content string
+		ops     []PatchOp
+		want    string
+	}{
+		{
+			name:    "append",
+			content: "hello",
+			ops:     []PatchOp{{Op: PatchOpAppend, Text: " world"}},
+			want:    "hello world",
+		},
+		{
+			name:    "insert at start",
+			content: "world",
+			ops:     []PatchOp{{Op: PatchOpInsert, Offset: 0, Text: "hello "}},
+			want:    "hello world",
+		},
+		{
+			name:    "insert at end",
+			content: "hello",
+			ops:     []PatchOp{{Op: PatchOpInsert, Offset: 5, Text: "!"}},
+			want:    "hello!",
+		},
+		{
+			name:    "replace range",
+			content: "hello world",
+			ops:     []PatchOp{{Op: PatchOpReplace, Offset: 6, Length: 5, Text: "there"}},
+			want:    "hello there",
+		},
+		{
+			name:    "replace with empty deletes",
+			content: "hello world",
+			ops:     []PatchOp{{Op: PatchOpReplace, Offset: 5, Length: 6}},
+			want:    "hello",
+		},
+		{
+			name:    "ops apply in order",
+			content: "b",
+			ops: []PatchOp{
+				{Op: PatchOpInsert, Offset: 0, Text: "a"},
+				{Op: PatchOpAppend, Text: "c"},
+				{Op: PatchOpReplace, Offset: 1, Length: 1, Text: "B"},
+			},
+			want: "aBc",
+		},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			got, _, err := ApplyPatch(tt.content, tt.ops)
+			if err != nil {
+				t.Fatalf("ApplyPatch failed: %v", err)
+			}
+			if got != tt.want {
+				t.Errorf("expected %q, got %q", tt.want, got)
+			}
+		})
+	}
+}
+
+// TestApplyPatchInvalid verifies that invalid ops are rejected.
+func TestApplyPatchInvalid(t *testing.T) {
+	tests := []struct {
+		name string
+		ops  []PatchOp
+	}{
+		{"unknown op", []PatchOp{{Op: "delete"}}},
+		{"negative offset", []PatchOp{{Op: PatchOpInsert, Offset: -1, Text: "x"}}},
+		{"offset past end", []PatchOp{{Op: PatchOpInsert, Offset: 100, Text: "x"}}},
+		{"range past end", []PatchOp{{Op: PatchOpReplace, Offset: 2, Length: 10}}},
+		{"splits UTF-8 character", []PatchOp{{Op: PatchOpInsert, Offset: 2, Text: "x"}}},
+		{"huge offset", []PatchOp{{Op: PatchOpInsert, Offset: 1 << 62, Text: "x"}}},
+		{"overflowing range", []PatchOp{{Op: PatchOpReplace, Offset: 1 << 62, Length: 1 << 62}}},
+		{"huge length", []PatchOp{{Op: PatchOpReplace, Offset: 1, Length: math.MaxInt}}},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			_, _, err := ApplyPatch("héllo", tt.ops)
+			if !errors.Is(err, ErrInvalidPatch) {
+				t.Errorf("expected ErrInvalidPatch, got %v", err)
+			}
+		})
+	}
+}
+
+// TestApplyPatchWireOffsets verifies conversion of byte offsets to UTF-16 units.
+func TestApplyPatchWireOffsets(t *testing.T) {
+	// "é" is 2 bytes / 1 UTF-16 unit; "😀" is 4 bytes / 2 UTF-16 units
+	content := "é😀abc"
+	ops := []PatchOp{{Op: PatchOpReplace, Offset: 6, Length: 1, Text: "A"}}
+
+	got, wire, err := ApplyPatch(content, ops)
+	if err != nil {
+		t.Fatalf("ApplyPatch failed: %v", err)
+	}
+	if got != "é😀Abc" {
+		t.Errorf("expected %q, got %q", "é😀Abc", got)
+	}
+	if wire[0].Offset != 3 {
+		t.Errorf("expected UTF-16 offset 3, got %d", wire[0].Offset)
+	}
+	if wire[0].Length != 1 {
+		t.Errorf("expected UTF-16 length 1, got %d", wire[0].Length)
+	}
+}
+
+// TestUTF16Len verifies UTF-16 length computation.
+func TestUTF16Len(t *testing.T) {
+	tests := []struct {
+		input string
+		want  int
+	}{
+		{"", 0},
+		{"abc", 3},
+		{"héllo", 5},
+		{"日本", 2},
+		{"😀", 2},
+		{"a😀b", 4},
+		{"a\xffb", 3},       // Invalid byte is one U+FFFD in JSON
+		{"\xe6\x97x", 3},    // Truncated sequence: one U+FFFD per byte
+		{"\xed\xa0\x80", 3}, // Encoded surrogate is invalid UTF-8
+	}
+
+	for _, tt := range tests {
+		if got := utf16Len(tt.input); got != tt.want {
+			t.Errorf("utf16Len(%q) = %d, want %d", tt.input, got, tt.want)
+		}
+	}
+}
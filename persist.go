@@ -0,0 +1,765 @@
+// Package main provides crash-safe persistence of tab state.
+package main
+
+import (
+	"bufio"
+	"encoding/hex"
+	"encoding/json"
+	"fmt"
+	"log"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"time"
+)
+
+const (
+	// persistSyncInterval is how often the journal is fsynced and checked for compaction.
+	persistSyncInterval = time.Second
+	// compactJournalBytes triggers a snapshot once the journal grows past this size.
+	compactJournalBytes = 16 << 20
+
+	snapshotFile   = "snapshot.json"
+	journalPrefix  = "journal-"
+	journalSuffix  = ".log"
+	blobsDir       = "blobs"
+	blobFileSuffix = ".gz"
+)
+
+// Journal record operations.
+const (
+	journalPut      = "put"      // Tab created or its metadata/content replaced
+	journalPatch    = "patch"    // Delta applied to a tab's content
+	journalDelete   = "delete"   // Tab closed (moved to the closed stack)
+	journalActivate = "activate" // Active tab changed
+	journalReopen   = "reopen"   // Most recently closed tab reopened
+	journalClear    = "clear"    // All tabs removed
+	journalBatch    = "batch"    // Puts and deletes applied as one transition
+)
+
+// persistedTab is a tab as stored on disk. Content is referenced by hash;
+// its compressed bytes live in blobs/<hash>.gz, or are re-read from
+// SourcePath when FileSynced is set.
+type persistedTab struct {
+	ID         string    `json:"id"`
+	Title      string    `json:"title"`
+	Type       TabType   `json:"type"`
+	Language   string    `json:"language,omitempty"`
+	DiffMeta   *DiffMeta `json:"diff,omitempty"`
+	SourcePath string    `json:"sourcePath,omitempty"`
+	Stale      bool      `json:"stale,omitempty"`
+	Follow     bool      `json:"follow,omitempty"`
+	Version    uint64    `json:"version"`
+	CreatedAt  time.Time `json:"createdAt"`
+	UpdatedAt  time.Time `json:"updatedAt"`
+	Blob       string    `json:"blob,omitempty"` // Hex content hash; empty for empty content
+	Size       int64     `json:"size,omitempty"`
+	FileSynced bool      `json:"fileSynced,omitempty"` // Content is SourcePath's; no blob file is kept
+}
+
+// journalRecord is one line of the append-only journal.
+type journalRecord struct {
+	Seq     uint64          `json:"seq"`
+	Op      string          `json:"op"`
+	ID      string          `json:"id,omitempty"`
+	Tab     *persistedTab   `json:"tab,omitempty"`
+	Ops     []PatchOp       `json:"ops,omitempty"`     // patch: ops with byte offsets
+	Version uint64          `json:"version,omitempty"` // patch: resulting version
+	At      time.Time       `json:"at,omitempty"`      // patch: update time
+	Batch   []journalRecord `json:"batch,omitempty"`   // batch: put and delete records in order
+}
+
+// stateSnapshot is a compacted copy of the state up to and including Seq.
+type stateSnapshot struct {
+	Seq    uint64          `json:"seq"`
+	Tabs   []*persistedTab `json:"tabs"`
+	Active string          `json:"active"`
+	Closed []*persistedTab `json:"closed"` // Oldest first
+}
+
+// Persister writes state mutations to a journal in a state directory and
+// compacts them into snapshots. Lock order: State.mu, then Persister.mu.
+type Persister struct {
+	dir string
+
+	mu           sync.Mutex
+	journal      *os.File
+	journalPath  string
+	journalBytes int64
+	seq          uint64            // Last sequence number written
+	dirty        bool              // Journal has unsynced writes
+	onDisk       map[BlobHash]bool // Blob files known to exist
+	pinned       map[BlobHash]bool // Blobs referenced by the current journal
+	writing      int               // Blob writes in progress; their temp files are kept
+	lost         map[string]bool   // Replayed tabs whose journaled content was never written
+
+	stop chan struct{}
+	done chan struct{}
+}
+
+// EnablePersistence restores tabs saved in dir and journals every later
+// mutation there. Tab metadata is restored immediately; content is loaded
+// lazily on first access. Must be called before the state is used.
+// Returns the number of tabs restored.
+func (s *State) EnablePersistence(dir string) (int, error) {
+	if err := os.MkdirAll(filepath.Join(dir, blobsDir), 0755); err != nil {
+		return 0, err
+	}
+	p := &Persister{
+		dir:    dir,
+		onDisk: make(map[BlobHash]bool),
+		pinned: make(map[BlobHash]bool),
+		lost:   make(map[string]bool),
+		stop:   make(chan struct{}),
+		done:   make(chan struct{}),
+	}
+
+	seq, journals, err := s.restore(p)
+	if err != nil {
+		return 0, err
+	}
+	if err := p.openJournal(seq); err != nil {
+		return 0, err
+	}
+
+	s.mu.Lock()
+	s.persist = p
+	restored := len(s.tabs)
+	s.mu.Unlock()
+
+	// Fold replayed journals into a fresh snapshot so the next start is fast
+	if len(journals) > 0 {
+		if err := s.Compact(); err != nil {
+			log.Printf("Warning: cannot compact state: %v", err)
+		}
+	}
+
+	go s.runPersister(p)
+	return restored, nil
+}
+
+// runPersister periodically fsyncs the journal and compacts it when large.
+func (s *State) runPersister(p *Persister) {
+	defer close(p.done)
+	ticker := time.NewTicker(persistSyncInterval)
+	defer ticker.Stop()
+
+	for {
+		select {
+		case <-p.stop:
+			return
+		case <-ticker.C:
+			s.writePendingBlobs()
+			p.mu.Lock()
+			if p.dirty {
+				p.journal.Sync()
+				p.dirty = false
+			}
+			large := p.journalBytes > compactJournalBytes
+			p.mu.Unlock()
+
+			if large {
+				if err := s.Compact(); err != nil {
+					log.Printf("Warning: cannot compact state: %v", err)
+				}
+			}
+		}
+	}
+}
+
+// closePersistence stops the background loop and writes a final snapshot.
+func (s *State) closePersistence() error {
+	s.mu.RLock()
+	p := s.persist
+	s.mu.RUnlock()
+	if p == nil {
+		return nil
+	}
+
+	close(p.stop)
+	<-p.done
+	s.writePendingBlobs()
+	err := s.Compact()
+
+	s.mu.Lock()
+	s.persist = nil
+	s.mu.Unlock()
+
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	p.journal.Close()
+	return err
+}
+
+// Compact writes a snapshot of the current state and removes the journal
+// entries it covers, along with blob files no longer referenced. Content of
+// patched tabs is written without holding the state lock.
+func (s *State) Compact() error {
+	s.mu.RLock()
+	p := s.persist
+	if p == nil {
+		s.mu.RUnlock()
+		return nil
+	}
+
+	snap := &stateSnapshot{Active: s.activeID}
+	pending := make(map[BlobHash]*Blob)
+	capture := func(tab *Tab) *persistedTab {
+		rec := s.persistedTabLocked(tab)
+		if rec.FileSynced || tab.blob == nil {
+			return rec
+		}
+		if _, seen := pending[tab.blob.hash]; !seen {
+			s.blobs.Retain(tab.blob)
+			pending[tab.blob.hash] = tab.blob
+		}
+		return rec
+	}
+	for _, id := range s.order.IDs() {
+		snap.Tabs = append(snap.Tabs, capture(s.tabs[id]))
+	}
+	for _, tab := range s.closedTabs {
+		snap.Closed = append(snap.Closed, capture(tab))
+	}
+
+	// Start a new journal; everything up to here is covered by the snapshot
+	p.mu.Lock()
+	snap.Seq = p.seq
+	err := p.rotateLocked()
+	p.mu.Unlock()
+	s.mu.RUnlock()
+
+	defer func() {
+		for _, blob := range pending {
+			s.blobs.Release(blob)
+		}
+	}()
+	if err != nil {
+		return err
+	}
+
+	for hash, blob := range pending {
+		if err := p.writeBlob(s.blobs, hash, blob); err != nil {
+			return err
+		}
+	}
+	if err := writeFileAtomic(filepath.Join(p.dir, snapshotFile), snap); err != nil {
+		return err
+	}
+
+	// The snapshot is durable; older journals and unreferenced blobs can go
+	p.removeOldJournals()
+	p.collectBlobs(snap, s.blobs)
+	return nil
+}
+
+// journalLocked appends a record to the journal, if persistence is enabled.
+// Failures are logged; the in-memory state stays authoritative.
+// Caller must hold the state write lock.
+func (s *State) journalLocked(rec journalRecord) {
+	if s.persist == nil {
+		return
+	}
+	if err := s.persist.append(rec); err != nil {
+		log.Printf("Warning: cannot journal %s of tab %s: %v", rec.Op, rec.ID, err)
+	}
+}
+
+// journalTabLocked journals the full state of a tab, queueing its content
+// for the blob directory if needed. Caller must hold the state write lock.
+func (s *State) journalTabLocked(tab *Tab) {
+	if rec, ok := s.putRecordLocked(tab); ok {
+		s.journalLocked(rec)
+	}
+}
+
+// putRecordLocked returns the put record for a tab. Content not yet in the
+// blob directory is queued for writePendingBlobs, so large content is never
+// compressed and written under the state lock. Returns false if persistence
+// is disabled. Caller must hold the state write lock.
+func (s *State) putRecordLocked(tab *Tab) (journalRecord, bool) {
+	if s.persist == nil {
+		return journalRecord{}, false
+	}
+	rec := s.persistedTabLocked(tab)
+	if !rec.FileSynced && tab.blob != nil && !s.persist.pin(tab.blob.hash) {
+		s.blobs.Retain(tab.blob)
+		s.unwritten = append(s.unwritten, tab.blob)
+	}
+	return journalRecord{Op: journalPut, ID: tab.ID, Tab: rec}, true
+}
+
+// writePendingBlobs writes content queued by putRecordLocked to the blob
+// directory. Mutations that journal tab content call it once the state lock
+// is released, and the persister loop calls it to catch the rest. Failed
+// writes stay queued and are retried; until then restore skips the puts
+// that reference them (see replay).
+func (s *State) writePendingBlobs() {
+	s.mu.Lock()
+	p, pending := s.persist, s.unwritten
+	s.unwritten = nil
+	s.mu.Unlock()
+
+	var failed []*Blob
+	for _, blob := range pending {
+		if p != nil {
+			if err := p.writeBlob(s.blobs, blob.hash, blob); err != nil {
+				log.Printf("Warning: cannot persist content %s: %v", blob.hash, err)
+				failed = append(failed, blob)
+				continue
+			}
+		}
+		s.blobs.Release(blob)
+	}
+	if len(failed) > 0 {
+		s.mu.Lock()
+		s.unwritten = append(s.unwritten, failed...)
+		s.mu.Unlock()
+	}
+}
+
+// persistedTabLocked converts a stored tab to its on-disk form.
+// Caller must hold the lock.
+func (s *State) persistedTabLocked(tab *Tab) *persistedTab {
+	rec := &persistedTab{
+		ID:         tab.ID,
+		Title:      tab.Title,
+		Type:       tab.Type,
+		Language:   tab.Language,
+		DiffMeta:   tab.DiffMeta,
+		SourcePath: tab.SourcePath,
+		Stale:      tab.Stale,
+		Follow:     tab.Follow,
+		Version:    tab.Version,
+		CreatedAt:  tab.CreatedAt,
+		UpdatedAt:  tab.UpdatedAt,
+		FileSynced: tab.fileSynced || tab.dropped,
+	}
+	switch {
+	case tab.dropped:
+		rec.Blob = tab.droppedHash.String()
+	case tab.blob != nil:
+		rec.Blob = tab.blob.hash.String()
+		rec.Size = tab.blob.size
+	}
+	return rec
+}
+
+// restore loads the snapshot and replays journals from p.dir into s.
+// Returns the last sequence number seen and the journal files replayed.
+func (s *State) restore(p *Persister) (uint64, []string, error) {
+	var snap stateSnapshot
+	data, err := os.ReadFile(filepath.Join(p.dir, snapshotFile))
+	switch {
+	case err == nil:
+		if err := json.Unmarshal(data, &snap); err != nil {
+			return 0, nil, fmt.Errorf("corrupt snapshot: %w", err)
+		}
+	case !os.IsNotExist(err):
+		return 0, nil, err
+	}
+
+	s.mu.Lock()
+	for _, rec := range snap.Tabs {
+		s.restoreTabLocked(p, rec)
+	}
+	for _, rec := range snap.Closed {
+		tab := &Tab{}
+		s.applyPersistedLocked(p, tab, rec)
+		s.closedTabs = append(s.closedTabs, tab)
+	}
+	if _, exists := s.tabs[snap.Active]; exists {
+		s.activeID = snap.Active
+	}
+	s.publishLocked()
+	s.mu.Unlock()
+
+	journals, err := p.listJournals()
+	if err != nil {
+		return 0, nil, err
+	}
+	seq := snap.Seq
+	for _, path := range journals {
+		last, err := s.replayJournal(p, path, snap.Seq)
+		if err != nil {
+			return 0, nil, err
+		}
+		seq = max(seq, last)
+	}
+	return seq, journals, nil
+}
+
+// replayJournal applies records after afterSeq from one journal file.
+// A torn final line (from a crash mid-write) ends the replay of that file.
+// Returns the last sequence number applied.
+func (s *State) replayJournal(p *Persister, path string, afterSeq uint64) (uint64, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return 0, err
+	}
+	defer f.Close()
+
+	var last uint64
+	scanner := bufio.NewScanner(f)
+	scanner.Buffer(make([]byte, 64*1024), 1<<30)
+	for scanner.Scan() {
+		var rec journalRecord
+		if err := json.Unmarshal(scanner.Bytes(), &rec); err != nil {
+			log.Printf("Warning: ignoring truncated journal entry in %s", path)
+			break
+		}
+		if rec.Seq <= afterSeq {
+			continue
+		}
+		s.replay(p, rec)
+		last = rec.Seq
+	}
+	return last, nil
+}
+
+// replay applies one journal record through the same State methods that
+// produced it. Persistence is not yet enabled, so nothing is re-journaled.
+func (s *State) replay(p *Persister, rec journalRecord) {
+	switch rec.Op {
+	case journalPut:
+		if rec.Tab == nil {
+			return
+		}
+		if !p.blobWritten(rec.Tab) {
+			// The process stopped before the content was written; keep the
+			// tab as it was, and skip patches made against the lost content
+			log.Printf("Warning: content of tab %s was not saved; restoring an earlier version", rec.ID)
+			p.lost[rec.ID] = true
+			return
+		}
+		delete(p.lost, rec.ID)
+		s.mu.Lock()
+		s.restoreTabLocked(p, rec.Tab)
+		s.publishLocked()
+		s.mu.Unlock()
+
+	case journalPatch:
+		s.mu.RLock()
+		tab, exists := s.tabs[rec.ID]
+		dropped := exists && tab.dropped
+		s.mu.RUnlock()
+		if dropped {
+			// Only journals from before patched file tabs were recorded in
+			// full can do this; the source file may have changed since
+			log.Printf("Warning: cannot replay patch of file tab %s without re-reading its file", rec.ID)
+			p.lost[rec.ID] = true
+		}
+		if p.lost[rec.ID] {
+			return
+		}
+		if _, err := s.PatchTab(rec.ID, 0, rec.Ops); err != nil {
+			log.Printf("Warning: cannot replay patch of tab %s: %v", rec.ID, err)
+			return
+		}
+		s.mu.Lock()
+		if tab, exists := s.tabs[rec.ID]; exists {
+			tab.Version = rec.Version
+			tab.UpdatedAt = rec.At
+			s.publishTabLocked(tab)
+		}
+		s.mu.Unlock()
+
+	case journalDelete:
+		s.DeleteTab(rec.ID)
+
+	case journalActivate:
+		s.SetActive(rec.ID)
+
+	case journalReopen:
+		if tab := s.ReopenTab(); tab != nil && tab.ID != rec.ID {
+			s.mu.Lock()
+			s.renameTabLocked(tab.ID, rec.ID)
+			s.mu.Unlock()
+		}
+
+	case journalClear:
+		p.lost = make(map[string]bool)
+		s.Clear()
+
+	case journalBatch:
+		for _, sub := range rec.Batch {
+			s.replay(p, sub)
+		}
+	}
+}
+
+// blobWritten reports whether a persisted tab's content blob, if it has
+// one, is in the blob directory.
+func (p *Persister) blobWritten(rec *persistedTab) bool {
+	hash, ok := parseBlobHash(rec.Blob)
+	if rec.FileSynced || !ok {
+		return true
+	}
+	_, err := os.Stat(p.blobPath(hash))
+	return err == nil
+}
+
+// restoreTabLocked creates or replaces an open tab from its persisted form.
+// Caller must hold the lock.
+func (s *State) restoreTabLocked(p *Persister, rec *persistedTab) {
+	tab, exists := s.tabs[rec.ID]
+	if !exists {
+		tab = &Tab{}
+		s.tabs[rec.ID] = tab
+		s.order.Append(rec.ID)
+		if len(s.tabs) == 1 {
+			s.activeID = rec.ID
+		}
+	}
+	s.applyPersistedLocked(p, tab, rec)
+}
+
+// applyPersistedLocked sets a tab's fields from rec. Content is attached
+// lazily: blob files are adopted without reading, and file-synced tabs are
+// marked dropped so SourcePath is read on first access. Caller must hold the lock.
+func (s *State) applyPersistedLocked(p *Persister, tab *Tab, rec *persistedTab) {
+	s.blobs.Release(tab.blob)
+	*tab = Tab{
+		ID:         rec.ID,
+		Title:      rec.Title,
+		Type:       rec.Type,
+		Language:   rec.Language,
+		DiffMeta:   rec.DiffMeta,
+		SourcePath: rec.SourcePath,
+		Stale:      rec.Stale,
+		Follow:     rec.Follow,
+		Version:    rec.Version,
+		CreatedAt:  rec.CreatedAt,
+		UpdatedAt:  rec.UpdatedAt,
+		access:     newAccessClock(),
+	}
+
+	hash, ok := parseBlobHash(rec.Blob)
+	switch {
+	case rec.FileSynced && rec.SourcePath != "":
+		tab.fileSynced = true
+		tab.dropped = true
+		tab.droppedHash = hash
+	case ok:
+		tab.blob = s.blobs.Adopt(hash, rec.Size, p.blobPath(hash))
+	}
+}
+
+// renameTabLocked changes an open tab's ID. Caller must hold the lock.
+func (s *State) renameTabLocked(from, to string) {
+	tab, exists := s.tabs[from]
+	if !exists || from == to {
+		return
+	}
+	if _, taken := s.tabs[to]; taken {
+		return
+	}
+	delete(s.tabs, from)
+	tab.ID = to
+	s.tabs[to] = tab
+	s.order.Rename(from, to)
+	if s.activeID == from {
+		s.activeID = to
+	}
+	s.publishLocked()
+}
+
+// append writes a record to the journal with the next sequence number.
+func (p *Persister) append(rec journalRecord) error {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	rec.Seq = p.seq + 1
+	data, err := json.Marshal(rec)
+	if err != nil {
+		return err
+	}
+	n, err := p.journal.Write(append(data, '\n'))
+	p.journalBytes += int64(n)
+	if err != nil {
+		return err
+	}
+	p.seq = rec.Seq
+	p.dirty = true
+	if rec.Tab != nil {
+		if hash, ok := parseBlobHash(rec.Tab.Blob); ok {
+			p.pinned[hash] = true
+		}
+	}
+	return nil
+}
+
+// pin protects a blob file from collection and reports whether it is
+// already written.
+func (p *Persister) pin(hash BlobHash) bool {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	p.pinned[hash] = true
+	return p.onDisk[hash]
+}
+
+// writeBlob writes a blob's content to the blob directory unless it is
+// already there, and pins it against collection.
+func (p *Persister) writeBlob(bs *BlobStore, hash BlobHash, blob *Blob) error {
+	p.mu.Lock()
+	known := p.onDisk[hash]
+	p.pinned[hash] = true
+	if !known {
+		p.writing++
+	}
+	p.mu.Unlock()
+	if known {
+		return nil
+	}
+
+	err := bs.Persist(blob, p.blobPath(hash))
+
+	p.mu.Lock()
+	p.writing--
+	if err == nil {
+		p.onDisk[hash] = true
+	}
+	p.mu.Unlock()
+	return err
+}
+
+// blobPath returns the path of a blob's file in the state directory.
+func (p *Persister) blobPath(hash BlobHash) string {
+	return filepath.Join(p.dir, blobsDir, hash.String()+blobFileSuffix)
+}
+
+// openJournal starts a journal file for records after seq.
+func (p *Persister) openJournal(seq uint64) error {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	p.seq = seq
+	return p.rotateLocked()
+}
+
+// rotateLocked closes the current journal and starts a new one for records
+// after p.seq. A leftover file of the same name holds no valid records
+// (otherwise seq would be higher), so it is truncated. Caller must hold p.mu.
+func (p *Persister) rotateLocked() error {
+	path := filepath.Join(p.dir, fmt.Sprintf("%s%020d%s", journalPrefix, p.seq+1, journalSuffix))
+	f, err := os.OpenFile(path, os.O_CREATE|os.O_WRONLY|os.O_TRUNC|os.O_APPEND, 0644)
+	if err != nil {
+		return err
+	}
+	if p.journal != nil {
+		p.journal.Sync()
+		p.journal.Close()
+	}
+	p.journal = f
+	p.journalPath = path
+	p.journalBytes = 0
+	p.dirty = false
+	p.pinned = make(map[BlobHash]bool)
+	return nil
+}
+
+// listJournals returns journal files in sequence order.
+func (p *Persister) listJournals() ([]string, error) {
+	matches, err := filepath.Glob(filepath.Join(p.dir, journalPrefix+"*"+journalSuffix))
+	if err != nil {
+		return nil, err
+	}
+	sort.Strings(matches) // Zero-padded start sequence sorts numerically
+	return matches, nil
+}
+
+// removeOldJournals deletes journal files other than the current one.
+func (p *Persister) removeOldJournals() {
+	journals, _ := p.listJournals()
+
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	for _, path := range journals {
+		if path != p.journalPath {
+			os.Remove(path)
+		}
+	}
+}
+
+// collectBlobs removes blob files referenced neither by snap, the current
+// journal, nor any blob still held in memory (which may use the file as its
+// spill copy). Temp files are kept while a blob write is in progress: it
+// starts and ends under p.mu, so none can start or finish during the sweep.
+func (p *Persister) collectBlobs(snap *stateSnapshot, bs *BlobStore) {
+	live := make(map[string]bool)
+	for _, tabs := range [][]*persistedTab{snap.Tabs, snap.Closed} {
+		for _, rec := range tabs {
+			if !rec.FileSynced && rec.Blob != "" {
+				live[rec.Blob] = true
+			}
+		}
+	}
+
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	for hash := range p.pinned {
+		live[hash.String()] = true
+	}
+
+	entries, err := os.ReadDir(filepath.Join(p.dir, blobsDir))
+	if err != nil {
+		return
+	}
+	for _, entry := range entries {
+		name := entry.Name()
+		key := strings.TrimSuffix(name, blobFileSuffix)
+		hash, ok := parseBlobHash(key)
+		if live[key] || (ok && bs.Contains(hash)) {
+			continue
+		}
+		if !ok && p.writing > 0 {
+			continue // May be the temp file of a write in progress
+		}
+		// Also clears temp files left by a crash mid-write
+		os.Remove(filepath.Join(p.dir, blobsDir, name))
+		delete(p.onDisk, hash)
+	}
+}
+
+// writeFileAtomic writes v as JSON to path via a synced temp file and rename.
+func writeFileAtomic(path string, v interface{}) error {
+	data, err := json.Marshal(v)
+	if err != nil {
+		return err
+	}
+
+	tmp := path + ".tmp." + strconv.Itoa(os.Getpid())
+	f, err := os.Create(tmp)
+	if err != nil {
+		return err
+	}
+	if _, err := f.Write(data); err != nil {
+		f.Close()
+		os.Remove(tmp)
+		return err
+	}
+	if err := f.Sync(); err != nil {
+		f.Close()
+		os.Remove(tmp)
+		return err
+	}
+	if err := f.Close(); err != nil {
+		os.Remove(tmp)
+		return err
+	}
+	return os.Rename(tmp, path)
+}
+
+// parseBlobHash decodes a hex content hash.
+func parseBlobHash(s string) (BlobHash, bool) {
+	var hash BlobHash
+	if len(s) != hex.EncodedLen(len(hash)) {
+		return hash, false
+	}
+	if _, err := hex.Decode(hash[:], []byte(s)); err != nil {
+		return hash, false
+	}
+	return hash, true
+}
@@ -0,0 +1,392 @@
+package main
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+)
+
+// openPersistentState creates a state persisted in dir, failing the test on error.
+func openPersistentState(t *testing.T, dir string) *State {
+	t.Helper()
+	state := NewState()
+	if _, err := state.EnablePersistence(dir); err != nil {
+		t.Fatalf("EnablePersistence failed: %v", err)
+	}
+	return state
+}
+
+// crash stops a state's persister without writing a final snapshot,
+// leaving only what the journal recorded.
+func crash(state *State) {
+	state.mu.Lock()
+	p := state.persist
+	state.persist = nil
+	state.mu.Unlock()
+
+	close(p.stop)
+	<-p.done
+	p.journal.Close()
+}
+
+// buildSession populates a state with open, closed, patched and active tabs.
+func buildSession(state *State) {
+	state.CreateTab(&Tab{ID: "readme", Title: "README", Type: TabTypeMarkdown, Content: "# Hello"})
+	state.CreateTab(&Tab{ID: "code", Title: "main.go", Type: TabTypeCode, Language: "go", Content: "package main\n"})
+	state.CreateTab(&Tab{ID: "log", Title: "Log", Type: TabTypeCode, Content: "start\n"})
+	state.CreateTab(&Tab{ID: "gone", Title: "Gone", Type: TabTypeMarkdown, Content: "closed content"})
+	state.PatchTab("log", 0, []PatchOp{{Op: PatchOpAppend, Text: "more\n"}})
+	state.DeleteTab("gone")
+	state.SetActive("code")
+}
+
+// checkSession verifies a state restored from buildSession.
+func checkSession(t *testing.T, state *State) {
+	t.Helper()
+
+	var ids []string
+	for _, tab := range state.ListTabs() {
+		ids = append(ids, tab.ID)
+	}
+	if got := strings.Join(ids, ","); got != "readme,code,log" {
+		t.Errorf("expected order readme,code,log, got %s", got)
+	}
+	if active := state.GetActive(); active != "code" {
+		t.Errorf("expected active tab 'code', got %q", active)
+	}
+
+	code, _ := state.GetTab("code")
+	if code.Title != "main.go" || code.Language != "go" || code.Content != "package main\n" {
+		t.Errorf("unexpected restored tab: %+v", code)
+	}
+
+	log, _ := state.GetTab("log")
+	if log.Content != "start\nmore\n" {
+		t.Errorf("expected patched content, got %q", log.Content)
+	}
+	if log.Version != 2 {
+		t.Errorf("expected version 2, got %d", log.Version)
+	}
+
+	if state.ClosedTabCount() != 1 {
+		t.Fatalf("expected 1 closed tab, got %d", state.ClosedTabCount())
+	}
+	reopened := state.ReopenTab()
+	if reopened.ID != "gone" || reopened.Content != "closed content" {
+		t.Errorf("unexpected reopened tab: %s %q", reopened.ID, reopened.Content)
+	}
+}
+
+// TestPersistence_RestoresAfterClose tests restoring from a compacted snapshot.
+func TestPersistence_RestoresAfterClose(t *testing.T) {
+	dir := t.TempDir()
+
+	state := openPersistentState(t, dir)
+	buildSession(state)
+	if err := state.Close(); err != nil {
+		t.Fatalf("Close failed: %v", err)
+	}
+
+	journals, _ := filepath.Glob(filepath.Join(dir, journalPrefix+"*"))
+	if len(journals) != 1 {
+		t.Errorf("expected compaction to leave 1 journal, got %d", len(journals))
+	}
+
+	restored := openPersistentState(t, dir)
+	defer restored.Close()
+	checkSession(t, restored)
+}
+
+// TestPersistence_RestoresAfterCrash tests replaying the journal without a snapshot.
+func TestPersistence_RestoresAfterCrash(t *testing.T) {
+	dir := t.TempDir()
+
+	state := openPersistentState(t, dir)
+	buildSession(state)
+	crash(state)
+
+	if _, err := os.Stat(filepath.Join(dir, snapshotFile)); !os.IsNotExist(err) {
+		t.Fatal("expected no snapshot before compaction")
+	}
+
+	restored := openPersistentState(t, dir)
+	defer restored.Close()
+	checkSession(t, restored)
+}
+
+// TestPersistence_SnapshotPlusJournal tests replaying journal entries after a snapshot.
+func TestPersistence_SnapshotPlusJournal(t *testing.T) {
+	dir := t.TempDir()
+
+	state := openPersistentState(t, dir)
+	state.CreateTab(&Tab{ID: "a", Content: "first"})
+	if err := state.Compact(); err != nil {
+		t.Fatalf("Compact failed: %v", err)
+	}
+	state.CreateTab(&Tab{ID: "b", Content: "second"})
+	state.PatchTab("a", 0, []PatchOp{{Op: PatchOpReplace, Offset: 0, Length: 5, Text: "FIRST"}})
+	crash(state)
+
+	restored := openPersistentState(t, dir)
+	defer restored.Close()
+
+	a, _ := restored.GetTab("a")
+	b, _ := restored.GetTab("b")
+	if a == nil || a.Content != "FIRST" {
+		t.Errorf("expected patched tab a, got %+v", a)
+	}
+	if b == nil || b.Content != "second" {
+		t.Errorf("expected tab b from journal, got %+v", b)
+	}
+}
+
+// TestPersistence_TornJournal tests that a partially written record is ignored.
+func TestPersistence_TornJournal(t *testing.T) {
+	dir := t.TempDir()
+
+	state := openPersistentState(t, dir)
+	state.CreateTab(&Tab{ID: "kept", Content: "safe"})
+	journal := state.persist.journalPath
+	crash(state)
+
+	f, _ := os.OpenFile(journal, os.O_APPEND|os.O_WRONLY, 0644)
+	f.WriteString(`{"seq":99,"op":"put","tab":{"id":"tor`)
+	f.Close()
+
+	restored := openPersistentState(t, dir)
+	defer restored.Close()
+	if restored.TabCount() != 1 {
+		t.Errorf("expected 1 tab, got %d", restored.TabCount())
+	}
+
+	// New records must not be lost behind the torn line
+	restored.CreateTab(&Tab{ID: "after", Content: "later"})
+	crash(restored)
+	again := openPersistentState(t, dir)
+	defer again.Close()
+	if _, exists := again.GetTab("after"); !exists {
+		t.Error("expected tab created after torn record to survive")
+	}
+}
+
+// TestPersistence_LazyContent tests that restored content is not read until accessed.
+func TestPersistence_LazyContent(t *testing.T) {
+	dir := t.TempDir()
+
+	state := openPersistentState(t, dir)
+	for i := 0; i < 1000; i++ {
+		state.CreateTab(&Tab{ID: fmt.Sprintf("tab-%d", i), Content: strings.Repeat(fmt.Sprint(i), 100)})
+	}
+	state.Close()
+
+	start := time.Now()
+	restored := openPersistentState(t, dir)
+	elapsed := time.Since(start)
+	defer restored.Close()
+
+	if restored.TabCount() != 1000 {
+		t.Fatalf("expected 1000 tabs, got %d", restored.TabCount())
+	}
+	if elapsed > time.Second {
+		t.Errorf("expected restore well under a second, took %v", elapsed)
+	}
+	if resident := restored.ContentStats().ResidentBytes; resident != 0 {
+		t.Errorf("expected no content loaded on restore, got %d resident bytes", resident)
+	}
+
+	tab, _ := restored.GetTab("tab-42")
+	if tab.Content != strings.Repeat("42", 100) {
+		t.Errorf("unexpected lazily loaded content %q", tab.Content)
+	}
+	if loads := restored.ContentStats().Loads; loads != 1 {
+		t.Errorf("expected exactly 1 load, got %d", loads)
+	}
+}
+
+// TestPersistence_FileBackedTabs tests that file tabs re-read their source on restore.
+func TestPersistence_FileBackedTabs(t *testing.T) {
+	dir := t.TempDir()
+	path := filepath.Join(t.TempDir(), "notes.md")
+	os.WriteFile(path, []byte("# Before"), 0644)
+
+	state := openPersistentState(t, dir)
+	state.CreateTab(&Tab{ID: "notes", Type: TabTypeMarkdown, Content: "# Before", SourcePath: path})
+	state.Close()
+
+	blobs, _ := os.ReadDir(filepath.Join(dir, blobsDir))
+	if len(blobs) != 0 {
+		t.Errorf("expected no blob file for file-backed content, got %d", len(blobs))
+	}
+
+	os.WriteFile(path, []byte("# After"), 0644)
+
+	restored := openPersistentState(t, dir)
+	defer restored.Close()
+	tab, _ := restored.GetTab("notes")
+	if tab.Content != "# After" {
+		t.Errorf("expected content re-read from file, got %q", tab.Content)
+	}
+	if tab.Version != 2 {
+		t.Errorf("expected version bump for changed file, got %d", tab.Version)
+	}
+}
+
+// TestPersistence_PatchedFileTab tests that a patched file tab is restored
+// from the journal without reading its source file.
+func TestPersistence_PatchedFileTab(t *testing.T) {
+	dir := t.TempDir()
+	path := filepath.Join(t.TempDir(), "log.txt")
+	os.WriteFile(path, []byte("line 1\n"), 0644)
+
+	state := openPersistentState(t, dir)
+	state.CreateTab(&Tab{ID: "log", Content: "line 1\n", SourcePath: path})
+	state.PatchTab("log", 0, []PatchOp{{Op: PatchOpAppend, Text: "local\n"}})
+	crash(state)
+	os.WriteFile(path, []byte("rewritten\n"), 0644)
+
+	restored := openPersistentState(t, dir)
+	defer restored.Close()
+	if reloads := restored.MemoryStats().Reloads; reloads != 0 {
+		t.Errorf("expected restore not to read the source file, got %d reloads", reloads)
+	}
+	if tab, _ := restored.GetTab("log"); tab.Content != "line 1\nlocal\n" || tab.Version != 2 {
+		t.Errorf("expected the patched content at version 2, got %q at %d", tab.Content, tab.Version)
+	}
+}
+
+// TestPersistence_CollectsBlobs tests that content of removed tabs is deleted on compaction.
+func TestPersistence_CollectsBlobs(t *testing.T) {
+	dir := t.TempDir()
+
+	state := openPersistentState(t, dir)
+	defer state.Close()
+	state.CreateTab(&Tab{ID: "keep", Content: "kept"})
+	state.CreateTab(&Tab{ID: "drop", Content: "dropped"})
+	state.Clear()
+	state.CreateTab(&Tab{ID: "keep", Content: "kept"})
+	if err := state.Compact(); err != nil {
+		t.Fatalf("Compact failed: %v", err)
+	}
+
+	blobs, _ := os.ReadDir(filepath.Join(dir, blobsDir))
+	if len(blobs) != 1 {
+		t.Errorf("expected 1 blob file after compaction, got %d", len(blobs))
+	}
+}
+
+// TestPersistence_WritesBlobsOutsideLock tests that journaling a tab only
+// queues its content, which is written once the state lock is released.
+func TestPersistence_WritesBlobsOutsideLock(t *testing.T) {
+	dir := t.TempDir()
+	state := openPersistentState(t, dir)
+	defer state.Close()
+
+	countBlobs := func() int {
+		blobs, _ := os.ReadDir(filepath.Join(dir, blobsDir))
+		return len(blobs)
+	}
+
+	state.mu.Lock()
+	stored, _ := state.createTabLocked(&Tab{ID: "big", Content: strings.Repeat("x", 1<<20)}, time.Now())
+	state.commitTabLocked(stored)
+	if n := countBlobs(); n != 0 {
+		t.Errorf("expected no blob written under the lock, got %d", n)
+	}
+	state.mu.Unlock()
+	state.writePendingBlobs()
+	if n := countBlobs(); n != 1 {
+		t.Errorf("expected the blob written after the lock, got %d", n)
+	}
+
+	state.ApplyBatch([]BatchOp{{Tab: &Tab{ID: "a", Content: "one"}}, {Tab: &Tab{ID: "b", Content: "two"}}})
+	if n := countBlobs(); n != 3 || len(state.unwritten) != 0 {
+		t.Errorf("expected batch content written on return, got %d files, %d queued", n, len(state.unwritten))
+	}
+}
+
+// TestPersistence_KeepsTempFilesDuringWrites tests that compaction leaves
+// the temp files of blob writes in progress, and clears them otherwise.
+func TestPersistence_KeepsTempFilesDuringWrites(t *testing.T) {
+	dir := t.TempDir()
+	state := openPersistentState(t, dir)
+	defer state.Close()
+
+	tmp := filepath.Join(dir, blobsDir, "blob-123.tmp")
+	os.WriteFile(tmp, []byte("partial"), 0644)
+	state.persist.mu.Lock()
+	state.persist.writing++
+	state.persist.mu.Unlock()
+	if err := state.Compact(); err != nil {
+		t.Fatalf("Compact failed: %v", err)
+	}
+	if _, err := os.Stat(tmp); err != nil {
+		t.Errorf("expected the temp file of a write in progress to be kept: %v", err)
+	}
+
+	state.persist.mu.Lock()
+	state.persist.writing--
+	state.persist.mu.Unlock()
+	if err := state.Compact(); err != nil {
+		t.Fatalf("Compact failed: %v", err)
+	}
+	if _, err := os.Stat(tmp); !os.IsNotExist(err) {
+		t.Error("expected a leftover temp file to be removed")
+	}
+}
+
+// TestPersistence_SkipsUnwrittenContent tests that a journaled put whose
+// content never reached the blob directory, and patches after it, are not
+// replayed.
+func TestPersistence_SkipsUnwrittenContent(t *testing.T) {
+	dir := t.TempDir()
+	state := openPersistentState(t, dir)
+	state.CreateTab(&Tab{ID: "doc", Content: "saved"})
+
+	// Journal a put as if the process stopped before writing its blob
+	state.mu.Lock()
+	stored, _ := state.createTabLocked(&Tab{ID: "doc", Content: "never written"}, time.Now())
+	state.commitTabLocked(stored)
+	state.unwritten = nil
+	state.mu.Unlock()
+	state.PatchTab("doc", 0, []PatchOp{{Op: PatchOpAppend, Text: "!"}})
+	crash(state)
+
+	restored := openPersistentState(t, dir)
+	defer restored.Close()
+	if tab, _ := restored.GetTab("doc"); tab.Content != "saved" || tab.Version != 1 {
+		t.Errorf("expected the last saved version, got %q at version %d", tab.Content, tab.Version)
+	}
+}
+
+// TestServerEnablePersistence_RewatchesFiles tests that restored file tabs are watched again.
+func TestServerEnablePersistence_RewatchesFiles(t *testing.T) {
+	dir := t.TempDir()
+	path := filepath.Join(t.TempDir(), "watched.md")
+	os.WriteFile(path, []byte("# Watched"), 0644)
+
+	state := openPersistentState(t, dir)
+	state.CreateTab(&Tab{ID: "w", Content: "# Watched", SourcePath: path})
+	state.Close()
+
+	srv := NewServer()
+	if srv.fileWatcher == nil {
+		t.Skip("file watching unavailable")
+	}
+	defer srv.fileWatcher.Stop()
+
+	restored, err := srv.EnablePersistence(dir)
+	if err != nil {
+		t.Fatalf("EnablePersistence failed: %v", err)
+	}
+	defer srv.state.Close()
+
+	if restored != 1 {
+		t.Errorf("expected 1 restored tab, got %d", restored)
+	}
+	if got := srv.fileWatcher.PathForTab("w"); got == "" {
+		t.Error("expected restored tab to be watched")
+	}
+}
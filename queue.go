@@ -0,0 +1,273 @@
+// Package main provides per-client coalescing queues for slow WebSocket consumers.
+package main
+
+import (
+	"sync"
+	"sync/atomic"
+)
+
+const (
+	// clientSendBuffer is the capacity of a client's send channel. Messages
+	// beyond it wait in the client's coalescing queue.
+	clientSendBuffer = 16
+
+	// defaultClientQueueBytes caps the payload bytes queued for one client.
+	// A client that falls further behind is sent a resync message instead.
+	defaultClientQueueBytes = 8 << 20
+
+	// maxMergedPatchBytes stops merging patches into a queued one once its
+	// payload reaches this size, since every merge re-encodes it.
+	maxMergedPatchBytes = 64 << 10
+)
+
+// clientQueue holds messages for a client whose send channel is full.
+// Superseded messages are coalesced so a slow client catches up on the
+// latest state rather than replaying every intermediate version.
+type clientQueue struct {
+	mu      sync.Mutex
+	entries []queued
+	bytes   int
+	closed  bool // Set when send is closed; nothing may be sent after
+}
+
+// queued is one message waiting for a client.
+type queued struct {
+	out  *outbound // Broadcast the payload was built from
+	data []byte    // Payload for this client
+}
+
+// queueCounters counts slow-consumer events across clients.
+type queueCounters struct {
+	queued    atomic.Int64 // Messages that had to wait in a queue
+	coalesced atomic.Int64 // Queued messages dropped or merged as superseded
+	resyncs   atomic.Int64 // Queues replaced by a resync message
+}
+
+// deliver sends a broadcast to a client without blocking. If the client's
+// send channel is full, or earlier messages are still queued, the message
+// is queued behind them and coalesced with superseded ones. Called from the
+// client's shard loop only.
+func (h *Hub) deliver(c *Client, out *outbound) {
+	if out.msg.Seq != 0 && out.msg.Seq <= c.resumedAt {
+		return // Already replayed
+	}
+	data := h.encodeFor(out, c)
+	if data == nil {
+		return // Could not be encoded
+	}
+
+	q := &c.queue
+	q.mu.Lock()
+	defer q.mu.Unlock()
+	if q.closed {
+		return
+	}
+	if len(q.entries) == 0 {
+		select {
+		case c.send <- data:
+			return
+		default:
+		}
+	}
+
+	h.queues.queued.Add(1)
+	if !h.coalesceLocked(c, out) {
+		q.entries = append(q.entries, queued{out: out, data: data})
+		q.bytes += len(data)
+	}
+	if q.bytes > h.clientQueueBytes {
+		// Too far behind to catch up message by message. The client reloads
+		// all state after receiving the resync, which covers every message
+		// queued behind it, so a pending resync absorbs them too. It carries
+		// the latest sequence number it covers.
+		h.queues.coalesced.Add(int64(len(q.entries)))
+		if q.entries[0].out.msg.Type != "resync" {
+			h.queues.resyncs.Add(1)
+		} else {
+			h.queues.coalesced.Add(-1)
+		}
+		resync := h.newOutbound(WSMessage{Type: "resync", Seq: out.msg.Seq})
+		q.entries = []queued{{out: resync, data: h.encodeFor(resync, c)}}
+		q.bytes = len(q.entries[0].data)
+	}
+	c.refillLocked()
+}
+
+// coalesceLocked drops queued messages that out supersedes, and returns
+// true if out was merged into a queued message rather than needing to be
+// appended. Caller must hold the queue lock.
+func (h *Hub) coalesceLocked(c *Client, out *outbound) bool {
+	q := &c.queue
+	msg := &out.msg
+	switch msg.Type {
+	case "tab_updated", "tab_stale", "tab_deleted":
+		// The tab's full state (or removal) supersedes earlier updates and
+		// patches of it. Stop at any other message about it, whose order
+		// relative to this one matters.
+		id := msg.ID
+		if msg.Tab != nil {
+			id = msg.Tab.ID
+		}
+		for i := len(q.entries) - 1; i >= 0; i-- {
+			prev := &q.entries[i].out.msg
+			if prev.Type == "tabs_cleared" {
+				break
+			}
+			if prev.Type == "tab_activated" || !prev.refersTo(id) {
+				continue
+			}
+			switch prev.Type {
+			case "tab_updated", "tab_stale", "tab_patched":
+				h.removeQueuedLocked(q, i)
+				continue
+			case "tab_created":
+				if msg.Tab != nil {
+					// Not yet seen by the client: create it at the latest state.
+					// Merged messages keep the earlier sequence number, so a
+					// client resuming after them may see later ones again
+					// but never misses one queued between them.
+					h.replaceQueuedLocked(c, i, WSMessage{Type: "tab_created", Seq: prev.Seq, Tab: msg.Tab})
+					return true
+				}
+			}
+			break
+		}
+
+	case "tab_patched":
+		// Consecutive patches of a tab merge into one
+		for i := len(q.entries) - 1; i >= 0; i-- {
+			prev := &q.entries[i].out.msg
+			if prev.Type == "tabs_cleared" {
+				break
+			}
+			if prev.Type == "tab_activated" || !prev.refersTo(msg.ID) {
+				continue
+			}
+			if prev.Type == "tab_patched" && prev.Patch.Version == msg.Patch.BaseVersion &&
+				len(q.entries[i].data) < maxMergedPatchBytes {
+				merged := *prev
+				merged.Patch = mergePatches(prev.Patch, msg.Patch)
+				h.replaceQueuedLocked(c, i, merged)
+				return true
+			}
+			break
+		}
+
+	case "tab_activated":
+		for i := len(q.entries) - 1; i >= 0; i-- {
+			if q.entries[i].out.msg.Type == "tab_activated" {
+				h.removeQueuedLocked(q, i)
+			}
+		}
+
+	case "tabs_cleared":
+		h.queues.coalesced.Add(int64(len(q.entries)))
+		q.entries = q.entries[:0]
+		q.bytes = 0
+	}
+	return false
+}
+
+// removeQueuedLocked drops the queued message at index i as superseded.
+func (h *Hub) removeQueuedLocked(q *clientQueue, i int) {
+	q.bytes -= len(q.entries[i].data)
+	q.entries = append(q.entries[:i], q.entries[i+1:]...)
+	h.queues.coalesced.Add(1)
+}
+
+// replaceQueuedLocked replaces the queued message at index i with msg,
+// encoded for the client. Counts the message it absorbs as coalesced.
+func (h *Hub) replaceQueuedLocked(c *Client, i int, msg WSMessage) {
+	q := &c.queue
+	out := h.newOutbound(msg)
+	data := h.encodeFor(out, c)
+	q.bytes += len(data) - len(q.entries[i].data)
+	q.entries[i] = queued{out: out, data: data}
+	h.queues.coalesced.Add(1)
+}
+
+// refillLocked moves queued messages into the send channel while it has
+// room. Caller must hold the queue lock.
+func (c *Client) refillLocked() {
+	q := &c.queue
+	n := 0
+	for n < len(q.entries) {
+		select {
+		case c.send <- q.entries[n].data:
+			q.bytes -= len(q.entries[n].data)
+			n++
+			continue
+		default:
+		}
+		break
+	}
+	if n > 0 {
+		q.entries = append(q.entries[:0], q.entries[n:]...)
+	}
+}
+
+// refill moves queued messages into the send channel after WritePump
+// has made room.
+func (c *Client) refill() {
+	c.queue.mu.Lock()
+	defer c.queue.mu.Unlock()
+	if !c.queue.closed {
+		c.refillLocked()
+	}
+}
+
+// closeSend closes the client's send channel and discards its queue.
+// Called with the client's shard locked, so no delivery is in progress.
+func (c *Client) closeSend() {
+	c.queue.mu.Lock()
+	defer c.queue.mu.Unlock()
+	if !c.queue.closed {
+		c.queue.closed = true
+		c.queue.entries = nil
+		c.queue.bytes = 0
+		close(c.send)
+	}
+}
+
+// depth returns the number of messages waiting for the client, in its
+// send channel and queue, and the queued payload bytes.
+func (c *Client) depth() (int, int) {
+	c.queue.mu.Lock()
+	defer c.queue.mu.Unlock()
+	return len(c.send) + len(c.queue.entries), c.queue.bytes
+}
+
+// refersTo reports whether a message concerns the given tab.
+func (m *WSMessage) refersTo(id string) bool {
+	if m.ID == id || (m.Tab != nil && m.Tab.ID == id) {
+		return true
+	}
+	for _, tab := range m.Tabs {
+		if tab.ID == id {
+			return true
+		}
+	}
+	for _, deleted := range m.IDs {
+		if deleted == id {
+			return true
+		}
+	}
+	return false
+}
+
+// mergePatches returns a patch equivalent to applying a and then b, where
+// b.BaseVersion is a.Version. Ops apply in order, so they are concatenated,
+// and consecutive appends are joined.
+func mergePatches(a, b *TabPatch) *TabPatch {
+	merged := *b
+	merged.BaseVersion = a.BaseVersion
+	merged.Ops = make([]PatchOp, 0, len(a.Ops)+len(b.Ops))
+	for _, op := range append(append([]PatchOp(nil), a.Ops...), b.Ops...) {
+		if last := len(merged.Ops) - 1; last >= 0 && op.Op == PatchOpAppend && merged.Ops[last].Op == PatchOpAppend {
+			merged.Ops[last].Text += op.Text
+			continue
+		}
+		merged.Ops = append(merged.Ops, op)
+	}
+	return &merged
+}
@@ -0,0 +1,167 @@
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"strings"
+	"testing"
+	"time"
+)
+
+// stalledClient registers a client whose send channel is full, so every
+// broadcast waits in its queue.
+func stalledClient(t *testing.T, hub *Hub) *Client {
+	t.Helper()
+	client := &Client{hub: hub, send: make(chan []byte, 1)}
+	client.send <- []byte(`{"type":"filler"}`)
+	hub.register <- client
+	return client
+}
+
+// drain empties a client's send channel and queue, returning the messages
+// after the filler.
+func drain(t *testing.T, c *Client) []WSMessage {
+	t.Helper()
+	time.Sleep(20 * time.Millisecond)
+	var msgs []WSMessage
+	for {
+		c.refill()
+		select {
+		case data := <-c.send:
+			var msg WSMessage
+			if err := json.Unmarshal(data, &msg); err != nil {
+				t.Fatalf("failed to unmarshal: %v", err)
+			}
+			if msg.Type != "filler" {
+				msgs = append(msgs, msg)
+			}
+		default:
+			return msgs
+		}
+	}
+}
+
+// types returns the message types in order.
+func types(msgs []WSMessage) string {
+	var names []string
+	for _, msg := range msgs {
+		names = append(names, msg.Type)
+	}
+	return strings.Join(names, ",")
+}
+
+// TestHubQueue_CoalescesUpdates tests that only the latest state of a tab
+// is delivered to a slow client.
+func TestHubQueue_CoalescesUpdates(t *testing.T) {
+	hub := NewHub()
+	hub.SetUpdateRate(0) // Exercise the queue, not the rate limit
+	go hub.Run()
+	defer hub.Shutdown()
+	client := stalledClient(t, hub)
+
+	hub.Broadcast(WSMessage{Type: "tab_created", Tab: &Tab{ID: "new", Content: "v1", Version: 1}})
+	hub.Broadcast(WSMessage{Type: "tab_activated", ID: "new"})
+	for v := uint64(2); v <= 50; v++ {
+		hub.Broadcast(WSMessage{Type: "tab_updated", Tab: &Tab{ID: "a", Content: fmt.Sprint(v), Version: v}})
+		hub.Broadcast(WSMessage{Type: "tab_updated", Tab: &Tab{ID: "new", Content: fmt.Sprint(v), Version: v}})
+	}
+	hub.Broadcast(WSMessage{Type: "tab_activated", ID: "a"})
+	hub.Broadcast(WSMessage{Type: "tab_deleted", ID: "gone"})
+
+	msgs := drain(t, client)
+	if got := types(msgs); got != "tab_created,tab_updated,tab_activated,tab_deleted" {
+		t.Fatalf("unexpected messages: %s", got)
+	}
+	if msgs[0].Tab.ID != "new" || msgs[0].Tab.Content != "50" {
+		t.Errorf("expected tab_created at the latest state, got %+v", msgs[0].Tab)
+	}
+	if msgs[1].Tab.ID != "a" || msgs[1].Tab.Version != 50 {
+		t.Errorf("expected only the latest update of a, got %+v", msgs[1].Tab)
+	}
+	if msgs[2].ID != "a" {
+		t.Errorf("expected the latest activation, got %s", msgs[2].ID)
+	}
+	if stats := hub.Stats(); stats.Coalesced != 98 || stats.QueuedMessages != 0 {
+		t.Errorf("unexpected stats: %+v", stats)
+	}
+}
+
+// TestHubQueue_MergesPatches tests that consecutive patches merge into one
+// and that a patch is not moved across other messages about its tab.
+func TestHubQueue_MergesPatches(t *testing.T) {
+	hub := NewHub()
+	hub.SetUpdateRate(0) // Exercise the queue, not the rate limit
+	go hub.Run()
+	defer hub.Shutdown()
+	client := stalledClient(t, hub)
+
+	patch := func(base uint64, ops ...PatchOp) WSMessage {
+		return WSMessage{Type: "tab_patched", ID: "log", Patch: &TabPatch{BaseVersion: base, Version: base + 1, Ops: ops}}
+	}
+	for v := uint64(1); v <= 10; v++ {
+		hub.Broadcast(patch(v, PatchOp{Op: PatchOpAppend, Text: fmt.Sprintf("%d;", v)}))
+	}
+	hub.Broadcast(patch(11, PatchOp{Op: PatchOpReplace, Offset: 0, Length: 2, Text: "one"}))
+	hub.Broadcast(WSMessage{Type: "tabs_batch", Tabs: []*Tab{{ID: "log", Version: 12}}})
+	hub.Broadcast(patch(12, PatchOp{Op: PatchOpAppend, Text: "end"}))
+
+	msgs := drain(t, client)
+	if got := types(msgs); got != "tab_patched,tabs_batch,tab_patched" {
+		t.Fatalf("unexpected messages: %s", got)
+	}
+	merged := msgs[0].Patch
+	if merged.BaseVersion != 1 || merged.Version != 12 || len(merged.Ops) != 2 {
+		t.Fatalf("unexpected merged patch: %+v", merged)
+	}
+	if merged.Ops[0].Text != "1;2;3;4;5;6;7;8;9;10;" || merged.Ops[1].Op != PatchOpReplace {
+		t.Errorf("expected joined appends then the replace, got %+v", merged.Ops)
+	}
+	if msgs[2].Patch.BaseVersion != 12 {
+		t.Errorf("expected the last patch to stay after the batch, got %+v", msgs[2].Patch)
+	}
+}
+
+// TestHubQueue_Resync tests that a client exceeding the byte cap gets a
+// resync message instead of being disconnected.
+func TestHubQueue_Resync(t *testing.T) {
+	hub := NewHub()
+	hub.SetUpdateRate(0) // Exercise the queue, not the rate limit
+	hub.clientQueueBytes = 10000
+	go hub.Run()
+	defer hub.Shutdown()
+	client := stalledClient(t, hub)
+
+	for i := 0; i < 20; i++ {
+		hub.Broadcast(WSMessage{Type: "tab_created", Tab: &Tab{ID: fmt.Sprint(i), Content: strings.Repeat("x", 1000)}})
+	}
+	hub.Broadcast(WSMessage{Type: "tab_activated", ID: "3"})
+
+	msgs := drain(t, client)
+	if got := types(msgs); !strings.HasPrefix(got, "resync") || !strings.HasSuffix(got, "tab_activated") {
+		t.Fatalf("expected resync followed by later messages, got %s", got)
+	}
+	if hub.ClientCount() != 1 {
+		t.Error("expected client to stay connected")
+	}
+	if stats := hub.Stats(); stats.Resyncs != 1 {
+		t.Errorf("expected 1 resync, got %+v", stats)
+	}
+}
+
+// TestHubBroadcast_NeverBlocks tests that Broadcast returns while the hub
+// is not draining.
+func TestHubBroadcast_NeverBlocks(t *testing.T) {
+	hub := NewHub()
+	done := make(chan struct{})
+	go func() {
+		for i := 0; i < 10000; i++ {
+			hub.Broadcast(WSMessage{Type: "tab_activated", ID: "a"})
+		}
+		close(done)
+	}()
+	select {
+	case <-done:
+	case <-time.After(5 * time.Second):
+		t.Fatal("Broadcast blocked")
+	}
+}
@@ -0,0 +1,108 @@
+// Package main provides raw byte access to tab content.
+package main
+
+import (
+	"bytes"
+	"fmt"
+	"net/http"
+	"net/url"
+	"os"
+	"strconv"
+	"strings"
+)
+
+// RawTabURL returns the URL at which a tab's raw content is served. Image
+// tabs created from files carry it as their content instead of the image
+// bytes, which stay on disk.
+func RawTabURL(id string) string {
+	return "/api/tabs/" + url.PathEscape(id) + "/raw"
+}
+
+// isImageRef reports whether a tab is a file-backed image whose content is
+// a reference to its raw URL.
+func isImageRef(tab *Tab) bool {
+	return tab.Type == TabTypeImage && tab.SourcePath != "" && tab.Content == RawTabURL(tab.ID)
+}
+
+// imageReference validates an image file and returns the content of the
+// image tab id showing it.
+func imageReference(id, path string) (string, error) {
+	if _, err := ValidateImageFile(path); err != nil {
+		return "", err
+	}
+	return RawTabURL(id), nil
+}
+
+// readSourceContent reads a file the way tab id created from it is
+// populated: images as a reference to their raw URL, everything else as text.
+func readSourceContent(id, path string) (string, error) {
+	if IsImageFile(path) {
+		return imageReference(id, path)
+	}
+	return ReadFileContent(path)
+}
+
+// handleRawTab handles GET /api/tabs/{id}/raw. It serves a tab's content
+// as bytes: file-backed images are streamed from disk with their MIME type
+// (or scaled down to the ?w= width), inline image data URLs are decoded, and
+// other tabs are served as UTF-8 text. Range and conditional requests are
+// supported through the ETag.
+func (s *Server) handleRawTab(w http.ResponseWriter, r *http.Request) {
+	tab, ok := s.state.GetTab(r.PathValue("id"))
+	if !ok {
+		writeError(w, http.StatusNotFound, "Tab not found")
+		return
+	}
+
+	// Never let raw content (such as SVG scripts) run as a page of this origin
+	w.Header().Set("X-Content-Type-Options", "nosniff")
+	w.Header().Set("Content-Security-Policy", "sandbox")
+
+	if isImageRef(tab) {
+		cleanPath, err := ValidateImageFile(tab.SourcePath)
+		if err != nil {
+			writeError(w, http.StatusNotFound, "Cannot read image: "+err.Error())
+			return
+		}
+		f, err := os.Open(cleanPath)
+		if err != nil {
+			writeError(w, http.StatusNotFound, "Cannot read image: "+err.Error())
+			return
+		}
+		defer f.Close()
+		info, err := f.Stat()
+		if err != nil {
+			writeError(w, http.StatusInternalServerError, "Cannot read image: "+err.Error())
+			return
+		}
+
+		// Validated by modification time and size, so edits made while the
+		// file is not watched are still picked up
+		version := fmt.Sprintf("%x-%x", info.ModTime().UnixNano(), info.Size())
+
+		// ?w= asks for a variant scaled down to about that many pixels wide.
+		// Images that cannot be decoded are served as they are.
+		if width, err := strconv.Atoi(r.URL.Query().Get("w")); err == nil && width > 0 {
+			if variant, err := s.images.Get(cleanPath, info, width); err == nil && variant != nil {
+				setETag(w, fmt.Sprintf(`"%s-w%d"`, version, variant.key.width))
+				w.Header().Set("Content-Type", variant.mime)
+				http.ServeContent(w, r, "", info.ModTime(), bytes.NewReader(variant.data))
+				return
+			}
+		}
+
+		setETag(w, `"`+version+`"`)
+		w.Header().Set("Content-Type", GetImageMIMEType(cleanPath))
+		http.ServeContent(w, r, "", info.ModTime(), f)
+		return
+	}
+
+	setETag(w, tabETag(tab))
+	if mime, data, isImage := splitImageDataURL(tab); isImage {
+		w.Header().Set("Content-Type", mime)
+		http.ServeContent(w, r, "", tab.UpdatedAt, bytes.NewReader(data))
+		return
+	}
+	w.Header().Set("Content-Type", "text/plain; charset=utf-8")
+	http.ServeContent(w, r, "", tab.UpdatedAt, strings.NewReader(tab.Content))
+}
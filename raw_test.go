@@ -0,0 +1,92 @@
+package main
+
+import (
+	"bytes"
+	"encoding/base64"
+	"io"
+	"net/http"
+	"net/http/httptest"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+// getRaw requests a tab's raw content with the given request headers.
+func getRaw(srv *Server, id string, headers map[string]string) *httptest.ResponseRecorder {
+	req := httptest.NewRequest("GET", RawTabURL(id), nil)
+	req.SetPathValue("id", id)
+	for k, v := range headers {
+		req.Header.Set(k, v)
+	}
+	w := httptest.NewRecorder()
+	srv.handleRawTab(w, req)
+	return w
+}
+
+// TestRawTab_FileImage tests that a file-backed image tab refers to its raw
+// URL, which streams the file with its MIME type, ETag and ranges.
+func TestRawTab_FileImage(t *testing.T) {
+	srv := setupTestServer()
+	data := bytes.Repeat([]byte{0x89, 'P', 'N', 'G'}, 1000)
+	path := filepath.Join(t.TempDir(), "shot.png")
+	if err := os.WriteFile(path, data, 0644); err != nil {
+		t.Fatalf("failed to write image: %v", err)
+	}
+
+	tab, err := buildTab(&CreateTabRequest{ID: "img", File: path})
+	if err != nil {
+		t.Fatalf("buildTab failed: %v", err)
+	}
+	srv.state.CreateTab(tab)
+	if tab.Type != TabTypeImage || tab.Content != "/api/tabs/img/raw" {
+		t.Fatalf("expected an image tab referring to its raw URL, got %s %q", tab.Type, tab.Content)
+	}
+
+	w := getRaw(srv, "img", nil)
+	if w.Code != http.StatusOK || !bytes.Equal(w.Body.Bytes(), data) {
+		t.Fatalf("expected the file bytes, got %d with %d bytes", w.Code, w.Body.Len())
+	}
+	if ct := w.Header().Get("Content-Type"); ct != "image/png" {
+		t.Errorf("expected image/png, got %q", ct)
+	}
+	etag := w.Header().Get("ETag")
+	if etag == "" {
+		t.Fatal("expected an ETag")
+	}
+
+	if w := getRaw(srv, "img", map[string]string{"If-None-Match": etag}); w.Code != http.StatusNotModified {
+		t.Errorf("expected 304 for a matching ETag, got %d", w.Code)
+	}
+
+	w = getRaw(srv, "img", map[string]string{"Range": "bytes=100-199"})
+	if w.Code != http.StatusPartialContent || !bytes.Equal(w.Body.Bytes(), data[100:200]) {
+		t.Errorf("expected bytes 100-199, got %d with %d bytes", w.Code, w.Body.Len())
+	}
+	if cr := w.Header().Get("Content-Range"); cr != "bytes 100-199/4000" {
+		t.Errorf("unexpected Content-Range %q", cr)
+	}
+}
+
+// TestRawTab_InlineContent tests that inline image data URLs are decoded
+// and other tabs are served as text.
+func TestRawTab_InlineContent(t *testing.T) {
+	srv := setupTestServer()
+	image := []byte("GIF89a not really")
+	srv.state.CreateTab(&Tab{ID: "gif", Type: TabTypeImage, Content: "data:image/gif;base64," + base64.StdEncoding.EncodeToString(image)})
+	srv.state.CreateTab(&Tab{ID: "md", Type: TabTypeMarkdown, Content: "# Notes"})
+
+	w := getRaw(srv, "gif", nil)
+	if !bytes.Equal(w.Body.Bytes(), image) || w.Header().Get("Content-Type") != "image/gif" {
+		t.Errorf("expected decoded image/gif bytes, got %q as %q", w.Body.Bytes(), w.Header().Get("Content-Type"))
+	}
+
+	w = getRaw(srv, "md", map[string]string{"Range": "bytes=2-"})
+	body, _ := io.ReadAll(w.Body)
+	if w.Code != http.StatusPartialContent || string(body) != "Notes" {
+		t.Errorf("expected the text range, got %d %q", w.Code, body)
+	}
+
+	if w := getRaw(srv, "missing", nil); w.Code != http.StatusNotFound {
+		t.Errorf("expected 404 for a missing tab, got %d", w.Code)
+	}
+}
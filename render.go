@@ -830,9 +830,9 @@ func GetImageMIMEType(filename string) string {
 	return "application/octet-stream"
 }
 
-// ReadImageAsDataURL reads an image file and returns it as a base64-encoded data URL.
-// This is suitable for embedding images directly in HTML/JSON responses.
-func ReadImageAsDataURL(path string) (string, error) {
+// ValidateImageFile checks that path is a readable regular file with an
+// image extension, and returns the cleaned path.
+func ValidateImageFile(path string) (string, error) {
 	// Validate and clean the path (includes security checks)
 	cleanPath, err := ValidatePath(path)
 	if err != nil {
@@ -860,6 +860,16 @@ func ReadImageAsDataURL(path string) (string, error) {
 	if !IsImageFile(cleanPath) {
 		return "", fmt.Errorf("file is not a recognized image format: %s", cleanPath)
 	}
+	return cleanPath, nil
+}
+
+// ReadImageAsDataURL reads an image file and returns it as a base64-encoded data URL.
+// This is suitable for embedding images directly in HTML/JSON responses.
+func ReadImageAsDataURL(path string) (string, error) {
+	cleanPath, err := ValidateImageFile(path)
+	if err != nil {
+		return "", err
+	}
 
 	// Read the file content
 	data, err := os.ReadFile(cleanPath)
@@ -0,0 +1,158 @@
+// Package main provides sequence-numbered replay of WebSocket broadcasts.
+package main
+
+import (
+	"sync/atomic"
+	"time"
+)
+
+const (
+	// defaultReplayMessages is the number of recent broadcasts kept for
+	// clients resuming after a reconnect.
+	defaultReplayMessages = 4096
+
+	// defaultReplayBytes caps the payload bytes of kept broadcasts, counting
+	// every view, encoding and compressed variant built for them.
+	defaultReplayBytes = 16 << 20
+)
+
+// replayRing keeps the most recent broadcasts, oldest first, bounded by
+// message count and payload bytes. Payloads are built after a broadcast is
+// kept, so each entry charges bytes as they are built and the byte bound
+// is enforced on the next push. Guarded by Hub.seqMu, except bytes.
+type replayRing struct {
+	entries  []*outbound // Circular buffer of capacity defaultReplayMessages
+	start    int         // Index of the oldest entry
+	count    int
+	bytes    atomic.Int64 // Payload bytes charged by kept entries
+	maxBytes int64
+}
+
+// replayCounters counts how resuming clients were brought up to date.
+type replayCounters struct {
+	replays   atomic.Int64 // Resumes served from the replay buffer
+	replayed  atomic.Int64 // Messages sent by those resumes
+	snapshots atomic.Int64 // Resumes whose gap needed a full-state snapshot
+}
+
+// newReplayRing creates an empty ring holding up to n messages and maxBytes.
+func newReplayRing(n, maxBytes int) *replayRing {
+	return &replayRing{entries: make([]*outbound, n), maxBytes: int64(maxBytes)}
+}
+
+// initialSeq returns the sequence number a new hub starts after. It is the
+// start time in microseconds, so numbers keep increasing across restarts
+// and a client resuming against a restarted server is sent a snapshot
+// rather than unrelated messages that happen to reuse its numbers.
+func initialSeq() uint64 {
+	return uint64(time.Now().UnixMicro())
+}
+
+// push appends a broadcast, evicting the oldest ones beyond the bounds.
+func (r *replayRing) push(out *outbound) {
+	if len(r.entries) == 0 {
+		return
+	}
+	for r.count > 0 && (r.count == len(r.entries) || r.bytes.Load() > r.maxBytes) {
+		r.evict()
+	}
+	i := (r.start + r.count) % len(r.entries)
+	r.entries[i] = out
+	r.count++
+	out.keep(&r.bytes)
+}
+
+// evict drops the oldest entry.
+func (r *replayRing) evict() {
+	r.entries[r.start].release()
+	r.entries[r.start] = nil
+	r.start = (r.start + 1) % len(r.entries)
+	r.count--
+}
+
+// keep makes the broadcast charge payloads built from now on to a replay
+// ring's byte count.
+func (o *outbound) keep(bytes *atomic.Int64) {
+	o.mu.Lock()
+	defer o.mu.Unlock()
+	o.kept = bytes
+}
+
+// release refunds the bytes the broadcast charged while kept.
+func (o *outbound) release() {
+	o.mu.Lock()
+	defer o.mu.Unlock()
+	if o.kept != nil {
+		o.kept.Add(-int64(o.charged))
+		o.kept, o.charged = nil, 0
+	}
+}
+
+// chargeLocked adds a newly built payload to the byte count of the replay
+// ring keeping the broadcast, if any. Caller must hold o.mu.
+func (o *outbound) chargeLocked(data []byte) {
+	if o.kept == nil {
+		return
+	}
+	o.charged += len(data)
+	o.kept.Add(int64(len(data)))
+}
+
+// since returns the broadcasts after seq, given that last is the latest
+// sequence number assigned. It returns false if any of them are no longer
+// kept, or seq is not one this hub has assigned.
+func (r *replayRing) since(seq, last uint64) ([]*outbound, bool) {
+	if seq >= last {
+		return nil, seq == last
+	}
+	if r.count == 0 || r.at(0).msg.Seq > seq+1 {
+		return nil, false
+	}
+	first := r.count - int(last-seq)
+	missed := make([]*outbound, 0, last-seq)
+	for i := first; i < r.count; i++ {
+		missed = append(missed, r.at(i))
+	}
+	return missed, true
+}
+
+// at returns the i-th oldest entry.
+func (r *replayRing) at(i int) *outbound {
+	return r.entries[(r.start+i)%len(r.entries)]
+}
+
+// Resume registers a reconnecting client whose last received message had
+// sequence number since. Before any later broadcast, it is sent the
+// messages it missed from the replay buffer, coalesced as for a slow
+// client, or a snapshot of the full state if they are no longer buffered.
+func (h *Hub) Resume(client *Client, since uint64) {
+	h.seqMu.Lock()
+	defer h.seqMu.Unlock()
+
+	if missed, ok := h.replay.since(since, h.seq); ok {
+		h.replays.replays.Add(1)
+		h.replays.replayed.Add(int64(len(missed)))
+		for _, out := range missed {
+			h.deliver(client, out)
+		}
+	} else if h.snapshot != nil {
+		h.replays.snapshots.Add(1)
+		msg := h.snapshot()
+		msg.Type = "snapshot"
+		msg.Seq = h.seq
+		h.deliver(client, h.newOutbound(msg))
+	}
+
+	// Broadcasts still pending in the client's shard were covered above
+	client.resumedAt = h.seq
+
+	// Join a shard directly: sending on register would hold seqMu, and
+	// with it every Broadcast, until a shard loop is free to take the
+	// client, and forever once the hub has shut down
+	select {
+	case <-h.done:
+		client.closeSend()
+	default:
+		h.leastLoadedShard().add(client)
+	}
+}
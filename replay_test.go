@@ -0,0 +1,187 @@
+package main
+
+import (
+	"context"
+	"encoding/json"
+	"net/http"
+	"net/http/httptest"
+	"strconv"
+	"strings"
+	"testing"
+	"time"
+
+	"nhooyr.io/websocket"
+)
+
+// receive reads the next message sent to a mock client.
+func receive(t *testing.T, client *Client) WSMessage {
+	t.Helper()
+	select {
+	case data := <-client.send:
+		var msg WSMessage
+		if err := json.Unmarshal(data, &msg); err != nil {
+			t.Fatalf("failed to decode message: %v", err)
+		}
+		return msg
+	case <-time.After(time.Second):
+		t.Fatal("timed out waiting for message")
+		return WSMessage{}
+	}
+}
+
+// TestReplayRing_Bounds tests eviction by count and bytes, and which gaps
+// the ring can fill.
+func TestReplayRing_Bounds(t *testing.T) {
+	r := newReplayRing(3, 100)
+	push := func(seq uint64, size int) {
+		out := &outbound{msg: WSMessage{Seq: seq}, payloads: make(map[payloadKey][]byte)}
+		r.push(out)
+		out.payload(payloadKey{view: viewFull})
+		out.cached(payloadKey{view: viewFull, deflate: true}, func() []byte { return make([]byte, size) })
+	}
+	for seq := uint64(1); seq <= 4; seq++ {
+		push(seq, 10)
+	}
+	if r.count != 3 || r.at(0).msg.Seq != 2 {
+		t.Fatalf("expected seqs 2-4 kept, got %d from %d", r.count, r.at(0).msg.Seq)
+	}
+
+	if missed, ok := r.since(1, 4); !ok || len(missed) != 3 || missed[0].msg.Seq != 2 {
+		t.Errorf("expected seqs 2-4 replayed after 1, got %d (%v)", len(missed), ok)
+	}
+	if missed, ok := r.since(4, 4); !ok || len(missed) != 0 {
+		t.Errorf("expected nothing to replay when up to date, got %d (%v)", len(missed), ok)
+	}
+	for _, seq := range []uint64{0, 5} {
+		if _, ok := r.since(seq, 4); ok {
+			t.Errorf("expected gap after %d not to be replayable", seq)
+		}
+	}
+
+	// Every variant is charged as it is built; the bound holds from the next push
+	full := len(r.at(0).payload(payloadKey{view: viewFull})) + 10
+	if got := r.bytes.Load(); got != int64(3*full) {
+		t.Errorf("expected %d bytes charged for JSON and compressed payloads, got %d", 3*full, got)
+	}
+	r.maxBytes = int64(full)
+	push(5, 10)
+	if r.count != 2 || r.at(0).msg.Seq != 4 || r.bytes.Load() != int64(2*full) {
+		t.Errorf("expected byte cap to keep seqs 4-5, got %d messages from %d, %d bytes", r.count, r.at(0).msg.Seq, r.bytes.Load())
+	}
+}
+
+// TestHubResume_ReplaysMissed tests that a resuming client receives the
+// broadcasts after its last sequence number, then live ones, each once.
+func TestHubResume_ReplaysMissed(t *testing.T) {
+	hub := NewHub()
+	go hub.Run()
+	defer hub.Shutdown()
+
+	first := hub.seq + 1
+	for i := 1; i <= 3; i++ {
+		hub.Broadcast(WSMessage{Type: "tab_activated", ID: strconv.Itoa(i)})
+	}
+
+	client := &Client{hub: hub, send: make(chan []byte, 16)}
+	hub.Resume(client, first)
+	hub.Broadcast(WSMessage{Type: "tab_deleted", ID: "4"})
+
+	for i, want := range []string{"2", "3", "4"} {
+		msg := receive(t, client)
+		if msg.ID != want || msg.Seq != first+uint64(i)+1 {
+			t.Errorf("expected message %s with seq %d, got %s with %d", want, first+uint64(i)+1, msg.ID, msg.Seq)
+		}
+	}
+	select {
+	case data := <-client.send:
+		t.Errorf("unexpected extra message: %s", data)
+	case <-time.After(20 * time.Millisecond):
+	}
+	if stats := hub.Stats(); stats.Replays != 1 || stats.ReplayedMessages != 2 {
+		t.Errorf("expected 1 replay of 2 messages, got %d of %d", stats.Replays, stats.ReplayedMessages)
+	}
+}
+
+// TestHubResume_Snapshot tests that a client whose gap is no longer
+// buffered is sent a snapshot at the latest sequence number.
+func TestHubResume_Snapshot(t *testing.T) {
+	hub := NewHub()
+	hub.replay = newReplayRing(2, defaultReplayBytes)
+	hub.snapshot = func() WSMessage {
+		return WSMessage{Tabs: []*Tab{{ID: "a", Active: true, ContentOmitted: true}}}
+	}
+	go hub.Run()
+	defer hub.Shutdown()
+
+	since := hub.seq
+	for i := 0; i < 5; i++ {
+		hub.Broadcast(WSMessage{Type: "tab_activated", ID: "a"})
+	}
+
+	client := &Client{hub: hub, send: make(chan []byte, 16)}
+	hub.Resume(client, since)
+	msg := receive(t, client)
+	if msg.Type != "snapshot" || msg.Seq != since+5 || len(msg.Tabs) != 1 || !msg.Tabs[0].Active {
+		t.Errorf("expected snapshot at seq %d, got %+v", since+5, msg)
+	}
+	if stats := hub.Stats(); stats.Snapshots != 1 || stats.Replays != 0 {
+		t.Errorf("expected 1 snapshot and no replays, got %d and %d", stats.Snapshots, stats.Replays)
+	}
+}
+
+// TestHubResume_AfterShutdown tests that resuming on a stopped hub closes
+// the client instead of blocking.
+func TestHubResume_AfterShutdown(t *testing.T) {
+	hub := NewHub()
+	go hub.Run()
+	hub.Broadcast(WSMessage{Type: "tab_activated", ID: "a"})
+	hub.Shutdown()
+
+	client := &Client{hub: hub, send: make(chan []byte, 16)}
+	done := make(chan struct{})
+	go func() {
+		hub.Resume(client, hub.seq)
+		close(done)
+	}()
+	select {
+	case <-done:
+	case <-time.After(time.Second):
+		t.Fatal("Resume blocked after Shutdown")
+	}
+	if _, open := <-client.send; open {
+		t.Error("expected the client's send channel to be closed")
+	}
+}
+
+// TestServeWS_ResumeSince tests reconnecting with the since parameter
+// after missing broadcasts.
+func TestServeWS_ResumeSince(t *testing.T) {
+	srv := NewServer()
+	go srv.hub.Run()
+	defer srv.hub.Shutdown()
+
+	ts := httptest.NewServer(http.HandlerFunc(srv.handleWebSocket))
+	defer ts.Close()
+
+	since := srv.hub.seq
+	srv.hub.Broadcast(WSMessage{Type: "tab_activated", ID: "missed"})
+
+	ctx, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+	wsURL := "ws" + strings.TrimPrefix(ts.URL, "http") + "/ws?since=" + strconv.FormatUint(since, 10)
+	conn, _, err := websocket.Dial(ctx, wsURL, nil)
+	if err != nil {
+		t.Fatalf("failed to connect: %v", err)
+	}
+	defer conn.Close(websocket.StatusNormalClosure, "")
+
+	_, data, err := conn.Read(ctx)
+	if err != nil {
+		t.Fatalf("failed to read: %v", err)
+	}
+	var msg WSMessage
+	json.Unmarshal(data, &msg)
+	if msg.Type != "tab_activated" || msg.ID != "missed" || msg.Seq != since+1 {
+		t.Errorf("expected the missed message, got %s", data)
+	}
+}
@@ -17,6 +17,8 @@ type Server struct {
 	state       *State
 	hub         *Hub
 	fileWatcher *FileWatcher
+	images      *imageVariants // Downscaled image variants served by /raw?w=
+	follow      followers      // Followed tabs' read positions
 }
 
 // NewServer creates a new Server instance.
@@ -24,27 +26,79 @@ func NewServer() *Server {
 	state := NewState()
 	hub := NewHub()
 	s := &Server{
-		state: state,
-		hub:   hub,
+		state:  state,
+		hub:    hub,
+		images: newImageVariants(defaultImageCacheBytes),
 	}
+	hub.snapshot = s.snapshot
+	hub.active = state.GetActive
+	state.onReload = s.broadcastReloaded
 
 	// Initialize file watcher with callbacks
-	watcher, err := NewFileWatcherWithCallbacks(FileWatcherCallbacks{
+	watcher, err := s.newFileWatcher(WatchBackendAuto)
+	if err != nil {
+		// Log error but continue without file watching
+		fmt.Printf("Warning: file watching disabled: %v\n", err)
+	} else {
+		s.fileWatcher = watcher
+	}
+
+	return s
+}
+
+// newFileWatcher creates a file watcher using the named backend that
+// reports to the server.
+func (s *Server) newFileWatcher(backend string) (*FileWatcher, error) {
+	return NewFileWatcherWithBackend(backend, FileWatcherCallbacks{
 		OnChange: func(path string, tabIDs []string) {
 			s.handleFileChange(path, tabIDs)
 		},
 		OnDelete: func(path string, tabIDs []string) {
 			s.handleFileDelete(path, tabIDs)
 		},
+		OnBatch: s.handleFileEvents,
 	})
+}
+
+// SetWatchBackend replaces the file watcher with one using the named
+// backend (WatchBackendAuto, WatchBackendFsnotify or WatchBackendPoll).
+// Call it before adding file tabs and before Serve.
+func (s *Server) SetWatchBackend(backend string) error {
+	watcher, err := s.newFileWatcher(backend)
 	if err != nil {
-		// Log error but continue without file watching
-		fmt.Printf("Warning: file watching disabled: %v\n", err)
-	} else {
-		s.fileWatcher = watcher
+		return err
+	}
+	if s.fileWatcher != nil {
+		s.fileWatcher.Stop()
+	}
+	s.fileWatcher = watcher
+	return nil
+}
+
+// EnablePersistence restores tabs saved in dir and keeps the session there
+// from now on (see State.EnablePersistence). File watches are re-registered
+// for restored tabs that have a source path. Returns the number of tabs restored.
+func (s *Server) EnablePersistence(dir string) (int, error) {
+	restored, err := s.state.EnablePersistence(dir)
+	if err != nil {
+		return 0, err
 	}
 
-	return s
+	if s.fileWatcher != nil {
+		for _, tab := range s.state.ListTabs() {
+			if tab.SourcePath == "" {
+				continue
+			}
+			// The read position is not saved; the next change reloads the tail
+			if tab.Follow {
+				s.follow.track(tab.ID, nil)
+			}
+			if err := s.fileWatcher.Add(tab.SourcePath, tab.ID); err != nil {
+				fmt.Printf("Warning: cannot watch %s: %v\n", tab.SourcePath, err)
+			}
+		}
+	}
+	return restored, nil
 }
 
 // Serve starts the HTTP server on the given listener.
@@ -80,20 +134,28 @@ func (s *Server) Shutdown(ctx context.Context) error {
 		s.fileWatcher.Stop()
 	}
 
+	var err error
 	if s.httpServer != nil {
-		return s.httpServer.Shutdown(ctx)
+		err = s.httpServer.Shutdown(ctx)
 	}
-	return nil
+
+	// Save the session and remove spilled content once no handler can use them
+	s.state.Close()
+	return err
 }
 
 // setupRoutes configures all HTTP routes.
 func (s *Server) setupRoutes(mux *http.ServeMux) {
 	// API routes
 	mux.HandleFunc("POST /api/tabs", s.handleCreateTab)
+	mux.HandleFunc("POST /api/tabs/batch", s.handleBatchTabs)
 	mux.HandleFunc("GET /api/tabs", s.handleListTabs)
 	mux.HandleFunc("GET /api/tabs/{id}", s.handleGetTab)
+	mux.HandleFunc("GET /api/tabs/{id}/raw", s.handleRawTab)
+	mux.HandleFunc("PATCH /api/tabs/{id}", s.handlePatchTab)
 	mux.HandleFunc("DELETE /api/tabs/{id}", s.handleDeleteTab)
 	mux.HandleFunc("POST /api/tabs/{id}/activate", s.handleActivateTab)
+	mux.HandleFunc("POST /api/tabs/{id}/stream", s.handleStreamTab)
 	mux.HandleFunc("DELETE /api/tabs", s.handleClearTabs)
 	mux.HandleFunc("GET /api/status", s.handleStatus)
 
@@ -125,37 +187,121 @@ func OpenBrowser(url string) error {
 // StartTime records when the server started.
 var StartTime = time.Now()
 
+// handleFileEvents is called with each batch of settled file events. Changed
+// files are re-read on a bounded worker pool. A batch touching one tab is
+// announced as before (tab_updated or tab_stale); a larger one, such as a
+// git checkout, is announced with a single tabs_updated message listing
+// every updated and stale tab without content, which clients fetch when
+// they view a tab.
+func (s *Server) handleFileEvents(events []FileEvent) {
+	updated := make([][]*Tab, len(events))
+	parallelFor(len(events), maxBatchWorkers, func(i int) {
+		if events[i].Deleted {
+			updated[i] = s.markFileStale(events[i].TabIDs)
+		} else {
+			updated[i] = s.reloadFile(events[i].Path, events[i].TabIDs)
+		}
+	})
+
+	var tabs []*Tab
+	for _, batch := range updated {
+		tabs = append(tabs, batch...)
+	}
+	switch {
+	case len(tabs) == 0:
+	case len(tabs) > 1:
+		for i, tab := range tabs {
+			tabs[i] = tab.metadata()
+		}
+		s.hub.Broadcast(WSMessage{Type: "tabs_updated", Tabs: tabs})
+	case tabs[0].Stale:
+		s.hub.Broadcast(WSMessage{Type: "tab_stale", Tab: tabs[0]})
+	default:
+		s.hub.Broadcast(WSMessage{Type: "tab_updated", Tab: tabs[0]})
+	}
+}
+
 // handleFileChange is called when a watched file changes.
 // It re-reads the file content, updates affected tabs, and broadcasts updates.
 func (s *Server) handleFileChange(path string, tabIDs []string) {
-	// Re-read the file content
-	content, err := ReadFileContent(path)
+	for _, tab := range s.reloadFile(path, tabIDs) {
+		// Broadcast the update to all connected clients
+		s.hub.Broadcast(WSMessage{Type: "tab_updated", Tab: tab})
+	}
+}
+
+// reloadFile re-reads a changed file into the tabs watching it and returns
+// the updated tabs. Followed tabs read only what was appended and send
+// their own patches (see followChange).
+func (s *Server) reloadFile(path string, tabIDs []string) []*Tab {
+	tabIDs = s.followChanges(path, tabIDs)
+	if len(tabIDs) == 0 {
+		return nil
+	}
+
+	// Re-read the file content; image tabs keep referring to the file
+	image := IsImageFile(path)
+	var content string
+	var err error
+	if image {
+		_, err = ValidateImageFile(path)
+	} else {
+		content, err = ReadFileContent(path)
+	}
 	if err != nil {
 		// File might have been deleted or become unreadable
 		// Log but don't remove the watch - file might come back
 		fmt.Printf("Warning: cannot read changed file %s: %v\n", path, err)
-		return
+		return nil
 	}
 
 	// Update each tab that watches this file
+	var tabs []*Tab
 	for _, tabID := range tabIDs {
-		tab := s.state.UpdateTabContent(tabID, content)
-		if tab != nil {
-			// Broadcast the update to all connected clients
-			s.hub.Broadcast(WSMessage{Type: "tab_updated", Tab: tab})
+		if image {
+			content = RawTabURL(tabID)
+		}
+		if tab := s.state.UpdateTabContent(tabID, content); tab != nil {
+			tabs = append(tabs, tab)
 		}
 	}
+	return tabs
 }
 
 // handleFileDelete is called when a watched file is deleted or renamed.
 // It marks affected tabs as stale and broadcasts updates.
 func (s *Server) handleFileDelete(path string, tabIDs []string) {
-	// Mark each tab that watches this file as stale
+	for _, tab := range s.markFileStale(tabIDs) {
+		// Broadcast the update to all connected clients
+		s.hub.Broadcast(WSMessage{Type: "tab_stale", Tab: tab})
+	}
+}
+
+// markFileStale marks the tabs of a deleted file as stale and returns them.
+func (s *Server) markFileStale(tabIDs []string) []*Tab {
+	var tabs []*Tab
 	for _, tabID := range tabIDs {
-		tab := s.state.MarkTabStale(tabID)
-		if tab != nil {
-			// Broadcast the update to all connected clients
-			s.hub.Broadcast(WSMessage{Type: "tab_stale", Tab: tab})
+		if tab := s.state.MarkTabStale(tabID); tab != nil {
+			tabs = append(tabs, tab)
 		}
 	}
+	return tabs
+}
+
+// broadcastReloaded announces a tab whose dropped content was re-read
+// from a file that changed, or went missing, while it was dropped.
+func (s *Server) broadcastReloaded(id string) {
+	if tab, ok := s.state.GetTab(id); ok {
+		s.hub.Broadcast(WSMessage{Type: "tab_updated", Tab: tab})
+	}
+}
+
+// snapshot returns the tab list without content, for a WebSocket client
+// resuming after more broadcasts than the hub keeps for replay.
+func (s *Server) snapshot() WSMessage {
+	tabs := s.state.ListTabs()
+	for _, tab := range tabs {
+		tab.ContentOmitted = true
+	}
+	return WSMessage{Tabs: tabs}
 }
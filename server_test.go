@@ -273,3 +273,69 @@ func TestHandleFileChangeMultipleTabs(t *testing.T) {
 		}
 	}
 }
+
+// TestHandleFileEventsBatch verifies that a batch of file events is
+// announced with a single tabs_updated message.
+func TestHandleFileEventsBatch(t *testing.T) {
+	state := NewState()
+	hub := NewHub()
+	s := &Server{
+		state: state,
+		hub:   hub,
+	}
+	go hub.Run()
+	defer hub.Shutdown()
+
+	tmpDir := t.TempDir()
+	var events []FileEvent
+	for _, name := range []string{"a.go", "b.go", "c.go"} {
+		path := filepath.Join(tmpDir, name)
+		if err := os.WriteFile(path, []byte("new "+name), 0644); err != nil {
+			t.Fatalf("failed to create temp file: %v", err)
+		}
+		tab, _ := state.CreateTab(&Tab{ID: name, Type: TabTypeCode, Content: "old", SourcePath: path})
+		events = append(events, FileEvent{Path: path, TabIDs: []string{tab.ID}})
+	}
+	state.CreateTab(&Tab{ID: "gone.go", Type: TabTypeCode, Content: "old", SourcePath: "/tmp/gone.go"})
+	events = append(events, FileEvent{Path: "/tmp/gone.go", TabIDs: []string{"gone.go"}, Deleted: true})
+
+	mockClient := &Client{
+		hub:  hub,
+		send: make(chan []byte, 10),
+	}
+	hub.register <- mockClient
+	time.Sleep(20 * time.Millisecond)
+
+	s.handleFileEvents(events)
+
+	var broadcasts []WSMessage
+	timeout := time.After(100 * time.Millisecond)
+loop:
+	for {
+		select {
+		case data := <-mockClient.send:
+			var msg WSMessage
+			if err := json.Unmarshal(data, &msg); err == nil {
+				broadcasts = append(broadcasts, msg)
+			}
+		case <-timeout:
+			break loop
+		}
+	}
+
+	if len(broadcasts) != 1 || broadcasts[0].Type != "tabs_updated" {
+		t.Fatalf("expected one tabs_updated message, got %+v", broadcasts)
+	}
+	tabs := broadcasts[0].Tabs
+	if len(tabs) != 4 || tabs[0].Size != len("new a.go") || !tabs[3].Stale {
+		t.Errorf("expected three reloaded tabs and a stale one, got %+v", tabs)
+	}
+	for _, tab := range tabs {
+		if tab.Content != "" || !tab.ContentOmitted {
+			t.Errorf("expected tab %s without content, got %q", tab.ID, tab.Content)
+		}
+	}
+	if tab, _ := state.GetTab("a.go"); tab.Content != "new a.go" {
+		t.Errorf("expected reloaded content to be fetchable, got %q", tab.Content)
+	}
+}
@@ -0,0 +1,127 @@
+// Package main provides sharded fan-out of WebSocket broadcasts.
+package main
+
+import (
+	"runtime"
+	"sync"
+)
+
+// hubShard delivers broadcasts to a subset of the hub's clients on its own
+// goroutine. Every shard receives every broadcast in Broadcast order, and a
+// client belongs to exactly one shard, so per-client message order is the
+// same as with a single delivery loop while fan-out runs on all cores.
+//
+// Shards take registrations themselves, so a client registered before a
+// Broadcast call is on its shard before that shard sees the broadcast.
+// Idle shards wait on the register channel in turn, which spreads clients
+// round-robin, favouring shards that are not busy delivering.
+type hubShard struct {
+	hub *Hub
+
+	mu      sync.RWMutex
+	clients map[*Client]bool
+
+	// pending holds broadcasts not yet fanned out, so Broadcast never blocks
+	pendingMu sync.Mutex
+	pending   []*outbound
+	wake      chan struct{} // Signals that pending holds broadcasts
+}
+
+// defaultHubShards returns the shard count used by NewHub: one per CPU
+// the Go scheduler may use.
+func defaultHubShards() int {
+	return runtime.GOMAXPROCS(0)
+}
+
+// newHubShard creates an empty shard of h.
+func newHubShard(h *Hub) *hubShard {
+	return &hubShard{
+		hub:     h,
+		clients: make(map[*Client]bool),
+		wake:    make(chan struct{}, 1),
+	}
+}
+
+// run registers clients and delivers pending broadcasts to them until the
+// hub shuts down.
+func (s *hubShard) run() {
+	for {
+		select {
+		case <-s.hub.done:
+			return
+		case client := <-s.hub.register:
+			s.add(client)
+		case <-s.wake:
+			s.pendingMu.Lock()
+			batch := s.pending
+			s.pending = nil
+			s.pendingMu.Unlock()
+
+			s.mu.RLock()
+			for _, out := range batch {
+				for client := range s.clients {
+					s.hub.deliver(client, out)
+				}
+			}
+			s.mu.RUnlock()
+		}
+	}
+}
+
+// leastLoadedShard returns the shard with the fewest clients.
+func (h *Hub) leastLoadedShard() *hubShard {
+	best := h.shards[0]
+	for _, s := range h.shards[1:] {
+		if s.size() < best.size() {
+			best = s
+		}
+	}
+	return best
+}
+
+// enqueue adds a broadcast to the shard's pending list and wakes its loop
+// without blocking.
+func (s *hubShard) enqueue(out *outbound) {
+	s.pendingMu.Lock()
+	s.pending = append(s.pending, out)
+	s.pendingMu.Unlock()
+	select {
+	case s.wake <- struct{}{}:
+	default:
+	}
+}
+
+// add registers a client with the shard.
+func (s *hubShard) add(client *Client) {
+	s.mu.Lock()
+	s.clients[client] = true
+	s.mu.Unlock()
+}
+
+// remove unregisters a client and closes its send channel. Holding the
+// write lock waits out any delivery in progress to the client.
+func (s *hubShard) remove(client *Client) {
+	s.mu.Lock()
+	if _, ok := s.clients[client]; ok {
+		delete(s.clients, client)
+		client.closeSend()
+	}
+	s.mu.Unlock()
+}
+
+// closeAll unregisters every client, closing their send channels.
+func (s *hubShard) closeAll() {
+	s.mu.Lock()
+	for client := range s.clients {
+		client.closeSend()
+		delete(s.clients, client)
+	}
+	s.mu.Unlock()
+}
+
+// size returns the number of clients on the shard.
+func (s *hubShard) size() int {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	return len(s.clients)
+}
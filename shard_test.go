@@ -0,0 +1,146 @@
+package main
+
+import (
+	"context"
+	"encoding/json"
+	"fmt"
+	"net/http"
+	"net/http/httptest"
+	"runtime"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"nhooyr.io/websocket"
+)
+
+// TestShardedHub_PreservesOrder tests that clients spread over shards each
+// receive every broadcast made after they registered, in order.
+func TestShardedHub_PreservesOrder(t *testing.T) {
+	hub := NewShardedHub(4)
+	go hub.Run()
+	defer hub.Shutdown()
+
+	const clients, messages = 20, 200
+	var list []*Client
+	for i := 0; i < clients; i++ {
+		client := &Client{hub: hub, send: make(chan []byte, messages)}
+		hub.register <- client
+		list = append(list, client)
+	}
+
+	for i := 0; i < messages; i++ {
+		hub.Broadcast(WSMessage{Type: "test", ID: strconv.Itoa(i)})
+	}
+	for c, client := range list {
+		for i := 0; i < messages; i++ {
+			select {
+			case data := <-client.send:
+				var msg WSMessage
+				json.Unmarshal(data, &msg)
+				if msg.ID != strconv.Itoa(i) {
+					t.Fatalf("client %d: expected message %d, got %s", c, i, msg.ID)
+				}
+			case <-time.After(time.Second):
+				t.Fatalf("client %d: timed out waiting for message %d", c, i)
+			}
+		}
+	}
+}
+
+// BenchmarkHubFanout broadcasts to 5,000 loopback WebSocket clients and
+// reports delivery latency percentiles (from Broadcast to the client's read)
+// and deliveries per second. shards=1 is equivalent to the single delivery
+// loop the hub had before sharding.
+func BenchmarkHubFanout(b *testing.B) {
+	if testing.Short() {
+		b.Skip("skipping fan-out benchmark in short mode")
+	}
+	counts := []int{1}
+	if n := runtime.GOMAXPROCS(0); n > 1 {
+		counts = append(counts, n)
+	}
+	for _, shards := range counts {
+		b.Run(fmt.Sprintf("clients=5000/shards=%d", shards), func(b *testing.B) {
+			benchmarkHubFanout(b, NewShardedHub(shards), 5000)
+		})
+	}
+}
+
+// benchmarkHubFanout runs one round per iteration: a timestamped broadcast
+// that every client must receive before the next round starts.
+func benchmarkHubFanout(b *testing.B, hub *Hub, clients int) {
+	go hub.Run()
+	defer hub.Shutdown()
+	ts := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		ServeWS(hub, w, r, nil)
+	}))
+	defer ts.Close()
+
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+	wsURL := "ws" + strings.TrimPrefix(ts.URL, "http") + "/ws"
+
+	var received atomic.Int64
+	roundDone := make(chan struct{}, 1)
+	latencies := make([]int64, 0, clients*b.N)
+	var latenciesMu sync.Mutex
+	var readers sync.WaitGroup
+	for i := 0; i < clients; i++ {
+		conn, _, err := websocket.Dial(ctx, wsURL, nil)
+		if err != nil {
+			b.Fatalf("failed to connect client %d (check ulimit -n): %v", i, err)
+		}
+		defer conn.Close(websocket.StatusNormalClosure, "")
+		readers.Add(1)
+		go func() {
+			defer readers.Done()
+			for {
+				_, data, err := conn.Read(ctx)
+				if err != nil {
+					return
+				}
+				var msg WSMessage
+				json.Unmarshal(data, &msg)
+				sent, _ := strconv.ParseInt(msg.ID, 10, 64)
+				latency := time.Now().UnixNano() - sent
+				latenciesMu.Lock()
+				latencies = append(latencies, latency)
+				latenciesMu.Unlock()
+				if received.Add(1)%int64(clients) == 0 {
+					roundDone <- struct{}{}
+				}
+			}
+		}()
+	}
+	for hub.ClientCount() < clients {
+		time.Sleep(time.Millisecond)
+	}
+
+	b.ResetTimer()
+	start := time.Now()
+	for i := 0; i < b.N; i++ {
+		hub.Broadcast(WSMessage{Type: "bench", ID: strconv.FormatInt(time.Now().UnixNano(), 10)})
+		<-roundDone
+	}
+	elapsed := time.Since(start)
+	b.StopTimer()
+
+	latenciesMu.Lock()
+	sort.Slice(latencies, func(i, j int) bool { return latencies[i] < latencies[j] })
+	percentile := func(p float64) float64 {
+		return float64(latencies[int(p*float64(len(latencies)-1))]) / float64(time.Millisecond)
+	}
+	b.ReportMetric(percentile(0.50), "p50-ms")
+	b.ReportMetric(percentile(0.99), "p99-ms")
+	b.ReportMetric(percentile(0.999), "p999-ms")
+	b.ReportMetric(float64(len(latencies))/elapsed.Seconds(), "deliveries/s")
+	latenciesMu.Unlock()
+
+	cancel()
+	readers.Wait()
+}
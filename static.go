@@ -2,22 +2,132 @@
 package main
 
 import (
+	"bytes"
+	"crypto/sha256"
 	"embed"
+	"encoding/hex"
+	"encoding/json"
+	"fmt"
 	"io/fs"
 	"net/http"
 	"path"
+	"strconv"
 	"strings"
+	"sync"
+	"time"
 )
 
+//go:generate go run gen_assets.go
+
 //go:embed web
 var webFS embed.FS
 
-// ServeStaticFile serves embedded static files.
+// immutableCacheControl is sent with fingerprinted assets: their names
+// change whenever their content does, so browsers never need to revalidate.
+const immutableCacheControl = "public, max-age=31536000, immutable"
+
+// staticAsset is a script or stylesheet fingerprinted by gen_assets.go,
+// with its precompressed variants.
+type staticAsset struct {
+	name   string // Path under web/, such as "vendor/katex.min.js"
+	hash   string // Content hash in the fingerprinted name
+	data   []byte
+	gzip   []byte // nil if there is no gzip variant
+	brotli []byte // nil if there is no brotli variant
+}
+
+// staticAssets is the fingerprinted asset set loaded from web/dist.
+type staticAssets struct {
+	bySource map[string]*staticAsset // By path under web/
+	byHashed map[string]*staticAsset // By fingerprinted path
+	index    []byte                  // index.html referring to fingerprinted paths
+	indexTag string
+}
+
+var (
+	assetsOnce   sync.Once
+	loadedAssets *staticAssets
+)
+
+// getStaticAssets returns the fingerprinted assets, loading them on first use.
+func getStaticAssets() *staticAssets {
+	assetsOnce.Do(func() {
+		loadedAssets = loadStaticAssets(webFS)
+	})
+	return loadedAssets
+}
+
+// loadStaticAssets reads web/dist/manifest.json and the variants it lists.
+// If the manifest is missing or any source no longer matches its hash
+// (web/ was edited without running go generate), assets are served under
+// their plain names only and index.html is served as written.
+func loadStaticAssets(fsys fs.FS) *staticAssets {
+	a := &staticAssets{bySource: make(map[string]*staticAsset), byHashed: make(map[string]*staticAsset)}
+	manifest := make(map[string]string)
+	if data, err := fs.ReadFile(fsys, "web/dist/manifest.json"); err == nil {
+		if err := json.Unmarshal(data, &manifest); err != nil {
+			fmt.Printf("Warning: ignoring invalid asset manifest: %v\n", err)
+			manifest = nil
+		}
+	}
+
+	stale := false
+	for name, hashed := range manifest {
+		data, err := fs.ReadFile(fsys, path.Join("web", name))
+		if err != nil {
+			stale = true
+			break
+		}
+		ext := path.Ext(name)
+		hash := strings.TrimSuffix(strings.TrimPrefix(hashed, strings.TrimSuffix(name, ext)+"."), ext)
+		if sum := sha256.Sum256(data); !strings.HasPrefix(hex.EncodeToString(sum[:]), hash) || hash == "" {
+			stale = true
+			break
+		}
+		asset := &staticAsset{name: name, hash: hash, data: data}
+		asset.gzip, _ = fs.ReadFile(fsys, path.Join("web/dist", hashed+".gz"))
+		asset.brotli, _ = fs.ReadFile(fsys, path.Join("web/dist", hashed+".br"))
+		a.bySource[name] = asset
+		a.byHashed[hashed] = asset
+	}
+
+	var err error
+	a.index, err = fs.ReadFile(fsys, "web/dist/index.html")
+	if stale || err != nil {
+		if len(manifest) > 0 {
+			fmt.Println("Warning: web/dist is out of date, serving assets without fingerprints (run go generate)")
+		}
+		a.bySource = make(map[string]*staticAsset)
+		a.byHashed = make(map[string]*staticAsset)
+		a.index, _ = fs.ReadFile(fsys, "web/index.html")
+	}
+	sum := sha256.Sum256(a.index)
+	a.indexTag = `"` + hex.EncodeToString(sum[:8]) + `"`
+	return a
+}
+
+// ServeStaticFile serves embedded static files. Fingerprinted scripts and
+// stylesheets are cached as immutable; under their plain names, and for
+// index.html, browsers revalidate by ETag. Precompressed variants are
+// chosen by Accept-Encoding.
 func ServeStaticFile(w http.ResponseWriter, r *http.Request) {
 	// Clean the path and default to index.html
 	urlPath := strings.TrimPrefix(r.URL.Path, "/")
-	if urlPath == "" {
-		urlPath = "index.html"
+	if urlPath == "" || urlPath == "index.html" {
+		serveIndex(w, r)
+		return
+	}
+
+	assets := getStaticAssets()
+	if asset, ok := assets.byHashed[urlPath]; ok {
+		w.Header().Set("Cache-Control", immutableCacheControl)
+		serveAsset(w, r, asset)
+		return
+	}
+	if asset, ok := assets.bySource[urlPath]; ok {
+		w.Header().Set("Cache-Control", "no-cache")
+		serveAsset(w, r, asset)
+		return
 	}
 
 	// Prepend "web/" to access embedded files
@@ -28,16 +138,11 @@ func ServeStaticFile(w http.ResponseWriter, r *http.Request) {
 	if err != nil {
 		// If not found and not a specific file request, serve index.html (SPA fallback)
 		if !strings.Contains(urlPath, ".") {
-			data, err = webFS.ReadFile("web/index.html")
-			if err != nil {
-				http.NotFound(w, r)
-				return
-			}
-			filePath = "web/index.html"
+			serveIndex(w, r)
 		} else {
 			http.NotFound(w, r)
-			return
 		}
+		return
 	}
 
 	// Set content type based on extension
@@ -46,6 +151,67 @@ func ServeStaticFile(w http.ResponseWriter, r *http.Request) {
 	w.Write(data)
 }
 
+// serveIndex serves index.html, which browsers must revalidate so they
+// pick up new asset fingerprints.
+func serveIndex(w http.ResponseWriter, r *http.Request) {
+	assets := getStaticAssets()
+	if assets.index == nil {
+		http.NotFound(w, r)
+		return
+	}
+	setETag(w, assets.indexTag)
+	w.Header().Set("Content-Type", "text/html; charset=utf-8")
+	http.ServeContent(w, r, "", time.Time{}, bytes.NewReader(assets.index))
+}
+
+// serveAsset serves the best variant of an asset the client accepts. Each
+// variant has its own ETag, since the bytes differ.
+func serveAsset(w http.ResponseWriter, r *http.Request, asset *staticAsset) {
+	body, encoding := asset.data, ""
+	accept := r.Header.Get("Accept-Encoding")
+	switch {
+	case asset.brotli != nil && acceptsEncoding(accept, "br"):
+		body, encoding = asset.brotli, "br"
+	case asset.gzip != nil && acceptsEncoding(accept, "gzip"):
+		body, encoding = asset.gzip, "gzip"
+	}
+
+	h := w.Header()
+	h.Set("Vary", "Accept-Encoding")
+	h.Set("Content-Type", getContentType(asset.name))
+	if encoding != "" {
+		h.Set("Content-Encoding", encoding)
+		h.Set("ETag", `"`+asset.hash+"-"+encoding+`"`)
+	} else {
+		h.Set("ETag", `"`+asset.hash+`"`)
+	}
+	http.ServeContent(w, r, "", time.Time{}, bytes.NewReader(body))
+}
+
+// acceptsEncoding reports whether an Accept-Encoding header allows a
+// content coding, either by name or through "*", and not with q=0.
+func acceptsEncoding(header, coding string) bool {
+	accepted := false
+	for _, part := range strings.Split(header, ",") {
+		name, params, _ := strings.Cut(strings.TrimSpace(part), ";")
+		name = strings.TrimSpace(name)
+		if !strings.EqualFold(name, coding) && name != "*" {
+			continue
+		}
+		q := 1.0
+		if v, ok := strings.CutPrefix(strings.TrimSpace(params), "q="); ok {
+			if f, err := strconv.ParseFloat(v, 64); err == nil {
+				q = f
+			}
+		}
+		if strings.EqualFold(name, coding) {
+			return q > 0 // An explicit entry overrides "*"
+		}
+		accepted = q > 0
+	}
+	return accepted
+}
+
 // getContentType returns the MIME type for a file path.
 func getContentType(filePath string) string {
 	ext := path.Ext(filePath)
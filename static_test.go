@@ -2,9 +2,13 @@
 package main
 
 import (
+	"bytes"
+	"compress/gzip"
+	"io"
 	"io/fs"
 	"net/http"
 	"net/http/httptest"
+	"path"
 	"strings"
 	"testing"
 )
@@ -151,6 +155,118 @@ func TestServeStaticFile(t *testing.T) {
 	}
 }
 
+// TestStaticAssets_UpToDate tests that web/dist fingerprints every script
+// and stylesheet and its gzip variants match the sources. It fails when
+// web/ was edited without running go generate.
+func TestStaticAssets_UpToDate(t *testing.T) {
+	assets := loadStaticAssets(webFS)
+	err := fs.WalkDir(webFS, "web", func(p string, d fs.DirEntry, err error) error {
+		if err != nil || d.IsDir() || strings.HasPrefix(p, "web/dist/") {
+			return err
+		}
+		if ext := path.Ext(p); ext == ".js" || ext == ".css" {
+			if _, ok := assets.bySource[strings.TrimPrefix(p, "web/")]; !ok {
+				t.Errorf("%s is not fingerprinted; run go generate", p)
+			}
+		}
+		return nil
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	for name, asset := range assets.bySource {
+		zr, err := gzip.NewReader(bytes.NewReader(asset.gzip))
+		if err != nil {
+			t.Errorf("%s: no gzip variant: %v", name, err)
+			continue
+		}
+		if data, err := io.ReadAll(zr); err != nil || !bytes.Equal(data, asset.data) {
+			t.Errorf("%s: gzip variant does not match the source", name)
+		}
+	}
+	if !bytes.Contains(assets.index, []byte(`src="/`+manifestName(t, assets, "app.js")+`"`)) {
+		t.Error("index.html does not refer to the fingerprinted app.js")
+	}
+}
+
+// manifestName returns the fingerprinted path of a source asset.
+func manifestName(t *testing.T, assets *staticAssets, name string) string {
+	t.Helper()
+	for hashed, asset := range assets.byHashed {
+		if asset.name == name {
+			return hashed
+		}
+	}
+	t.Fatalf("%s is not fingerprinted", name)
+	return ""
+}
+
+// TestServeStaticFile_Fingerprinted tests immutable caching and
+// Accept-Encoding negotiation of fingerprinted assets.
+func TestServeStaticFile_Fingerprinted(t *testing.T) {
+	hashed := "/" + manifestName(t, getStaticAssets(), "vendor/mermaid.min.js")
+	get := func(path string, headers map[string]string) *http.Response {
+		req := httptest.NewRequest(http.MethodGet, path, nil)
+		for k, v := range headers {
+			req.Header.Set(k, v)
+		}
+		w := httptest.NewRecorder()
+		ServeStaticFile(w, req)
+		return w.Result()
+	}
+
+	resp := get(hashed, map[string]string{"Accept-Encoding": "gzip, deflate"})
+	if resp.StatusCode != http.StatusOK || resp.Header.Get("Content-Encoding") != "gzip" {
+		t.Fatalf("expected a gzip response, got %d %q", resp.StatusCode, resp.Header.Get("Content-Encoding"))
+	}
+	if cc := resp.Header.Get("Cache-Control"); cc != immutableCacheControl {
+		t.Errorf("expected immutable caching, got %q", cc)
+	}
+	if resp.Header.Get("Vary") != "Accept-Encoding" || resp.Header.Get("Content-Type") != "application/javascript; charset=utf-8" {
+		t.Errorf("unexpected headers %v", resp.Header)
+	}
+	etag := resp.Header.Get("ETag")
+	if resp := get(hashed, map[string]string{"Accept-Encoding": "gzip", "If-None-Match": etag}); resp.StatusCode != http.StatusNotModified {
+		t.Errorf("expected 304 for a matching ETag, got %d", resp.StatusCode)
+	}
+
+	resp = get(hashed, map[string]string{"Accept-Encoding": "gzip;q=0"})
+	if resp.Header.Get("Content-Encoding") != "" || resp.Header.Get("ETag") == etag {
+		t.Errorf("expected the identity variant with its own ETag, got %q %q", resp.Header.Get("Content-Encoding"), resp.Header.Get("ETag"))
+	}
+
+	if cc := get("/vendor/mermaid.min.js", nil).Header.Get("Cache-Control"); cc != "no-cache" {
+		t.Errorf("expected plain names to be revalidated, got %q", cc)
+	}
+	if cc := get("/", nil).Header.Get("Cache-Control"); cc != "no-cache" {
+		t.Errorf("expected index.html to be revalidated, got %q", cc)
+	}
+}
+
+// TestAcceptsEncoding tests Accept-Encoding parsing.
+func TestAcceptsEncoding(t *testing.T) {
+	tests := []struct {
+		header string
+		coding string
+		want   bool
+	}{
+		{"gzip, deflate, br", "br", true},
+		{"gzip, deflate", "br", false},
+		{"GZIP", "gzip", true},
+		{"gzip;q=0", "gzip", false},
+		{"gzip; q=0.5", "gzip", true},
+		{"*", "br", true},
+		{"*, br;q=0", "br", false},
+		{"", "gzip", false},
+	}
+	for _, tt := range tests {
+		if got := acceptsEncoding(tt.header, tt.coding); got != tt.want {
+			t.Errorf("acceptsEncoding(%q, %q) = %v, want %v", tt.header, tt.coding, got, tt.want)
+		}
+	}
+}
+
 func min(a, b int) int {
 	if a < b {
 		return a
@@ -0,0 +1,234 @@
+// Package main provides chunked streaming ingest into tabs.
+package main
+
+import (
+	"errors"
+	"io"
+	"net/http"
+	"strconv"
+	"sync"
+	"time"
+)
+
+const (
+	// defaultStreamRate is the default maximum broadcasts per second per streamed tab.
+	defaultStreamRate = 10
+	// maxStreamRate caps the ?rate= query parameter.
+	maxStreamRate = 60
+	// streamReadSize is the size of each read from the request body.
+	streamReadSize = 64 * 1024
+)
+
+// StreamTabResponse is the response once a stream upload finishes.
+type StreamTabResponse struct {
+	ID      string `json:"id"`
+	Version uint64 `json:"version"`
+	Size    int    `json:"size"`  // Content length in bytes after the stream
+	Bytes   int64  `json:"bytes"` // Bytes received from this upload
+}
+
+// streamBuffer accumulates bytes read from the request body until the
+// flush loop commits them. The reader never blocks on state or the hub.
+type streamBuffer struct {
+	mu      sync.Mutex
+	pending []byte
+	total   int64
+	notify  chan struct{} // Signaled (non-blocking) when pending grows
+}
+
+// write appends data and signals the flush loop.
+func (b *streamBuffer) write(data []byte) {
+	b.mu.Lock()
+	b.pending = append(b.pending, data...)
+	b.total += int64(len(data))
+	b.mu.Unlock()
+
+	select {
+	case b.notify <- struct{}{}:
+	default:
+	}
+}
+
+// take returns and clears the pending bytes. Unless final, a character
+// split across reads is kept back until the rest of it arrives, so appended
+// text is always valid UTF-8.
+func (b *streamBuffer) take(final bool) []byte {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	end := len(b.pending)
+	if !final {
+		end = completeRunes(b.pending)
+	}
+	data := b.pending[:end]
+	b.pending = append([]byte(nil), b.pending[end:]...)
+	return data
+}
+
+// handleStreamTab handles POST /api/tabs/{id}/stream.
+// The request body (typically chunked) is appended to the tab as it arrives.
+// Appends are coalesced so that at most ?rate= tab_patched broadcasts are
+// sent per second. The tab is created if needed and flagged as streaming
+// until the body ends.
+//
+// Query parameters: title, type, language (used when creating the tab),
+// reset=true (clear existing content first) and rate (broadcasts per second).
+func (s *Server) handleStreamTab(w http.ResponseWriter, r *http.Request) {
+	id := r.PathValue("id")
+	query := r.URL.Query()
+
+	tabType := query.Get("type")
+	if !ValidTabTypes[tabType] {
+		writeError(w, http.StatusBadRequest, "Invalid type: must be 'markdown', 'code', 'diff', 'image', 'csv', or 'mermaid'")
+		return
+	}
+
+	rate := defaultStreamRate
+	if v := query.Get("rate"); v != "" {
+		n, err := strconv.Atoi(v)
+		if err != nil || n < 1 || n > maxStreamRate {
+			writeError(w, http.StatusBadRequest, "Invalid rate: must be 1-"+strconv.Itoa(maxStreamRate))
+			return
+		}
+		rate = n
+	}
+
+	template := &Tab{ID: id, Title: query.Get("title"), Type: TabType(tabType), Language: query.Get("language")}
+	if !s.beginStream(template, query.Get("reset") == "true") {
+		writeError(w, http.StatusInternalServerError, "Cannot start stream")
+		return
+	}
+
+	buf := &streamBuffer{notify: make(chan struct{}, 1)}
+	readDone := make(chan error, 1)
+	go func() {
+		chunk := make([]byte, streamReadSize)
+		for {
+			n, err := r.Body.Read(chunk)
+			if n > 0 {
+				buf.write(chunk[:n])
+			}
+			if err != nil {
+				if errors.Is(err, io.EOF) {
+					err = nil
+				}
+				readDone <- err
+				return
+			}
+		}
+	}()
+
+	// Flush loop: commit pending bytes at most once per interval
+	interval := time.Second / time.Duration(rate)
+	var lastFlush time.Time
+	var readErr error
+	tabGone := false
+	for reading := true; reading; {
+		select {
+		case <-buf.notify:
+		case readErr = <-readDone:
+			reading = false
+		}
+
+		if reading {
+			if wait := interval - time.Since(lastFlush); wait > 0 {
+				timer := time.NewTimer(wait)
+				select {
+				case <-timer.C:
+				case readErr = <-readDone:
+					timer.Stop()
+					reading = false
+				}
+			}
+		}
+
+		if err := s.flushStream(id, buf.take(!reading)); err != nil {
+			// Tab was closed mid-stream; stop reading and discard the rest
+			tabGone = true
+			r.Body.Close()
+			if reading {
+				<-readDone
+			}
+			break
+		}
+		lastFlush = time.Now()
+	}
+
+	if tabGone {
+		writeError(w, http.StatusNotFound, "Tab was closed during stream")
+		return
+	}
+
+	patch, err := s.state.SetStreaming(id, false)
+	if err != nil {
+		writeError(w, http.StatusNotFound, "Tab was closed during stream")
+		return
+	}
+	s.hub.Broadcast(WSMessage{Type: "tab_patched", ID: id, Patch: patch})
+
+	if readErr != nil {
+		writeError(w, http.StatusBadRequest, "Stream interrupted: "+readErr.Error())
+		return
+	}
+
+	writeJSON(w, http.StatusOK, StreamTabResponse{
+		ID:      id,
+		Version: patch.Version,
+		Size:    patch.Size,
+		Bytes:   buf.total,
+	})
+}
+
+// beginStream creates (or resets) the tab described by template and marks it
+// as streaming, broadcasting the change. Empty template fields fall back to
+// the existing tab's values, or to a code tab titled by its ID.
+// Returns false if the tab could not be prepared.
+func (s *Server) beginStream(template *Tab, reset bool) bool {
+	id := template.ID
+	existing, exists := s.state.GetTab(id)
+	if !exists || reset {
+		if !exists {
+			existing = &Tab{Title: id, Type: TabTypeCode}
+		}
+		if template.Title == "" {
+			template.Title = existing.Title
+		}
+		if template.Type == "" {
+			template.Type = existing.Type
+		}
+		if template.Language == "" {
+			template.Language = existing.Language
+		}
+		template.Streaming = true
+
+		tab, created := s.state.CreateTab(template)
+		msgType := "tab_updated"
+		if created {
+			msgType = "tab_created"
+		}
+		s.hub.Broadcast(WSMessage{Type: msgType, Tab: tab})
+		if created {
+			return true
+		}
+	}
+
+	patch, err := s.state.SetStreaming(id, true)
+	if err != nil {
+		return false
+	}
+	s.hub.Broadcast(WSMessage{Type: "tab_patched", ID: id, Patch: patch})
+	return true
+}
+
+// flushStream appends data to the tab and broadcasts the delta.
+func (s *Server) flushStream(id string, data []byte) error {
+	if len(data) == 0 {
+		return nil
+	}
+
+	patch, err := s.state.PatchTab(id, 0, []PatchOp{{Op: PatchOpAppend, Text: string(data)}})
+	if err != nil {
+		return err
+	}
+	s.hub.Broadcast(WSMessage{Type: "tab_patched", ID: id, Patch: patch})
+	return nil
+}
@@ -0,0 +1,222 @@
+package main
+
+import (
+	"encoding/json"
+	"io"
+	"net/http"
+	"net/http/httptest"
+	"strings"
+	"testing"
+	"time"
+)
+
+// newStreamRequest builds a stream request for the given tab ID and query.
+func newStreamRequest(id, query string, body io.Reader) *http.Request {
+	req := httptest.NewRequest("POST", "/api/tabs/"+id+"/stream?"+query, body)
+	req.SetPathValue("id", id)
+	return req
+}
+
+// TestStreamTab_CreatesTab tests streaming into a new tab.
+func TestStreamTab_CreatesTab(t *testing.T) {
+	srv := setupTestServer()
+
+	req := newStreamRequest("build-log", "title=Build", strings.NewReader("line 1\nline 2\n"))
+	w := httptest.NewRecorder()
+
+	srv.handleStreamTab(w, req)
+
+	if w.Code != http.StatusOK {
+		t.Fatalf("expected status 200, got %d: %s", w.Code, w.Body.String())
+	}
+
+	var resp StreamTabResponse
+	if err := json.Unmarshal(w.Body.Bytes(), &resp); err != nil {
+		t.Fatalf("failed to parse response: %v", err)
+	}
+	if resp.Bytes != 14 || resp.Size != 14 {
+		t.Errorf("expected 14 bytes received and stored, got %d / %d", resp.Bytes, resp.Size)
+	}
+
+	tab, exists := srv.state.GetTab("build-log")
+	if !exists {
+		t.Fatal("expected tab to be created")
+	}
+	if tab.Title != "Build" {
+		t.Errorf("expected title 'Build', got %q", tab.Title)
+	}
+	if tab.Type != TabTypeCode {
+		t.Errorf("expected default type code, got %q", tab.Type)
+	}
+	if tab.Content != "line 1\nline 2\n" {
+		t.Errorf("unexpected content %q", tab.Content)
+	}
+	if tab.Streaming {
+		t.Error("expected streaming flag to be cleared after stream ends")
+	}
+}
+
+// TestStreamTab_AppendsAndResets tests appending to and resetting an existing tab.
+func TestStreamTab_AppendsAndResets(t *testing.T) {
+	srv := setupTestServer()
+	srv.state.CreateTab(&Tab{ID: "log", Title: "Log", Type: TabTypeMarkdown, Content: "start\n"})
+
+	srv.handleStreamTab(httptest.NewRecorder(), newStreamRequest("log", "", strings.NewReader("more\n")))
+
+	tab, _ := srv.state.GetTab("log")
+	if tab.Content != "start\nmore\n" {
+		t.Errorf("expected appended content, got %q", tab.Content)
+	}
+	if tab.Type != TabTypeMarkdown || tab.Title != "Log" {
+		t.Errorf("expected existing title/type kept, got %q / %q", tab.Title, tab.Type)
+	}
+
+	srv.handleStreamTab(httptest.NewRecorder(), newStreamRequest("log", "reset=true", strings.NewReader("fresh\n")))
+
+	tab, _ = srv.state.GetTab("log")
+	if tab.Content != "fresh\n" {
+		t.Errorf("expected reset content, got %q", tab.Content)
+	}
+	if tab.Title != "Log" {
+		t.Errorf("expected title kept on reset, got %q", tab.Title)
+	}
+}
+
+// TestStreamTab_FlagWhileStreaming tests that the tab is flagged while the body is open.
+func TestStreamTab_FlagWhileStreaming(t *testing.T) {
+	srv := setupTestServer()
+	pr, pw := io.Pipe()
+
+	done := make(chan struct{})
+	go func() {
+		srv.handleStreamTab(httptest.NewRecorder(), newStreamRequest("live", "", pr))
+		close(done)
+	}()
+
+	pw.Write([]byte("partial"))
+	time.Sleep(200 * time.Millisecond)
+
+	tab, exists := srv.state.GetTab("live")
+	if !exists {
+		t.Fatal("expected tab to exist while streaming")
+	}
+	if !tab.Streaming {
+		t.Error("expected streaming flag while body is open")
+	}
+	if tab.Content != "partial" {
+		t.Errorf("expected partial content to be visible, got %q", tab.Content)
+	}
+
+	pw.Close()
+	<-done
+
+	tab, _ = srv.state.GetTab("live")
+	if tab.Streaming {
+		t.Error("expected streaming flag cleared after body closes")
+	}
+}
+
+// TestStreamTab_SplitCharacter tests that a character split across reads
+// is held back until it is complete, so the tab never holds invalid UTF-8.
+func TestStreamTab_SplitCharacter(t *testing.T) {
+	srv := setupTestServer()
+	pr, pw := io.Pipe()
+
+	done := make(chan struct{})
+	go func() {
+		srv.handleStreamTab(httptest.NewRecorder(), newStreamRequest("utf8", "rate=60", pr))
+		close(done)
+	}()
+
+	pw.Write([]byte("caf\xc3"))
+	time.Sleep(100 * time.Millisecond)
+	if tab, _ := srv.state.GetTab("utf8"); tab.Content != "caf" {
+		t.Errorf("expected the split character held back, got %q", tab.Content)
+	}
+
+	pw.Write([]byte("\xa9 \xe2\x82"))
+	time.Sleep(100 * time.Millisecond)
+	if tab, _ := srv.state.GetTab("utf8"); tab.Content != "café " {
+		t.Errorf("expected the completed character, got %q", tab.Content)
+	}
+
+	pw.Write([]byte("\xac"))
+	pw.Close()
+	<-done
+	if tab, _ := srv.state.GetTab("utf8"); tab.Content != "café €" {
+		t.Errorf("expected the full text at the end, got %q", tab.Content)
+	}
+}
+
+// TestStreamTab_CoalescesBroadcasts tests that rapid chunks are coalesced.
+func TestStreamTab_CoalescesBroadcasts(t *testing.T) {
+	srv := setupTestServer()
+	client := &Client{hub: srv.hub, send: make(chan []byte, 1024)}
+	srv.hub.register <- client
+
+	pr, pw := io.Pipe()
+	done := make(chan struct{})
+	go func() {
+		srv.handleStreamTab(httptest.NewRecorder(), newStreamRequest("tokens", "rate=5", pr))
+		close(done)
+	}()
+
+	// 100 chunks over ~500ms would be 100 broadcasts without coalescing
+	var want strings.Builder
+	for i := 0; i < 100; i++ {
+		chunk := "token "
+		want.WriteString(chunk)
+		pw.Write([]byte(chunk))
+		time.Sleep(5 * time.Millisecond)
+	}
+	pw.Close()
+	<-done
+	time.Sleep(20 * time.Millisecond)
+
+	appends := 0
+	for len(client.send) > 0 {
+		var msg WSMessage
+		json.Unmarshal(<-client.send, &msg)
+		if msg.Type == "tab_patched" && len(msg.Patch.Ops) > 0 {
+			appends++
+		}
+	}
+	// rate=5 over ~0.5-1s allows a handful of flushes plus the final one
+	if appends == 0 || appends > 10 {
+		t.Errorf("expected coalesced broadcasts (1-10), got %d", appends)
+	}
+
+	tab, _ := srv.state.GetTab("tokens")
+	if tab.Content != want.String() {
+		t.Errorf("expected all chunks in content, got %d bytes", len(tab.Content))
+	}
+}
+
+// TestStreamTab_InvalidParams tests query parameter validation.
+func TestStreamTab_InvalidParams(t *testing.T) {
+	tests := []struct {
+		name  string
+		query string
+	}{
+		{"invalid type", "type=video"},
+		{"zero rate", "rate=0"},
+		{"rate too high", "rate=1000"},
+		{"non-numeric rate", "rate=fast"},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			srv := setupTestServer()
+			w := httptest.NewRecorder()
+
+			srv.handleStreamTab(w, newStreamRequest("x", tt.query, strings.NewReader("data")))
+
+			if w.Code != http.StatusBadRequest {
+				t.Errorf("expected status 400, got %d", w.Code)
+			}
+			if _, exists := srv.state.GetTab("x"); exists {
+				t.Error("expected no tab to be created")
+			}
+		})
+	}
+}
@@ -4,7 +4,12 @@ package main
 import (
 	"crypto/rand"
 	"encoding/hex"
+	"fmt"
+	"log"
+	"strconv"
+	"strings"
 	"sync"
+	"sync/atomic"
 	"time"
 )
 
@@ -30,9 +35,30 @@ type Tab struct {
 	DiffMeta   *DiffMeta `json:"diff,omitempty"`
 	SourcePath string    `json:"sourcePath,omitempty"` // File path for auto-reload; only set when created from file
 	Stale      bool      `json:"stale,omitempty"`      // True when source file was deleted/renamed; content preserved
+	Follow     bool      `json:"follow,omitempty"`     // Content is the tail of SourcePath and grows as the file does
+	Streaming  bool      `json:"streaming,omitempty"`  // True while content is being streamed in via /api/tabs/{id}/stream
 	Active     bool      `json:"active,omitempty"`
-	CreatedAt  time.Time `json:"createdAt"`
-	UpdatedAt  time.Time `json:"updatedAt"`
+	Version    uint64    `json:"version"` // Incremented on every change to the tab
+	// Size is the content length in bytes and ContentOmitted is set when
+	// Content was left out of a metadata-only WebSocket push.
+	Size           int       `json:"size,omitempty"`
+	ContentOmitted bool      `json:"contentOmitted,omitempty"`
+	CreatedAt      time.Time `json:"createdAt"`
+	UpdatedAt      time.Time `json:"updatedAt"`
+
+	// blob is the interned content. Tabs held by State own a reference and
+	// leave Content empty; copies handed out have Content filled from blob.
+	blob *Blob
+	// fileSynced is set while content is what was read from SourcePath, so
+	// it can be dropped under memory pressure and re-read later.
+	fileSynced bool
+	// dropped is set when a file-backed tab's content was evicted; it is
+	// re-read from SourcePath on next access. droppedHash detects changes.
+	dropped     bool
+	droppedHash BlobHash
+	// access is the last-access time (Unix nanoseconds) used for LRU
+	// eviction. Copies share it so lock-free readers can update it.
+	access *atomic.Int64
 }
 
 // DiffMeta holds metadata for diff tabs.
@@ -49,17 +75,34 @@ const maxClosedTabs = 10
 type State struct {
 	mu         sync.RWMutex
 	tabs       map[string]*Tab
-	order      []string
+	order      *tabOrder
 	activeID   string
-	closedTabs []*Tab // Recently closed tabs (stack, most recent last)
+	closedTabs []*Tab     // Recently closed tabs (stack, most recent last)
+	blobs      *BlobStore // Content store shared by tabs and closedTabs
+	memory     memoryBudget
+	persist    *Persister      // Journal and snapshots; nil unless persistence is enabled
+	unwritten  []*Blob         // Journaled content not yet in the blob directory (see writePendingBlobs)
+	onReload   func(id string) // Called when re-read content differs from what was dropped; set before use
+	generation uint64          // Incremented on every committed mutation
+	epoch      string          // Distinguishes generations across server restarts
+
+	// view is the snapshot read by lock-free readers; writers publish a new
+	// one under mu after every mutation.
+	view atomic.Pointer[tabsView]
 }
 
 // NewState creates a new State instance.
 func NewState() *State {
-	return &State{
+	s := &State{
 		tabs:  make(map[string]*Tab),
-		order: make([]string, 0),
+		order: newTabOrder(),
+		blobs: NewBlobStore(),
+		epoch: GenerateID(),
 	}
+	s.memory.wake = make(chan struct{}, 1)
+	s.view.Store(&tabsView{})
+	s.publishLocked()
+	return s
 }
 
 // GenerateID creates a unique tab ID.
@@ -72,58 +115,89 @@ func GenerateID() string {
 // CreateTab creates a new tab or updates an existing one.
 // Returns the tab and whether it was newly created (true) or updated (false).
 func (s *State) CreateTab(tab *Tab) (*Tab, bool) {
+	defer s.writePendingBlobs()
 	s.mu.Lock()
 	defer s.mu.Unlock()
 
+	stored, created := s.createTabLocked(tab, time.Now())
+	s.commitTabLocked(stored)
+	return s.viewLocked(stored), created
+}
+
+// createTabLocked creates or updates a stored tab without committing.
+// Returns the stored tab and whether it was newly created.
+// Caller must hold the write lock.
+func (s *State) createTabLocked(tab *Tab, now time.Time) (*Tab, bool) {
 	if tab.ID == "" {
 		tab.ID = GenerateID()
 	}
 
-	now := time.Now()
 	existing, exists := s.tabs[tab.ID]
 
 	if exists {
 		// Update existing tab
 		existing.Title = tab.Title
 		existing.Type = tab.Type
-		existing.Content = tab.Content
+		s.setContentLocked(existing, tab.Content)
+		existing.fileSynced = tab.SourcePath != "" && !tab.Follow
+		existing.Follow = tab.Follow
 		existing.Language = tab.Language
 		existing.DiffMeta = tab.DiffMeta
 		// Only update SourcePath if provided (don't overwrite with empty)
 		if tab.SourcePath != "" {
 			existing.SourcePath = tab.SourcePath
 		}
+		existing.Version++
 		existing.UpdatedAt = now
 		return existing, false
 	}
 
-	// Create new tab
-	tab.CreatedAt = now
-	tab.UpdatedAt = now
-	s.tabs[tab.ID] = tab
-	s.order = append(s.order, tab.ID)
+	// Create new tab from a private copy so callers can't mutate stored state
+	stored := *tab
+	stored.blob = nil
+	stored.access = newAccessClock()
+	s.setContentLocked(&stored, tab.Content)
+	stored.fileSynced = tab.SourcePath != "" && !tab.Follow
+	stored.Version = 1
+	stored.CreatedAt = now
+	stored.UpdatedAt = now
+	s.tabs[stored.ID] = &stored
+	s.order.Append(stored.ID)
 
 	// If this is the first tab, make it active
 	if len(s.tabs) == 1 {
-		s.activeID = tab.ID
+		s.activeID = stored.ID
 	}
-
-	return tab, true
+	return &stored, true
 }
 
 // GetTab returns a tab by ID.
+// It reads the published view without locking; content evicted under the
+// memory budget is loaded back transparently.
 func (s *State) GetTab(id string) (*Tab, bool) {
-	s.mu.RLock()
-	defer s.mu.RUnlock()
+	view := s.view.Load()
+	tab, exists := view.lookup(id)
+	if !exists {
+		return nil, false
+	}
+	if !tab.dropped {
+		if content, err := s.blobs.Load(tab.blob); err == nil {
+			s.touch(tab)
+			tabCopy := *tab
+			tabCopy.Active = (view.activeID == id)
+			tabCopy.Content = content
+			return &tabCopy, true
+		}
+	}
 
-	tab, exists := s.tabs[id]
-	if exists {
-		// Return a copy with active status
-		tabCopy := *tab
-		tabCopy.Active = (s.activeID == id)
-		return &tabCopy, true
+	// Slow path: re-read dropped content, or retry against the current state
+	// if a concurrent update released the blob this view referenced
+	stored, exists := s.lockLoaded(id)
+	defer s.mu.Unlock()
+	if !exists {
+		return nil, false
 	}
-	return nil, false
+	return s.viewLocked(stored), true
 }
 
 // DeleteTab removes a tab by ID, storing it for potential reopen.
@@ -131,6 +205,16 @@ func (s *State) DeleteTab(id string) bool {
 	s.mu.Lock()
 	defer s.mu.Unlock()
 
+	if !s.deleteTabLocked(id) {
+		return false
+	}
+	s.commitLocked(journalRecord{Op: journalDelete, ID: id})
+	return true
+}
+
+// deleteTabLocked moves a tab to the closed stack without committing.
+// Caller must hold the write lock.
+func (s *State) deleteTabLocked(id string) bool {
 	tab, exists := s.tabs[id]
 	if !exists {
 		return false
@@ -140,47 +224,66 @@ func (s *State) DeleteTab(id string) bool {
 	tabCopy := *tab
 	s.closedTabs = append(s.closedTabs, &tabCopy)
 
-	// Trim closed tabs if we exceed the limit
+	// Trim closed tabs if we exceed the limit, dropping their content references.
+	// The closed copy inherits the deleted tab's reference, so no retain is needed.
 	if len(s.closedTabs) > maxClosedTabs {
+		for _, closed := range s.closedTabs[:len(s.closedTabs)-maxClosedTabs] {
+			s.blobs.Release(closed.blob)
+		}
 		s.closedTabs = s.closedTabs[len(s.closedTabs)-maxClosedTabs:]
 	}
 
 	delete(s.tabs, id)
+	s.order.Remove(id)
 
-	// Remove from order
-	for i, oid := range s.order {
-		if oid == id {
-			s.order = append(s.order[:i], s.order[i+1:]...)
-			break
-		}
-	}
-
-	// If we deleted the active tab, activate another one
+	// If we deleted the active tab, activate the first one
 	if s.activeID == id {
-		if len(s.order) > 0 {
-			s.activeID = s.order[0]
-		} else {
-			s.activeID = ""
-		}
+		s.activeID = s.order.First()
 	}
-
 	return true
 }
 
-// ListTabs returns all tabs in order.
+// ListTabs returns all tabs in order, from the published view without locking.
+// Content is not included; use GetTab to fetch it.
 func (s *State) ListTabs() []*Tab {
-	s.mu.RLock()
-	defer s.mu.RUnlock()
+	tabs, _, _, _ := s.ListTabsPage("", 0)
+	return tabs
+}
 
-	tabs := make([]*Tab, 0, len(s.order))
-	for _, id := range s.order {
-		if tab, exists := s.tabs[id]; exists {
-			tabCopy := *tab
-			tabCopy.Active = (s.activeID == id)
-			tabs = append(tabs, &tabCopy)
+// ListTabsPage returns up to limit tabs (all if limit <= 0) following the
+// tab named by cursor ("" for the first page), the cursor for the next page
+// ("" after the last one) and the total number of tabs. Content is not
+// included. Pages stay consistent while tabs are added or removed; a cursor
+// whose tab was removed is rejected with ErrInvalidCursor only after the
+// order has since been compacted.
+func (s *State) ListTabsPage(cursor string, limit int) ([]*Tab, string, int, error) {
+	view := s.view.Load()
+
+	start := 0
+	if cursor != "" {
+		var err error
+		if start, err = view.resolveCursor(cursor); err != nil {
+			return nil, "", view.count, err
 		}
 	}
-	return tabs
+
+	size := view.count
+	if limit > 0 && limit < size {
+		size = limit
+	}
+	tabs := make([]*Tab, 0, size)
+	next := ""
+	view.each(start, func(_ int, tab *Tab) bool {
+		if limit > 0 && len(tabs) == limit {
+			next = view.cursor(tabs[len(tabs)-1].ID)
+			return false
+		}
+		tabCopy := *tab
+		tabCopy.Active = (view.activeID == tab.ID)
+		tabs = append(tabs, &tabCopy)
+		return true
+	})
+	return tabs, next, view.count, nil
 }
 
 // SetActive sets the active tab.
@@ -188,19 +291,22 @@ func (s *State) SetActive(id string) bool {
 	s.mu.Lock()
 	defer s.mu.Unlock()
 
-	if _, exists := s.tabs[id]; !exists {
+	tab, exists := s.tabs[id]
+	if !exists {
 		return false
 	}
 
-	s.activeID = id
+	s.touch(tab)
+	if s.activeID != id {
+		s.activeID = id
+		s.commitLocked(journalRecord{Op: journalActivate, ID: id})
+	}
 	return true
 }
 
 // GetActive returns the active tab ID.
 func (s *State) GetActive() string {
-	s.mu.RLock()
-	defer s.mu.RUnlock()
-	return s.activeID
+	return s.view.Load().activeID
 }
 
 // Clear removes all tabs.
@@ -208,21 +314,25 @@ func (s *State) Clear() {
 	s.mu.Lock()
 	defer s.mu.Unlock()
 
+	for _, tab := range s.tabs {
+		s.blobs.Release(tab.blob)
+	}
 	s.tabs = make(map[string]*Tab)
-	s.order = make([]string, 0)
+	s.order.Reset()
 	s.activeID = ""
+	s.commitLocked(journalRecord{Op: journalClear})
 }
 
 // TabCount returns the number of tabs.
 func (s *State) TabCount() int {
-	s.mu.RLock()
-	defer s.mu.RUnlock()
-	return len(s.tabs)
+	return s.view.Load().count
 }
 
-// UpdateTabContent updates only the content of a tab.
+// UpdateTabContent updates only the content of a tab with content read from
+// its source file.
 // Returns the updated tab or nil if the tab doesn't exist.
 func (s *State) UpdateTabContent(id, content string) *Tab {
+	defer s.writePendingBlobs()
 	s.mu.Lock()
 	defer s.mu.Unlock()
 
@@ -231,54 +341,146 @@ func (s *State) UpdateTabContent(id, content string) *Tab {
 		return nil
 	}
 
-	tab.Content = content
+	s.setContentLocked(tab, content)
+	// A followed tab holds only the file's tail, so it cannot be re-read
+	tab.fileSynced = tab.SourcePath != "" && !tab.Follow
 	tab.Stale = false // File was just read, so it's no longer stale
+	tab.Version++
 	tab.UpdatedAt = time.Now()
+	s.commitTabLocked(tab)
 
 	// Return a copy with active status
-	tabCopy := *tab
-	tabCopy.Active = (s.activeID == id)
-	return &tabCopy
+	return s.viewLocked(tab)
 }
 
-// MarkTabStale marks a tab as stale (source file deleted/renamed).
-// Content is preserved. Returns the updated tab or nil if the tab doesn't exist.
-func (s *State) MarkTabStale(id string) *Tab {
+// PatchTab applies delta operations to a tab's content.
+// If baseVersion is non-zero it must match the tab's current version.
+// Returns the patch as it should be forwarded to clients (see ApplyPatch),
+// or ErrTabNotFound, ErrVersionConflict or ErrInvalidPatch.
+func (s *State) PatchTab(id string, baseVersion uint64, ops []PatchOp) (*TabPatch, error) {
+	defer s.writePendingBlobs()
+	tab, exists := s.lockLoaded(id)
+	defer s.mu.Unlock()
+	if !exists {
+		return nil, ErrTabNotFound
+	}
+	if baseVersion != 0 && baseVersion != tab.Version {
+		return nil, ErrVersionConflict
+	}
+
+	var blob *Blob
+	var wireOps []PatchOp
+	wasSynced := tab.fileSynced
+	if isAppendOnly(ops) {
+		// Fast path: resume the content hash instead of rehashing the document
+		var suffix strings.Builder
+		wireOps = make([]PatchOp, len(ops))
+		for i, op := range ops {
+			suffix.WriteString(op.Text)
+			wireOps[i] = PatchOp{Op: PatchOpAppend, Text: op.Text}
+		}
+		blob = s.blobs.Append(tab.blob, suffix.String())
+	} else {
+		current, err := s.blobs.Load(tab.blob)
+		if err != nil {
+			return nil, err
+		}
+		content, converted, err := ApplyPatch(current, ops)
+		if err != nil {
+			return nil, err
+		}
+		blob = s.blobs.Put(content)
+		wireOps = converted
+	}
+
+	s.blobs.Release(tab.blob)
+	tab.blob = blob
+	tab.fileSynced = false // Diverged from the source file; must not be dropped
+	s.touch(tab)
+
+	patch := &TabPatch{
+		BaseVersion: tab.Version,
+		Version:     tab.Version + 1,
+		Ops:         wireOps,
+		Size:        int(blob.Size()),
+		Streaming:   tab.Streaming,
+	}
+	tab.Version++
+	tab.UpdatedAt = time.Now()
+	if wasSynced {
+		// The journal holds no content for a file-synced tab to patch on
+		// replay, so record the patched content in full
+		s.commitTabLocked(tab)
+	} else {
+		s.commitLocked(journalRecord{Op: journalPatch, ID: id, Ops: ops, Version: tab.Version, At: tab.UpdatedAt})
+	}
+
+	return patch, nil
+}
+
+// SetStreaming sets or clears a tab's streaming flag.
+// Returns a patch with no ops that carries the new flag and version.
+func (s *State) SetStreaming(id string, streaming bool) (*TabPatch, error) {
+	defer s.writePendingBlobs()
 	s.mu.Lock()
 	defer s.mu.Unlock()
 
 	tab, exists := s.tabs[id]
+	if !exists {
+		return nil, ErrTabNotFound
+	}
+
+	patch := &TabPatch{
+		BaseVersion: tab.Version,
+		Version:     tab.Version + 1,
+		Ops:         []PatchOp{},
+		Size:        int(tab.blob.Size()),
+		Streaming:   streaming,
+	}
+	tab.Streaming = streaming
+	tab.Version++
+	tab.UpdatedAt = time.Now()
+	s.commitTabLocked(tab)
+
+	return patch, nil
+}
+
+// MarkTabStale marks a tab as stale (source file deleted/renamed).
+// Content is preserved. Returns the updated tab or nil if the tab doesn't exist.
+func (s *State) MarkTabStale(id string) *Tab {
+	defer s.writePendingBlobs()
+	tab, exists := s.lockLoaded(id)
+	defer s.mu.Unlock()
 	if !exists {
 		return nil
 	}
 
 	tab.Stale = true
+	tab.Version++
 	tab.UpdatedAt = time.Now()
+	s.commitTabLocked(tab)
 
 	// Return a copy with active status
-	tabCopy := *tab
-	tabCopy.Active = (s.activeID == id)
-	return &tabCopy
+	return s.viewLocked(tab)
 }
 
 // ClearTabStale removes the stale flag from a tab.
 // Returns the updated tab or nil if the tab doesn't exist.
 func (s *State) ClearTabStale(id string) *Tab {
-	s.mu.Lock()
+	defer s.writePendingBlobs()
+	tab, exists := s.lockLoaded(id)
 	defer s.mu.Unlock()
-
-	tab, exists := s.tabs[id]
 	if !exists {
 		return nil
 	}
 
 	tab.Stale = false
+	tab.Version++
 	tab.UpdatedAt = time.Now()
+	s.commitTabLocked(tab)
 
 	// Return a copy with active status
-	tabCopy := *tab
-	tabCopy.Active = (s.activeID == id)
-	return &tabCopy
+	return s.viewLocked(tab)
 }
 
 // ReopenTab restores the most recently closed tab.
@@ -303,22 +505,117 @@ func (s *State) ReopenTab() *Tab {
 
 	// Update timestamps
 	now := time.Now()
+	tab.Version++
 	tab.UpdatedAt = now
 
 	// Re-add to state
 	s.tabs[tab.ID] = tab
-	s.order = append(s.order, tab.ID)
+	s.order.Append(tab.ID)
 	s.activeID = tab.ID
+	s.commitLocked(journalRecord{Op: journalReopen, ID: tab.ID})
 
 	// Return a copy
-	tabCopy := *tab
-	tabCopy.Active = true
-	return &tabCopy
+	return s.viewLocked(tab)
 }
 
 // ClosedTabCount returns the number of tabs available for reopen.
 func (s *State) ClosedTabCount() int {
-	s.mu.RLock()
-	defer s.mu.RUnlock()
-	return len(s.closedTabs)
+	return s.view.Load().closed
+}
+
+// TabETag returns the strong entity tag of a tab's content and metadata,
+// without loading its content. The active flag is not covered, so switching
+// tabs does not invalidate cached content.
+func (s *State) TabETag(id string) (string, bool) {
+	tab, exists := s.view.Load().lookup(id)
+	if !exists {
+		return "", false
+	}
+	return tabETag(tab), true
+}
+
+// ListETag returns the entity tag of the tab list. It changes on every
+// mutation, including activation.
+func (s *State) ListETag() string {
+	return s.view.Load().listETag()
+}
+
+// tabETag derives a tab's entity tag from its creation time and version.
+// Including the creation time keeps tags unique when a tab ID is reused.
+func tabETag(tab *Tab) string {
+	return fmt.Sprintf(`"%s-%d"`, strconv.FormatInt(tab.CreatedAt.UnixNano(), 36), tab.Version)
+}
+
+// metadata returns a copy of a tab without its content, for metadata-only pushes.
+// A tab whose content is already omitted is returned as is.
+func (t *Tab) metadata() *Tab {
+	if t.ContentOmitted {
+		return t
+	}
+	meta := *t
+	meta.Size = len(t.Content)
+	meta.Content = ""
+	meta.ContentOmitted = true
+	return &meta
+}
+
+// ContentStats returns logical vs. physical byte usage of tab content.
+// Logical bytes count every tab and closed tab; physical bytes count each
+// distinct piece of content once.
+func (s *State) ContentStats() BlobStats {
+	return s.blobs.Stats()
+}
+
+// setContentLocked replaces a tab's content with an interned blob, releasing
+// the previous reference. Caller must hold the lock.
+func (s *State) setContentLocked(tab *Tab, content string) {
+	old := tab.blob
+	tab.blob = s.blobs.Put(content)
+	tab.Content = ""
+	tab.dropped = false
+	s.blobs.Release(old)
+	s.touch(tab)
+}
+
+// commitLocked records a mutation: it advances the generation used for list
+// ETags, journals the change if persistence is enabled and publishes a new
+// view for readers. Caller must hold the write lock.
+func (s *State) commitLocked(rec journalRecord) {
+	s.generation++
+	s.journalLocked(rec)
+
+	switch rec.Op {
+	case journalActivate:
+		s.publishActiveLocked()
+	case journalPatch:
+		s.publishTabLocked(s.tabs[rec.ID])
+	case journalDelete:
+		s.publishRemoveLocked(rec.ID)
+	default:
+		s.publishLocked()
+	}
+}
+
+// commitTabLocked records a change to one tab, journaling its full state.
+// Caller must hold the write lock.
+func (s *State) commitTabLocked(tab *Tab) {
+	s.generation++
+	s.journalTabLocked(tab)
+	s.publishTabLocked(tab)
+}
+
+// viewLocked returns a copy of a stored tab with Content loaded and the
+// active flag set, marking it as recently used. Caller must hold the write
+// lock, taken with lockLoaded if the tab may have been dropped.
+func (s *State) viewLocked(tab *Tab) *Tab {
+	s.touch(tab)
+
+	tabCopy := *tab
+	tabCopy.Active = (s.activeID == tab.ID)
+	content, err := s.blobs.Load(tab.blob)
+	if err != nil {
+		log.Printf("Warning: cannot load content for tab %s: %v", tab.ID, err)
+	}
+	tabCopy.Content = content
+	return &tabCopy
 }
@@ -1,6 +1,9 @@
 package main
 
 import (
+	"errors"
+	"fmt"
+	"strings"
 	"sync"
 	"testing"
 )
@@ -18,15 +21,15 @@ func TestNewState(t *testing.T) {
 	}
 
 	if state.order == nil {
-		t.Error("order slice should be initialized")
+		t.Error("order should be initialized")
 	}
 
 	if len(state.tabs) != 0 {
 		t.Errorf("expected 0 tabs, got %d", len(state.tabs))
 	}
 
-	if len(state.order) != 0 {
-		t.Errorf("expected 0 order entries, got %d", len(state.order))
+	if state.order.Len() != 0 {
+		t.Errorf("expected 0 order entries, got %d", state.order.Len())
 	}
 
 	if state.activeID != "" {
@@ -1172,3 +1175,166 @@ func TestClearTabStale(t *testing.T) {
 		}
 	})
 }
+
+// TestContentDeduplication verifies that identical content is stored once
+// across tabs, closed tabs, and content updates.
+func TestContentDeduplication(t *testing.T) {
+	t.Run("identical content in several tabs is stored once", func(t *testing.T) {
+		state := NewState()
+		content := strings.Repeat("generated line\n", 100)
+		state.CreateTab(&Tab{ID: "a", Title: "A", Type: TabTypeCode, Content: content})
+		state.CreateTab(&Tab{ID: "b", Title: "B", Type: TabTypeCode, Content: content})
+		state.CreateTab(&Tab{ID: "c", Title: "C", Type: TabTypeCode, Content: content})
+
+		stats := state.ContentStats()
+		if stats.Blobs != 1 {
+			t.Errorf("expected 1 blob, got %d", stats.Blobs)
+		}
+		if stats.LogicalBytes != int64(3*len(content)) {
+			t.Errorf("expected %d logical bytes, got %d", 3*len(content), stats.LogicalBytes)
+		}
+		if stats.PhysicalBytes != int64(len(content)) {
+			t.Errorf("expected %d physical bytes, got %d", len(content), stats.PhysicalBytes)
+		}
+	})
+
+	t.Run("closed tabs keep content referenced", func(t *testing.T) {
+		state := NewState()
+		state.CreateTab(&Tab{ID: "a", Title: "A", Type: TabTypeMarkdown, Content: "closed content"})
+		state.DeleteTab("a")
+
+		stats := state.ContentStats()
+		if stats.Blobs != 1 || stats.References != 1 {
+			t.Errorf("expected closed tab to hold 1 reference, got %+v", stats)
+		}
+
+		reopened := state.ReopenTab()
+		if reopened.Content != "closed content" {
+			t.Errorf("expected reopened content, got %q", reopened.Content)
+		}
+		if stats := state.ContentStats(); stats.References != 1 {
+			t.Errorf("expected 1 reference after reopen, got %d", stats.References)
+		}
+	})
+
+	t.Run("trimmed closed tabs release content", func(t *testing.T) {
+		state := NewState()
+		for i := 0; i < maxClosedTabs+5; i++ {
+			id := fmt.Sprintf("tab-%d", i)
+			state.CreateTab(&Tab{ID: id, Title: id, Type: TabTypeMarkdown, Content: "content " + id})
+			state.DeleteTab(id)
+		}
+
+		if stats := state.ContentStats(); stats.Blobs != maxClosedTabs {
+			t.Errorf("expected %d blobs, got %d", maxClosedTabs, stats.Blobs)
+		}
+	})
+
+	t.Run("updates release replaced content", func(t *testing.T) {
+		state := NewState()
+		state.CreateTab(&Tab{ID: "a", Title: "A", Type: TabTypeCode, Content: "v1"})
+		state.UpdateTabContent("a", "v2")
+		state.CreateTab(&Tab{ID: "a", Title: "A", Type: TabTypeCode, Content: "v3"})
+
+		stats := state.ContentStats()
+		if stats.Blobs != 1 || stats.PhysicalBytes != 2 {
+			t.Errorf("expected only current content to remain, got %+v", stats)
+		}
+	})
+
+	t.Run("clear releases tab content", func(t *testing.T) {
+		state := NewState()
+		state.CreateTab(&Tab{ID: "a", Title: "A", Type: TabTypeCode, Content: "one"})
+		state.CreateTab(&Tab{ID: "b", Title: "B", Type: TabTypeCode, Content: "two"})
+		state.Clear()
+
+		if stats := state.ContentStats(); stats != (BlobStats{}) {
+			t.Errorf("expected empty content store after clear, got %+v", stats)
+		}
+	})
+}
+
+// TestPatchTab verifies delta updates and per-tab versioning.
+func TestPatchTab(t *testing.T) {
+	t.Run("appends content and bumps version", func(t *testing.T) {
+		state := NewState()
+		created, _ := state.CreateTab(&Tab{ID: "log", Title: "Log", Type: TabTypeMarkdown, Content: "line 1\n"})
+		if created.Version != 1 {
+			t.Fatalf("expected new tab at version 1, got %d", created.Version)
+		}
+
+		patch, err := state.PatchTab("log", 1, []PatchOp{{Op: PatchOpAppend, Text: "line 2\n"}})
+		if err != nil {
+			t.Fatalf("PatchTab failed: %v", err)
+		}
+		if patch.BaseVersion != 1 || patch.Version != 2 {
+			t.Errorf("expected version 1 -> 2, got %d -> %d", patch.BaseVersion, patch.Version)
+		}
+
+		tab, _ := state.GetTab("log")
+		if tab.Content != "line 1\nline 2\n" {
+			t.Errorf("unexpected content %q", tab.Content)
+		}
+		if tab.Version != 2 {
+			t.Errorf("expected version 2, got %d", tab.Version)
+		}
+	})
+
+	t.Run("appended content hashes like a full put", func(t *testing.T) {
+		state := NewState()
+		state.CreateTab(&Tab{ID: "a", Title: "A", Type: TabTypeMarkdown, Content: "hello"})
+		state.CreateTab(&Tab{ID: "b", Title: "B", Type: TabTypeMarkdown, Content: "hello world"})
+
+		if _, err := state.PatchTab("a", 0, []PatchOp{{Op: PatchOpAppend, Text: " world"}}); err != nil {
+			t.Fatalf("PatchTab failed: %v", err)
+		}
+
+		if stats := state.ContentStats(); stats.Blobs != 1 {
+			t.Errorf("expected appended content to dedupe with identical tab, got %d blobs", stats.Blobs)
+		}
+	})
+
+	t.Run("zero base version skips conflict check", func(t *testing.T) {
+		state := NewState()
+		state.CreateTab(&Tab{ID: "a", Title: "A", Type: TabTypeMarkdown, Content: "x"})
+		state.UpdateTabContent("a", "y")
+
+		if _, err := state.PatchTab("a", 0, []PatchOp{{Op: PatchOpAppend, Text: "z"}}); err != nil {
+			t.Errorf("expected patch without baseVersion to succeed, got %v", err)
+		}
+	})
+
+	t.Run("stale base version conflicts", func(t *testing.T) {
+		state := NewState()
+		state.CreateTab(&Tab{ID: "a", Title: "A", Type: TabTypeMarkdown, Content: "x"})
+		state.UpdateTabContent("a", "y")
+
+		_, err := state.PatchTab("a", 1, []PatchOp{{Op: PatchOpAppend, Text: "z"}})
+		if !errors.Is(err, ErrVersionConflict) {
+			t.Errorf("expected ErrVersionConflict, got %v", err)
+		}
+	})
+
+	t.Run("missing tab", func(t *testing.T) {
+		state := NewState()
+		_, err := state.PatchTab("missing", 0, []PatchOp{{Op: PatchOpAppend, Text: "z"}})
+		if !errors.Is(err, ErrTabNotFound) {
+			t.Errorf("expected ErrTabNotFound, got %v", err)
+		}
+	})
+
+	t.Run("invalid op leaves content unchanged", func(t *testing.T) {
+		state := NewState()
+		state.CreateTab(&Tab{ID: "a", Title: "A", Type: TabTypeMarkdown, Content: "abc"})
+
+		_, err := state.PatchTab("a", 0, []PatchOp{{Op: PatchOpReplace, Offset: 1, Length: 10}})
+		if !errors.Is(err, ErrInvalidPatch) {
+			t.Errorf("expected ErrInvalidPatch, got %v", err)
+		}
+
+		tab, _ := state.GetTab("a")
+		if tab.Content != "abc" || tab.Version != 1 {
+			t.Errorf("expected unchanged tab, got content %q version %d", tab.Content, tab.Version)
+		}
+	})
+}
@@ -0,0 +1,156 @@
+// Package main provides per-tab rate limiting of WebSocket tab updates.
+package main
+
+import (
+	"sync/atomic"
+	"time"
+)
+
+const (
+	// defaultUpdateRate is the most tab_updated pushes per second for the
+	// active tab. Faster updates are coalesced and the latest one is sent.
+	defaultUpdateRate = 10
+
+	// backgroundSlowdown divides the update rate of tabs other than the
+	// active one, which nobody is looking at.
+	backgroundSlowdown = 4
+)
+
+// throttledTab tracks the pushes of one tab's full-state updates.
+type throttledTab struct {
+	last    time.Time   // When an update of the tab was last sent
+	pending *WSMessage  // Latest update held back, if any
+	timer   *time.Timer // Sends pending once the interval has passed
+}
+
+// throttleCounters counts updates held back by the rate limit.
+type throttleCounters struct {
+	deferred  atomic.Int64 // Updates held back rather than sent at once
+	coalesced atomic.Int64 // Held-back updates superseded before being sent
+}
+
+// SetUpdateRate sets the most tab_updated pushes per second for the active
+// tab; other tabs get a quarter of it. Zero or less sends every update.
+func (h *Hub) SetUpdateRate(perSecond int) {
+	h.seqMu.Lock()
+	defer h.seqMu.Unlock()
+	h.updateInterval = 0
+	if perSecond > 0 {
+		h.updateInterval = time.Second / time.Duration(perSecond)
+	}
+}
+
+// throttleLocked decides whether a tab_updated message can be sent now.
+// If the tab was pushed less than its interval ago, the message is held
+// back, replacing any earlier held-back update, and sent when the interval
+// ends; it returns true in that case. Caller must hold seqMu.
+func (h *Hub) throttleLocked(msg WSMessage) bool {
+	if h.updateInterval <= 0 || msg.Tab == nil {
+		return false
+	}
+	id := msg.Tab.ID
+	interval := h.updateInterval
+	if h.active == nil || h.active() != id {
+		interval *= backgroundSlowdown
+	}
+
+	t := h.throttled[id]
+	if t == nil {
+		t = &throttledTab{}
+		h.throttled[id] = t
+	}
+	now := time.Now()
+	if t.pending == nil && now.Sub(t.last) >= interval {
+		t.last = now
+		return false
+	}
+
+	h.throttle.deferred.Add(1)
+	if t.pending != nil {
+		h.throttle.coalesced.Add(1)
+	}
+	t.pending = &msg
+	if t.timer == nil {
+		var timer *time.Timer
+		timer = time.AfterFunc(t.last.Add(interval).Sub(now), func() {
+			h.seqMu.Lock()
+			defer h.seqMu.Unlock()
+			if t.timer == timer { // Not stopped or replaced meanwhile
+				h.flushThrottledLocked(id)
+			}
+		})
+		t.timer = timer
+	}
+	return true
+}
+
+// settleThrottledLocked keeps held-back updates consistent with a message
+// about to be sent: updates superseded by the message's full tab state or
+// deletion are dropped, and those it builds on (patches, activation) are
+// sent first. Sent tab state restarts the tab's interval. Caller must hold seqMu.
+func (h *Hub) settleThrottledLocked(msg *WSMessage) {
+	if len(h.throttled) == 0 {
+		return
+	}
+	switch msg.Type {
+	case "tabs_cleared":
+		for id := range h.throttled {
+			h.forgetThrottledLocked(id)
+		}
+	case "tab_deleted":
+		h.forgetThrottledLocked(msg.ID)
+	case "tab_created", "tab_stale":
+		if msg.Tab != nil {
+			h.supersedeThrottledLocked(msg.Tab.ID)
+		}
+	case "tabs_batch", "tabs_updated":
+		for _, id := range msg.IDs {
+			h.forgetThrottledLocked(id)
+		}
+		for _, tab := range msg.Tabs {
+			h.supersedeThrottledLocked(tab.ID)
+		}
+	case "tab_patched", "tab_activated":
+		h.flushThrottledLocked(msg.ID)
+	}
+}
+
+// flushThrottledLocked sends a tab's held-back update now, if any.
+func (h *Hub) flushThrottledLocked(id string) {
+	t := h.throttled[id]
+	if t == nil || t.pending == nil {
+		return
+	}
+	if t.timer != nil {
+		t.timer.Stop()
+		t.timer = nil
+	}
+	msg := *t.pending
+	t.pending = nil
+	t.last = time.Now()
+	h.publishLocked(msg)
+}
+
+// supersedeThrottledLocked discards a tab's held-back update because its
+// full state is about to be sent, which restarts the tab's interval.
+func (h *Hub) supersedeThrottledLocked(id string) {
+	t := h.throttled[id]
+	if t == nil {
+		return
+	}
+	if t.timer != nil {
+		t.timer.Stop()
+		t.timer = nil
+	}
+	if t.pending != nil {
+		t.pending = nil
+		h.throttle.coalesced.Add(1)
+	}
+	t.last = time.Now()
+}
+
+// forgetThrottledLocked discards a deleted tab's held-back update and state.
+func (h *Hub) forgetThrottledLocked(id string) {
+	h.supersedeThrottledLocked(id)
+	delete(h.throttled, id)
+}
@@ -0,0 +1,101 @@
+package main
+
+import (
+	"strconv"
+	"testing"
+	"time"
+)
+
+// throttledHub starts a hub limited to 20 updates per second (50ms) for
+// the active tab "a", with one registered client.
+func throttledHub(t *testing.T) (*Hub, *Client) {
+	t.Helper()
+	hub := NewHub()
+	hub.SetUpdateRate(20)
+	hub.active = func() string { return "a" }
+	go hub.Run()
+	t.Cleanup(hub.Shutdown)
+
+	client := &Client{hub: hub, send: make(chan []byte, 64)}
+	hub.register <- client
+	return hub, client
+}
+
+// update returns a tab_updated message for a tab at a version.
+func update(id string, version uint64) WSMessage {
+	return WSMessage{Type: "tab_updated", Tab: &Tab{ID: id, Version: version, Content: strconv.FormatUint(version, 10)}}
+}
+
+// expectNone fails if the client receives a message within d.
+func expectNone(t *testing.T, client *Client, d time.Duration) {
+	t.Helper()
+	select {
+	case data := <-client.send:
+		t.Errorf("unexpected message: %s", data)
+	case <-time.After(d):
+	}
+}
+
+// TestHubThrottle_DeliversLatest tests that rapid updates of a tab are
+// coalesced and its final state is delivered.
+func TestHubThrottle_DeliversLatest(t *testing.T) {
+	hub, client := throttledHub(t)
+
+	for v := uint64(1); v <= 50; v++ {
+		hub.Broadcast(update("a", v))
+	}
+	if msg := receive(t, client); msg.Tab.Version != 1 {
+		t.Errorf("expected the first update at once, got version %d", msg.Tab.Version)
+	}
+	if msg := receive(t, client); msg.Tab.Version != 50 {
+		t.Errorf("expected the final update next, got version %d", msg.Tab.Version)
+	}
+	expectNone(t, client, 100*time.Millisecond)
+
+	if stats := hub.Stats(); stats.DeferredUpdates != 49 || stats.CoalescedUpdates != 48 {
+		t.Errorf("expected 49 deferred and 48 coalesced, got %d and %d", stats.DeferredUpdates, stats.CoalescedUpdates)
+	}
+}
+
+// TestHubThrottle_ActiveTabFirst tests that a background tab waits four
+// times as long as the active tab between updates.
+func TestHubThrottle_ActiveTabFirst(t *testing.T) {
+	hub, client := throttledHub(t)
+
+	hub.Broadcast(update("b", 1))
+	hub.Broadcast(update("a", 1))
+	receive(t, client)
+	receive(t, client)
+
+	start := time.Now()
+	hub.Broadcast(update("b", 2))
+	hub.Broadcast(update("a", 2))
+	if msg := receive(t, client); msg.Tab.ID != "a" || time.Since(start) > 150*time.Millisecond {
+		t.Errorf("expected the active tab within its 50ms interval, got %s after %v", msg.Tab.ID, time.Since(start))
+	}
+	if msg := receive(t, client); msg.Tab.ID != "b" || time.Since(start) < 150*time.Millisecond {
+		t.Errorf("expected the background tab after its 200ms interval, got %s after %v", msg.Tab.ID, time.Since(start))
+	}
+}
+
+// TestHubThrottle_KeepsOrder tests that a held-back update is sent before
+// a patch that builds on it, and dropped when its tab is deleted.
+func TestHubThrottle_KeepsOrder(t *testing.T) {
+	hub, client := throttledHub(t)
+
+	hub.Broadcast(update("a", 1))
+	hub.Broadcast(update("a", 2))
+	hub.Broadcast(WSMessage{Type: "tab_patched", ID: "a", Patch: &TabPatch{BaseVersion: 2, Version: 3}})
+	for _, want := range []string{"tab_updated", "tab_updated", "tab_patched"} {
+		if msg := receive(t, client); msg.Type != want {
+			t.Errorf("expected %s, got %s", want, msg.Type)
+		}
+	}
+
+	hub.Broadcast(update("a", 4))
+	hub.Broadcast(WSMessage{Type: "tab_deleted", ID: "a"})
+	if msg := receive(t, client); msg.Type != "tab_deleted" {
+		t.Errorf("expected tab_deleted, got %s", msg.Type)
+	}
+	expectNone(t, client, 100*time.Millisecond)
+}
@@ -0,0 +1,305 @@
+// Package main provides lock-free snapshots of tab state for readers.
+package main
+
+import (
+	"encoding/base64"
+	"errors"
+	"fmt"
+	"math"
+	"strconv"
+	"strings"
+	"sync/atomic"
+)
+
+// viewChunkSize is the number of slots per chunk of a tabsView.
+const viewChunkSize = 256
+
+// ErrInvalidCursor is returned for a malformed or expired list cursor.
+var ErrInvalidCursor = errors.New("invalid or expired cursor")
+
+// tabsView is an immutable snapshot of tab metadata. Writers publish a new
+// view after every mutation; readers load the current one through
+// State.view without taking State.mu. Neither the view nor the tabs it
+// points to are modified after publishing.
+//
+// Tabs are stored by their State.order slot in fixed-size chunks, so
+// publishing a single append, removal or update copies one chunk and the
+// chunk list rather than every slot, and reuses the index.
+type tabsView struct {
+	chunks [][]*Tab // Frozen tabs by order slot (Content empty, Active unset); nil for holes
+	size   int      // Number of slots
+	count  int      // Number of non-nil slots
+	// index maps tab IDs to slots as of the last rebuild or fold and is shared
+	// by later views; added holds tabs appended since. Entries may be
+	// outdated by removals, so lookups check the slot's ID.
+	index      map[string]int
+	added      map[string]int
+	orderEpoch uint64 // tabOrder.epoch the slots refer to
+	activeID   string
+	closed     int    // Number of recently closed tabs
+	generation uint64 // State.generation when published
+	epoch      string
+}
+
+// at returns the tab in a slot, or nil for a hole.
+func (v *tabsView) at(slot int) *Tab {
+	if slot < 0 || slot >= v.size {
+		return nil
+	}
+	return v.chunks[slot/viewChunkSize][slot%viewChunkSize]
+}
+
+// each calls fn for every tab from slot start on, in order, until fn returns false.
+func (v *tabsView) each(start int, fn func(slot int, tab *Tab) bool) {
+	for c := start / viewChunkSize; c < len(v.chunks); c++ {
+		chunk := v.chunks[c]
+		for j := max(start-c*viewChunkSize, 0); j < len(chunk); j++ {
+			if chunk[j] != nil && !fn(c*viewChunkSize+j, chunk[j]) {
+				return
+			}
+		}
+	}
+}
+
+// lookup returns the tab with the given ID.
+func (v *tabsView) lookup(id string) (*Tab, bool) {
+	i, exists := v.slot(id)
+	if !exists {
+		return nil, false
+	}
+	return v.at(i), true
+}
+
+// slot returns the slot of the tab with the given ID.
+func (v *tabsView) slot(id string) (int, bool) {
+	i, exists := v.added[id]
+	if !exists {
+		i, exists = v.index[id]
+	}
+	if !exists {
+		return 0, false
+	}
+	if tab := v.at(i); tab == nil || tab.ID != id {
+		return 0, false
+	}
+	return i, true
+}
+
+// foldIndex returns a new index holding the live entries of index and added.
+func (v *tabsView) foldIndex() map[string]int {
+	index := make(map[string]int, v.count+1)
+	for _, m := range []map[string]int{v.index, v.added} {
+		for id, i := range m {
+			if tab := v.at(i); tab != nil && tab.ID == id {
+				index[id] = i
+			}
+		}
+	}
+	return index
+}
+
+// cursor returns an opaque list cursor positioned after the given tab.
+// It records the tab's slot so paging can continue after the tab is
+// removed, and its ID to find it again once slots are renumbered.
+func (v *tabsView) cursor(id string) string {
+	slot, _ := v.slot(id)
+	raw := fmt.Sprintf("%s.%d.%d.%s", v.epoch, v.orderEpoch, slot, id)
+	return base64.RawURLEncoding.EncodeToString([]byte(raw))
+}
+
+// resolveCursor returns the slot at which the page after cursor starts.
+func (v *tabsView) resolveCursor(cursor string) (int, error) {
+	raw, err := base64.RawURLEncoding.DecodeString(cursor)
+	if err != nil {
+		return 0, ErrInvalidCursor
+	}
+	parts := strings.SplitN(string(raw), ".", 4)
+	if len(parts) != 4 {
+		return 0, ErrInvalidCursor
+	}
+	orderEpoch, err1 := strconv.ParseUint(parts[1], 10, 64)
+	slot, err2 := strconv.Atoi(parts[2])
+	if err1 != nil || err2 != nil || slot < 0 {
+		return 0, ErrInvalidCursor
+	}
+	id := parts[3]
+
+	if parts[0] == v.epoch && orderEpoch == v.orderEpoch {
+		// Same numbering: a removed tab leaves a hole, and a slot freed at
+		// the end may since hold a newer tab, which belongs on this page
+		if tab := v.at(slot); tab != nil && tab.ID != id {
+			return slot, nil
+		}
+		return slot + 1, nil
+	}
+	if i, exists := v.slot(id); exists {
+		return i + 1, nil
+	}
+	return 0, ErrInvalidCursor
+}
+
+// listETag returns the entity tag of the tab list in this view.
+func (v *tabsView) listETag() string {
+	return fmt.Sprintf(`"%s-%d"`, v.epoch, v.generation)
+}
+
+// newAccessClock returns the shared last-access clock for a new stored tab.
+func newAccessClock() *atomic.Int64 {
+	return new(atomic.Int64)
+}
+
+// frozenCopy returns an immutable copy of a stored tab for publishing.
+func frozenCopy(tab *Tab) *Tab {
+	frozen := *tab
+	frozen.Content = ""
+	frozen.Active = false
+	return &frozen
+}
+
+// publishLocked rebuilds and publishes the view, including its index.
+// Tabs unchanged since the previous view keep their frozen copies.
+// Caller must hold the write lock.
+func (s *State) publishLocked() {
+	prev := s.view.Load()
+	next := s.nextViewLocked(prev)
+	next.chunks = make([][]*Tab, (next.size+viewChunkSize-1)/viewChunkSize)
+	next.index = make(map[string]int, s.order.Len())
+	next.added = nil
+	for c := range next.chunks {
+		chunk := make([]*Tab, min(viewChunkSize, next.size-c*viewChunkSize))
+		for j := range chunk {
+			i := c*viewChunkSize + j
+			id := s.order.At(i)
+			if id == "" {
+				continue
+			}
+			tab := s.tabs[id]
+			if old, exists := prev.lookup(id); exists && sameFrozen(old, tab) {
+				chunk[j] = old
+			} else {
+				chunk[j] = frozenCopy(tab)
+			}
+			next.index[id] = i
+		}
+		next.chunks[c] = chunk
+	}
+	s.view.Store(next)
+}
+
+// publishTabLocked publishes a view in which one tab was added or changed.
+// An appended tab goes into the overlay index, which is folded into a new
+// full index once copying it would cost more than an amortized fold.
+// Falls back to a full rebuild if the previous view does not line up.
+// Caller must hold the write lock.
+func (s *State) publishTabLocked(tab *Tab) {
+	prev := s.view.Load()
+	i, exists := s.order.Slot(tab.ID)
+	if !exists || s.tabs[tab.ID] != tab || !s.lineUpLocked(prev) {
+		s.publishLocked()
+		return
+	}
+
+	next := s.nextViewLocked(prev)
+	if at, ok := prev.slot(tab.ID); !ok || at != i {
+		// Newly appended
+		if len(prev.added) >= overlayLimit(s.order.Len()) {
+			next.index = prev.foldIndex()
+			next.added = nil
+			next.index[tab.ID] = i
+		} else {
+			next.added = make(map[string]int, len(prev.added)+1)
+			for id, slot := range prev.added {
+				next.added[id] = slot
+			}
+			next.added[tab.ID] = i
+		}
+	}
+	next.chunks = setSlot(prev.chunks, next.size, i, frozenCopy(tab))
+	s.view.Store(next)
+}
+
+// publishRemoveLocked publishes a view without a removed tab.
+// Caller must hold the write lock.
+func (s *State) publishRemoveLocked(id string) {
+	prev := s.view.Load()
+	i, exists := prev.slot(id)
+	if !exists || !s.lineUpLocked(prev) {
+		s.publishLocked()
+		return
+	}
+
+	next := s.nextViewLocked(prev)
+	next.chunks = setSlot(prev.chunks, next.size, i, nil)
+	s.view.Store(next)
+}
+
+// publishActiveLocked publishes a view in which only the active tab changed.
+// Caller must hold the write lock.
+func (s *State) publishActiveLocked() {
+	prev := s.view.Load()
+	if !s.lineUpLocked(prev) {
+		s.publishLocked()
+		return
+	}
+	s.view.Store(s.nextViewLocked(prev))
+}
+
+// nextViewLocked returns a copy of prev with the current slot count, tab
+// count, active tab, closed count and generation. Caller must hold the write lock.
+func (s *State) nextViewLocked(prev *tabsView) *tabsView {
+	next := *prev
+	next.size = s.order.Slots()
+	next.count = s.order.Len()
+	next.orderEpoch = s.order.epoch
+	next.activeID = s.activeID
+	next.closed = len(s.closedTabs)
+	next.generation = s.generation
+	next.epoch = s.epoch
+	return &next
+}
+
+// lineUpLocked reports whether prev's slots match the current order, so a
+// single change can be applied to a copy of them. Caller must hold the lock.
+func (s *State) lineUpLocked(prev *tabsView) bool {
+	return prev.orderEpoch == s.order.epoch && prev.index != nil
+}
+
+// overlayLimit returns the overlay index size at which publishing folds it
+// into the full index. Folding costs O(n) and copying the overlay O(limit)
+// per append, so about sqrt(2n) balances the two.
+func overlayLimit(n int) int {
+	return max(minCompactSlots, int(math.Sqrt(float64(2*n))))
+}
+
+// setSlot returns chunks resized to size slots with slot i set to tab,
+// copying only the chunks that change.
+func setSlot(chunks [][]*Tab, size, i int, tab *Tab) [][]*Tab {
+	next := make([][]*Tab, (size+viewChunkSize-1)/viewChunkSize)
+	copy(next, chunks)
+	if len(next) > 0 {
+		last := len(next) - 1
+		if want := size - last*viewChunkSize; len(next[last]) != want {
+			resized := make([]*Tab, want)
+			copy(resized, next[last])
+			next[last] = resized
+		}
+	}
+	if i < size {
+		c := i / viewChunkSize
+		chunk := make([]*Tab, len(next[c]))
+		copy(chunk, next[c])
+		chunk[i%viewChunkSize] = tab
+		next[c] = chunk
+	}
+	return next
+}
+
+// sameFrozen reports whether a frozen copy still matches a stored tab.
+// Every visible change bumps the version; blob drops do not, so the blob
+// and dropped flag are compared too.
+func sameFrozen(frozen, tab *Tab) bool {
+	return frozen.Version == tab.Version &&
+		frozen.CreatedAt.Equal(tab.CreatedAt) &&
+		frozen.blob == tab.blob &&
+		frozen.dropped == tab.dropped
+}
@@ -0,0 +1,495 @@
+// Package main provides the event sources behind FileWatcher: fsnotify, and
+// stat polling for filesystems where fsnotify sees no changes.
+package main
+
+import (
+	"errors"
+	"fmt"
+	"os"
+	"path/filepath"
+	"sync"
+	"sync/atomic"
+	"syscall"
+	"time"
+
+	"github.com/fsnotify/fsnotify"
+)
+
+// File watcher backends, chosen with serve --watch-backend.
+const (
+	// WatchBackendAuto uses fsnotify, and polls files it cannot watch:
+	// those on network filesystems, those whose watch could not be added,
+	// or all of them if fsnotify is unavailable.
+	WatchBackendAuto = "auto"
+	// WatchBackendFsnotify uses only fsnotify (inotify, FSEvents, ...).
+	WatchBackendFsnotify = "fsnotify"
+	// WatchBackendPoll polls every watched file with stat.
+	WatchBackendPoll = "poll"
+)
+
+const (
+	// minPollInterval is how often a recently changed file is polled.
+	minPollInterval = 250 * time.Millisecond
+	// maxPollInterval is how often a file that has not changed for a while
+	// is polled. Each unchanged poll doubles a file's interval up to this.
+	maxPollInterval = 4 * time.Second
+	// maxPollWorkers caps concurrent stat calls in a polling round.
+	maxPollWorkers = 8
+)
+
+// watchBackend reports possible changes of individual watched files to a
+// FileWatcher, which checks what actually changed (see FileWatcher.settle).
+// Implementations are safe for concurrent use.
+type watchBackend interface {
+	// Add starts watching a file; Remove stops.
+	Add(path string) error
+	Remove(path string)
+	// Changes delivers paths of watched files that may have been written,
+	// created, removed or renamed.
+	Changes() <-chan string
+	// Errors delivers errors the backend recovered from.
+	Errors() <-chan error
+	// Stats fills in the backend's fields of stats.
+	Stats(stats *WatchStats)
+	Close() error
+}
+
+// newWatchBackend creates the named backend.
+func newWatchBackend(kind string) (watchBackend, error) {
+	changes := make(chan string, 256)
+	switch kind {
+	case WatchBackendAuto, "":
+		notify, err := newFsnotifyBackend(changes)
+		if err != nil {
+			notify = nil // Poll everything
+		}
+		return &autoBackend{notify: notify, poll: newPollBackend(changes), polled: make(map[string]bool), changes: changes}, nil
+	case WatchBackendFsnotify:
+		return newFsnotifyBackend(changes)
+	case WatchBackendPoll:
+		return newPollBackend(changes), nil
+	}
+	return nil, fmt.Errorf("unknown watch backend %q (want %s, %s or %s)", kind, WatchBackendAuto, WatchBackendFsnotify, WatchBackendPoll)
+}
+
+// fsnotifyBackend watches files through their parent directory, so all
+// files in a directory share one fsnotify watch, and events for other
+// files in it are ignored. A symlink is also watched through its target's
+// directory, since writes through the link are reported on the target.
+type fsnotifyBackend struct {
+	watcher *fsnotify.Watcher
+	changes chan string
+	done    chan struct{}
+
+	mu sync.Mutex
+	// files maps each watched file to the names its events arrive under:
+	// its path, and its symlink target's if it is a symlink.
+	files map[string][]string
+	// names maps each such name back to the watched files it stands for.
+	names map[string][]string
+	// dirs counts the watched names in each directory holding a watch.
+	dirs map[string]int
+	// failed counts directories that could not be watched.
+	failed int64
+}
+
+// newFsnotifyBackend starts an fsnotify watcher reporting to changes.
+func newFsnotifyBackend(changes chan string) (*fsnotifyBackend, error) {
+	watcher, err := fsnotify.NewWatcher()
+	if err != nil {
+		return nil, err
+	}
+	b := &fsnotifyBackend{
+		watcher: watcher,
+		changes: changes,
+		done:    make(chan struct{}),
+		files:   make(map[string][]string),
+		names:   make(map[string][]string),
+		dirs:    make(map[string]int),
+	}
+	go b.run()
+	return b, nil
+}
+
+// run forwards the events of watched files until Close.
+func (b *fsnotifyBackend) run() {
+	for {
+		select {
+		case <-b.done:
+			return
+		case event, ok := <-b.watcher.Events:
+			if !ok {
+				return
+			}
+			for _, path := range b.affected(event) {
+				select {
+				case b.changes <- path:
+				case <-b.done:
+					return
+				}
+			}
+		}
+	}
+}
+
+// affected returns the watched files an event may have changed.
+func (b *fsnotifyBackend) affected(event fsnotify.Event) []string {
+	if event.Op&(fsnotify.Write|fsnotify.Create|fsnotify.Remove|fsnotify.Rename) == 0 {
+		return nil
+	}
+
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	if paths := b.names[event.Name]; len(paths) > 0 {
+		return append([]string(nil), paths...)
+	}
+	var affected []string
+	if event.Op&(fsnotify.Remove|fsnotify.Rename) != 0 && b.dirs[event.Name] > 0 {
+		// A watched directory went away, taking its files with it
+		for name, paths := range b.names {
+			if filepath.Dir(name) == event.Name {
+				affected = append(affected, paths...)
+			}
+		}
+	}
+	return affected
+}
+
+// Add counts one more watched file in its directory, adding a watch on
+// the directory for the first. A symlink is counted in its target's
+// directory too.
+func (b *fsnotifyBackend) Add(path string) error {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	if _, exists := b.files[path]; exists {
+		return nil
+	}
+	names := []string{path}
+	if target := symlinkTarget(path); target != "" {
+		names = append(names, target)
+	}
+	for i, name := range names {
+		if err := b.watchDirLocked(filepath.Dir(name)); err != nil {
+			for _, added := range names[:i] {
+				b.unwatchDirLocked(filepath.Dir(added))
+			}
+			return err
+		}
+	}
+	for _, name := range names {
+		b.names[name] = append(b.names[name], path)
+	}
+	b.files[path] = names
+	return nil
+}
+
+// Remove counts one less watched file in its directories, removing a
+// directory's watch after the last.
+func (b *fsnotifyBackend) Remove(path string) {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	names, exists := b.files[path]
+	if !exists {
+		return
+	}
+	delete(b.files, path)
+	for _, name := range names {
+		paths := b.names[name]
+		for i, p := range paths {
+			if p == path {
+				paths = append(paths[:i], paths[i+1:]...)
+				break
+			}
+		}
+		if len(paths) == 0 {
+			delete(b.names, name)
+		} else {
+			b.names[name] = paths
+		}
+		b.unwatchDirLocked(filepath.Dir(name))
+	}
+}
+
+// watchDirLocked counts one more watched name in dir, adding a watch on it
+// for the first. Caller must hold b.mu.
+func (b *fsnotifyBackend) watchDirLocked(dir string) error {
+	if b.dirs[dir] == 0 {
+		if err := b.watcher.Add(dir); err != nil {
+			b.failed++
+			if errors.Is(err, syscall.ENOSPC) {
+				return fmt.Errorf("%w: out of inotify watches with %d directories watched (raise fs.inotify.max_user_watches)", err, len(b.dirs))
+			}
+			return err
+		}
+	}
+	b.dirs[dir]++
+	return nil
+}
+
+// unwatchDirLocked counts one less watched name in dir, removing its watch
+// after the last. Caller must hold b.mu.
+func (b *fsnotifyBackend) unwatchDirLocked(dir string) {
+	b.dirs[dir]--
+	if b.dirs[dir] <= 0 {
+		delete(b.dirs, dir)
+		b.watcher.Remove(dir)
+	}
+}
+
+// symlinkTarget returns the name that writes through a symlink at path are
+// reported under, or "" if path is not a symlink or cannot be resolved. A
+// target in the link's own directory, which may be reached through another
+// name for it, is named through the link's directory: that one is watched
+// already, and watching one directory under two names confuses fsnotify.
+func symlinkTarget(path string) string {
+	if info, err := os.Lstat(path); err != nil || info.Mode()&os.ModeSymlink == 0 {
+		return ""
+	}
+	target, err := filepath.EvalSymlinks(path)
+	if err != nil {
+		return ""
+	}
+	dir := filepath.Dir(path)
+	if linkDir, err := os.Stat(dir); err == nil {
+		if targetDir, err := os.Stat(filepath.Dir(target)); err == nil && os.SameFile(linkDir, targetDir) {
+			target = filepath.Join(dir, filepath.Base(target))
+		}
+	}
+	if target == path {
+		return ""
+	}
+	return target
+}
+
+// Changes returns the channel of possibly changed files.
+func (b *fsnotifyBackend) Changes() <-chan string { return b.changes }
+
+// Errors returns fsnotify's error channel.
+func (b *fsnotifyBackend) Errors() <-chan error { return b.watcher.Errors }
+
+// Stats reports the directory watches and the system limit.
+func (b *fsnotifyBackend) Stats(stats *WatchStats) {
+	b.mu.Lock()
+	stats.Directories += len(b.dirs)
+	stats.Failed += b.failed
+	b.mu.Unlock()
+	stats.Limit = inotifyWatchLimit()
+}
+
+// Close stops the fsnotify watcher.
+func (b *fsnotifyBackend) Close() error {
+	close(b.done)
+	return b.watcher.Close()
+}
+
+// polledFile is what a pollBackend knows about a watched file.
+type polledFile struct {
+	info     os.FileInfo // Nil while the file is missing
+	interval time.Duration
+	next     time.Time // When the file is next due
+}
+
+// pollBackend detects changes by comparing each watched file's stat result
+// with the previous one. Files are polled at adaptive intervals: every
+// minPollInterval after a change, backing off to maxPollInterval while they
+// stay unchanged. Each round stats the files that are due on a small worker
+// pool, so a large, mostly idle set of files costs few stat calls.
+type pollBackend struct {
+	changes chan string
+	done    chan struct{}
+
+	mu    sync.Mutex
+	files map[string]*polledFile
+
+	rounds, stats atomic.Int64
+}
+
+// newPollBackend starts polling, reporting to changes.
+func newPollBackend(changes chan string) *pollBackend {
+	b := &pollBackend{
+		changes: changes,
+		done:    make(chan struct{}),
+		files:   make(map[string]*polledFile),
+	}
+	go b.run()
+	return b
+}
+
+// run polls until Close.
+func (b *pollBackend) run() {
+	ticker := time.NewTicker(minPollInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-b.done:
+			return
+		case now := <-ticker.C:
+			for _, path := range b.poll(now) {
+				select {
+				case b.changes <- path:
+				case <-b.done:
+					return
+				}
+			}
+		}
+	}
+}
+
+// poll stats the files due at now and returns those that changed.
+func (b *pollBackend) poll(now time.Time) []string {
+	b.mu.Lock()
+	var due []string
+	for path, f := range b.files {
+		if !f.next.After(now) {
+			due = append(due, path)
+		}
+	}
+	b.mu.Unlock()
+	if len(due) == 0 {
+		return nil
+	}
+
+	infos := make([]os.FileInfo, len(due))
+	parallelFor(len(due), maxPollWorkers, func(i int) {
+		infos[i], _ = os.Stat(due[i]) // Nil if missing
+	})
+	b.rounds.Add(1)
+	b.stats.Add(int64(len(due)))
+
+	var changed []string
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	for i, path := range due {
+		f := b.files[path]
+		if f == nil {
+			continue // Removed during the round
+		}
+		if sameStat(f.info, infos[i]) {
+			f.interval *= 2
+			if f.interval > maxPollInterval {
+				f.interval = maxPollInterval
+			}
+		} else {
+			f.interval = minPollInterval
+			changed = append(changed, path)
+		}
+		f.info = infos[i]
+		f.next = now.Add(f.interval)
+	}
+	return changed
+}
+
+// sameStat reports whether two stat results (nil for a missing file)
+// describe the same version of a file.
+func sameStat(a, b os.FileInfo) bool {
+	if a == nil || b == nil {
+		return a == nil && b == nil
+	}
+	return os.SameFile(a, b) && a.Size() == b.Size() && a.ModTime().Equal(b.ModTime())
+}
+
+// Add starts polling a file.
+func (b *pollBackend) Add(path string) error {
+	info, _ := os.Stat(path)
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	if _, exists := b.files[path]; !exists {
+		b.files[path] = &polledFile{info: info, interval: minPollInterval, next: time.Now().Add(minPollInterval)}
+	}
+	return nil
+}
+
+// Remove stops polling a file.
+func (b *pollBackend) Remove(path string) {
+	b.mu.Lock()
+	delete(b.files, path)
+	b.mu.Unlock()
+}
+
+// Changes returns the channel of possibly changed files.
+func (b *pollBackend) Changes() <-chan string { return b.changes }
+
+// Errors returns nil: polling has no errors to report beyond missing files.
+func (b *pollBackend) Errors() <-chan error { return nil }
+
+// Stats reports the polled files and the work done polling them.
+func (b *pollBackend) Stats(stats *WatchStats) {
+	b.mu.Lock()
+	stats.Polled += len(b.files)
+	b.mu.Unlock()
+	stats.PollRounds += b.rounds.Load()
+	stats.PollStats += b.stats.Load()
+}
+
+// Close stops polling.
+func (b *pollBackend) Close() error {
+	close(b.done)
+	return nil
+}
+
+// autoBackend watches files with fsnotify where it works and polls the
+// rest. Both report to the same channel.
+type autoBackend struct {
+	notify  *fsnotifyBackend // Nil if fsnotify could not start
+	poll    *pollBackend
+	changes chan string
+
+	mu     sync.Mutex
+	polled map[string]bool
+}
+
+// Add watches a file with fsnotify, or polls it if it is on a network
+// filesystem (whose remote changes fsnotify does not see) or fsnotify
+// cannot watch it, for example because the inotify limit was reached.
+func (b *autoBackend) Add(path string) error {
+	if b.notify != nil && !isRemoteFS(filepath.Dir(path)) {
+		if err := b.notify.Add(path); err == nil {
+			return nil
+		}
+	}
+	b.mu.Lock()
+	b.polled[path] = true
+	b.mu.Unlock()
+	return b.poll.Add(path)
+}
+
+// Remove stops watching or polling a file.
+func (b *autoBackend) Remove(path string) {
+	b.mu.Lock()
+	polled := b.polled[path]
+	delete(b.polled, path)
+	b.mu.Unlock()
+	if polled {
+		b.poll.Remove(path)
+	} else if b.notify != nil {
+		b.notify.Remove(path)
+	}
+}
+
+// Changes returns the channel both backends report to.
+func (b *autoBackend) Changes() <-chan string { return b.changes }
+
+// Errors returns fsnotify's errors, if it is running.
+func (b *autoBackend) Errors() <-chan error {
+	if b.notify == nil {
+		return nil
+	}
+	return b.notify.Errors()
+}
+
+// Stats reports both backends.
+func (b *autoBackend) Stats(stats *WatchStats) {
+	if b.notify != nil {
+		b.notify.Stats(stats)
+	}
+	b.poll.Stats(stats)
+}
+
+// Close stops both backends.
+func (b *autoBackend) Close() error {
+	b.poll.Close()
+	if b.notify != nil {
+		return b.notify.Close()
+	}
+	return nil
+}
@@ -0,0 +1,28 @@
+// Package main provides detection of network filesystems on Linux, whose
+// remote changes inotify does not report.
+package main
+
+import "syscall"
+
+// Filesystem magic numbers (statfs f_type) of network and FUSE filesystems.
+// FUSE covers Docker Desktop's file sharing, sshfs and virtiofs; 9P covers
+// WSL2 Windows drives.
+var remoteFSTypes = map[uint32]bool{
+	0x6969:     true, // NFS
+	0x517b:     true, // SMB
+	0xfe534d42: true, // SMB2
+	0xff534d42: true, // CIFS
+	0x65735546: true, // FUSE
+	0x01021997: true, // 9P
+	0x00c36400: true, // Ceph
+	0x5346414f: true, // AFS
+}
+
+// isRemoteFS reports whether dir is on a network or FUSE filesystem.
+func isRemoteFS(dir string) bool {
+	var fs syscall.Statfs_t
+	if err := syscall.Statfs(dir, &fs); err != nil {
+		return false
+	}
+	return remoteFSTypes[uint32(fs.Type)] // Type is 32 or 64 bits wide depending on the platform
+}
@@ -0,0 +1,11 @@
+//go:build !linux
+
+// Package main provides network filesystem detection where it is not
+// implemented.
+package main
+
+// isRemoteFS reports false: outside Linux, every directory is watched with
+// fsnotify unless adding the watch fails.
+func isRemoteFS(dir string) bool {
+	return false
+}
@@ -0,0 +1,254 @@
+package main
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/fsnotify/fsnotify"
+)
+
+// TestPollBackend_AdaptiveInterval tests that an unchanged file is polled
+// less and less often, and that a change or deletion is reported and
+// brings the file back to the shortest interval.
+func TestPollBackend_AdaptiveInterval(t *testing.T) {
+	b := newPollBackend(make(chan string, 1))
+	b.Close() // Rounds are driven by hand below
+
+	path := createTempFile(t, "v1")
+	if err := b.Add(path); err != nil {
+		t.Fatalf("Add failed: %v", err)
+	}
+	now := time.Now()
+
+	// Back off while unchanged, up to maxPollInterval
+	for want := 2 * minPollInterval; ; want *= 2 {
+		if want > maxPollInterval {
+			want = maxPollInterval
+		}
+		now = now.Add(maxPollInterval)
+		if changed := b.poll(now); len(changed) != 0 {
+			t.Fatalf("expected no change, got %v", changed)
+		}
+		if got := b.files[path].interval; got != want {
+			t.Fatalf("expected interval %v, got %v", want, got)
+		}
+		if want == maxPollInterval {
+			break
+		}
+	}
+	stats := b.stats.Load()
+	if changed := b.poll(now.Add(time.Second)); changed != nil || b.stats.Load() != stats {
+		t.Errorf("expected a file that is not due to be skipped, got %v", changed)
+	}
+
+	if err := os.WriteFile(path, []byte("version 2"), 0644); err != nil {
+		t.Fatal(err)
+	}
+	now = now.Add(maxPollInterval)
+	if changed := b.poll(now); len(changed) != 1 || changed[0] != path {
+		t.Errorf("expected the change to be reported, got %v", changed)
+	}
+	if got := b.files[path].interval; got != minPollInterval {
+		t.Errorf("expected the interval to reset to %v, got %v", minPollInterval, got)
+	}
+
+	if err := os.Remove(path); err != nil {
+		t.Fatal(err)
+	}
+	if changed := b.poll(now.Add(maxPollInterval)); len(changed) != 1 {
+		t.Errorf("expected the deletion to be reported, got %v", changed)
+	}
+}
+
+// TestFileWatcherPollBackend tests that a watcher using the poll backend
+// reports changes to watched files.
+func TestFileWatcherPollBackend(t *testing.T) {
+	changes := make(chan string, 10)
+	fw, err := NewFileWatcherWithBackend(WatchBackendPoll, FileWatcherCallbacks{
+		OnChange: func(path string, tabIDs []string) { changes <- path },
+	})
+	if err != nil {
+		t.Fatalf("NewFileWatcherWithBackend failed: %v", err)
+	}
+	defer fw.Stop()
+	go fw.Run()
+
+	path := createTempFile(t, "initial content")
+	if err := fw.Add(path, "tab1"); err != nil {
+		t.Fatalf("Add failed: %v", err)
+	}
+	if err := os.WriteFile(path, []byte("polled content"), 0644); err != nil {
+		t.Fatal(err)
+	}
+	select {
+	case got := <-changes:
+		if got != path {
+			t.Errorf("expected a change of %s, got %s", path, got)
+		}
+	case <-time.After(2 * time.Second):
+		t.Fatal("timeout waiting for change callback")
+	}
+
+	stats := fw.Stats()
+	if stats.Backend != WatchBackendPoll || stats.Polled != 1 || stats.Directories != 0 || stats.PollStats == 0 {
+		t.Errorf("expected one polled file, got %+v", stats)
+	}
+}
+
+// TestAutoBackend_FallsBackToPolling tests that the auto backend polls
+// files when fsnotify is unavailable, and that unknown backends are rejected.
+func TestAutoBackend_FallsBackToPolling(t *testing.T) {
+	changes := make(chan string, 1)
+	b := &autoBackend{poll: newPollBackend(changes), polled: make(map[string]bool), changes: changes}
+	defer b.Close()
+
+	path := createTempFile(t, "content")
+	if err := b.Add(path); err != nil {
+		t.Fatalf("Add failed: %v", err)
+	}
+	var stats WatchStats
+	b.Stats(&stats)
+	if stats.Polled != 1 {
+		t.Errorf("expected the file to be polled, got %+v", stats)
+	}
+	b.Remove(path)
+	stats = WatchStats{}
+	b.Stats(&stats)
+	if stats.Polled != 0 {
+		t.Errorf("expected no polled files after Remove, got %+v", stats)
+	}
+
+	if _, err := NewFileWatcherWithBackend("kqueue", FileWatcherCallbacks{}); err == nil {
+		t.Error("expected an unknown backend to be rejected")
+	}
+}
+
+// TestFsnotifyBackend_FollowsSymlink tests that a symlinked file is
+// reported when its target, in another directory, is written, and that
+// Remove drops the target directory's watch.
+func TestFsnotifyBackend_FollowsSymlink(t *testing.T) {
+	root := t.TempDir()
+	for _, dir := range []string{"links", "files"} {
+		if err := os.Mkdir(filepath.Join(root, dir), 0755); err != nil {
+			t.Fatal(err)
+		}
+	}
+	target := filepath.Join(root, "files", "notes.md")
+	link := filepath.Join(root, "links", "notes.md")
+	if err := os.WriteFile(target, []byte("before"), 0644); err != nil {
+		t.Fatal(err)
+	}
+	if err := os.Symlink(target, link); err != nil {
+		t.Skipf("symlinks not supported: %v", err)
+	}
+	resolved, err := filepath.EvalSymlinks(target)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	changes := make(chan string, 16)
+	b, err := newFsnotifyBackend(changes)
+	if err != nil {
+		t.Skipf("fsnotify unavailable: %v", err)
+	}
+	defer b.Close()
+	if err := b.Add(link); err != nil {
+		t.Fatalf("Add failed: %v", err)
+	}
+	if got := b.affected(fsnotify.Event{Name: resolved, Op: fsnotify.Write}); len(got) != 1 || got[0] != link {
+		t.Errorf("expected a write to the target to affect the link, got %v", got)
+	}
+
+	time.Sleep(50 * time.Millisecond)
+	if err := os.WriteFile(target, []byte("after!"), 0644); err != nil {
+		t.Fatal(err)
+	}
+	timeout := time.After(2 * time.Second)
+	for reported := false; !reported; {
+		select {
+		case path := <-changes:
+			reported = path == link
+		case <-timeout:
+			t.Fatal("timed out waiting for the link to be reported")
+		}
+	}
+
+	b.Remove(link)
+	var stats WatchStats
+	b.Stats(&stats)
+	if stats.Directories != 0 || len(b.names) != 0 {
+		t.Errorf("expected no watches after Remove, got %d directories, names %v", stats.Directories, b.names)
+	}
+}
+
+// createWatchedFiles creates n files spread over directories of 100.
+func createWatchedFiles(b *testing.B, n int) []string {
+	b.Helper()
+	root := b.TempDir()
+	paths := make([]string, n)
+	for i := range paths {
+		dir := filepath.Join(root, fmt.Sprintf("d%03d", i/100))
+		if i%100 == 0 {
+			if err := os.Mkdir(dir, 0755); err != nil {
+				b.Fatal(err)
+			}
+		}
+		paths[i] = filepath.Join(dir, fmt.Sprintf("f%02d.go", i%100))
+		if err := os.WriteFile(paths[i], []byte("package f\n"), 0644); err != nil {
+			b.Fatal(err)
+		}
+	}
+	return paths
+}
+
+// BenchmarkPollRound measures the CPU cost of polling 10,000 idle files.
+// ns/file is the cost of one stat round per file; idle files are polled
+// every maxPollInterval, so ns/file/s is the steady-state cost per file
+// per second of watching.
+func BenchmarkPollRound(b *testing.B) {
+	paths := createWatchedFiles(b, 10000)
+	p := newPollBackend(make(chan string, 1))
+	p.Close()
+	for _, path := range paths {
+		p.Add(path)
+	}
+
+	now := time.Now()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		now = now.Add(2 * maxPollInterval) // Every file is due
+		if changed := p.poll(now); len(changed) != 0 {
+			b.Fatalf("expected idle files, got %d changes", len(changed))
+		}
+	}
+	perFile := float64(b.Elapsed().Nanoseconds()) / float64(b.N) / float64(len(paths))
+	b.ReportMetric(perFile, "ns/file")
+	b.ReportMetric(perFile/maxPollInterval.Seconds(), "ns/file/s")
+}
+
+// BenchmarkWatchAdd measures adding and removing a watched file with each
+// backend. An idle fsnotify watch costs no CPU after this.
+func BenchmarkWatchAdd(b *testing.B) {
+	for _, kind := range []string{WatchBackendFsnotify, WatchBackendPoll} {
+		b.Run(kind, func(b *testing.B) {
+			paths := createWatchedFiles(b, 1000)
+			backend, err := newWatchBackend(kind)
+			if err != nil {
+				b.Skipf("%s unavailable: %v", kind, err)
+			}
+			defer backend.Close()
+
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				path := paths[i%len(paths)]
+				if err := backend.Add(path); err != nil {
+					b.Fatal(err)
+				}
+				backend.Remove(path)
+			}
+		})
+	}
+}
@@ -2,21 +2,47 @@
 package main
 
 import (
+	"hash/maphash"
+	"io"
 	"log"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
 	"sync"
+	"sync/atomic"
 	"time"
-
-	"github.com/fsnotify/fsnotify"
 )
 
-// debounceDelay is how long to wait after a file event before notifying.
-// This handles editors that write multiple times in quick succession.
+// debounceDelay is how long events must stop before the files they affect
+// are checked. This handles editors that write multiple times in quick
+// succession, and groups the changes of a git checkout or code generator
+// into one batch.
 const debounceDelay = 150 * time.Millisecond
 
+// maxBatchWait is the longest a file event waits for a batch to be checked,
+// so files written continuously are still reported.
+const maxBatchWait = time.Second
+
+// maxSettleWorkers caps concurrent checks of the files in a batch.
+const maxSettleWorkers = 16
+
+// maxFingerprintBytes is the largest file whose content is hashed to tell a
+// touched file from a changed one. Larger files are compared by size and
+// modification time only.
+const maxFingerprintBytes = 16 << 20 // 16 MiB
+
+// inotifyWatchLimitFile holds the per-user limit on inotify watches (Linux).
+const inotifyWatchLimitFile = "/proc/sys/fs/inotify/max_user_watches"
+
 // FileWatcher watches files for changes and notifies when they are modified.
+// Possible changes come from a backend (see watchBackend); the watcher
+// batches them, checks which files really changed and reports those.
 // It is safe for concurrent use.
 type FileWatcher struct {
-	watcher *fsnotify.Watcher
+	backend watchBackend
+	kind    string // Backend name, e.g. WatchBackendAuto
 
 	mu sync.RWMutex
 	// pathToTabs maps absolute file paths to sets of tab IDs watching that path.
@@ -25,9 +51,15 @@ type FileWatcher struct {
 	// tabToPath maps tab IDs to the file path they are watching.
 	// Each tab watches at most one file.
 	tabToPath map[string]string
-	// pendingEvents tracks debounce timers for each path.
-	// Only accessed from Run() goroutine, no lock needed.
-	pendingEvents map[string]*time.Timer
+	// prints holds the last seen fingerprint of each watched path, to skip
+	// events that leave the file's content as it was.
+	prints map[string]*fileFingerprint
+	// seed keys the content hashes in prints.
+	seed maphash.Seed
+	// delivered and suppressed count settled changes that were reported
+	// and that were skipped as unchanged; hashes counts content hashes and
+	// batches the batches checked.
+	delivered, suppressed, hashes, batches atomic.Int64
 
 	// onChange is called when a watched file changes.
 	// Arguments are the file path and a list of tab IDs watching it.
@@ -37,6 +69,10 @@ type FileWatcher struct {
 	// Arguments are the file path and a list of tab IDs that were watching it.
 	onDelete func(path string, tabIDs []string)
 
+	// onBatch, if set, is called with each batch's events instead of
+	// onChange and onDelete.
+	onBatch func(events []FileEvent)
+
 	// done signals shutdown
 	done chan struct{}
 }
@@ -47,6 +83,16 @@ type FileWatcherCallbacks struct {
 	OnChange func(path string, tabIDs []string)
 	// OnDelete is called when a watched file is deleted or renamed.
 	OnDelete func(path string, tabIDs []string)
+	// OnBatch, if set, is called once per batch with all of its events, in
+	// path order, instead of OnChange and OnDelete.
+	OnBatch func(events []FileEvent)
+}
+
+// FileEvent is a settled change of a watched file.
+type FileEvent struct {
+	Path    string
+	TabIDs  []string // Tabs watching the file
+	Deleted bool     // The file no longer exists
 }
 
 // NewFileWatcher creates a new FileWatcher.
@@ -55,50 +101,108 @@ func NewFileWatcher(onChange func(path string, tabIDs []string)) (*FileWatcher,
 	return NewFileWatcherWithCallbacks(FileWatcherCallbacks{OnChange: onChange})
 }
 
-// NewFileWatcherWithCallbacks creates a new FileWatcher with full callbacks.
+// NewFileWatcherWithCallbacks creates a new FileWatcher with full callbacks,
+// using the auto backend.
 func NewFileWatcherWithCallbacks(callbacks FileWatcherCallbacks) (*FileWatcher, error) {
-	watcher, err := fsnotify.NewWatcher()
+	return NewFileWatcherWithBackend(WatchBackendAuto, callbacks)
+}
+
+// NewFileWatcherWithBackend creates a new FileWatcher using the named
+// backend: WatchBackendAuto, WatchBackendFsnotify or WatchBackendPoll.
+func NewFileWatcherWithBackend(kind string, callbacks FileWatcherCallbacks) (*FileWatcher, error) {
+	if kind == "" {
+		kind = WatchBackendAuto
+	}
+	backend, err := newWatchBackend(kind)
 	if err != nil {
 		return nil, err
 	}
 
 	return &FileWatcher{
-		watcher:       watcher,
-		pathToTabs:    make(map[string]map[string]bool),
-		tabToPath:     make(map[string]string),
-		pendingEvents: make(map[string]*time.Timer),
-		onChange:      callbacks.OnChange,
-		onDelete:      callbacks.OnDelete,
-		done:          make(chan struct{}),
+		backend:    backend,
+		kind:       kind,
+		pathToTabs: make(map[string]map[string]bool),
+		tabToPath:  make(map[string]string),
+		prints:     make(map[string]*fileFingerprint),
+		seed:       maphash.MakeSeed(),
+		onChange:   callbacks.OnChange,
+		onDelete:   callbacks.OnDelete,
+		onBatch:    callbacks.OnBatch,
+		done:       make(chan struct{}),
 	}, nil
 }
 
 // Run starts the file watcher event loop.
 // This should be called in a goroutine. It blocks until Stop() is called.
+//
+// Affected files are collected into a batch until events stop for
+// debounceDelay, or the oldest has waited maxBatchWait. The batch is then
+// checked in the background (see settleBatch) while the next one collects;
+// batches are checked one at a time, so their reports stay in order. A
+// removed or renamed file only counts as deleted if it is still missing
+// then, so editors that save by renaming a new file over the old one
+// update the tab instead.
 func (fw *FileWatcher) Run() {
+	pending := make(map[string]bool)
+	var oldest time.Time // When the first event of the pending batch arrived
+	timer := time.NewTimer(debounceDelay)
+	timer.Stop()
+	settled := make(chan struct{}, 1)
+	settling := false // A batch is being checked
+	due := false      // The pending batch waits for the one being checked
+
+	flush := func() {
+		paths := make([]string, 0, len(pending))
+		for path := range pending {
+			paths = append(paths, path)
+		}
+		pending = make(map[string]bool)
+		settling, due = true, false
+		go func() {
+			fw.settleBatch(paths)
+			settled <- struct{}{}
+		}()
+	}
+
 	for {
 		select {
 		case <-fw.done:
-			// Stop all pending timers
-			for _, timer := range fw.pendingEvents {
-				timer.Stop()
-			}
+			timer.Stop()
 			return
 
-		case event, ok := <-fw.watcher.Events:
-			if !ok {
-				return
+		case path := <-fw.backend.Changes():
+			if len(pending) == 0 {
+				oldest = time.Now()
+			}
+			pending[path] = true
+			wait := debounceDelay
+			if left := time.Until(oldest.Add(maxBatchWait)); left < wait {
+				wait = max(left, 0)
 			}
-			// Handle Write and Create events (file modified or recreated)
-			if event.Op&(fsnotify.Write|fsnotify.Create) != 0 {
-				fw.scheduleChange(event.Name)
+			if !timer.Stop() {
+				select {
+				case <-timer.C:
+				default:
+				}
 			}
-			// Handle Remove and Rename events (file deleted or renamed)
-			if event.Op&(fsnotify.Remove|fsnotify.Rename) != 0 {
-				fw.handleDelete(event.Name)
+			timer.Reset(wait)
+
+		case <-timer.C:
+			switch {
+			case len(pending) == 0:
+			case settling:
+				due = true
+			default:
+				flush()
+			}
+
+		case <-settled:
+			settling = false
+			if due {
+				flush()
 			}
 
-		case err, ok := <-fw.watcher.Errors:
+		case err, ok := <-fw.backend.Errors():
 			if !ok {
 				return
 			}
@@ -108,80 +212,144 @@ func (fw *FileWatcher) Run() {
 	}
 }
 
-// scheduleChange debounces file change events for a path.
-// Multiple rapid events for the same file will be coalesced into one notification.
-func (fw *FileWatcher) scheduleChange(path string) {
-	// If there's already a pending timer for this path, reset it
-	if timer, exists := fw.pendingEvents[path]; exists {
-		timer.Reset(debounceDelay)
-		return
-	}
-
-	// Create a new timer for this path
-	fw.pendingEvents[path] = time.AfterFunc(debounceDelay, func() {
-		// Remove from pending events
-		delete(fw.pendingEvents, path)
-		// Trigger the actual change handler
-		fw.handleChange(path)
+// settleBatch checks a batch of files on a bounded worker pool and reports
+// those that changed or were deleted, in path order: to onBatch in one
+// call if set, otherwise one by one to onChange and onDelete.
+func (fw *FileWatcher) settleBatch(paths []string) {
+	sort.Strings(paths)
+	events := make([]FileEvent, len(paths))
+	report := make([]bool, len(paths))
+	parallelFor(len(paths), maxSettleWorkers, func(i int) {
+		events[i], report[i] = fw.settle(paths[i])
 	})
-}
+	fw.batches.Add(1)
 
-// handleChange processes a file change event.
-func (fw *FileWatcher) handleChange(path string) {
-	fw.mu.RLock()
-	tabSet, exists := fw.pathToTabs[path]
-	if !exists || len(tabSet) == 0 {
-		fw.mu.RUnlock()
+	reported := events[:0]
+	for i, event := range events {
+		if report[i] {
+			reported = append(reported, event)
+		}
+	}
+	if fw.onBatch != nil {
+		if len(reported) > 0 {
+			fw.onBatch(reported)
+		}
 		return
 	}
+	for _, event := range reported {
+		switch {
+		case event.Deleted && fw.onDelete != nil:
+			fw.onDelete(event.Path, event.TabIDs)
+		case !event.Deleted && fw.onChange != nil:
+			fw.onChange(event.Path, event.TabIDs)
+		}
+	}
+}
 
-	// Copy tab IDs to avoid holding lock during callback
-	tabIDs := make([]string, 0, len(tabSet))
-	for tabID := range tabSet {
-		tabIDs = append(tabIDs, tabID)
+// settle checks a file whose events have stopped. It is reported changed
+// if it exists and its content may differ from when it was last seen, or
+// deleted if it does not exist. Returns false if there is nothing to report.
+func (fw *FileWatcher) settle(path string) (FileEvent, bool) {
+	event := FileEvent{Path: path}
+	info, err := os.Stat(path)
+	if err != nil {
+		fw.mu.Lock()
+		delete(fw.prints, path) // A recreated file is always reported
+		fw.mu.Unlock()
+		event.Deleted = true
+	} else if fw.unchanged(path, info) {
+		fw.suppressed.Add(1)
+		return event, false
 	}
-	fw.mu.RUnlock()
 
-	// Invoke callback outside lock
-	if fw.onChange != nil {
-		fw.onChange(path, tabIDs)
+	// Unwatched since the event arrived
+	if event.TabIDs = fw.TabsWatching(path); len(event.TabIDs) == 0 {
+		return event, false
 	}
+	if !event.Deleted {
+		fw.delivered.Add(1)
+	}
+	return event, true
+}
+
+// fileFingerprint identifies a version of a file cheaply. A file with the
+// same identity, size and modification time is taken to be unchanged
+// without reading it; otherwise, a file of the same size is hashed to
+// tell a touch (or a save of identical bytes) from an edit.
+type fileFingerprint struct {
+	info   os.FileInfo
+	hash   uint64
+	hashed bool // False for large files, and after a change of size
 }
 
-// handleDelete processes a file delete/rename event.
-// It stops watching the file but keeps the tab->path mappings so the tab
-// can resume watching if the file is recreated.
-func (fw *FileWatcher) handleDelete(path string) {
+// unchanged records path's new fingerprint and reports whether its content
+// is known to be the same as at the previous one.
+func (fw *FileWatcher) unchanged(path string, info os.FileInfo) bool {
 	fw.mu.RLock()
-	tabSet, exists := fw.pathToTabs[path]
-	if !exists || len(tabSet) == 0 {
-		fw.mu.RUnlock()
-		return
+	prev := fw.prints[path]
+	fw.mu.RUnlock()
+
+	if prev != nil && os.SameFile(prev.info, info) && prev.info.Size() == info.Size() && prev.info.ModTime().Equal(info.ModTime()) {
+		return true
 	}
 
-	// Copy tab IDs to avoid holding lock during callback
-	tabIDs := make([]string, 0, len(tabSet))
-	for tabID := range tabSet {
-		tabIDs = append(tabIDs, tabID)
+	// A file that changed size has changed; only hash it once a later event
+	// could be a touch, so appends to a growing file are never hashed
+	fp := &fileFingerprint{info: info}
+	if prev != nil && prev.info.Size() == info.Size() {
+		fp.hash, fp.hashed = fw.hashFile(path, info)
 	}
-	fw.mu.RUnlock()
 
-	// Cancel any pending change event for this path
-	if timer, exists := fw.pendingEvents[path]; exists {
-		timer.Stop()
-		delete(fw.pendingEvents, path)
+	fw.mu.Lock()
+	if _, watched := fw.pathToTabs[path]; watched {
+		fw.prints[path] = fp
+	}
+	fw.mu.Unlock()
+	return prev != nil && prev.hashed && fp.hashed && prev.hash == fp.hash
+}
+
+// hashFile hashes the content of a file up to maxFingerprintBytes long.
+// Reports false if the file is larger or cannot be read.
+func (fw *FileWatcher) hashFile(path string, info os.FileInfo) (uint64, bool) {
+	if info.Size() > maxFingerprintBytes {
+		return 0, false
+	}
+	f, err := os.Open(path)
+	if err != nil {
+		return 0, false
 	}
+	defer f.Close()
 
-	// Invoke callback outside lock
-	if fw.onDelete != nil {
-		fw.onDelete(path, tabIDs)
+	var h maphash.Hash
+	h.SetSeed(fw.seed)
+	if _, err := io.Copy(&h, f); err != nil {
+		return 0, false
 	}
+	fw.hashes.Add(1)
+	return h.Sum64(), true
 }
 
 // Add registers a tab to watch a file path.
 // The path should be absolute. If the tab is already watching a different file,
 // it will be removed from watching that file first.
 func (fw *FileWatcher) Add(path, tabID string) error {
+	path = watchPath(path)
+	// Backends may watch the parent directory, so check the file exists here
+	info, err := os.Stat(path)
+	if err != nil {
+		return err
+	}
+
+	// Fingerprint a newly watched file, so touching it is not reported
+	var fp *fileFingerprint
+	fw.mu.RLock()
+	_, watched := fw.pathToTabs[path]
+	fw.mu.RUnlock()
+	if !watched {
+		fp = &fileFingerprint{info: info}
+		fp.hash, fp.hashed = fw.hashFile(path, info)
+	}
+
 	fw.mu.Lock()
 	defer fw.mu.Unlock()
 
@@ -192,11 +360,14 @@ func (fw *FileWatcher) Add(path, tabID string) error {
 
 	// Add tab to path's watch set
 	if fw.pathToTabs[path] == nil {
-		fw.pathToTabs[path] = make(map[string]bool)
-		// First tab watching this path, start watching the file
-		if err := fw.watcher.Add(path); err != nil {
+		// First tab watching this path, start watching it
+		if err := fw.backend.Add(path); err != nil {
 			return err
 		}
+		fw.pathToTabs[path] = make(map[string]bool)
+		if fp != nil {
+			fw.prints[path] = fp
+		}
 	}
 	fw.pathToTabs[path][tabID] = true
 	fw.tabToPath[tabID] = path
@@ -228,7 +399,8 @@ func (fw *FileWatcher) removeTabFromPathLocked(tabID, path string) {
 		// If no more tabs are watching this path, stop watching
 		if len(tabSet) == 0 {
 			delete(fw.pathToTabs, path)
-			fw.watcher.Remove(path)
+			delete(fw.prints, path)
+			fw.backend.Remove(path)
 		}
 	}
 }
@@ -236,6 +408,7 @@ func (fw *FileWatcher) removeTabFromPathLocked(tabID, path string) {
 // RemovePath stops watching a file entirely and removes all tabs watching it.
 // Returns the list of tab IDs that were watching the path.
 func (fw *FileWatcher) RemovePath(path string) []string {
+	path = watchPath(path)
 	fw.mu.Lock()
 	defer fw.mu.Unlock()
 
@@ -251,13 +424,24 @@ func (fw *FileWatcher) RemovePath(path string) []string {
 	}
 
 	delete(fw.pathToTabs, path)
-	fw.watcher.Remove(path)
+	delete(fw.prints, path)
+	fw.backend.Remove(path)
 
 	return tabIDs
 }
 
+// watchPath returns the absolute, clean form of path, which is how watched
+// files are keyed and how backends name them in events.
+func watchPath(path string) string {
+	if abs, err := filepath.Abs(path); err == nil {
+		return abs
+	}
+	return filepath.Clean(path)
+}
+
 // TabsWatching returns the list of tab IDs watching a specific path.
 func (fw *FileWatcher) TabsWatching(path string) []string {
+	path = watchPath(path)
 	fw.mu.RLock()
 	defer fw.mu.RUnlock()
 
@@ -287,23 +471,72 @@ func (fw *FileWatcher) WatchCount() int {
 	return len(fw.pathToTabs)
 }
 
+// WatchStats reports watched files and directories against the system's
+// limit on watches.
+type WatchStats struct {
+	Enabled     bool   `json:"enabled"`     // False if the watcher could not start
+	Backend     string `json:"backend"`     // auto, fsnotify or poll
+	Files       int    `json:"files"`       // Files watched by tabs
+	Directories int    `json:"directories"` // Directory watches shared by those files
+	Failed      int64  `json:"failed"`      // Directories that could not be watched
+	Limit       int    `json:"limit"`       // Per-user inotify watch limit, or 0 if unknown
+	Polled      int    `json:"polled"`      // Files polled instead of watched
+	PollRounds  int64  `json:"pollRounds"`  // Polling rounds that found files due
+	PollStats   int64  `json:"pollStats"`   // Stat calls made polling
+	Delivered   int64  `json:"delivered"`   // Settled changes reported to tabs
+	Suppressed  int64  `json:"suppressed"`  // Settled changes skipped because the content was unchanged
+	Hashes      int64  `json:"hashes"`      // Files read to compare content hashes
+	Batches     int64  `json:"batches"`     // Batches of settled events checked
+}
+
+// Stats returns the number of watches, the system limit and how many
+// settled changes were delivered or suppressed.
+func (fw *FileWatcher) Stats() WatchStats {
+	fw.mu.RLock()
+	stats := WatchStats{
+		Enabled:    true,
+		Backend:    fw.kind,
+		Files:      len(fw.pathToTabs),
+		Delivered:  fw.delivered.Load(),
+		Suppressed: fw.suppressed.Load(),
+		Hashes:     fw.hashes.Load(),
+		Batches:    fw.batches.Load(),
+	}
+	fw.mu.RUnlock()
+	fw.backend.Stats(&stats)
+	return stats
+}
+
+// inotifyWatchLimit returns fs.inotify.max_user_watches, or 0 where it
+// cannot be read (other systems). The limit is shared by all of the user's
+// processes.
+func inotifyWatchLimit() int {
+	data, err := os.ReadFile(inotifyWatchLimitFile)
+	if err != nil {
+		return 0
+	}
+	limit, _ := strconv.Atoi(strings.TrimSpace(string(data)))
+	return limit
+}
+
 // Clear removes all watches and clears all internal state.
 func (fw *FileWatcher) Clear() {
 	fw.mu.Lock()
 	defer fw.mu.Unlock()
 
-	// Remove all watches from fsnotify
+	// Remove all watches from the backend
 	for path := range fw.pathToTabs {
-		fw.watcher.Remove(path)
+		fw.backend.Remove(path)
 	}
 
 	// Clear internal maps
 	fw.pathToTabs = make(map[string]map[string]bool)
 	fw.tabToPath = make(map[string]string)
+	fw.prints = make(map[string]*fileFingerprint)
 }
 
 // Stop stops the file watcher and closes all resources.
 func (fw *FileWatcher) Stop() error {
 	close(fw.done)
-	return fw.watcher.Close()
+	return fw.backend.Close()
 }
@@ -1,6 +1,7 @@
 package main
 
 import (
+	"fmt"
 	"os"
 	"path/filepath"
 	"sync"
@@ -652,6 +653,268 @@ func TestFileWatcherAddNonExistentFile(t *testing.T) {
 	})
 }
 
+// TestFileWatcherSharesDirectoryWatch tests that files in one directory
+// share a single directory watch, removed with the last file.
+func TestFileWatcherSharesDirectoryWatch(t *testing.T) {
+	fw, err := NewFileWatcher(func(path string, tabIDs []string) {})
+	if err != nil {
+		t.Fatalf("NewFileWatcher failed: %v", err)
+	}
+	defer fw.Stop()
+
+	dir := t.TempDir()
+	var paths []string
+	for i := 0; i < 3; i++ {
+		path := filepath.Join(dir, "file"+string(rune('a'+i))+".txt")
+		if err := os.WriteFile(path, []byte("content"), 0644); err != nil {
+			t.Fatal(err)
+		}
+		paths = append(paths, path)
+		if err := fw.Add(path, "tab"+string(rune('a'+i))); err != nil {
+			t.Fatalf("Add failed: %v", err)
+		}
+	}
+	if stats := fw.Stats(); stats.Files != 3 || stats.Directories != 1 || !stats.Enabled {
+		t.Errorf("expected 3 files in 1 directory watch, got %+v", stats)
+	}
+
+	fw.Remove("taba")
+	fw.RemovePath(paths[1])
+	if stats := fw.Stats(); stats.Files != 1 || stats.Directories != 1 {
+		t.Errorf("expected the directory watch to stay for the last file, got %+v", stats)
+	}
+	fw.Remove("tabc")
+	if stats := fw.Stats(); stats.Files != 0 || stats.Directories != 0 {
+		t.Errorf("expected no watches, got %+v", stats)
+	}
+}
+
+// TestFileWatcherAtomicSave tests that saving by renaming a new file over
+// the watched one is a change, not a deletion, and that other files in the
+// directory are ignored.
+func TestFileWatcherAtomicSave(t *testing.T) {
+	changes := make(chan string, 10)
+	deleted := make(chan string, 10)
+	fw, err := NewFileWatcherWithCallbacks(FileWatcherCallbacks{
+		OnChange: func(path string, tabIDs []string) { changes <- path },
+		OnDelete: func(path string, tabIDs []string) { deleted <- path },
+	})
+	if err != nil {
+		t.Fatalf("NewFileWatcherWithCallbacks failed: %v", err)
+	}
+	defer fw.Stop()
+	go fw.Run()
+
+	path := createTempFile(t, "original")
+	if err := fw.Add(path, "tab1"); err != nil {
+		t.Fatalf("Add failed: %v", err)
+	}
+	time.Sleep(50 * time.Millisecond)
+
+	tmp := path + ".swp"
+	if err := os.WriteFile(tmp, []byte("saved atomically"), 0644); err != nil {
+		t.Fatal(err)
+	}
+	if err := os.Rename(tmp, path); err != nil {
+		t.Fatal(err)
+	}
+
+	select {
+	case got := <-changes:
+		if got != path {
+			t.Errorf("expected a change of %s, got %s", path, got)
+		}
+	case got := <-deleted:
+		t.Fatalf("expected a change, got a deletion of %s", got)
+	case <-time.After(2 * time.Second):
+		t.Fatal("timeout waiting for change callback")
+	}
+	select {
+	case got := <-changes:
+		t.Errorf("unexpected change of %s", got)
+	case got := <-deleted:
+		t.Errorf("unexpected deletion of %s", got)
+	case <-time.After(300 * time.Millisecond):
+	}
+}
+
+// TestFileWatcherNormalizesPaths tests that files added by relative or
+// unclean paths are matched to the events their directory watch reports.
+func TestFileWatcherNormalizesPaths(t *testing.T) {
+	changes := make(chan string, 10)
+	fw, err := NewFileWatcher(func(path string, tabIDs []string) { changes <- tabIDs[0] })
+	if err != nil {
+		t.Fatalf("NewFileWatcher failed: %v", err)
+	}
+	defer fw.Stop()
+	go fw.Run()
+
+	dir := t.TempDir()
+	for _, name := range []string{"rel.txt", "unclean.txt"} {
+		if err := os.WriteFile(filepath.Join(dir, name), []byte("v1"), 0644); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := os.Mkdir(filepath.Join(dir, "sub"), 0755); err != nil {
+		t.Fatal(err)
+	}
+	wd, err := os.Getwd()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := os.Chdir(dir); err != nil {
+		t.Fatal(err)
+	}
+	defer os.Chdir(wd)
+
+	tab, err := buildTab(&CreateTabRequest{ID: "rel", Type: "code", File: "sub/../rel.txt"})
+	if err != nil {
+		t.Fatalf("buildTab failed: %v", err)
+	}
+	if want := filepath.Join(dir, "rel.txt"); tab.SourcePath != want {
+		t.Errorf("expected source path %s, got %s", want, tab.SourcePath)
+	}
+
+	if err := fw.Add("rel.txt", "rel"); err != nil {
+		t.Fatalf("Add failed: %v", err)
+	}
+	if err := fw.Add(dir+"//sub/../unclean.txt", "unclean"); err != nil {
+		t.Fatalf("Add failed: %v", err)
+	}
+	if got := fw.TabsWatching(filepath.Join(dir, "rel.txt")); len(got) != 1 || got[0] != "rel" {
+		t.Errorf("expected the relative path to be keyed absolutely, got %v", got)
+	}
+
+	for _, name := range []string{"rel.txt", "unclean.txt"} {
+		if err := os.WriteFile(filepath.Join(dir, name), []byte("version 2"), 0644); err != nil {
+			t.Fatal(err)
+		}
+	}
+	seen := map[string]bool{}
+	for len(seen) < 2 {
+		select {
+		case tabID := <-changes:
+			seen[tabID] = true
+		case <-time.After(2 * time.Second):
+			t.Fatalf("timeout waiting for changes, got %v", seen)
+		}
+	}
+}
+
+// TestFileWatcherSuppressesUnchanged tests that settled events are only
+// reported when the file's content may have changed.
+func TestFileWatcherSuppressesUnchanged(t *testing.T) {
+	changes := 0
+	fw, err := NewFileWatcher(func(path string, tabIDs []string) { changes++ })
+	if err != nil {
+		t.Fatalf("NewFileWatcher failed: %v", err)
+	}
+	defer fw.Stop()
+
+	path := createTempFile(t, "original")
+	if err := fw.Add(path, "tab1"); err != nil {
+		t.Fatalf("Add failed: %v", err)
+	}
+	later := time.Now().Add(time.Hour)
+	steps := []struct {
+		name   string
+		modify func() error
+		report bool
+	}{
+		{"untouched", func() error { return nil }, false},
+		{"touched", func() error { return os.Chtimes(path, later, later) }, false},
+		{"same bytes rewritten", func() error { return os.WriteFile(path, []byte("original"), 0644) }, false},
+		{"same size edit", func() error { return os.WriteFile(path, []byte("modified"), 0644) }, true},
+		{"grown", func() error { return os.WriteFile(path, []byte("modified more"), 0644) }, true},
+		{"touched after growing", func() error { return os.Chtimes(path, later, later.Add(time.Minute)) }, true},
+		{"touched again", func() error { return os.Chtimes(path, later, later.Add(2*time.Minute)) }, false},
+	}
+	var delivered, suppressed int64
+	for _, step := range steps {
+		if err := step.modify(); err != nil {
+			t.Fatalf("%s: %v", step.name, err)
+		}
+		before := changes
+		fw.settleBatch([]string{path})
+		if reported := changes > before; reported != step.report {
+			t.Errorf("%s: expected reported=%v, got %v", step.name, step.report, reported)
+		}
+		if step.report {
+			delivered++
+		} else {
+			suppressed++
+		}
+	}
+
+	stats := fw.Stats()
+	if stats.Delivered != delivered || stats.Suppressed != suppressed {
+		t.Errorf("expected %d delivered and %d suppressed, got %+v", delivered, suppressed, stats)
+	}
+}
+
+// TestFileWatcherBatchesEventStorm tests that files changed together are
+// reported in one batch, and that continuous writes cannot hold a batch
+// back for longer than maxBatchWait.
+func TestFileWatcherBatchesEventStorm(t *testing.T) {
+	batches := make(chan []FileEvent, 10)
+	fw, err := NewFileWatcherWithCallbacks(FileWatcherCallbacks{
+		OnBatch: func(events []FileEvent) { batches <- events },
+	})
+	if err != nil {
+		t.Fatalf("NewFileWatcherWithCallbacks failed: %v", err)
+	}
+	defer fw.Stop()
+	go fw.Run()
+
+	dir := t.TempDir()
+	var paths []string
+	for i := 0; i < 50; i++ {
+		path := filepath.Join(dir, fmt.Sprintf("gen%02d.go", i))
+		if err := os.WriteFile(path, []byte("package gen\n"), 0644); err != nil {
+			t.Fatal(err)
+		}
+		if err := fw.Add(path, fmt.Sprintf("tab%02d", i)); err != nil {
+			t.Fatalf("Add failed: %v", err)
+		}
+		paths = append(paths, path)
+	}
+	time.Sleep(50 * time.Millisecond)
+
+	for _, path := range paths {
+		if err := os.WriteFile(path, []byte("package gen // regenerated\n"), 0644); err != nil {
+			t.Fatal(err)
+		}
+	}
+	select {
+	case events := <-batches:
+		if len(events) != len(paths) || events[0].Path != paths[0] || events[0].TabIDs[0] != "tab00" {
+			t.Fatalf("expected all %d files in path order, got %d events", len(paths), len(events))
+		}
+	case <-time.After(2 * time.Second):
+		t.Fatal("timeout waiting for batch")
+	}
+
+	// Keep writing one file well past the deadline
+	start := time.Now()
+	stop := time.After(maxBatchWait + 500*time.Millisecond)
+	for i := 0; ; i++ {
+		select {
+		case events := <-batches:
+			if waited := time.Since(start); waited > maxBatchWait+300*time.Millisecond {
+				t.Errorf("expected a batch within %v of continuous writes, got one after %v", maxBatchWait, waited)
+			}
+			if len(events) != 1 || events[0].Path != paths[0] {
+				t.Errorf("expected the written file, got %+v", events)
+			}
+			return
+		case <-stop:
+			t.Fatal("continuous writes held back the batch")
+		case <-time.After(50 * time.Millisecond):
+			os.WriteFile(paths[0], []byte(fmt.Sprintf("package gen // write %d\n", i)), 0644)
+		}
+	}
+}
+
 // createTempFile creates a temporary file with the given content and returns its path.
 func createTempFile(t *testing.T, content string) string {
 	t.Helper()
@@ -8,7 +8,16 @@
     let activeTabId = null;
     let ws = null;
     let reconnectAttempts = 0;
+    let lastSeq = 0;          // Sequence number of the latest message, to resume from
+    let wasConnected = false; // Set once the first connection opened
     const maxReconnectDelay = 30000; // 30 seconds max
+
+    // Push mode: with 'metadata' the server sends content only for the tab
+    // being viewed; other tabs are fetched on activation. Set localStorage
+    // 'agentviewer-push' to 'full' to receive every tab's content instead.
+    const PUSH_STORAGE_KEY = 'agentviewer-push';
+    const pushMode = localStorage.getItem(PUSH_STORAGE_KEY) === 'full' ? 'full' : 'metadata';
+    let reportedViewId = null; // Tab last reported to the server as viewed
     let closedTabsHistory = []; // Stack of closed tabs for reopen functionality
     const maxClosedTabs = 10; // Maximum number of closed tabs to remember
 
@@ -21,8 +30,20 @@
         originalContent: null // Store original content for restoring
     };
 
+    // Tab bar state
+    const VIRTUAL_TAB_THRESHOLD = 200; // Virtualize the tab bar beyond this many tabs
+    const VIRTUAL_TAB_WIDTH = 160;     // Fixed tab width (px) while virtualized; matches style.css
+    const VIRTUAL_TAB_OVERSCAN = 10;   // Tabs rendered beyond each edge of the viewport
+    const TAB_FILTER_THRESHOLD = 20;   // Show the filter box beyond this many tabs
+    const TAB_PAGE_SIZE = 1000;        // Page size when loading the tab list
+    const FOLLOW_SCROLL_SLACK = 40;    // Px from the end at which a followed tab keeps scrolling
+    const tabElements = new Map();     // Tab ID -> rendered element
+    let tabFilter = '';
+    let tabBarFrame = null;
+
     // DOM Elements
     const tabsContainer = document.getElementById('tabs-container');
+    const tabFilterInput = document.getElementById('tab-filter');
     const contentArea = document.getElementById('content');
 
     // Initialize
@@ -31,6 +52,7 @@
         initVendorLibs();
         connectWebSocket();
         loadTabs();
+        setupTabBar();
         setupKeyboardShortcuts();
         setupThemeToggle();
         setupSearch();
@@ -99,23 +121,112 @@
         updateMermaidTheme(getCurrentTheme());
     }
 
+    // Vendor libraries other than marked are loaded when the first tab that
+    // needs one is rendered. index.html lists their (fingerprinted) URLs.
+    const VENDOR_ASSETS = JSON.parse(document.getElementById('vendor-assets')?.textContent || '{}');
+    const VENDOR_GLOBALS = { highlight: 'hljs', mermaid: 'mermaid', katex: 'katex', diff2html: 'Diff2HtmlUI' };
+    const vendorLoads = {};
+    const vendorFailed = {};
+
+    function vendorReady(name) {
+        return typeof window[VENDOR_GLOBALS[name]] !== 'undefined';
+    }
+
+    // Load a vendor library, the libraries it needs and its stylesheets
+    // once; the promise resolves when it can be used
+    function loadVendor(name) {
+        if (!vendorLoads[name]) {
+            const asset = VENDOR_ASSETS[name] || {};
+            const load = Promise.all((asset.needs || []).map(loadVendor)).then(() => Promise.all([
+                ...(asset.css || []).map(href => loadElement('link', { rel: 'stylesheet', href })),
+                ...(vendorReady(name) ? [] : (asset.js || []).map(src => loadElement('script', { src })))
+            ])).then(() => {
+                if (name === 'mermaid') {
+                    updateMermaidTheme(getCurrentTheme());
+                }
+            });
+            load.catch((error) => {
+                console.error(`Failed to load ${name}:`, error);
+                vendorFailed[name] = true; // Render without it from now on
+            });
+            vendorLoads[name] = load;
+        }
+        return vendorLoads[name];
+    }
+
+    // Append a script or stylesheet to the page; resolves once it has loaded
+    function loadElement(tag, attrs) {
+        return new Promise((resolve, reject) => {
+            const el = document.createElement(tag);
+            Object.assign(el, attrs);
+            el.onload = resolve;
+            el.onerror = () => reject(new Error(`cannot load ${attrs.src || attrs.href}`));
+            document.head.appendChild(el);
+        });
+    }
+
+    // Vendor libraries a tab's renderer uses: highlight.js for code and
+    // fenced blocks, mermaid for diagrams, KaTeX when math delimiters are present
+    function vendorNeeds(tab) {
+        const content = typeof tab.content === 'string' ? tab.content : '';
+        switch (tab.type) {
+            case 'code':
+                return ['highlight'];
+            case 'diff':
+                return ['diff2html'];
+            case 'mermaid':
+                return ['mermaid'];
+            case 'markdown': {
+                const needs = [];
+                if (/^ {0,3}(```|~~~)/m.test(content)) {
+                    needs.push('highlight');
+                }
+                if (/^ {0,3}(```|~~~)\s*mermaid/m.test(content)) {
+                    needs.push('mermaid');
+                }
+                if (content.includes('$') && Object.keys(extractMathExpressions(content).mathMap).length > 0) {
+                    needs.push('katex');
+                }
+                return needs;
+            }
+            default:
+                return [];
+        }
+    }
+
     // WebSocket Connection
     function connectWebSocket() {
         const protocol = window.location.protocol === 'https:' ? 'wss:' : 'ws:';
-        ws = new WebSocket(`${protocol}//${window.location.host}/ws`);
+        // Messages arrive as binary MessagePack; large ones are compressed
+        // once on the server and shared by all clients, when the browser can
+        // inflate them
+        const protocols = 'DecompressionStream' in window
+            ? ['agentviewer.msgpack.deflate', 'agentviewer.msgpack']
+            : ['agentviewer.msgpack'];
+        // After a drop, resume from the last message received: the server
+        // replays what was missed, or sends a snapshot if too much was
+        const since = lastSeq ? `&since=${lastSeq}` : '';
+        ws = new WebSocket(`${protocol}//${window.location.host}/ws?subscribe=${pushMode}${since}`, protocols);
+        ws.binaryType = 'arraybuffer';
+        let inbound = Promise.resolve(); // Keeps messages in arrival order while inflating
 
         ws.onopen = () => {
             console.log('WebSocket connected');
             reconnectAttempts = 0;
+            reportedViewId = null;
+            reportViewing(activeTabId);
+            if (wasConnected && !since) {
+                loadTabs(); // Nothing to resume from
+            }
+            wasConnected = true;
         };
 
         ws.onmessage = (event) => {
-            try {
-                const msg = JSON.parse(event.data);
-                handleWSMessage(msg);
-            } catch (e) {
-                console.error('Failed to parse WebSocket message:', e);
-            }
+            const data = event.data;
+            inbound = inbound
+                .then(() => decodeWSData(data))
+                .then(handleWSMessage)
+                .catch((e) => console.error('Failed to handle WebSocket message:', e));
         };
 
         ws.onclose = () => {
@@ -128,6 +239,140 @@
         };
     }
 
+    // Decode a WebSocket message: JSON text, or binary MessagePack or JSON,
+    // possibly zlib-compressed
+    async function decodeWSData(data) {
+        if (typeof data === 'string') {
+            return JSON.parse(data);
+        }
+        let bytes = new Uint8Array(data);
+        if (bytes[0] === 0x78) { // zlib header
+            bytes = new Uint8Array(await inflate(bytes));
+        }
+        if (bytes[0] === 0x7b) { // '{'
+            return JSON.parse(textDecoder.decode(bytes));
+        }
+        return decodeMsgpack(bytes);
+    }
+
+    // Decompress a zlib-compressed binary message
+    function inflate(bytes) {
+        const stream = new Blob([bytes]).stream().pipeThrough(new DecompressionStream('deflate'));
+        return new Response(stream).arrayBuffer();
+    }
+
+    const textDecoder = new TextDecoder();
+
+    // Decode a MessagePack value. Strings are decoded natively by
+    // TextDecoder and bin values are returned as Uint8Array views without
+    // copying, so large content never goes through JSON.parse.
+    function decodeMsgpack(bytes) {
+        const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+        let pos = 0;
+
+        function str(n) {
+            const s = textDecoder.decode(bytes.subarray(pos, pos + n));
+            pos += n;
+            return s;
+        }
+        function bin(n) {
+            const b = bytes.subarray(pos, pos + n);
+            pos += n;
+            return b;
+        }
+        function array(n) {
+            const a = new Array(n);
+            for (let i = 0; i < n; i++) a[i] = read();
+            return a;
+        }
+        function map(n) {
+            const m = {};
+            for (let i = 0; i < n; i++) {
+                const key = read();
+                m[key] = read();
+            }
+            return m;
+        }
+        function next(size, get) {
+            const v = get(pos);
+            pos += size;
+            return v;
+        }
+        function read() {
+            const b = bytes[pos++];
+            if (b <= 0x7f) return b;
+            if (b >= 0xe0) return b - 0x100;
+            if ((b & 0xf0) === 0x80) return map(b & 0x0f);
+            if ((b & 0xf0) === 0x90) return array(b & 0x0f);
+            if ((b & 0xe0) === 0xa0) return str(b & 0x1f);
+            switch (b) {
+                case 0xc0: return null;
+                case 0xc2: return false;
+                case 0xc3: return true;
+                case 0xc4: return bin(next(1, p => view.getUint8(p)));
+                case 0xc5: return bin(next(2, p => view.getUint16(p)));
+                case 0xc6: return bin(next(4, p => view.getUint32(p)));
+                case 0xcb: return next(8, p => view.getFloat64(p));
+                case 0xcc: return next(1, p => view.getUint8(p));
+                case 0xcd: return next(2, p => view.getUint16(p));
+                case 0xce: return next(4, p => view.getUint32(p));
+                case 0xcf: return Number(next(8, p => view.getBigUint64(p)));
+                case 0xd0: return next(1, p => view.getInt8(p));
+                case 0xd1: return next(2, p => view.getInt16(p));
+                case 0xd2: return next(4, p => view.getInt32(p));
+                case 0xd3: return Number(next(8, p => view.getBigInt64(p)));
+                case 0xd9: return str(next(1, p => view.getUint8(p)));
+                case 0xda: return str(next(2, p => view.getUint16(p)));
+                case 0xdb: return str(next(4, p => view.getUint32(p)));
+                case 0xdc: return array(next(2, p => view.getUint16(p)));
+                case 0xdd: return array(next(4, p => view.getUint32(p)));
+                case 0xde: return map(next(2, p => view.getUint16(p)));
+                case 0xdf: return map(next(4, p => view.getUint32(p)));
+            }
+            throw new Error(`Unsupported MessagePack type 0x${b.toString(16)}`);
+        }
+
+        return read();
+    }
+
+    // Tell the server which tab is on screen, so its content keeps being
+    // pushed while other tabs arrive as metadata only
+    function reportViewing(id) {
+        if (pushMode !== 'metadata' || id === reportedViewId) return;
+        if (ws && ws.readyState === WebSocket.OPEN) {
+            ws.send(JSON.stringify({ type: 'view_tab', id: id || '' }));
+            reportedViewId = id;
+        }
+    }
+
+    // Prepare a pushed tab for the cache: drop the empty content of a
+    // metadata-only tab so it is fetched when viewed, and turn raw image
+    // bytes into an object URL
+    const imageURLs = new Map(); // Tab ID -> object URL of its pushed image
+    function prepareTab(tab) {
+        if (tab.contentOmitted) {
+            delete tab.content;
+            delete tab.contentOmitted;
+        }
+        if (tab.content instanceof Uint8Array) {
+            const url = URL.createObjectURL(new Blob([tab.content], { type: tab.contentType }));
+            releaseImageURL(tab.id);
+            imageURLs.set(tab.id, url);
+            tab.content = url;
+            delete tab.contentType;
+        }
+        return tab;
+    }
+
+    // Revoke the object URL of a tab's pushed image once it is replaced
+    function releaseImageURL(id) {
+        const url = imageURLs.get(id);
+        if (url) {
+            URL.revokeObjectURL(url);
+            imageURLs.delete(id);
+        }
+    }
+
     // Schedule reconnection with exponential backoff
     function scheduleReconnect() {
         reconnectAttempts++;
@@ -139,9 +384,13 @@
 
     // Handle WebSocket messages
     function handleWSMessage(msg) {
+        if (msg.seq) {
+            // Messages coalesced on the server keep their earliest number
+            lastSeq = Math.max(lastSeq, msg.seq);
+        }
         switch (msg.type) {
             case 'tab_created':
-                tabs.push(msg.tab);
+                tabs.push(prepareTab(msg.tab));
                 renderTabs();
                 activateTab(msg.tab.id);
                 break;
@@ -149,14 +398,22 @@
             case 'tab_updated':
                 const idx = tabs.findIndex(t => t.id === msg.tab.id);
                 if (idx !== -1) {
-                    tabs[idx] = msg.tab;
+                    tabs[idx] = prepareTab(msg.tab);
                     if (activeTabId === msg.tab.id) {
-                        renderContent(msg.tab);
+                        if (typeof msg.tab.content === 'string') {
+                            renderContent(msg.tab);
+                        } else {
+                            renderActiveContent();
+                        }
                     }
                     renderTabs();
                 }
                 break;
 
+            case 'tab_patched':
+                applyTabPatch(msg.id, msg.patch);
+                break;
+
             case 'tab_deleted':
                 // Save closed tab to history for reopen (only if not already saved locally)
                 // This handles tabs deleted via external API calls
@@ -172,13 +429,36 @@
                 renderActiveContent();
                 break;
 
+            case 'tabs_batch':
+                applyTabsBatch(msg.tabs || [], msg.ids || []);
+                break;
+
+            case 'tabs_updated': {
+                // Files changed together, e.g. by a git checkout; never creates tabs
+                const known = new Set(tabs.map(t => t.id));
+                applyTabsBatch((msg.tabs || []).filter(t => known.has(t.id)), []);
+                break;
+            }
+
             case 'tab_activated':
                 activeTabId = msg.id;
                 renderTabs();
                 renderActiveContent();
                 break;
 
+            case 'resync':
+                // The server dropped queued updates because this client fell
+                // too far behind; reload the current state
+                loadTabs();
+                break;
+
+            case 'snapshot':
+                applySnapshot(msg.tabs || []);
+                break;
+
             case 'tabs_cleared':
+                imageURLs.forEach(url => URL.revokeObjectURL(url));
+                imageURLs.clear();
                 tabs = [];
                 activeTabId = null;
                 renderTabs();
@@ -187,12 +467,144 @@
         }
     }
 
+    // Replace the tab list with a snapshot sent after a reconnect that
+    // missed more than the server keeps for replay. Snapshot tabs carry no
+    // content; cached content is kept for tabs whose version is unchanged.
+    function applySnapshot(snapshot) {
+        const cached = new Map(tabs.map(t => [t.id, t]));
+        tabs = snapshot.map(tab => {
+            prepareTab(tab);
+            const prev = cached.get(tab.id);
+            if (prev && prev.version === tab.version && typeof prev.content === 'string') {
+                tab.content = prev.content;
+                tab.etag = prev.etag;
+            }
+            return tab;
+        });
+        const kept = new Set(tabs.map(t => t.id));
+        for (const id of [...imageURLs.keys()]) {
+            if (!kept.has(id)) releaseImageURL(id);
+        }
+
+        const active = tabs.find(t => t.active);
+        activeTabId = active ? active.id : (tabs.length > 0 ? tabs[0].id : null);
+        renderTabs();
+        renderActiveContent();
+    }
+
+    // Apply a batch of deletes and creates/updates with a single render.
+    // Deleted IDs are removed first; tabs re-created in the same batch are
+    // among the updates and move to the end, as on the server.
+    function applyTabsBatch(updated, deletedIds) {
+        const deleted = new Set(deletedIds);
+        for (const tab of tabs) {
+            if (deleted.has(tab.id) && !closedTabsHistory.some(t => t.id === tab.id && Date.now() - t.closedAt < 1000)) {
+                saveClosedTab(tab);
+            }
+        }
+        tabs = tabs.filter(t => !deleted.has(t.id));
+
+        let lastCreated = null;
+        for (const tab of updated) {
+            prepareTab(tab);
+            const idx = tabs.findIndex(t => t.id === tab.id);
+            if (idx !== -1) {
+                tabs[idx] = tab;
+            } else {
+                tabs.push(tab);
+                lastCreated = tab.id;
+            }
+        }
+
+        if (lastCreated) {
+            activateTab(lastCreated);
+            return;
+        }
+        if (!tabs.some(t => t.id === activeTabId)) {
+            activeTabId = tabs.length > 0 ? tabs[0].id : null;
+            renderTabs();
+            renderActiveContent();
+            return;
+        }
+        renderTabs();
+        const active = updated.find(t => t.id === activeTabId);
+        if (active && typeof active.content === 'string') {
+            renderContent(active);
+        } else if (active) {
+            renderActiveContent();
+        }
+    }
+
+    // Apply a content delta to the cached tab.
+    // Falls back to refetching when the cache is missing or at another version.
+    function applyTabPatch(id, patch) {
+        const idx = tabs.findIndex(t => t.id === id);
+        if (idx === -1 || !patch) return;
+
+        const tab = tabs[idx];
+        const streamingChanged = !!tab.streaming !== !!patch.streaming;
+        tab.streaming = !!patch.streaming;
+        if (streamingChanged) {
+            renderTabs();
+        }
+
+        if (patch.contentOmitted || typeof tab.content !== 'string' || tab.version !== patch.baseVersion) {
+            delete tab.content;
+            tab.version = patch.version;
+            if (activeTabId === id) {
+                renderActiveContent();
+            }
+            return;
+        }
+
+        // Offsets and lengths are UTF-16 code units, matching JS strings
+        let content = tab.content;
+        for (const op of patch.ops || []) {
+            const text = op.text || '';
+            const offset = op.offset || 0;
+            switch (op.op) {
+                case 'append':
+                    content += text;
+                    break;
+                case 'insert':
+                    content = content.slice(0, offset) + text + content.slice(offset);
+                    break;
+                case 'replace':
+                    content = content.slice(0, offset) + text + content.slice(offset + (op.length || 0));
+                    break;
+            }
+        }
+
+        tab.content = content;
+        tab.version = patch.version;
+        delete tab.etag;
+        if (activeTabId === id && patch.ops && patch.ops.length > 0) {
+            // A followed file stays scrolled to its end unless the user scrolled up
+            const atEnd = contentArea.scrollTop + contentArea.clientHeight >= contentArea.scrollHeight - FOLLOW_SCROLL_SLACK;
+            renderContent(tab);
+            if (tab.follow && atEnd) {
+                contentArea.scrollTop = contentArea.scrollHeight;
+            }
+        }
+    }
+
     // Load initial tabs
     async function loadTabs() {
         try {
-            const response = await fetch('/api/tabs');
-            const data = await response.json();
-            tabs = data.tabs || [];
+            // Page through the list so huge sessions arrive in bounded responses
+            let loaded = [];
+            let cursor = '';
+            do {
+                const query = '?limit=' + TAB_PAGE_SIZE + (cursor ? '&cursor=' + encodeURIComponent(cursor) : '');
+                const response = await fetch('/api/tabs' + query);
+                if (!response.ok) {
+                    throw new Error('HTTP ' + response.status);
+                }
+                const data = await response.json();
+                loaded = loaded.concat(data.tabs || []);
+                cursor = data.nextCursor || '';
+            } while (cursor);
+            tabs = loaded;
 
             // Find active tab
             const active = tabs.find(t => t.active);
@@ -205,44 +617,178 @@
         }
     }
 
-    // Render tab bar
+    // Render tab bar.
+    // Elements are keyed by tab ID and updated in place; clicks are handled
+    // by delegation (setupTabBar). Beyond VIRTUAL_TAB_THRESHOLD tabs only
+    // those in view are rendered, at a fixed width, with padding standing
+    // in for the rest.
     function renderTabs() {
-        tabsContainer.innerHTML = tabs.map(tab => `
-            <div class="tab ${tab.id === activeTabId ? 'active' : ''}" data-id="${tab.id}">
-                <span class="tab-title">${escapeHtml(tab.title || 'Untitled')}</span>
-                <span class="tab-close" data-close="${tab.id}">&times;</span>
-            </div>
-        `).join('');
+        const visible = filteredTabs();
+        const virtual = visible.length > VIRTUAL_TAB_THRESHOLD;
+        tabsContainer.classList.toggle('tabs-virtual', virtual);
+        tabFilterInput.classList.toggle('hidden', tabs.length <= TAB_FILTER_THRESHOLD && !tabFilter);
+
+        let start = 0;
+        let end = visible.length;
+        if (virtual) {
+            const first = Math.floor(tabsContainer.scrollLeft / VIRTUAL_TAB_WIDTH);
+            const count = Math.ceil(tabsContainer.clientWidth / VIRTUAL_TAB_WIDTH);
+            start = Math.max(0, first - VIRTUAL_TAB_OVERSCAN);
+            end = Math.min(visible.length, first + count + VIRTUAL_TAB_OVERSCAN);
+        }
+        tabsContainer.style.paddingLeft = virtual ? (start * VIRTUAL_TAB_WIDTH) + 'px' : '';
+        tabsContainer.style.paddingRight = virtual ? ((visible.length - end) * VIRTUAL_TAB_WIDTH) + 'px' : '';
+
+        // Reconcile: walk the wanted tabs, reusing elements by ID and moving
+        // only those out of place; whatever is left over is removed
+        const wanted = new Set();
+        let cursor = tabsContainer.firstElementChild;
+        for (let i = start; i < end; i++) {
+            const tab = visible[i];
+            wanted.add(tab.id);
+            let el = tabElements.get(tab.id);
+            if (!el) {
+                el = createTabElement(tab);
+                tabElements.set(tab.id, el);
+            }
+            updateTabElement(el, tab);
+            if (el === cursor) {
+                cursor = cursor.nextElementSibling;
+            } else {
+                tabsContainer.insertBefore(el, cursor);
+            }
+        }
+        for (const [id, el] of tabElements) {
+            if (!wanted.has(id)) {
+                el.remove();
+                tabElements.delete(id);
+            }
+        }
+    }
 
-        // Add click handlers
-        tabsContainer.querySelectorAll('.tab').forEach(el => {
-            el.addEventListener('click', (e) => {
-                if (e.target.classList.contains('tab-close')) {
-                    closeTab(e.target.dataset.close);
-                } else {
-                    activateTab(el.dataset.id);
-                }
-            });
+    // Tabs matching the filter box, in order
+    function filteredTabs() {
+        if (!tabFilter) return tabs;
+        return tabs.filter(t => (t.title || 'Untitled').toLowerCase().includes(tabFilter));
+    }
 
-            // Middle-click to close tab
-            el.addEventListener('mousedown', (e) => {
-                if (e.button === 1) { // Middle mouse button
-                    e.preventDefault();
-                    closeTab(el.dataset.id);
-                }
-            });
+    function createTabElement(tab) {
+        const el = document.createElement('div');
+        el.className = 'tab';
+        el.dataset.id = tab.id;
+        el.innerHTML = `<span class="tab-title"></span><span class="tab-close" data-close="${escapeHtml(tab.id)}">&times;</span>`;
+        return el;
+    }
 
-            // Prevent middle-click from triggering browser behavior
-            el.addEventListener('auxclick', (e) => {
-                if (e.button === 1) {
-                    e.preventDefault();
-                }
-            });
+    // Update a tab element to match the tab, touching only what changed
+    function updateTabElement(el, tab) {
+        el.classList.toggle('active', tab.id === activeTabId);
+        el.classList.toggle('streaming', !!tab.streaming);
+
+        const titleEl = el.querySelector('.tab-title');
+        const title = tab.title || 'Untitled';
+        if (titleEl.textContent !== title) {
+            titleEl.textContent = title;
+        }
+
+        const indicator = el.querySelector('.tab-streaming');
+        if (tab.streaming && !indicator) {
+            const dot = document.createElement('span');
+            dot.className = 'tab-streaming';
+            dot.title = 'Streaming';
+            el.insertBefore(dot, titleEl);
+        } else if (!tab.streaming && indicator) {
+            indicator.remove();
+        }
+    }
+
+    // Coalesce tab bar renders triggered by scrolling and resizing
+    function scheduleTabBarRender() {
+        if (tabBarFrame !== null) return;
+        tabBarFrame = requestAnimationFrame(() => {
+            tabBarFrame = null;
+            renderTabs();
+        });
+    }
+
+    // Scroll a virtualized tab bar so the given tab is rendered and visible
+    function scrollTabIntoView(id) {
+        if (!tabsContainer.classList.contains('tabs-virtual')) return;
+        const idx = filteredTabs().findIndex(t => t.id === id);
+        if (idx === -1) return;
+        const left = idx * VIRTUAL_TAB_WIDTH;
+        if (left < tabsContainer.scrollLeft || left + VIRTUAL_TAB_WIDTH > tabsContainer.scrollLeft + tabsContainer.clientWidth) {
+            tabsContainer.scrollLeft = left - (tabsContainer.clientWidth - VIRTUAL_TAB_WIDTH) / 2;
+            renderTabs();
+        }
+    }
+
+    // Delegated tab bar events and the filter box
+    function setupTabBar() {
+        tabsContainer.addEventListener('click', (e) => {
+            const close = e.target.closest('.tab-close');
+            if (close) {
+                closeTab(close.dataset.close);
+                return;
+            }
+            const el = e.target.closest('.tab');
+            if (el) {
+                activateTab(el.dataset.id);
+            }
+        });
+
+        // Middle-click to close tab
+        tabsContainer.addEventListener('mousedown', (e) => {
+            const el = e.target.closest('.tab');
+            if (el && e.button === 1) { // Middle mouse button
+                e.preventDefault();
+                closeTab(el.dataset.id);
+            }
+        });
+
+        // Prevent middle-click from triggering browser behavior
+        tabsContainer.addEventListener('auxclick', (e) => {
+            if (e.button === 1 && e.target.closest('.tab')) {
+                e.preventDefault();
+            }
+        });
+
+        tabsContainer.addEventListener('scroll', () => {
+            if (tabsContainer.classList.contains('tabs-virtual')) {
+                scheduleTabBarRender();
+            }
+        }, { passive: true });
+        window.addEventListener('resize', scheduleTabBarRender);
+
+        tabFilterInput.addEventListener('input', () => {
+            tabFilter = tabFilterInput.value.trim().toLowerCase();
+            tabsContainer.scrollLeft = 0;
+            renderTabs();
+        });
+        tabFilterInput.addEventListener('keydown', (e) => {
+            if (e.key === 'Enter') {
+                const first = filteredTabs()[0];
+                if (first) activateTab(first.id);
+            } else if (e.key === 'Escape') {
+                tabFilterInput.value = '';
+                tabFilter = '';
+                tabFilterInput.blur();
+                renderTabs();
+                scrollTabIntoView(activeTabId);
+            }
         });
     }
 
+    // Show the end of a followed file, where new lines arrive
+    function scrollFollowedToEnd(tab) {
+        if (tab && tab.follow) {
+            contentArea.scrollTop = contentArea.scrollHeight;
+        }
+    }
+
     // Render active content
     async function renderActiveContent() {
+        reportViewing(activeTabId);
         if (!activeTabId) {
             contentArea.innerHTML = `
                 <div class="empty-state">
@@ -253,10 +799,34 @@
             return;
         }
 
+        const id = activeTabId;
+        const cached = tabs.find(t => t.id === id);
+
         try {
-            const response = await fetch(`/api/tabs/${activeTabId}`);
+            // Revalidate cached content instead of downloading it again
+            const headers = {};
+            if (cached && typeof cached.content === 'string' && cached.etag) {
+                headers['If-None-Match'] = cached.etag;
+            }
+            const response = await fetch(`/api/tabs/${id}`, { headers, cache: 'no-store' });
+            if (activeTabId !== id) return; // Switched away while loading
+
+            if (response.status === 304) {
+                renderContent(cached);
+                scrollFollowedToEnd(cached);
+                return;
+            }
+
             const tab = await response.json();
+            tab.etag = response.headers.get('ETag');
+
+            // Cache the full tab so later tab_patched deltas can be applied locally
+            const idx = tabs.findIndex(t => t.id === tab.id);
+            if (idx !== -1) {
+                Object.assign(tabs[idx], tab);
+            }
             renderContent(tab);
+            scrollFollowedToEnd(tab);
         } catch (error) {
             console.error('Failed to load tab content:', error);
         }
@@ -264,6 +834,23 @@
 
     // Render tab content
     function renderContent(tab) {
+        // Libraries not loaded yet are fetched, and the tab rendered again
+        // when they arrive (or fail). Meanwhile markdown and code are shown
+        // without them.
+        const missing = vendorNeeds(tab).filter(name => !vendorReady(name) && !vendorFailed[name]);
+        if (missing.length > 0) {
+            const rerender = () => {
+                if (activeTabId !== tab.id) return;
+                const cached = tabs.find(t => t.id === tab.id);
+                renderContent(cached && typeof cached.content === 'string' ? cached : tab);
+            };
+            Promise.all(missing.map(loadVendor)).then(rerender, rerender);
+            if (tab.type === 'diff' || tab.type === 'mermaid') {
+                contentArea.innerHTML = `<div class="empty-state"><p>Loading renderer...</p></div>`;
+                return;
+            }
+        }
+
         let html = '';
 
         switch (tab.type) {
@@ -284,7 +871,7 @@
                 break;
 
             case 'image':
-                html = `<div class="content-image">${renderImage(tab.content, tab.title)}</div>`;
+                html = `<div class="content-image">${renderImage(imageSource(tab), tab.title, imageSource(tab, true))}</div>`;
                 break;
 
             case 'csv':
@@ -335,6 +922,10 @@
             // Setup copy button handlers
             setupCopyButtons();
         }
+
+        if (type === 'image') {
+            setupImageZoom();
+        }
     }
 
     // Setup copy button click handlers
@@ -855,8 +1446,39 @@
         return string.replace(/[.*+?^${}()|[\]\\]/g, '\\$&');
     }
 
-    // Render image content (expects a data URL or URL string)
-    function renderImage(content, title) {
+    // Image tabs created from files refer to their raw URL, which streams
+    // the file; the version makes the browser refetch it after a change.
+    // Unless full resolution is asked for, the server scales the image down
+    // to the width of the content area in device pixels.
+    function imageSource(tab, full) {
+        const content = tab.content;
+        if (typeof content === 'string' && content.startsWith('/api/tabs/') && content.endsWith('/raw')) {
+            if (full) {
+                return `${content}?v=${tab.version}`;
+            }
+            const width = Math.ceil(contentArea.clientWidth * (window.devicePixelRatio || 1));
+            return `${content}?v=${tab.version}&w=${width}`;
+        }
+        return content;
+    }
+
+    // Clicking an image toggles between fitting the window and its natural
+    // size, loading the full-resolution image the first time
+    function setupImageZoom() {
+        const img = contentArea.querySelector('.image-display');
+        if (!img) return;
+        img.addEventListener('click', () => {
+            const zoomed = contentArea.querySelector('.content-image').classList.toggle('zoomed');
+            if (zoomed && img.dataset.fullSrc) {
+                img.src = img.dataset.fullSrc;
+                delete img.dataset.fullSrc;
+            }
+        });
+    }
+
+    // Render image content (expects a data URL or URL string). fullContent
+    // is the full-resolution source loaded on zoom, if content is scaled.
+    function renderImage(content, title, fullContent) {
         // Handle empty content
         if (!content) {
             return `<div class="image-error">
@@ -870,7 +1492,7 @@
 
         // Check if content is a data URL or a regular URL
         const isDataUrl = content.startsWith('data:');
-        const isUrl = content.startsWith('http://') || content.startsWith('https://') || content.startsWith('/');
+        const isUrl = content.startsWith('http://') || content.startsWith('https://') || content.startsWith('/') || content.startsWith('blob:');
 
         if (!isDataUrl && !isUrl) {
             // Content might be raw base64, try to wrap it
@@ -882,7 +1504,7 @@
         }
 
         return `<figure class="image-figure">
-            <img src="${content}" alt="${altText}" class="image-display" loading="lazy" />
+            <img src="${content}" alt="${altText}" class="image-display" loading="lazy"${fullContent && fullContent !== content ? ` data-full-src="${fullContent}"` : ''} />
             ${title ? `<figcaption class="image-caption">${escapeHtml(title)}</figcaption>` : ''}
         </figure>`;
     }
@@ -1513,6 +2135,7 @@
     function activateTab(id) {
         activeTabId = id;
         renderTabs();
+        scrollTabIntoView(id);
         renderActiveContent();
 
         // Notify server
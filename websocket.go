@@ -5,7 +5,9 @@ import (
 	"context"
 	"encoding/json"
 	"net/http"
+	"strconv"
 	"sync"
+	"sync/atomic"
 	"time"
 
 	"nhooyr.io/websocket"
@@ -13,14 +15,53 @@ import (
 
 // Hub maintains active WebSocket connections and broadcasts messages.
 type Hub struct {
-	mu      sync.RWMutex
-	clients map[*Client]bool
+	// shards deliver broadcasts in parallel; each client belongs to one
+	shards []*hubShard
 
 	// Channels for client management
 	register   chan *Client
 	unregister chan *Client
-	broadcast  chan []byte
 	done       chan struct{}
+
+	// seqMu orders broadcasts: it guards seq and replay, and is held while
+	// a broadcast is handed to the shards
+	seqMu    sync.Mutex
+	seq      uint64 // Sequence number of the latest broadcast
+	replay   *replayRing
+	snapshot func() WSMessage // Full state for clients that missed too much
+	replays  replayCounters
+
+	// Rate limiting of tab_updated pushes, also guarded by seqMu
+	updateInterval time.Duration // Minimum time between updates of the active tab
+	active         func() string // Returns the active tab ID
+	throttled      map[string]*throttledTab
+	throttle       throttleCounters
+
+	compressThreshold int // Smallest payload compressed for DeflateSubprotocol clients
+	clientQueueBytes  int // Queued bytes at which a client is sent a resync instead
+	compression       compressionCounters
+	queues            queueCounters
+}
+
+// HubStats reports WebSocket connection, queue and compression counters.
+type HubStats struct {
+	Clients                int    `json:"clients"`
+	QueuedMessages         int    `json:"queuedMessages"`         // Messages waiting for clients now
+	QueuedBytes            int    `json:"queuedBytes"`            // Their bytes in coalescing queues
+	MaxQueueDepth          int    `json:"maxQueueDepth"`          // Most messages waiting for one client
+	SlowDeliveries         int64  `json:"slowDeliveries"`         // Messages that waited in a coalescing queue
+	Coalesced              int64  `json:"coalesced"`              // Queued messages dropped or merged as superseded
+	Resyncs                int64  `json:"resyncs"`                // Clients told to resync after exceeding the queue cap
+	Seq                    uint64 `json:"seq"`                    // Sequence number of the latest broadcast
+	ReplayBuffered         int    `json:"replayBuffered"`         // Broadcasts kept for resuming clients
+	Replays                int64  `json:"replays"`                // Reconnects served from the replay buffer
+	ReplayedMessages       int64  `json:"replayedMessages"`       // Messages sent by those reconnects
+	Snapshots              int64  `json:"snapshots"`              // Reconnects sent a full-state snapshot instead
+	DeferredUpdates        int64  `json:"deferredUpdates"`        // Tab updates held back by the per-tab rate limit
+	CoalescedUpdates       int64  `json:"coalescedUpdates"`       // Held-back updates superseded before being sent
+	CompressedMessages     int64  `json:"compressedMessages"`     // Broadcast payloads compressed (once each)
+	BytesBeforeCompression int64  `json:"bytesBeforeCompression"` // Their size as JSON
+	BytesAfterCompression  int64  `json:"bytesAfterCompression"`  // Their size compressed
 }
 
 // Client represents a single WebSocket connection.
@@ -28,86 +69,346 @@ type Client struct {
 	hub  *Hub
 	conn *websocket.Conn
 	send chan []byte
+	sub  atomic.Pointer[Subscription] // nil means full pushes
+	// queue holds messages while send is full; see Hub.deliver
+	queue clientQueue
+	// resumedAt is the latest message replayed by Hub.Resume; broadcasts
+	// up to it are not delivered again
+	resumedAt uint64
+	// msgpack and deflate are set from the negotiated subprotocol: msgpack
+	// clients receive binary MessagePack, deflate clients receive large
+	// broadcasts as shared compressed binary messages.
+	msgpack bool
+	deflate bool
+}
+
+// Subscription modes.
+const (
+	SubscribeFull     = "full"     // Push content for every tab (default)
+	SubscribeMetadata = "metadata" // Push content only for the viewed tab
+)
+
+// Subscription describes what a client wants pushed. In metadata mode,
+// tab content is only pushed for the tab the client is viewing; other tabs
+// arrive as metadata with ContentOmitted set and are fetched on activation.
+type Subscription struct {
+	Metadata bool
+	Viewing  string
+}
+
+// outbound is a broadcast message with its payloads. Payloads are built
+// by the hub on first use and shared by every client that needs the same
+// view of the message, encoding and compression. Shards build payloads
+// concurrently, so the cache is guarded by mu.
+type outbound struct {
+	msg        WSMessage
+	hasContent bool
+	mu         sync.RWMutex
+	payloads   map[payloadKey][]byte
+	kept       *atomic.Int64 // Byte count of the replay ring keeping the broadcast, if any
+	charged    int           // Payload bytes added to kept
 }
 
+// payloadKey identifies one payload of a broadcast.
+type payloadKey struct {
+	view    string // viewFull, viewMeta, or the viewed tab whose content is kept
+	msgpack bool   // MessagePack rather than JSON
+	deflate bool   // Compressed for shared deflate (nil payload if not worth it)
+}
+
+// Views of a broadcast; other views keep the content of one viewed tab.
+const (
+	viewFull = "\x00full"
+	viewMeta = "\x00meta"
+)
+
 // WSMessage represents a WebSocket message.
 type WSMessage struct {
 	Type    string      `json:"type"`
+	Seq     uint64      `json:"seq,omitempty"` // Broadcast sequence number, for resuming after a reconnect
 	ID      string      `json:"id,omitempty"`
 	Tab     *Tab        `json:"tab,omitempty"`
 	Content string      `json:"content,omitempty"`
+	Patch   *TabPatch   `json:"patch,omitempty"` // Content delta for tab_patched
+	Tabs    []*Tab      `json:"tabs,omitempty"`  // Created or updated tabs for tabs_batch and tabs_updated
+	IDs     []string    `json:"ids,omitempty"`   // Deleted tab IDs for tabs_batch
+	Mode    string      `json:"mode,omitempty"`  // Subscription mode for subscribe
 	Data    interface{} `json:"data,omitempty"`
 }
 
-// NewHub creates a new Hub instance.
+// NewHub creates a new Hub instance with one delivery shard per CPU.
 func NewHub() *Hub {
-	return &Hub{
-		clients:    make(map[*Client]bool),
+	return NewShardedHub(defaultHubShards())
+}
+
+// NewShardedHub creates a new Hub that fans broadcasts out on n delivery
+// goroutines (at least one).
+func NewShardedHub(n int) *Hub {
+	h := &Hub{
 		register:   make(chan *Client),
 		unregister: make(chan *Client),
-		broadcast:  make(chan []byte, 256),
 		done:       make(chan struct{}),
+
+		seq:    initialSeq(),
+		replay: newReplayRing(defaultReplayMessages, defaultReplayBytes),
+
+		updateInterval: time.Second / defaultUpdateRate,
+		throttled:      make(map[string]*throttledTab),
+
+		compressThreshold: defaultCompressThreshold,
+		clientQueueBytes:  defaultClientQueueBytes,
 	}
+	for i := 0; i < max(n, 1); i++ {
+		h.shards = append(h.shards, newHubShard(h))
+	}
+	return h
 }
 
-// Run starts the hub's main loop.
+// Run starts the hub's main loop. It starts the delivery shards, which
+// register clients, and handles unregistration and shutdown.
 func (h *Hub) Run() {
+	var shards sync.WaitGroup
+	for _, s := range h.shards {
+		shards.Add(1)
+		go func(s *hubShard) {
+			defer shards.Done()
+			s.run()
+		}(s)
+	}
+
 	for {
 		select {
 		case <-h.done:
-			// Shutdown requested, close all clients
-			h.mu.Lock()
-			for client := range h.clients {
-				close(client.send)
-				delete(h.clients, client)
+			// Shutdown requested, close all clients once delivery has stopped
+			shards.Wait()
+			for _, s := range h.shards {
+				s.closeAll()
 			}
-			h.mu.Unlock()
 			return
 
-		case client := <-h.register:
-			h.mu.Lock()
-			h.clients[client] = true
-			h.mu.Unlock()
-
 		case client := <-h.unregister:
-			h.mu.Lock()
-			if _, ok := h.clients[client]; ok {
-				delete(h.clients, client)
-				close(client.send)
-			}
-			h.mu.Unlock()
-
-		case message := <-h.broadcast:
-			h.mu.RLock()
-			for client := range h.clients {
-				select {
-				case client.send <- message:
-				default:
-					// Client buffer full, remove client
-					go func(c *Client) {
-						h.unregister <- c
-					}(client)
-				}
+			for _, s := range h.shards {
+				s.remove(client)
 			}
-			h.mu.RUnlock()
 		}
 	}
 }
 
-// Broadcast sends a message to all connected clients.
+// Broadcast sends a message to all connected clients. Clients subscribed
+// to metadata receive tab content only for the tab they are viewing.
+// tab_updated messages are rate limited per tab (see SetUpdateRate): one
+// arriving too soon after the previous update of its tab is held back and
+// replaced by later ones, so the tab's latest state is sent when its
+// interval ends.
 func (h *Hub) Broadcast(msg WSMessage) {
-	data, err := json.Marshal(msg)
-	if err != nil {
+	h.seqMu.Lock()
+	defer h.seqMu.Unlock()
+
+	if msg.Type == "tab_updated" && h.throttleLocked(msg) {
 		return
 	}
-	h.broadcast <- data
+	h.settleThrottledLocked(&msg)
+	h.publishLocked(msg)
+}
+
+// publishLocked gives a message the next sequence number, keeps it for
+// replay and hands it to every shard. Caller must hold seqMu, so nothing
+// is encoded here; shards build payloads on first use.
+func (h *Hub) publishLocked(msg WSMessage) {
+	h.seq++
+	msg.Seq = h.seq
+	out := h.newOutbound(msg)
+	h.replay.push(out)
+
+	for _, s := range h.shards {
+		s.enqueue(out)
+	}
+}
+
+// newOutbound prepares a message for delivery.
+func (h *Hub) newOutbound(msg WSMessage) *outbound {
+	return &outbound{msg: msg, hasContent: msg.hasContent(), payloads: make(map[payloadKey][]byte)}
+}
+
+// encodeFor returns the payload of a broadcast for one client: the full
+// or metadata view, or the view keeping the client's viewed tab, in the
+// client's encoding and compressed if it negotiated shared deflate. Each
+// payload is built at most once per broadcast, by whichever shard needs
+// it first.
+func (h *Hub) encodeFor(out *outbound, client *Client) []byte {
+	key := payloadKey{view: viewFull, msgpack: client.msgpack}
+	if sub := client.sub.Load(); sub != nil && sub.Metadata && out.hasContent {
+		key.view = viewMeta
+		if out.msg.involves(sub.Viewing) {
+			key.view = sub.Viewing
+		}
+	}
+	message := out.payload(key)
+	if client.deflate {
+		key.deflate = true
+		compressed := out.cached(key, func() []byte { return h.compress(message) })
+		if compressed != nil {
+			return compressed
+		}
+	}
+	return message
+}
+
+// cached returns the payload for key, calling build and storing its result
+// (which may be nil) on first use. Concurrent callers wait for one build.
+func (o *outbound) cached(key payloadKey, build func() []byte) []byte {
+	o.mu.RLock()
+	data, exists := o.payloads[key]
+	o.mu.RUnlock()
+	if exists {
+		return data
+	}
+
+	o.mu.Lock()
+	defer o.mu.Unlock()
+	if data, exists := o.payloads[key]; exists {
+		return data
+	}
+	data = build()
+	o.payloads[key] = data
+	o.chargeLocked(data)
+	return data
+}
+
+// payload returns the uncompressed payload for a view and encoding,
+// building it on first use.
+func (o *outbound) payload(key payloadKey) []byte {
+	return o.cached(key, func() []byte { return o.build(key) })
+}
+
+// build encodes the payload for a view and encoding. Caller must hold o.mu.
+func (o *outbound) build(key payloadKey) []byte {
+	msg := o.msg
+	switch key.view {
+	case viewFull:
+	case viewMeta:
+		msg = o.msg.withContentFor("")
+	default:
+		msg = o.msg.withContentFor(key.view)
+	}
+
+	var data []byte
+	if key.msgpack {
+		data = encodeMsgpack(&msg)
+	} else {
+		var err error
+		if data, err = json.Marshal(msg); err != nil {
+			data = o.payloads[payloadKey{view: viewFull}]
+		}
+	}
+	return data
+}
+
+// hasContent reports whether the message carries tab content.
+func (m *WSMessage) hasContent() bool {
+	if m.Tab != nil || len(m.Tabs) > 0 {
+		return true
+	}
+	return m.Patch != nil && len(m.Patch.Ops) > 0
+}
+
+// involves reports whether the message carries content for the given tab.
+func (m *WSMessage) involves(id string) bool {
+	if id == "" {
+		return false
+	}
+	if (m.Tab != nil && m.Tab.ID == id) || (m.Patch != nil && m.ID == id) {
+		return true
+	}
+	for _, tab := range m.Tabs {
+		if tab.ID == id {
+			return true
+		}
+	}
+	return false
+}
+
+// withContentFor returns a copy of the message with content omitted for
+// every tab except keep ("" omits all).
+func (m WSMessage) withContentFor(keep string) WSMessage {
+	if m.Tab != nil && m.Tab.ID != keep {
+		m.Tab = m.Tab.metadata()
+	}
+	if m.Patch != nil && m.ID != keep {
+		patch := *m.Patch
+		patch.Ops = nil
+		patch.ContentOmitted = true
+		m.Patch = &patch
+	}
+	if len(m.Tabs) > 0 {
+		tabs := make([]*Tab, len(m.Tabs))
+		for i, tab := range m.Tabs {
+			tabs[i] = tab
+			if tab.ID != keep {
+				tabs[i] = tab.metadata()
+			}
+		}
+		m.Tabs = tabs
+	}
+	return m
+}
+
+// Subscribe sets what the client wants pushed.
+func (c *Client) Subscribe(sub Subscription) {
+	c.sub.Store(&sub)
+}
+
+// SetViewing records the tab the client is viewing, keeping its mode.
+func (c *Client) SetViewing(id string) {
+	sub := Subscription{Viewing: id}
+	if prev := c.sub.Load(); prev != nil {
+		sub.Metadata = prev.Metadata
+	}
+	c.sub.Store(&sub)
 }
 
 // ClientCount returns the number of connected clients.
 func (h *Hub) ClientCount() int {
-	h.mu.RLock()
-	defer h.mu.RUnlock()
-	return len(h.clients)
+	n := 0
+	for _, s := range h.shards {
+		n += s.size()
+	}
+	return n
+}
+
+// Stats returns connection, queue and compression counters.
+func (h *Hub) Stats() HubStats {
+	stats := HubStats{
+		SlowDeliveries:         h.queues.queued.Load(),
+		Coalesced:              h.queues.coalesced.Load(),
+		Resyncs:                h.queues.resyncs.Load(),
+		CompressedMessages:     h.compression.messages.Load(),
+		BytesBeforeCompression: h.compression.bytesBefore.Load(),
+		BytesAfterCompression:  h.compression.bytesAfter.Load(),
+		Replays:                h.replays.replays.Load(),
+		ReplayedMessages:       h.replays.replayed.Load(),
+		Snapshots:              h.replays.snapshots.Load(),
+		DeferredUpdates:        h.throttle.deferred.Load(),
+		CoalescedUpdates:       h.throttle.coalesced.Load(),
+	}
+
+	h.seqMu.Lock()
+	stats.Seq = h.seq
+	stats.ReplayBuffered = h.replay.count
+	h.seqMu.Unlock()
+
+	for _, s := range h.shards {
+		s.mu.RLock()
+		stats.Clients += len(s.clients)
+		for client := range s.clients {
+			messages, bytes := client.depth()
+			stats.QueuedMessages += messages
+			stats.QueuedBytes += bytes
+			stats.MaxQueueDepth = max(stats.MaxQueueDepth, messages)
+		}
+		s.mu.RUnlock()
+	}
+	return stats
 }
 
 // Shutdown gracefully stops the hub and closes all client connections.
@@ -120,12 +421,12 @@ func NewClient(hub *Hub, conn *websocket.Conn) *Client {
 	return &Client{
 		hub:  hub,
 		conn: conn,
-		send: make(chan []byte, 256),
+		send: make(chan []byte, clientSendBuffer),
 	}
 }
 
 // ReadPump pumps messages from the WebSocket to the hub.
-func (c *Client) ReadPump(ctx context.Context, onMessage func([]byte)) {
+func (c *Client) ReadPump(ctx context.Context, onMessage func(*Client, []byte)) {
 	defer func() {
 		c.hub.unregister <- c
 		c.conn.Close(websocket.StatusNormalClosure, "")
@@ -137,7 +438,7 @@ func (c *Client) ReadPump(ctx context.Context, onMessage func([]byte)) {
 			return
 		}
 		if onMessage != nil {
-			onMessage(data)
+			onMessage(c, data)
 		}
 	}
 }
@@ -156,12 +457,17 @@ func (c *Client) WritePump(ctx context.Context) {
 			if !ok {
 				return
 			}
+			typ := websocket.MessageText
+			if c.msgpack || (c.deflate && isCompressed(message)) {
+				typ = websocket.MessageBinary
+			}
 			writeCtx, cancel := context.WithTimeout(ctx, 10*time.Second)
-			err := c.conn.Write(writeCtx, websocket.MessageText, message)
+			err := c.conn.Write(writeCtx, typ, message)
 			cancel()
 			if err != nil {
 				return
 			}
+			c.refill()
 
 		case <-ticker.C:
 			// Send ping to keep connection alive
@@ -178,18 +484,48 @@ func (c *Client) WritePump(ctx context.Context) {
 	}
 }
 
-// ServeWS handles WebSocket connections.
-func ServeWS(hub *Hub, w http.ResponseWriter, r *http.Request, onMessage func([]byte)) {
-	conn, err := websocket.Accept(w, r, &websocket.AcceptOptions{
-		OriginPatterns: []string{"localhost:*", "127.0.0.1:*"},
-	})
+// ServeWS handles WebSocket connections. A "subscribe" query parameter
+// ("full" or "metadata") sets the initial subscription mode, and a "since"
+// parameter with the sequence number of the last message received resumes
+// a previous connection (see Hub.Resume).
+//
+// Clients offering DeflateSubprotocol receive large broadcasts compressed
+// once by the hub and shared across connections. Others may negotiate
+// standard permessage-deflate, which compresses messages of at least the
+// same threshold per connection.
+func ServeWS(hub *Hub, w http.ResponseWriter, r *http.Request, onMessage func(*Client, []byte)) {
+	opts := &websocket.AcceptOptions{
+		OriginPatterns:       []string{"localhost:*", "127.0.0.1:*"},
+		Subprotocols:         []string{MsgpackDeflateSubprotocol, MsgpackSubprotocol, DeflateSubprotocol},
+		CompressionMode:      websocket.CompressionNoContextTakeover,
+		CompressionThreshold: hub.compressThreshold,
+	}
+	if wantsSharedDeflate(r) {
+		opts.CompressionMode = websocket.CompressionDisabled
+	}
+	conn, err := websocket.Accept(w, r, opts)
 	if err != nil {
 		http.Error(w, "Failed to upgrade to WebSocket", http.StatusBadRequest)
 		return
 	}
 
 	client := NewClient(hub, conn)
-	hub.register <- client
+	switch conn.Subprotocol() {
+	case MsgpackDeflateSubprotocol:
+		client.msgpack, client.deflate = true, true
+	case MsgpackSubprotocol:
+		client.msgpack = true
+	case DeflateSubprotocol:
+		client.deflate = true
+	}
+	if r.URL.Query().Get("subscribe") == SubscribeMetadata {
+		client.Subscribe(Subscription{Metadata: true})
+	}
+	if since, err := strconv.ParseUint(r.URL.Query().Get("since"), 10, 64); err == nil && since > 0 {
+		hub.Resume(client, since)
+	} else {
+		hub.register <- client
+	}
 
 	ctx := r.Context()
 	go client.WritePump(ctx)
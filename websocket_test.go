@@ -5,6 +5,8 @@ import (
 	"encoding/json"
 	"net/http"
 	"net/http/httptest"
+	"os"
+	"path/filepath"
 	"strings"
 	"sync"
 	"testing"
@@ -20,8 +22,8 @@ func TestNewHub(t *testing.T) {
 	if hub == nil {
 		t.Fatal("NewHub returned nil")
 	}
-	if hub.clients == nil {
-		t.Error("clients map is nil")
+	if len(hub.shards) == 0 {
+		t.Error("hub has no shards")
 	}
 	if hub.register == nil {
 		t.Error("register channel is nil")
@@ -29,9 +31,6 @@ func TestNewHub(t *testing.T) {
 	if hub.unregister == nil {
 		t.Error("unregister channel is nil")
 	}
-	if hub.broadcast == nil {
-		t.Error("broadcast channel is nil")
-	}
 	if hub.done == nil {
 		t.Error("done channel is nil")
 	}
@@ -160,8 +159,9 @@ func TestHubBroadcastToNoClients(t *testing.T) {
 	// Success if no panic
 }
 
-// TestHubBroadcastDropsSlowClient tests that slow clients with full buffers get removed.
-func TestHubBroadcastDropsSlowClient(t *testing.T) {
+// TestHubBroadcastKeepsSlowClient tests that slow clients with full buffers
+// are queued for rather than removed.
+func TestHubBroadcastKeepsSlowClient(t *testing.T) {
 	hub := NewHub()
 	go hub.Run()
 	defer hub.Shutdown()
@@ -173,16 +173,22 @@ func TestHubBroadcastDropsSlowClient(t *testing.T) {
 	hub.register <- slowClient
 	time.Sleep(10 * time.Millisecond)
 
+	// Broadcast - the message waits in the client's queue
+	hub.Broadcast(WSMessage{Type: "test"})
+	time.Sleep(50 * time.Millisecond)
+
 	if hub.ClientCount() != 1 {
-		t.Fatalf("expected 1 client, got %d", hub.ClientCount())
+		t.Fatalf("expected slow client to stay connected, got %d clients", hub.ClientCount())
+	}
+	if stats := hub.Stats(); stats.QueuedMessages != 2 || stats.SlowDeliveries != 1 {
+		t.Errorf("expected 2 waiting messages, 1 slow delivery, got %+v", stats)
 	}
 
-	// Broadcast - the slow client should be scheduled for removal
-	hub.Broadcast(WSMessage{Type: "test"})
-	time.Sleep(50 * time.Millisecond) // Give time for async unregister
-
-	if hub.ClientCount() != 0 {
-		t.Errorf("expected slow client to be removed, got %d clients", hub.ClientCount())
+	<-slowClient.send
+	slowClient.refill()
+	var msg WSMessage
+	if err := json.Unmarshal(<-slowClient.send, &msg); err != nil || msg.Type != "test" {
+		t.Errorf("expected the queued message after draining, got %+v (%v)", msg, err)
 	}
 }
 
@@ -528,7 +534,7 @@ func TestServeWS_ClientMessage(t *testing.T) {
 
 	mux := http.NewServeMux()
 	mux.HandleFunc("GET /ws", func(w http.ResponseWriter, r *http.Request) {
-		ServeWS(srv.hub, w, r, func(data []byte) {
+		ServeWS(srv.hub, w, r, func(_ *Client, data []byte) {
 			var msg WSMessage
 			if json.Unmarshal(data, &msg) == nil {
 				select {
@@ -755,12 +761,17 @@ func TestServerHandleWebSocket_CloseTab(t *testing.T) {
 	go srv.hub.Run()
 	defer srv.hub.Shutdown()
 
-	// Create a tab to delete
-	srv.state.CreateTab(&Tab{
-		ID:    "to-delete",
-		Title: "To Delete",
-		Type:  TabTypeMarkdown,
-	})
+	// Create a followed file tab to delete
+	path := filepath.Join(t.TempDir(), "app.log")
+	if err := os.WriteFile(path, []byte("line\n"), 0644); err != nil {
+		t.Fatal(err)
+	}
+	body := `{"id": "to-delete", "type": "code", "file": "` + path + `", "follow": true}`
+	w := httptest.NewRecorder()
+	srv.handleCreateTab(w, httptest.NewRequest("POST", "/api/tabs", strings.NewReader(body)))
+	if w.Code != http.StatusOK {
+		t.Fatalf("expected status 200, got %d: %s", w.Code, w.Body.String())
+	}
 
 	if srv.state.TabCount() != 1 {
 		t.Fatalf("expected 1 tab, got %d", srv.state.TabCount())
@@ -811,10 +822,16 @@ func TestServerHandleWebSocket_CloseTab(t *testing.T) {
 		t.Errorf("expected ID 'to-delete', got %q", responseMsg.ID)
 	}
 
-	// Verify the tab was deleted
+	// Verify the tab was deleted and its file is no longer watched or followed
 	if srv.state.TabCount() != 0 {
 		t.Errorf("expected 0 tabs after delete, got %d", srv.state.TabCount())
 	}
+	if srv.fileWatcher != nil && srv.fileWatcher.PathForTab("to-delete") != "" {
+		t.Error("expected the closed tab's file to be unwatched")
+	}
+	if _, _, followed := srv.follow.lookup("to-delete"); followed {
+		t.Error("expected the closed tab to be unfollowed")
+	}
 }
 
 // TestServerHandleWebSocket_InvalidMessage tests handling of invalid JSON messages.
@@ -1023,3 +1040,121 @@ func TestServerHandleWebSocket_EmptyID(t *testing.T) {
 		t.Errorf("expected tab to still exist, got %d tabs", srv.state.TabCount())
 	}
 }
+
+// TestHubBroadcast_MetadataSubscription tests that metadata subscribers get
+// content only for the tab they are viewing.
+func TestHubBroadcast_MetadataSubscription(t *testing.T) {
+	hub := NewHub()
+	go hub.Run()
+	defer hub.Shutdown()
+
+	full := &Client{hub: hub, send: make(chan []byte, 16)}
+	viewingA := &Client{hub: hub, send: make(chan []byte, 16)}
+	viewingA.Subscribe(Subscription{Metadata: true, Viewing: "a"})
+	viewingB := &Client{hub: hub, send: make(chan []byte, 16)}
+	viewingB.Subscribe(Subscription{Metadata: true, Viewing: "b"})
+	for _, c := range []*Client{full, viewingA, viewingB} {
+		hub.register <- c
+	}
+
+	recv := func(c *Client) WSMessage {
+		t.Helper()
+		select {
+		case data := <-c.send:
+			var msg WSMessage
+			json.Unmarshal(data, &msg)
+			return msg
+		case <-time.After(time.Second):
+			t.Fatal("timeout waiting for message")
+			return WSMessage{}
+		}
+	}
+
+	hub.Broadcast(WSMessage{Type: "tab_updated", Tab: &Tab{ID: "a", Title: "A", Content: "hello", Version: 3}})
+	if msg := recv(full); msg.Tab.Content != "hello" || msg.Tab.ContentOmitted {
+		t.Errorf("full subscriber: expected content, got %+v", msg.Tab)
+	}
+	if msg := recv(viewingA); msg.Tab.Content != "hello" || msg.Tab.ContentOmitted {
+		t.Errorf("viewer of a: expected content, got %+v", msg.Tab)
+	}
+	if msg := recv(viewingB); msg.Tab.Content != "" || !msg.Tab.ContentOmitted || msg.Tab.Size != 5 || msg.Tab.Version != 3 {
+		t.Errorf("viewer of b: expected metadata only, got %+v", msg.Tab)
+	}
+
+	hub.Broadcast(WSMessage{Type: "tabs_batch", Tabs: []*Tab{{ID: "a", Content: "x"}, {ID: "b", Content: "y"}}})
+	for _, tc := range []struct {
+		client *Client
+		keep   string
+	}{{full, "*"}, {viewingA, "a"}, {viewingB, "b"}} {
+		msg := recv(tc.client)
+		for _, tab := range msg.Tabs {
+			if want := tc.keep == "*" || tab.ID == tc.keep; want == tab.ContentOmitted {
+				t.Errorf("viewing %s: unexpected content for tab %s: %+v", tc.keep, tab.ID, tab)
+			}
+		}
+	}
+
+	patch := &TabPatch{BaseVersion: 3, Version: 4, Ops: []PatchOp{{Op: PatchOpAppend, Text: "!"}}, Size: 6}
+	hub.Broadcast(WSMessage{Type: "tab_patched", ID: "a", Patch: patch})
+	if msg := recv(viewingA); len(msg.Patch.Ops) != 1 || msg.Patch.ContentOmitted {
+		t.Errorf("viewer of a: expected ops, got %+v", msg.Patch)
+	}
+	if msg := recv(viewingB); len(msg.Patch.Ops) != 0 || !msg.Patch.ContentOmitted || msg.Patch.Version != 4 {
+		t.Errorf("viewer of b: expected version-only patch, got %+v", msg.Patch)
+	}
+	recv(full)
+}
+
+// TestServeWS_ViewTab tests subscribing at connect and switching the viewed tab.
+func TestServeWS_ViewTab(t *testing.T) {
+	srv := NewServer()
+	go srv.hub.Run()
+	defer srv.hub.Shutdown()
+
+	mux := http.NewServeMux()
+	mux.HandleFunc("GET /ws", srv.handleWebSocket)
+	ts := httptest.NewServer(mux)
+	defer ts.Close()
+
+	ctx, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+	wsURL := "ws" + strings.TrimPrefix(ts.URL, "http") + "/ws?subscribe=metadata"
+	conn, _, err := websocket.Dial(ctx, wsURL, nil)
+	if err != nil {
+		t.Fatalf("failed to connect: %v", err)
+	}
+	defer conn.Close(websocket.StatusNormalClosure, "")
+
+	readTab := func() *Tab {
+		t.Helper()
+		_, data, err := conn.Read(ctx)
+		if err != nil {
+			t.Fatalf("failed to read: %v", err)
+		}
+		var msg WSMessage
+		json.Unmarshal(data, &msg)
+		return msg.Tab
+	}
+
+	time.Sleep(50 * time.Millisecond)
+	srv.hub.Broadcast(WSMessage{Type: "tab_updated", Tab: &Tab{ID: "a", Content: "content"}})
+	if tab := readTab(); !tab.ContentOmitted {
+		t.Errorf("expected metadata only before viewing, got %+v", tab)
+	}
+
+	msgData, _ := json.Marshal(WSMessage{Type: "view_tab", ID: "a"})
+	conn.Write(ctx, websocket.MessageText, msgData)
+	time.Sleep(50 * time.Millisecond)
+	srv.hub.Broadcast(WSMessage{Type: "tab_updated", Tab: &Tab{ID: "a", Content: "content"}})
+	if tab := readTab(); tab.ContentOmitted || tab.Content != "content" {
+		t.Errorf("expected content for viewed tab, got %+v", tab)
+	}
+
+	msgData, _ = json.Marshal(WSMessage{Type: "subscribe", Mode: SubscribeFull})
+	conn.Write(ctx, websocket.MessageText, msgData)
+	time.Sleep(50 * time.Millisecond)
+	srv.hub.Broadcast(WSMessage{Type: "tab_updated", Tab: &Tab{ID: "b", Content: "other"}})
+	if tab := readTab(); tab.ContentOmitted || tab.Content != "other" {
+		t.Errorf("expected content after opting into full pushes, got %+v", tab)
+	}
+}